@@ -0,0 +1,112 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "backpressure.h"
+#include "protocol.h"
+
+
+static uint8_t reason_index(AppMessageResult reason) {
+  uint8_t index = 0;
+  uint32_t bits = (uint32_t)reason;
+
+  while (bits > 1 && index < BACKPRESSURE_REASON_COUNT - 1) {
+    bits >>= 1;
+    index++;
+  }
+
+  return index;
+}
+
+void backpressure_init(Backpressure *backpressure) {
+  memset(backpressure, 0, sizeof(Backpressure));
+  backpressure->retry_after_ms = BACKPRESSURE_MIN_RETRY_MS;
+}
+
+/**
+ * Room for a burst of the largest inbound messages, as far as the firmware
+ * allows. The size is advertised in HELLO, so the phone keeps its bursts
+ * (and batches) within it.
+ */
+uint32_t backpressure_inbox_size(uint32_t inbox_size_maximum) {
+  uint32_t size = INBOX_MESSAGE_SIZE * INBOX_BURST_MESSAGES;
+
+  return size < inbox_size_maximum ? size : inbox_size_maximum;
+}
+
+/**
+ * Count the drop and return the delay the phone should hold off for.
+ */
+uint16_t backpressure_on_drop(Backpressure *backpressure, AppMessageResult reason,
+  int64_t now_ms) {
+
+  backpressure->dropped[reason_index(reason)]++;
+
+  if (backpressure->last_drop_ms == 0
+    || now_ms - backpressure->last_drop_ms > BACKPRESSURE_QUIET_MS) {
+
+    backpressure->retry_after_ms = BACKPRESSURE_MIN_RETRY_MS;
+  } else if (backpressure->unreported == 0) {
+    // The phone was told and still overruns the inbox.
+    backpressure->retry_after_ms = backpressure->retry_after_ms < BACKPRESSURE_MAX_RETRY_MS / 2
+      ? 2 * backpressure->retry_after_ms : BACKPRESSURE_MAX_RETRY_MS;
+  }
+
+  backpressure->last_drop_ms = now_ms;
+  backpressure->unreported++;
+
+  return backpressure->retry_after_ms;
+}
+
+bool backpressure_is_backoff_due(const Backpressure *backpressure) {
+  return backpressure->unreported > 0;
+}
+
+void backpressure_write_backoff(Backpressure *backpressure, DictionaryIterator *iter) {
+  Tuplet cmd_tuplet = TupletInteger(SEND_CMD_KEY, (uint8_t)SEND_CMD_BACKOFF);
+  Tuplet retry_after_tuplet = TupletInteger(SEND_RETRY_AFTER_MS_KEY,
+    backpressure->retry_after_ms);
+  Tuplet dropped_tuplet = TupletInteger(SEND_DROPPED_KEY, backpressure->unreported);
+
+  dict_write_tuplet(iter, &cmd_tuplet);
+  dict_write_tuplet(iter, &retry_after_tuplet);
+  dict_write_tuplet(iter, &dropped_tuplet);
+
+  backpressure->unreported = 0;
+}
+
+uint16_t backpressure_drops(const Backpressure *backpressure, AppMessageResult reason) {
+  return backpressure->dropped[reason_index(reason)];
+}
+
+uint32_t backpressure_total_drops(const Backpressure *backpressure) {
+  uint32_t total = 0;
+
+  for (uint8_t i = 0; i < BACKPRESSURE_REASON_COUNT; i++) {
+    total += backpressure->dropped[i];
+  }
+
+  return total;
+}
+
+const char *backpressure_reason_name(AppMessageResult reason) {
+  switch (reason) {
+    case APP_MSG_OK: return "ok";
+    case APP_MSG_SEND_TIMEOUT: return "send timeout";
+    case APP_MSG_SEND_REJECTED: return "send rejected";
+    case APP_MSG_NOT_CONNECTED: return "not connected";
+    case APP_MSG_APP_NOT_RUNNING: return "app not running";
+    case APP_MSG_INVALID_ARGS: return "invalid args";
+    case APP_MSG_BUSY: return "busy";
+    case APP_MSG_BUFFER_OVERFLOW: return "buffer overflow";
+    case APP_MSG_ALREADY_RELEASED: return "already released";
+    case APP_MSG_CALLBACK_ALREADY_REGISTERED: return "callback already registered";
+    case APP_MSG_CALLBACK_NOT_REGISTERED: return "callback not registered";
+    case APP_MSG_OUT_OF_MEMORY: return "out of memory";
+    case APP_MSG_CLOSED: return "closed";
+    case APP_MSG_INTERNAL_ERROR: return "internal error";
+    case APP_MSG_INVALID_STATE: return "invalid state";
+    default: return "?";
+  }
+}
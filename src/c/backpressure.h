@@ -0,0 +1,51 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+/**
+ * The largest message the phone sends (SET under the legacy keys with all
+ * the timestamps, the largest score CRDT and the sport) and how many of
+ * them the inbox should hold, so a burst is queued instead of dropped.
+ */
+#define INBOX_MESSAGE_SIZE 176
+#define INBOX_BURST_MESSAGES 4
+
+#define BACKPRESSURE_MIN_RETRY_MS 100
+#define BACKPRESSURE_MAX_RETRY_MS 3200
+#define BACKPRESSURE_QUIET_MS 2000
+
+/**
+ * AppMessageResult values are single bits, counted by the bit position.
+ */
+#define BACKPRESSURE_REASON_COUNT 16
+
+/**
+ * Inbound messages dropped by the firmware, and how long the phone is asked
+ * to hold off before sending again (see BACKOFF in protocol.h). The delay
+ * starts at BACKPRESSURE_MIN_RETRY_MS and doubles whenever the phone
+ * overruns the inbox again after being told, until there has been
+ * no drop for BACKPRESSURE_QUIET_MS.
+ */
+typedef struct {
+  uint16_t dropped[BACKPRESSURE_REASON_COUNT];
+  int64_t last_drop_ms;
+  uint16_t retry_after_ms;
+  /**
+   * Drops since the last BACKOFF sent, 0 when the phone knows about all.
+   */
+  uint16_t unreported;
+} Backpressure;
+
+void backpressure_init(Backpressure *backpressure);
+uint32_t backpressure_inbox_size(uint32_t inbox_size_maximum);
+uint16_t backpressure_on_drop(Backpressure *backpressure, AppMessageResult reason,
+  int64_t now_ms);
+bool backpressure_is_backoff_due(const Backpressure *backpressure);
+void backpressure_write_backoff(Backpressure *backpressure, DictionaryIterator *iter);
+uint16_t backpressure_drops(const Backpressure *backpressure, AppMessageResult reason);
+uint32_t backpressure_total_drops(const Backpressure *backpressure);
+const char *backpressure_reason_name(AppMessageResult reason);
@@ -0,0 +1,100 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+/**
+ * Compile-time switches set by the build profile in wscript.
+ * The defaults correspond to the debug profile.
+ */
+
+/**
+ * Log messages with a level above SC_LOG_LEVEL are compiled out together
+ * with their format strings. The level is one of AppLogLevel values.
+ */
+#ifndef SC_LOG_LEVEL
+#define SC_LOG_LEVEL APP_LOG_LEVEL_DEBUG_VERBOSE
+#endif
+
+#define SC_LOG(level, fmt, args...) \
+  do { \
+    if ((level) <= SC_LOG_LEVEL) { \
+      APP_LOG(level, fmt, ## args); \
+    } \
+  } while (0)
+
+/**
+ * Redraw accounting per input event, see redraw_stats.h. When enabled, the
+ * SDK calls that make a layer repaint are wrapped to record the layer and
+ * the calling function (their arguments are evaluated twice).
+ */
+#ifndef SC_REDRAW_STATS
+#define SC_REDRAW_STATS 0
+#endif
+
+#if SC_REDRAW_STATS
+#include "redraw_stats.h"
+
+#define SC_REDRAW_EVENT(event) redraw_stats_begin(event)
+#define SC_REDRAW_SUMMARY() redraw_stats_log_summary()
+
+#ifndef REDRAW_STATS_IMPL
+#define layer_mark_dirty(layer) \
+  (redraw_stats_record((layer), __func__), layer_mark_dirty(layer))
+#define layer_add_child(parent, child) \
+  (redraw_stats_record((child), __func__), layer_add_child((parent), (child)))
+#define text_layer_set_text(text_layer, text) \
+  (redraw_stats_record(text_layer_get_layer(text_layer), __func__), \
+    text_layer_set_text((text_layer), (text)))
+#define text_layer_set_background_color(text_layer, color) \
+  (redraw_stats_record(text_layer_get_layer(text_layer), __func__), \
+    text_layer_set_background_color((text_layer), (color)))
+#define window_set_background_color(window, color) \
+  (redraw_stats_record(window_get_root_layer(window), __func__), \
+    window_set_background_color((window), (color)))
+#endif
+
+#else
+#define SC_REDRAW_EVENT(event) do {} while (0)
+#define SC_REDRAW_SUMMARY() do {} while (0)
+#endif
+
+/**
+ * Launch profile, see launch_profile.h: the phases of a cold start are
+ * timestamped and logged once the app is fully up.
+ */
+#ifndef SC_LAUNCH_PROFILE
+#define SC_LAUNCH_PROFILE 0
+#endif
+
+#if SC_LAUNCH_PROFILE
+#include "launch_profile.h"
+
+#define SC_LAUNCH_MARK(phase) launch_profile_mark(phase)
+#define SC_LAUNCH_SUMMARY() launch_profile_log_summary()
+#else
+#define SC_LAUNCH_MARK(phase) do {} while (0)
+#define SC_LAUNCH_SUMMARY() do {} while (0)
+#endif
+
+/**
+ * Input trace, see trace_recorder.h: the clicks, the inbound messages and
+ * the link changes are recorded to a ring in RAM, exported when the phone
+ * asks for it. Compiled in unless SC_TRACE is 0.
+ */
+#ifndef SC_TRACE
+#define SC_TRACE 1
+#endif
+
+#if SC_TRACE
+#include "trace_recorder.h"
+
+#define SC_TRACE_INPUT(type, arg, data, size) trace_recorder_add_input(type, arg, data, size)
+#define SC_TRACE_EVENT(type, arg, data, size) trace_recorder_add(type, arg, data, size)
+#else
+#define SC_TRACE_INPUT(type, arg, data, size) do {} while (0)
+#define SC_TRACE_EVENT(type, arg, data, size) do {} while (0)
+#endif
@@ -0,0 +1,121 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "clock_sync.h"
+
+
+/**
+ * Link quality of one probe, 100 for a fast round trip, 0 for a lost probe.
+ */
+static uint8_t probe_quality(int32_t rtt_ms) {
+  if (rtt_ms <= CLOCK_SYNC_RTT_GOOD_MS) {
+    return 100;
+  }
+  if (rtt_ms >= CLOCK_SYNC_RTT_BAD_MS) {
+    return 0;
+  }
+
+  return 100 - (rtt_ms - CLOCK_SYNC_RTT_GOOD_MS) * 100 
+    / (CLOCK_SYNC_RTT_BAD_MS - CLOCK_SYNC_RTT_GOOD_MS);
+}
+
+void clock_sync_init(ClockSync *clock_sync) {
+  memset(clock_sync, 0, sizeof(ClockSync));
+}
+
+int64_t clock_sync_now_ms() {
+  time_t seconds;
+  uint16_t millis;
+
+  time_ms(&seconds, &millis);
+
+  return (int64_t)seconds * 1000 + millis;
+}
+
+void clock_sync_on_probe_sent(ClockSync *clock_sync, int64_t t0) {
+  clock_sync->pending_t0 = t0;
+}
+
+/**
+ * Update the estimates from a pong. Return false for a pong that does not
+ * answer the pending ping.
+ */
+bool clock_sync_on_pong(ClockSync *clock_sync, int64_t t0, int64_t t1, int64_t t2, 
+  int64_t t3) {
+
+  if (clock_sync->pending_t0 == 0 || t0 != clock_sync->pending_t0) {
+    return false;
+  }
+  clock_sync->pending_t0 = 0;
+
+  int32_t rtt = (int32_t)((t3 - t0) - (t2 - t1));
+  int32_t offset = (int32_t)(((t1 - t0) + (t2 - t3)) / 2);
+
+  if (rtt < 0) {
+    rtt = 0;
+  }
+  if (rtt > UINT16_MAX) {
+    rtt = UINT16_MAX;
+  }
+
+  if (clock_sync->samples == 0) {
+    clock_sync->rtt_ms = rtt;
+    clock_sync->offset_ms = offset;
+    clock_sync->link_quality = probe_quality(rtt);
+  } else {
+    // A slow round trip is likely asymmetric, so its offset is not trusted.
+    if (rtt <= 2 * clock_sync->rtt_ms) {
+      clock_sync->offset_ms += (offset - clock_sync->offset_ms) / 4;
+    }
+    clock_sync->rtt_ms += (rtt - (int32_t)clock_sync->rtt_ms) / 8;
+    clock_sync->link_quality += 
+      ((int16_t)probe_quality(rtt) - clock_sync->link_quality) / 4;
+  }
+
+  clock_sync->last_rtt_ms = rtt;
+  if (clock_sync->samples < UINT8_MAX) {
+    clock_sync->samples++;
+  }
+
+  return true;
+}
+
+void clock_sync_on_probe_lost(ClockSync *clock_sync) {
+  clock_sync->pending_t0 = 0;
+  clock_sync->link_quality -= clock_sync->link_quality / 4;
+}
+
+bool clock_sync_is_probe_pending(const ClockSync *clock_sync) {
+  return clock_sync->pending_t0 != 0;
+}
+
+int64_t clock_sync_local_to_shared_ms(const ClockSync *clock_sync, int64_t local_ms) {
+  return local_ms + clock_sync->offset_ms;
+}
+
+int64_t clock_sync_shared_to_local_ms(const ClockSync *clock_sync, int64_t shared_ms) {
+  return shared_ms - clock_sync->offset_ms;
+}
+
+/**
+ * Millisecond timestamps travel as 8 byte little endian byte arrays.
+ */
+void clock_sync_write_timestamp(int64_t timestamp_ms, uint8_t *buff) {
+  uint64_t value = (uint64_t)timestamp_ms;
+
+  for (uint8_t i = 0; i < CLOCK_SYNC_TIMESTAMP_SIZE; i++) {
+    buff[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+int64_t clock_sync_read_timestamp(const uint8_t *buff) {
+  uint64_t value = 0;
+
+  for (uint8_t i = 0; i < CLOCK_SYNC_TIMESTAMP_SIZE; i++) {
+    value |= (uint64_t)buff[i] << (8 * i);
+  }
+
+  return (int64_t)value;
+}
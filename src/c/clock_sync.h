@@ -0,0 +1,41 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+#define CLOCK_SYNC_RTT_GOOD_MS 100
+#define CLOCK_SYNC_RTT_BAD_MS 2000
+#define CLOCK_SYNC_TIMESTAMP_SIZE 8
+
+/**
+ * Round-trip time and clock offset between the watch and the phone,
+ * estimated NTP-style from ping/pong exchanges:
+ *   t0 - ping sent (watch clock)    t1 - ping received (phone clock)
+ *   t2 - pong sent (phone clock)    t3 - pong received (watch clock)
+ *   rtt = (t3 - t0) - (t2 - t1)     offset = ((t1 - t0) + (t2 - t3)) / 2
+ * The phone clock is the shared timeline, offset_ms = phone - watch.
+ * All the figures are exponentially smoothed.
+ */
+typedef struct {
+  int64_t pending_t0;
+  int32_t offset_ms;
+  uint16_t rtt_ms;
+  uint16_t last_rtt_ms;
+  uint8_t link_quality;
+  uint8_t samples;
+} ClockSync;
+
+void clock_sync_init(ClockSync *clock_sync);
+int64_t clock_sync_now_ms();
+void clock_sync_on_probe_sent(ClockSync *clock_sync, int64_t t0);
+bool clock_sync_on_pong(ClockSync *clock_sync, int64_t t0, int64_t t1, int64_t t2, 
+  int64_t t3);
+void clock_sync_on_probe_lost(ClockSync *clock_sync);
+bool clock_sync_is_probe_pending(const ClockSync *clock_sync);
+int64_t clock_sync_local_to_shared_ms(const ClockSync *clock_sync, int64_t local_ms);
+int64_t clock_sync_shared_to_local_ms(const ClockSync *clock_sync, int64_t shared_ms);
+void clock_sync_write_timestamp(int64_t timestamp_ms, uint8_t *buff);
+int64_t clock_sync_read_timestamp(const uint8_t *buff);
@@ -1,5 +1,6 @@
 #include "custom_status_bar.h"
 #include "pebble.h"
+#include "build_config.h"
 
 #ifndef PEBBLE_HEIGHT
 #define PEBBLE_HEIGHT 168
@@ -17,11 +18,13 @@ typedef struct {
     TextLayer* left_text;
     TextLayer* center_text;
     TextLayer* right_text;
+#if CSB_ENABLE_BITMAPS
     BitmapLayer* icon_0;
     BitmapLayer* icon_1;
     BitmapLayer* icon_2;
     BitmapLayer* icon_3;
     BitmapLayer* icon_4;
+#endif
 } CustomStatusBarLayerHidden;
 
 static void update_proc(Layer* layer, GContext *context);
@@ -29,7 +32,7 @@ static void update_proc(Layer* layer, GContext *context);
 CustomStatusBarLayer * custom_status_bar_layer_create(uint8_t height, GColor bar_colour, uint8_t icon_width){
 
     if(icon_width > MAX_ICON_WIDTH){
-        APP_LOG(APP_LOG_LEVEL_ERROR, "ERROR: ICON WIDTH TOO LARGE. SEE MAX_ICON_WIDTH. STATUS BAR NOT CREATED. RETURNING NULL.");
+        SC_LOG(APP_LOG_LEVEL_ERROR, "ERROR: ICON WIDTH TOO LARGE. SEE MAX_ICON_WIDTH. STATUS BAR NOT CREATED. RETURNING NULL.");
         return NULL;
     }
 
@@ -43,7 +46,7 @@ CustomStatusBarLayer * custom_status_bar_layer_create(uint8_t height, GColor bar
 
     CustomStatusBarLayer* status_bar = layer_create_with_data(frame, sizeof(CustomStatusBarLayerHidden));
     if (status_bar == NULL) {
-        APP_LOG(APP_LOG_LEVEL_ERROR, "OOM Couldn't create custom status bar.");
+        SC_LOG(APP_LOG_LEVEL_ERROR, "OOM Couldn't create custom status bar.");
     }
 
     // Get status hidden pointer
@@ -65,11 +68,13 @@ CustomStatusBarLayer * custom_status_bar_layer_create(uint8_t height, GColor bar
     status_hidden->left_text = NULL;
     status_hidden->center_text = NULL;
     status_hidden->right_text = NULL;
+#if CSB_ENABLE_BITMAPS
     status_hidden->icon_0 = NULL;
     status_hidden->icon_1 = NULL;
     status_hidden->icon_2 = NULL;
     status_hidden->icon_3 = NULL;
     status_hidden->icon_4 = NULL;
+#endif
 
     return status_bar;
 }
@@ -81,21 +86,25 @@ void custom_status_bar_layer_destroy(CustomStatusBarLayer* custom_status_bar_lay
     if(status_hidden->left_text != NULL) text_layer_destroy(status_hidden->left_text);
     if(status_hidden->right_text != NULL) text_layer_destroy(status_hidden->right_text);
     if(status_hidden->center_text != NULL) text_layer_destroy(status_hidden->center_text);
+#if CSB_ENABLE_BITMAPS
     if(status_hidden->icon_0 != NULL) bitmap_layer_destroy(status_hidden->icon_0);
     if(status_hidden->icon_1 != NULL) bitmap_layer_destroy(status_hidden->icon_1);
     if(status_hidden->icon_2 != NULL) bitmap_layer_destroy(status_hidden->icon_2);
     if(status_hidden->icon_3 != NULL) bitmap_layer_destroy(status_hidden->icon_3);
     if(status_hidden->icon_4 != NULL) bitmap_layer_destroy(status_hidden->icon_4);
+#endif
 
     if(custom_status_bar_layer != NULL) layer_destroy(custom_status_bar_layer);
 
 }
 
+#if CSB_ENABLE_EXTRAS
 void custom_status_bar_layer_set_height(CustomStatusBarLayer* custom_status_bar_layer, uint32_t height){
     CustomStatusBarLayerHidden* status_hidden = (CustomStatusBarLayerHidden*) layer_get_data(custom_status_bar_layer);
     status_hidden->height = height;
     layer_mark_dirty(custom_status_bar_layer);
 }
+#endif
 
 void custom_status_bar_layer_set_text(CustomStatusBarLayer* custom_status_bar_layer, CsbTextPosition position, char * status_bar_text){
 
@@ -162,6 +171,7 @@ void custom_status_bar_layer_set_text_font(CustomStatusBarLayer* custom_status_b
 
 }
 
+#if CSB_ENABLE_EXTRAS
 void custom_status_bar_layer_set_text_hidden(CustomStatusBarLayer* custom_status_bar_layer, CsbTextPosition position, bool hidden){
 
     CustomStatusBarLayerHidden* status_hidden = (CustomStatusBarLayerHidden*) layer_get_data(custom_status_bar_layer);
@@ -181,7 +191,9 @@ void custom_status_bar_layer_set_text_hidden(CustomStatusBarLayer* custom_status
     } 
 
 }
+#endif
 
+#if CSB_ENABLE_BITMAPS
 void custom_status_bar_layer_set_bitmap(CustomStatusBarLayer* custom_status_bar_layer, CsbIconPosition position, GBitmap* gbitmap){
 
     CustomStatusBarLayerHidden* status_hidden = (CustomStatusBarLayerHidden*) layer_get_data(custom_status_bar_layer);
@@ -265,7 +277,9 @@ void custom_status_bar_layer_set_bitmap_hidden(CustomStatusBarLayer* custom_stat
         break;
     } 
 }
+#endif
 
+#if CSB_ENABLE_EXTRAS
 void custom_status_bar_layer_set_all_text_hidden(CustomStatusBarLayer* custom_status_bar_layer, bool hidden){
     
     CustomStatusBarLayerHidden* status_hidden = (CustomStatusBarLayerHidden*) layer_get_data(custom_status_bar_layer);
@@ -275,7 +289,9 @@ void custom_status_bar_layer_set_all_text_hidden(CustomStatusBarLayer* custom_st
     layer_set_hidden(text_layer_get_layer(status_hidden->center_text), hidden);  
 
 }
+#endif
 
+#if CSB_ENABLE_BITMAPS
 void custom_status_bar_layer_set_all_bitmaps_hidden(CustomStatusBarLayer* custom_status_bar_layer, bool hidden){
 
     CustomStatusBarLayerHidden* status_hidden = (CustomStatusBarLayerHidden*) layer_get_data(custom_status_bar_layer);
@@ -287,6 +303,7 @@ void custom_status_bar_layer_set_all_bitmaps_hidden(CustomStatusBarLayer* custom
     layer_set_hidden(bitmap_layer_get_layer(status_hidden->icon_4), hidden);
 
 }
+#endif
 
 static void update_proc(Layer* layer, GContext *context) {
 
@@ -4,6 +4,15 @@ typedef struct Layer CustomStatusBarLayer;
 
 #define MAX_ICON_WIDTH 28
 
+//Optional features, switched off by the release build profile to save code size and RAM
+#ifndef CSB_ENABLE_BITMAPS
+#define CSB_ENABLE_BITMAPS 1
+#endif
+
+#ifndef CSB_ENABLE_EXTRAS
+#define CSB_ENABLE_EXTRAS 1
+#endif
+
 typedef enum {
   CSB_TEXT_LEFT,
   CSB_TEXT_RIGHT,
@@ -24,10 +33,15 @@ CustomStatusBarLayer * custom_status_bar_layer_create(uint8_t height, GColor bar
 void custom_status_bar_layer_destroy(CustomStatusBarLayer* custom_status_bar_layer);
 void custom_status_bar_layer_set_text(CustomStatusBarLayer* custom_status_bar_layer, CsbTextPosition position, char* status_bar_text);
 void custom_status_bar_layer_set_text_font(CustomStatusBarLayer* custom_status_bar_layer, CsbTextPosition position, GFont font);
+#if CSB_ENABLE_EXTRAS
+void custom_status_bar_layer_set_height(CustomStatusBarLayer* custom_status_bar_layer, uint32_t height);
 void custom_status_bar_layer_set_text_hidden(CustomStatusBarLayer* custom_status_bar_layer, CsbTextPosition position, bool hidden);
+void custom_status_bar_layer_set_all_text_hidden(CustomStatusBarLayer* custom_status_bar_layer, bool hidden);
+#endif
+#if CSB_ENABLE_BITMAPS
 void custom_status_bar_layer_set_bitmap(CustomStatusBarLayer* custom_status_bar_layer, CsbIconPosition position, GBitmap* gbitmap);
 void custom_status_bar_layer_set_bitmap_hidden(CustomStatusBarLayer* custom_status_bar_layer, CsbIconPosition position, bool hidden);
-void custom_status_bar_layer_set_all_text_hidden(CustomStatusBarLayer* custom_status_bar_layer, bool hidden);
 void custom_status_bar_layer_set_all_bitmaps_hidden(CustomStatusBarLayer* custom_status_bar_layer, bool hidden);
+#endif
 bool color_equals(GColor color1, GColor color2);
 
@@ -0,0 +1,99 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "event_log.h"
+#include "clock_sync.h"
+
+
+static void write_uint16(uint8_t *buff, uint16_t value) {
+  buff[0] = (uint8_t)value;
+  buff[1] = (uint8_t)(value >> 8);
+}
+
+void event_log_open(EventLog *log, uint32_t tag, uint32_t seq_key) {
+  memset(log, 0, sizeof(EventLog));
+  log->seq_key = seq_key;
+  if (persist_exists(seq_key)) {
+    log->next_seq = (uint16_t)persist_read_int(seq_key);
+  }
+  log->stored_seq = log->next_seq;
+
+  // Buffered, the system batches the records before writing them out.
+  log->session = data_logging_create(tag, DATA_LOGGING_BYTE_ARRAY, EVENT_LOG_RECORD_SIZE, 
+    true);
+}
+
+void event_log_add(EventLog *log, const ScoreEvent *event) {
+  if (log->pending_count == EVENT_LOG_PENDING_RECORDS) {
+    memmove(log->pending, log->pending + EVENT_LOG_RECORD_SIZE, 
+      (EVENT_LOG_PENDING_RECORDS - 1) * EVENT_LOG_RECORD_SIZE);
+    log->pending_count--;
+    log->dropped++;
+  }
+
+  if (log->next_seq == log->stored_seq) {
+    log->stored_seq += EVENT_LOG_SEQ_RESERVE;
+    persist_write_int(log->seq_key, log->stored_seq);
+  }
+
+  uint8_t *record = log->pending + log->pending_count * EVENT_LOG_RECORD_SIZE;
+
+  clock_sync_write_timestamp(event->timestamp_ms, record);
+  write_uint16(record + 8, log->next_seq++);
+  record[10] = (uint8_t)event->type;
+  record[11] = event->detail;
+  write_uint16(record + 12, event->score_1);
+  write_uint16(record + 14, event->score_2);
+
+  log->pending_count++;
+}
+
+/**
+ * Log the pending records. Return false when they have to wait, the session
+ * is busy.
+ */
+bool event_log_flush(EventLog *log) {
+  if (log->pending_count == 0) {
+    return true;
+  }
+  if (log->session == NULL) {
+    log->dropped += log->pending_count;
+    log->pending_count = 0;
+    return true;
+  }
+
+  DataLoggingResult result = data_logging_log(log->session, log->pending, log->pending_count);
+
+  if (result == DATA_LOGGING_BUSY) {
+    return false;
+  }
+
+  if (result == DATA_LOGGING_SUCCESS) {
+    log->logged += log->pending_count;
+  } else {
+    // Full or closed, these records won't get through.
+    log->dropped += log->pending_count;
+  }
+  log->pending_count = 0;
+
+  return true;
+}
+
+/**
+ * A log never opened has nothing to store.
+ */
+void event_log_close(EventLog *log) {
+  event_log_flush(log);
+
+  if (log->next_seq != log->stored_seq) {
+    persist_write_int(log->seq_key, log->next_seq);
+    log->stored_seq = log->next_seq;
+  }
+
+  if (log->session != NULL) {
+    data_logging_finish(log->session);
+    log->session = NULL;
+  }
+}
@@ -0,0 +1,83 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+/**
+ * Record layout: timestamp in ms in the shared timeline (8 bytes), sequence
+ * number (2 bytes), ScoreEventType (1 byte), detail (1 byte), score_1 and
+ * score_2 in the transferred orientation (2 bytes each), all little endian.
+ */
+#define EVENT_LOG_RECORD_SIZE 16
+#define EVENT_LOG_PENDING_RECORDS 8
+
+/**
+ * Sequence numbers stored ahead at a time, see EventLog.
+ */
+#define EVENT_LOG_SEQ_RESERVE 32
+
+typedef enum {
+  /**
+   * Detail: the team scored, 0 for score_1, 1 for score_2.
+   */
+  SCORE_EVENT_POINT = 1,
+  /**
+   * Detail: the team the point was taken back from.
+   */
+  SCORE_EVENT_TAKE_BACK = 2,
+  SCORE_EVENT_RESET = 3,
+  SCORE_EVENT_SWAP = 4,
+  /**
+   * Detail: the user role (high 4 bits) and the Score Counter position
+   * relative to the user (low 4 bits) confirmed in the setting mode.
+   */
+  SCORE_EVENT_MODE = 5,
+  /**
+   * Score set by the phone.
+   */
+  SCORE_EVENT_REMOTE = 6
+} ScoreEventType;
+
+typedef struct {
+  int64_t timestamp_ms;
+  ScoreEventType type;
+  uint8_t detail;
+  uint16_t score_1;
+  uint16_t score_2;
+} ScoreEvent;
+
+/**
+ * Score events exported to the phone through data logging, off the
+ * AppMessage link: the system stores the records and delivers them in
+ * batches whenever it suits it, so the history never holds up a live score
+ * update in the outbox.
+ *
+ * Events are only encoded in RAM when they happen and logged together by
+ * event_log_flush(). While the session is busy they wait, the oldest one
+ * dropped when there are more than EVENT_LOG_PENDING_RECORDS.
+ */
+typedef struct {
+  DataLoggingSessionRef session;
+  uint8_t pending[EVENT_LOG_PENDING_RECORDS * EVENT_LOG_RECORD_SIZE];
+  uint8_t pending_count;
+  /**
+   * Sequence number of the next record, so the phone notices gaps. It goes
+   * on across launches: the number stored under seq_key is never below the
+   * ones already used, EVENT_LOG_SEQ_RESERVE of them are stored ahead, and
+   * the exact one on closing. After a crash the numbers skip the rest of
+   * what was stored ahead, but never repeat.
+   */
+  uint16_t next_seq;
+  uint16_t stored_seq;
+  uint32_t seq_key;
+  uint32_t logged;
+  uint32_t dropped;
+} EventLog;
+
+void event_log_open(EventLog *log, uint32_t tag, uint32_t seq_key);
+void event_log_add(EventLog *log, const ScoreEvent *event);
+bool event_log_flush(EventLog *log);
+void event_log_close(EventLog *log);
@@ -0,0 +1,295 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "inbox_decoder.h"
+#include "protocol.h"
+#include "clock_sync.h"
+#include "link_caps.h"
+#include "pn_counter.h"
+#include "sport_rules.h"
+
+
+/**
+ * Read an integer tuple of any width the phone may use. Negative values
+ * are out of range for all the fields.
+ */
+static InboxDecodeResult read_uint(const Tuple *tuple, uint32_t max, uint32_t *value) {
+  if (tuple->type != TUPLE_UINT && tuple->type != TUPLE_INT) {
+    return INBOX_ERR_BAD_TYPE;
+  }
+
+  int64_t raw;
+
+  switch (tuple->length) {
+    case 1:
+      raw = tuple->type == TUPLE_UINT ? tuple->value->uint8 : tuple->value->int8;
+      break;
+    case 2:
+      raw = tuple->type == TUPLE_UINT ? tuple->value->uint16 : tuple->value->int16;
+      break;
+    case 4:
+      raw = tuple->type == TUPLE_UINT 
+        ? (int64_t)tuple->value->uint32 : (int64_t)tuple->value->int32;
+      break;
+    default:
+      return INBOX_ERR_BAD_LENGTH;
+  }
+
+  if (raw < 0 || raw > max) {
+    return INBOX_ERR_OUT_OF_RANGE;
+  }
+
+  *value = (uint32_t)raw;
+
+  return INBOX_OK;
+}
+
+static InboxDecodeResult read_timestamp_ms(const Tuple *tuple, int64_t *value) {
+  if (tuple->type != TUPLE_BYTE_ARRAY) {
+    return INBOX_ERR_BAD_TYPE;
+  }
+  if (tuple->length != CLOCK_SYNC_TIMESTAMP_SIZE) {
+    return INBOX_ERR_BAD_LENGTH;
+  }
+
+  *value = clock_sync_read_timestamp(tuple->value->data);
+
+  return INBOX_OK;
+}
+
+/**
+ * PACKED_SCORE stands for the score and timestamp keys.
+ */
+static InboxDecodeResult read_packed_score(InboxDecoder *decoder, const Tuple *tuple, 
+  InboxCommand *command) {
+
+  if (tuple->type != TUPLE_BYTE_ARRAY) {
+    return INBOX_ERR_BAD_TYPE;
+  }
+  if (tuple->length != PACKED_SCORE_SIZE) {
+    return INBOX_ERR_BAD_LENGTH;
+  }
+
+  int64_t timestamp_ms;
+  link_caps_read_packed_score(tuple->value->data, &command->score_1, &command->score_2, 
+    &timestamp_ms);
+
+  if (command->score_1 > decoder->max_score || command->score_2 > decoder->max_score 
+    || timestamp_ms < 0 || timestamp_ms / 1000 > UINT32_MAX) {
+    return INBOX_ERR_OUT_OF_RANGE;
+  }
+
+  command->timestamp = (uint32_t)(timestamp_ms / 1000);
+  command->timestamp_ms = (uint16_t)(timestamp_ms % 1000);
+  command->fields |= INBOX_FIELD_SCORE_1 | INBOX_FIELD_SCORE_2 
+    | INBOX_FIELD_TIMESTAMP | INBOX_FIELD_TIMESTAMP_MS;
+
+  return INBOX_OK;
+}
+
+static InboxDecodeResult read_score_crdt(const Tuple *tuple, InboxCommand *command) {
+  if (tuple->type != TUPLE_BYTE_ARRAY) {
+    return INBOX_ERR_BAD_TYPE;
+  }
+  if (!pn_counter_check_wire(tuple->value->data, tuple->length)) {
+    return INBOX_ERR_BAD_LENGTH;
+  }
+
+  command->score_crdt = tuple->value->data;
+  command->score_crdt_size = tuple->length;
+  command->fields |= INBOX_FIELD_SCORE_CRDT;
+
+  return INBOX_OK;
+}
+
+static InboxDecodeResult read_sport(const Tuple *tuple, InboxCommand *command) {
+  if (tuple->type != TUPLE_BYTE_ARRAY) {
+    return INBOX_ERR_BAD_TYPE;
+  }
+  if (tuple->length != SPORT_WIRE_SIZE) {
+    return INBOX_ERR_BAD_LENGTH;
+  }
+  if (!sport_check_wire(tuple->value->data, tuple->length)) {
+    return INBOX_ERR_OUT_OF_RANGE;
+  }
+
+  memcpy(command->sport, tuple->value->data, SPORT_WIRE_SIZE);
+  command->fields |= INBOX_FIELD_SPORT;
+
+  return INBOX_OK;
+}
+
+static InboxDecodeResult read_digest(const Tuple *tuple, InboxCommand *command) {
+  if (tuple->type != TUPLE_BYTE_ARRAY) {
+    return INBOX_ERR_BAD_TYPE;
+  }
+  if (tuple->length != STATE_DIGEST_SIZE) {
+    return INBOX_ERR_BAD_LENGTH;
+  }
+
+  state_digest_read(tuple->value->data, &command->digest);
+  command->fields |= INBOX_FIELD_DIGEST;
+
+  return INBOX_OK;
+}
+
+static InboxDecodeResult decode_tuple(InboxDecoder *decoder, const Tuple *tuple, 
+  InboxCommand *command, bool *has_cmd) {
+
+  InboxDecodeResult result = INBOX_OK;
+  uint32_t value;
+
+  switch (tuple->key) {
+    case RECEIVE_CMD_KEY:
+      result = read_uint(tuple, UINT8_MAX, &value);
+      command->cmd = value;
+      *has_cmd = true;
+      break;
+    case RECEIVE_SCORE_1_KEY:
+      result = read_uint(tuple, decoder->max_score, &value);
+      command->score_1 = value;
+      command->fields |= INBOX_FIELD_SCORE_1;
+      break;
+    case RECEIVE_SCORE_2_KEY:
+      result = read_uint(tuple, decoder->max_score, &value);
+      command->score_2 = value;
+      command->fields |= INBOX_FIELD_SCORE_2;
+      break;
+    case RECEIVE_TIMESTAMP_KEY:
+      result = read_uint(tuple, UINT32_MAX, &value);
+      command->timestamp = value;
+      command->fields |= INBOX_FIELD_TIMESTAMP;
+      break;
+    case RECEIVE_TIMESTAMP_MS_KEY:
+      result = read_uint(tuple, 999, &value);
+      command->timestamp_ms = value;
+      command->fields |= INBOX_FIELD_TIMESTAMP_MS;
+      break;
+    case RECEIVE_PING_T0_KEY:
+      result = read_timestamp_ms(tuple, &command->ping_t0);
+      command->fields |= INBOX_FIELD_PING_T0;
+      break;
+    case RECEIVE_PONG_T1_KEY:
+      result = read_timestamp_ms(tuple, &command->pong_t1);
+      command->fields |= INBOX_FIELD_PONG_T1;
+      break;
+    case RECEIVE_PONG_T2_KEY:
+      result = read_timestamp_ms(tuple, &command->pong_t2);
+      command->fields |= INBOX_FIELD_PONG_T2;
+      break;
+    case RECEIVE_HELLO_VERSION_KEY:
+      result = read_uint(tuple, UINT8_MAX, &value);
+      command->hello_version = value;
+      command->fields |= INBOX_FIELD_HELLO_VERSION;
+      break;
+    case RECEIVE_HELLO_COMMANDS_KEY:
+      result = read_uint(tuple, UINT32_MAX, &value);
+      command->hello_commands = value;
+      command->fields |= INBOX_FIELD_HELLO_COMMANDS;
+      break;
+    case RECEIVE_HELLO_INBOX_SIZE_KEY:
+      result = read_uint(tuple, UINT16_MAX, &value);
+      command->hello_inbox_size = value;
+      command->fields |= INBOX_FIELD_HELLO_INBOX_SIZE;
+      break;
+    case RECEIVE_HELLO_FEATURES_KEY:
+      result = read_uint(tuple, UINT32_MAX, &value);
+      command->hello_features = value;
+      command->fields |= INBOX_FIELD_HELLO_FEATURES;
+      break;
+    case RECEIVE_PACKED_SCORE_KEY:
+      result = read_packed_score(decoder, tuple, command);
+      break;
+    case RECEIVE_SCORE_CRDT_KEY:
+      result = read_score_crdt(tuple, command);
+      break;
+    case RECEIVE_DIGEST_KEY:
+      result = read_digest(tuple, command);
+      break;
+    case RECEIVE_SPORT_KEY:
+      result = read_sport(tuple, command);
+      break;
+    default:
+      // Keys of newer protocol versions are skipped.
+      break;
+  }
+
+  return result;
+}
+
+/**
+ * Fields each command cannot do without.
+ */
+static InboxDecodeResult check_required_fields(const InboxCommand *command) {
+  uint16_t required;
+
+  switch (command->cmd) {
+    case RECEIVE_CMD_SET_SCORE_VAL:
+      required = INBOX_FIELD_SCORE_1 | INBOX_FIELD_SCORE_2;
+      break;
+    case RECEIVE_CMD_SYNC_SCORE_VAL:
+    case RECEIVE_CMD_EXPORT_TRACE:
+      required = 0;
+      break;
+    case RECEIVE_CMD_PONG:
+      required = INBOX_FIELD_PING_T0 | INBOX_FIELD_PONG_T1 | INBOX_FIELD_PONG_T2;
+      break;
+    case RECEIVE_CMD_HELLO:
+      required = INBOX_FIELD_HELLO_VERSION | INBOX_FIELD_HELLO_INBOX_SIZE 
+        | INBOX_FIELD_HELLO_FEATURES;
+      break;
+    default:
+      return INBOX_ERR_UNKNOWN_CMD;
+  }
+
+  return (command->fields & required) == required ? INBOX_OK : INBOX_ERR_MISSING_FIELD;
+}
+
+void inbox_decoder_init(InboxDecoder *decoder, uint16_t max_score) {
+  memset(decoder, 0, sizeof(InboxDecoder));
+  decoder->max_score = max_score;
+}
+
+/**
+ * Walk the dictionary once and fill command. On a malformed message,
+ * the reason is counted and returned.
+ */
+InboxDecodeResult inbox_decoder_decode(InboxDecoder *decoder, DictionaryIterator *iter, 
+  InboxCommand *command) {
+
+  InboxDecodeResult result = INBOX_OK;
+  bool has_cmd = false;
+
+  memset(command, 0, sizeof(InboxCommand));
+
+  for (Tuple *tuple = dict_read_first(iter); tuple != NULL && result == INBOX_OK; 
+    tuple = dict_read_next(iter)) {
+
+    result = decode_tuple(decoder, tuple, command, &has_cmd);
+  }
+
+  if (result == INBOX_OK) {
+    result = has_cmd ? check_required_fields(command) : INBOX_ERR_NO_CMD;
+  }
+
+  if (result != INBOX_OK) {
+    decoder->rejected[result]++;
+  }
+
+  return result;
+}
+
+const char *inbox_decoder_result_name(InboxDecodeResult result) {
+  switch (result) {
+    case INBOX_OK: return "ok";
+    case INBOX_ERR_NO_CMD: return "no command";
+    case INBOX_ERR_UNKNOWN_CMD: return "unknown command";
+    case INBOX_ERR_BAD_TYPE: return "bad type";
+    case INBOX_ERR_BAD_LENGTH: return "bad length";
+    case INBOX_ERR_OUT_OF_RANGE: return "out of range";
+    case INBOX_ERR_MISSING_FIELD: return "missing field";
+    default: return "?";
+  }
+}
@@ -0,0 +1,82 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+#include "protocol.h"
+#include "state_digest.h"
+
+/**
+ * Reasons for rejecting an inbound message.
+ */
+typedef enum {
+  INBOX_OK = 0,
+  INBOX_ERR_NO_CMD,
+  INBOX_ERR_UNKNOWN_CMD,
+  INBOX_ERR_BAD_TYPE,
+  INBOX_ERR_BAD_LENGTH,
+  INBOX_ERR_OUT_OF_RANGE,
+  INBOX_ERR_MISSING_FIELD,
+  INBOX_ERR_COUNT
+} InboxDecodeResult;
+
+/**
+ * Bitmask of the fields present in an InboxCommand.
+ */
+typedef enum {
+  INBOX_FIELD_SCORE_1 = 1 << 0,
+  INBOX_FIELD_SCORE_2 = 1 << 1,
+  INBOX_FIELD_TIMESTAMP = 1 << 2,
+  INBOX_FIELD_TIMESTAMP_MS = 1 << 3,
+  INBOX_FIELD_PING_T0 = 1 << 4,
+  INBOX_FIELD_PONG_T1 = 1 << 5,
+  INBOX_FIELD_PONG_T2 = 1 << 6,
+  INBOX_FIELD_HELLO_VERSION = 1 << 7,
+  INBOX_FIELD_HELLO_COMMANDS = 1 << 8,
+  INBOX_FIELD_HELLO_INBOX_SIZE = 1 << 9,
+  INBOX_FIELD_HELLO_FEATURES = 1 << 10,
+  INBOX_FIELD_SCORE_CRDT = 1 << 11,
+  INBOX_FIELD_DIGEST = 1 << 12,
+  INBOX_FIELD_SPORT = 1 << 13
+} InboxField;
+
+/**
+ * Typed content of one inbound message.
+ */
+typedef struct {
+  uint8_t cmd;
+  uint16_t fields;
+  uint16_t score_1;
+  uint16_t score_2;
+  uint32_t timestamp;
+  uint16_t timestamp_ms;
+  int64_t ping_t0;
+  int64_t pong_t1;
+  int64_t pong_t2;
+  uint8_t hello_version;
+  uint32_t hello_commands;
+  uint16_t hello_inbox_size;
+  uint32_t hello_features;
+  /**
+   * Encoded PnCounter, points into the inbox, valid during the callback only.
+   */
+  const uint8_t *score_crdt;
+  uint16_t score_crdt_size;
+  StateDigest digest;
+  /**
+   * Sets and games won, checked by sport_check_wire().
+   */
+  uint8_t sport[SPORT_WIRE_SIZE];
+} InboxCommand;
+
+typedef struct {
+  uint16_t max_score;
+  uint16_t rejected[INBOX_ERR_COUNT];
+} InboxDecoder;
+
+void inbox_decoder_init(InboxDecoder *decoder, uint16_t max_score);
+InboxDecodeResult inbox_decoder_decode(InboxDecoder *decoder, DictionaryIterator *iter, 
+  InboxCommand *command);
+const char *inbox_decoder_result_name(InboxDecodeResult result);
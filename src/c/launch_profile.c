@@ -0,0 +1,48 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "launch_profile.h"
+#include "build_config.h"
+
+#if SC_LAUNCH_PROFILE
+
+static const char *phase_names[LAUNCH_PHASE_COUNT] = {
+  [LAUNCH_PHASE_START] = "start",
+  [LAUNCH_PHASE_STATE_READ] = "state read",
+  [LAUNCH_PHASE_WINDOW_PUSHED] = "window pushed",
+  [LAUNCH_PHASE_FIRST_FRAME] = "first frame",
+  [LAUNCH_PHASE_STATE_LOADED] = "state loaded",
+  [LAUNCH_PHASE_LINK_OPEN] = "link open",
+  [LAUNCH_PHASE_DONE] = "done",
+};
+
+/**
+ * Milliseconds of each phase on the wall clock, 0 while not reached.
+ */
+static int64_t phase_ms[LAUNCH_PHASE_COUNT];
+
+
+void launch_profile_mark(LaunchPhase phase) {
+  time_t now;
+  uint16_t now_ms;
+
+  time_ms(&now, &now_ms);
+  phase_ms[phase] = (int64_t)now * 1000 + now_ms;
+}
+
+void launch_profile_log_summary() {
+  int64_t previous_ms = phase_ms[LAUNCH_PHASE_START];
+
+  for (uint8_t i = 0; i < LAUNCH_PHASE_COUNT; i++) {
+    if (phase_ms[i] == 0) {
+      continue;
+    }
+    SC_LOG(APP_LOG_LEVEL_INFO, "Launch %s: %d ms, +%d ms", phase_names[i], 
+      (int)(phase_ms[i] - phase_ms[LAUNCH_PHASE_START]), (int)(phase_ms[i] - previous_ms));
+    previous_ms = phase_ms[i];
+  }
+}
+
+#endif
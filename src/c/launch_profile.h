@@ -0,0 +1,31 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+/**
+ * Phases of the cold start, in the order they are reached. The first frame
+ * is on screen by LAUNCH_PHASE_FIRST_FRAME, the app is fully up by
+ * LAUNCH_PHASE_DONE.
+ */
+typedef enum {
+  LAUNCH_PHASE_START,
+  LAUNCH_PHASE_STATE_READ,
+  LAUNCH_PHASE_WINDOW_PUSHED,
+  LAUNCH_PHASE_FIRST_FRAME,
+  LAUNCH_PHASE_STATE_LOADED,
+  LAUNCH_PHASE_LINK_OPEN,
+  LAUNCH_PHASE_DONE,
+  LAUNCH_PHASE_COUNT
+} LaunchPhase;
+
+/**
+ * Launch profile, compiled in with SC_LAUNCH_PROFILE (see build_config.h).
+ * Every phase is timestamped when reached, and the summary logs the time
+ * of each since the start and since the phase before.
+ */
+void launch_profile_mark(LaunchPhase phase);
+void launch_profile_log_summary();
@@ -0,0 +1,120 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "link_caps.h"
+#include "protocol.h"
+#include "clock_sync.h"
+#include "offline_queue.h"
+#include "pn_counter.h"
+
+
+/**
+ * Everything in a BATCH message but the changes themselves: the command,
+ * the latest score and timestamp under the legacy keys, the batch header.
+ */
+#define BATCH_OVERHEAD (LINK_DICT_HEADER_SIZE \
+  + LINK_TUPLE_HEADER_SIZE + sizeof(uint8_t) \
+  + 2 * (LINK_TUPLE_HEADER_SIZE + sizeof(uint16_t)) \
+  + LINK_TUPLE_HEADER_SIZE + sizeof(uint32_t) \
+  + LINK_TUPLE_HEADER_SIZE)
+#define SCORE_CRDT_OVERHEAD (LINK_TUPLE_HEADER_SIZE + PN_COUNTER_WIRE_MAX_SIZE)
+
+/**
+ * Commands the watch sends, as 1 << DictSendCmdVal.
+ */
+#define SENT_COMMANDS ((1 << SEND_CMD_SET_SCORE_VAL) | (1 << SEND_CMD_SYNC_SCORE_VAL) \
+  | (1 << SEND_CMD_BATCH_SCORE_VAL) | (1 << SEND_CMD_PING) | (1 << SEND_CMD_HELLO) \
+  | (1 << SEND_CMD_BACKOFF))
+
+static uint8_t batch_ops_for(uint16_t max_message_size, uint16_t overhead) {
+  if (max_message_size < overhead + sizeof(OfflineOp)) {
+    return 0;
+  }
+
+  uint16_t ops = (max_message_size - overhead) / sizeof(OfflineOp);
+
+  return ops < OFFLINE_QUEUE_CAPACITY ? ops : OFFLINE_QUEUE_CAPACITY;
+}
+
+static void write_uint16_le(uint8_t *buff, uint16_t value) {
+  buff[0] = (uint8_t)value;
+  buff[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t read_uint16_le(const uint8_t *buff) {
+  return (uint16_t)(buff[0] | buff[1] << 8);
+}
+
+/**
+ * The legacy phone is sent just SET and SYNC with the keys of version 1:
+ * no feature is assumed of a phone that did not answer HELLO.
+ */
+void link_caps_init_legacy(LinkCaps *caps, uint16_t outbox_size) {
+  caps->peer_version = PROTOCOL_VERSION_LEGACY;
+  caps->peer_commands = 0;
+  caps->features = 0;
+  caps->max_message_size = outbox_size;
+  caps->batch_ops = 0;
+}
+
+void link_caps_write_hello(DictionaryIterator *iter, uint32_t features, 
+  uint16_t inbox_size, uint16_t outbox_size) {
+
+  Tuplet cmd_tuplet = TupletInteger(SEND_CMD_KEY, (uint8_t)SEND_CMD_HELLO);
+  Tuplet version_tuplet = TupletInteger(SEND_HELLO_VERSION_KEY, (uint8_t)PROTOCOL_VERSION);
+  Tuplet commands_tuplet = TupletInteger(SEND_HELLO_COMMANDS_KEY, (uint32_t)SENT_COMMANDS);
+  Tuplet inbox_tuplet = TupletInteger(SEND_HELLO_INBOX_SIZE_KEY, inbox_size);
+  Tuplet outbox_tuplet = TupletInteger(SEND_HELLO_OUTBOX_SIZE_KEY, outbox_size);
+  Tuplet features_tuplet = TupletInteger(SEND_HELLO_FEATURES_KEY, features);
+
+  dict_write_tuplet(iter, &cmd_tuplet);
+  dict_write_tuplet(iter, &version_tuplet);
+  dict_write_tuplet(iter, &commands_tuplet);
+  dict_write_tuplet(iter, &inbox_tuplet);
+  dict_write_tuplet(iter, &outbox_tuplet);
+  dict_write_tuplet(iter, &features_tuplet);
+}
+
+/**
+ * Settle on the features both sides have and on the message size both
+ * buffers can take. The score CRDT in a batch leaves less room for changes.
+ */
+void link_caps_on_hello(LinkCaps *caps, const InboxCommand *command, uint32_t features, 
+  uint16_t outbox_size) {
+
+  caps->peer_version = command->hello_version;
+  caps->peer_commands = command->hello_commands;
+  caps->features = features & command->hello_features;
+  caps->max_message_size = command->hello_inbox_size < outbox_size 
+    ? command->hello_inbox_size : outbox_size;
+  uint16_t overhead = BATCH_OVERHEAD 
+    + (link_caps_has(caps, PROTOCOL_FEATURE_SCORE_CRDT) ? SCORE_CRDT_OVERHEAD : 0);
+  caps->batch_ops = link_caps_has(caps, PROTOCOL_FEATURE_BATCH) 
+    ? batch_ops_for(caps->max_message_size, overhead) : 0;
+}
+
+bool link_caps_is_legacy(const LinkCaps *caps) {
+  return caps->peer_version < PROTOCOL_VERSION;
+}
+
+bool link_caps_has(const LinkCaps *caps, uint32_t feature) {
+  return (caps->features & feature) == feature;
+}
+
+void link_caps_write_packed_score(uint8_t *buff, uint16_t score_1, uint16_t score_2, 
+  int64_t timestamp_ms) {
+
+  write_uint16_le(buff, score_1);
+  write_uint16_le(buff + 2, score_2);
+  clock_sync_write_timestamp(timestamp_ms, buff + 4);
+}
+
+void link_caps_read_packed_score(const uint8_t *buff, uint16_t *score_1, uint16_t *score_2, 
+  int64_t *timestamp_ms) {
+
+  *score_1 = read_uint16_le(buff);
+  *score_2 = read_uint16_le(buff + 2);
+  *timestamp_ms = clock_sync_read_timestamp(buff + 4);
+}
@@ -0,0 +1,48 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+#include "inbox_decoder.h"
+
+/**
+ * Size of the dictionary header and of each tuple header, on top of the data.
+ */
+#define LINK_DICT_HEADER_SIZE 1
+#define LINK_TUPLE_HEADER_SIZE 7
+
+/**
+ * What the peer on the other end of the link can do, as negotiated by the
+ * HELLO exchange (see protocol.h). Until the peer answers, and for good
+ * when it does not, the legacy protocol is assumed.
+ */
+typedef struct {
+  uint8_t peer_version;
+  uint32_t peer_commands;
+  /**
+   * ProtocolFeature bits supported by both sides.
+   */
+  uint32_t features;
+  /**
+   * The largest message the peer can take and the outbox can hold.
+   */
+  uint16_t max_message_size;
+  /**
+   * Offline changes per BATCH message, 0 to replay the latest one as SET.
+   */
+  uint8_t batch_ops;
+} LinkCaps;
+
+void link_caps_init_legacy(LinkCaps *caps, uint16_t outbox_size);
+void link_caps_write_hello(DictionaryIterator *iter, uint32_t features, 
+  uint16_t inbox_size, uint16_t outbox_size);
+void link_caps_on_hello(LinkCaps *caps, const InboxCommand *command, uint32_t features, 
+  uint16_t outbox_size);
+bool link_caps_is_legacy(const LinkCaps *caps);
+bool link_caps_has(const LinkCaps *caps, uint32_t feature);
+void link_caps_write_packed_score(uint8_t *buff, uint16_t score_1, uint16_t score_2, 
+  int64_t timestamp_ms);
+void link_caps_read_packed_score(const uint8_t *buff, uint16_t *score_1, uint16_t *score_2, 
+  int64_t *timestamp_ms);
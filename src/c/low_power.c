@@ -0,0 +1,61 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "low_power.h"
+
+
+static bool is_battery_low(bool was_low, BatteryChargeState charge) {
+  if (charge.is_charging || charge.is_plugged) {
+    return false;
+  }
+
+  return charge.charge_percent < (was_low ? LOW_POWER_EXIT_PERCENT : LOW_POWER_ENTER_PERCENT);
+}
+
+void low_power_init(LowPower *low_power, LowPowerSetting setting, BatteryChargeState charge) {
+  low_power->setting = setting < LOW_POWER_SETTING_COUNT ? setting : LOW_POWER_AUTO;
+  low_power->is_battery_low = is_battery_low(false, charge);
+}
+
+bool low_power_is_active(const LowPower *low_power) {
+  switch (low_power->setting) {
+    case LOW_POWER_ALWAYS:
+      return true;
+    case LOW_POWER_NEVER:
+      return false;
+    default:
+      return low_power->is_battery_low;
+  }
+}
+
+/**
+ * Return true when the mode turned on or off.
+ */
+bool low_power_on_battery(LowPower *low_power, BatteryChargeState charge) {
+  bool was_active = low_power_is_active(low_power);
+
+  low_power->is_battery_low = is_battery_low(low_power->is_battery_low, charge);
+
+  return low_power_is_active(low_power) != was_active;
+}
+
+/**
+ * Cycle through the settings. Return true when the mode turned on or off.
+ */
+bool low_power_next_setting(LowPower *low_power) {
+  bool was_active = low_power_is_active(low_power);
+
+  low_power->setting = (low_power->setting + 1) % LOW_POWER_SETTING_COUNT;
+
+  return low_power_is_active(low_power) != was_active;
+}
+
+const char *low_power_setting_name(LowPowerSetting setting) {
+  switch (setting) {
+    case LOW_POWER_ALWAYS: return "Eco on";
+    case LOW_POWER_NEVER: return "Eco off";
+    default: return "Eco auto";
+  }
+}
@@ -0,0 +1,36 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+/**
+ * Charge below which the low-power mode turns on by itself, and above which
+ * it turns off again, apart so it doesn't flip at every reading.
+ */
+#define LOW_POWER_ENTER_PERCENT 20
+#define LOW_POWER_EXIT_PERCENT 30
+
+typedef enum {
+  LOW_POWER_AUTO,
+  LOW_POWER_ALWAYS,
+  LOW_POWER_NEVER,
+  LOW_POWER_SETTING_COUNT
+} LowPowerSetting;
+
+/**
+ * Whether the app should save the battery: on low charge while not charging
+ * in the automatic setting, or as set by the user.
+ */
+typedef struct {
+  LowPowerSetting setting;
+  bool is_battery_low;
+} LowPower;
+
+void low_power_init(LowPower *low_power, LowPowerSetting setting, BatteryChargeState charge);
+bool low_power_is_active(const LowPower *low_power);
+bool low_power_on_battery(LowPower *low_power, BatteryChargeState charge);
+bool low_power_next_setting(LowPower *low_power);
+const char *low_power_setting_name(LowPowerSetting setting);
@@ -0,0 +1,113 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "match_clock.h"
+
+
+static time_t monotonic(const MatchClock *clock, time_t now) {
+  time_t mono = now + clock->offset;
+
+  // Set back since the last observation, not noticed yet.
+  return mono < clock->last_seen ? clock->last_seen : mono;
+}
+
+static uint32_t secs_since(const MatchClock *clock, time_t start, time_t now) {
+  if (start == 0) {
+    return 0;
+  }
+
+  time_t mono = monotonic(clock, now);
+
+  return mono > start ? (uint32_t)(mono - start) : 0;
+}
+
+void match_clock_init(MatchClock *clock) {
+  memset(clock, 0, sizeof(MatchClock));
+}
+
+/**
+ * Follow the wall clock. Return true when it was set back and the offset
+ * changed, so the clock should be persisted.
+ */
+bool match_clock_observe(MatchClock *clock, time_t now) {
+  time_t mono = now + clock->offset;
+
+  if (mono < clock->last_seen) {
+    clock->offset += clock->last_seen - mono;
+    return true;
+  }
+
+  clock->last_seen = mono;
+
+  return false;
+}
+
+/**
+ * A point starts the next rally, and the match with the first one.
+ */
+void match_clock_on_point(MatchClock *clock, time_t now) {
+  match_clock_observe(clock, now);
+
+  clock->rally_start = clock->last_seen;
+  if (clock->match_start == 0) {
+    clock->match_start = clock->last_seen;
+  }
+}
+
+void match_clock_reset(MatchClock *clock) {
+  clock->match_start = 0;
+  clock->rally_start = 0;
+}
+
+bool match_clock_is_running(const MatchClock *clock) {
+  return clock->match_start != 0;
+}
+
+uint32_t match_clock_match_secs(const MatchClock *clock, time_t now) {
+  return secs_since(clock, clock->match_start, now);
+}
+
+uint32_t match_clock_rally_secs(const MatchClock *clock, time_t now) {
+  return secs_since(clock, clock->rally_start, now);
+}
+
+/**
+ * Match time and the rally time, "m:ss  m:ss" (the match in "h:mm:ss" after
+ * an hour). Coarse is the match time alone in hours and minutes, for a clock
+ * updated once a minute.
+ */
+void match_clock_format(const MatchClock *clock, time_t now, bool is_coarse, 
+  char *buff, size_t size) {
+
+  uint32_t match_secs = match_clock_match_secs(clock, now);
+  uint32_t rally_secs = match_clock_rally_secs(clock, now);
+
+  if (is_coarse) {
+    snprintf(buff, size, "%d:%02d", (int)(match_secs / 3600), (int)(match_secs / 60 % 60));
+  } else if (match_secs >= 3600) {
+    snprintf(buff, size, "%d:%02d:%02d  %d:%02d", (int)(match_secs / 3600), 
+      (int)(match_secs / 60 % 60), (int)(match_secs % 60), 
+      (int)(rally_secs / 60), (int)(rally_secs % 60));
+  } else {
+    snprintf(buff, size, "%d:%02d  %d:%02d", (int)(match_secs / 60), (int)(match_secs % 60),
+      (int)(rally_secs / 60), (int)(rally_secs % 60));
+  }
+}
+
+/**
+ * Match time alone, "m:ss", or "h:mm" after an hour or when coarse. Leaves
+ * room on the line for the sets and games.
+ */
+void match_clock_format_match(const MatchClock *clock, time_t now, bool is_coarse, 
+  char *buff, size_t size) {
+
+  uint32_t match_secs = match_clock_match_secs(clock, now);
+
+  if (is_coarse || match_secs >= 3600) {
+    snprintf(buff, size, "%d:%02d", (int)(match_secs / 3600), (int)(match_secs / 60 % 60));
+  } else {
+    snprintf(buff, size, "%d:%02d", (int)(match_secs / 60), (int)(match_secs % 60));
+  }
+}
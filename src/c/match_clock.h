@@ -0,0 +1,48 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+/**
+ * Region of the match clock on the main window, the only part repainted
+ * by the second ticks.
+ */
+#define MATCH_CLOCK_WIDTH 96
+#define MATCH_CLOCK_HEIGHT 18
+#define MATCH_CLOCK_TEXT_BUFF_SIZE 20
+
+/**
+ * Running match clock and the rally timer, the time since the last point.
+ * Both count in a monotonic timeline: the wall clock plus an offset that
+ * grows whenever the wall clock is set back (a time sync with the phone),
+ * so neither of them ever runs backwards. Only the starts are kept, not the
+ * running time, so the struct needs to be persisted on a point, a reset or
+ * a wall clock set back, never on a tick.
+ */
+typedef struct {
+  int32_t offset;
+  /**
+   * Latest monotonic time seen, to find out the wall clock was set back.
+   */
+  time_t last_seen;
+  /**
+   * Start of the match and of the current rally, 0 before the first point.
+   */
+  time_t match_start;
+  time_t rally_start;
+} MatchClock;
+
+void match_clock_init(MatchClock *clock);
+bool match_clock_observe(MatchClock *clock, time_t now);
+void match_clock_on_point(MatchClock *clock, time_t now);
+void match_clock_reset(MatchClock *clock);
+bool match_clock_is_running(const MatchClock *clock);
+uint32_t match_clock_match_secs(const MatchClock *clock, time_t now);
+uint32_t match_clock_rally_secs(const MatchClock *clock, time_t now);
+void match_clock_format(const MatchClock *clock, time_t now, bool is_coarse, 
+  char *buff, size_t size);
+void match_clock_format_match(const MatchClock *clock, time_t now, bool is_coarse, 
+  char *buff, size_t size);
@@ -0,0 +1,178 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "match_stats.h"
+
+
+/**
+ * Difference between two score values, taking the wraparound at 
+ * score_modulo into account, so MAX_SCORE -> MIN_SCORE counts as +1.
+ */
+static int32_t score_delta(const MatchStats *stats, uint16_t from, uint16_t to) {
+  int32_t delta = (int32_t)to - (int32_t)from;
+  int32_t modulo = stats->score_modulo;
+
+  if (modulo > 0) {
+    if (delta > modulo / 2) {
+      delta -= modulo;
+    } else if (delta < -modulo / 2) {
+      delta += modulo;
+    }
+  }
+
+  return delta;
+}
+
+static void apply_points(MatchStats *stats, MatchStatsSide side, int32_t delta, 
+  time_t timestamp) {
+
+  uint16_t *points = side == STATS_SIDE_1 ? &stats->points_1 : &stats->points_2;
+  uint16_t *longest_run = side == STATS_SIDE_1 
+    ? &stats->longest_run_1 : &stats->longest_run_2;
+
+  if (delta > 0) {
+    *points += delta;
+
+    if (stats->run_side == side) {
+      stats->run_length += delta;
+    } else {
+      stats->run_side = side;
+      stats->run_length = delta;
+    }
+    if (stats->run_length > *longest_run) {
+      *longest_run = stats->run_length;
+    }
+
+    if (stats->match_start == 0) {
+      stats->match_start = timestamp;
+    }
+    stats->last_point_time = timestamp;
+  } else if (delta < 0) {
+    // Taking a point back. The longest run stays, it was already reached.
+    uint16_t taken_back = -delta;
+
+    *points = *points > taken_back ? *points - taken_back : 0;
+
+    if (stats->run_side == side) {
+      if (stats->run_length > taken_back) {
+        stats->run_length -= taken_back;
+      } else {
+        stats->run_length = 0;
+        stats->run_side = STATS_SIDE_NONE;
+      }
+    }
+  }
+}
+
+void match_stats_init(MatchStats *stats, uint16_t score_1, uint16_t score_2, 
+  uint16_t score_modulo) {
+
+  memset(stats, 0, sizeof(MatchStats));
+  stats->score_modulo = score_modulo;
+  stats->last_score_1 = score_1;
+  stats->last_score_2 = score_2;
+}
+
+/**
+ * Every score change counts as points scored or taken back. A reset has to
+ * be told with match_stats_init() and a swap with match_stats_swap(), the
+ * score alone does not tell them from points.
+ */
+void match_stats_update(MatchStats *stats, uint16_t score_1, uint16_t score_2, 
+  time_t timestamp) {
+
+  if (score_1 == stats->last_score_1 && score_2 == stats->last_score_2) {
+    return;
+  }
+
+  apply_points(stats, STATS_SIDE_1, 
+    score_delta(stats, stats->last_score_1, score_1), timestamp);
+  apply_points(stats, STATS_SIDE_2, 
+    score_delta(stats, stats->last_score_2, score_2), timestamp);
+
+  stats->last_score_1 = score_1;
+  stats->last_score_2 = score_2;
+}
+
+/**
+ * The score was swapped in SETTING_MODE, the statistics follow the sides.
+ */
+void match_stats_swap(MatchStats *stats) {
+  uint16_t tmp = stats->points_1;
+  stats->points_1 = stats->points_2;
+  stats->points_2 = tmp;
+
+  tmp = stats->longest_run_1;
+  stats->longest_run_1 = stats->longest_run_2;
+  stats->longest_run_2 = tmp;
+
+  tmp = stats->last_score_1;
+  stats->last_score_1 = stats->last_score_2;
+  stats->last_score_2 = tmp;
+
+  if (stats->run_side == STATS_SIDE_1) {
+    stats->run_side = STATS_SIDE_2;
+  } else if (stats->run_side == STATS_SIDE_2) {
+    stats->run_side = STATS_SIDE_1;
+  }
+}
+
+/**
+ * The score moved on without points scored, like the 0:0 a new set starts
+ * from. The next update counts from there.
+ */
+void match_stats_rebase(MatchStats *stats, uint16_t score_1, uint16_t score_2) {
+  stats->last_score_1 = score_1;
+  stats->last_score_2 = score_2;
+}
+
+uint16_t match_stats_points_per_minute_x10(const MatchStats *stats, time_t now) {
+  if (stats->match_start == 0 || now <= stats->match_start) {
+    return 0;
+  }
+
+  uint32_t elapsed = now - stats->match_start;
+  uint32_t points = stats->points_1 + stats->points_2;
+
+  return (uint16_t)(points * 600 / elapsed);
+}
+
+uint32_t match_stats_secs_since_last_point(const MatchStats *stats, time_t now) {
+  if (stats->last_point_time == 0 || now <= stats->last_point_time) {
+    return 0;
+  }
+
+  return now - stats->last_point_time;
+}
+
+void match_stats_to_wire(const MatchStats *stats, time_t now, bool swap_sides, 
+  MatchStatsWire *wire) {
+
+  wire->points_per_minute_x10 = match_stats_points_per_minute_x10(stats, now);
+  wire->run_length = stats->run_length;
+  wire->secs_since_last_point = match_stats_secs_since_last_point(stats, now);
+
+  if (swap_sides) {
+    wire->longest_run_1 = stats->longest_run_2;
+    wire->longest_run_2 = stats->longest_run_1;
+    wire->run_side = stats->run_side == STATS_SIDE_NONE 
+      ? STATS_SIDE_NONE : STATS_SIDE_1 + STATS_SIDE_2 - stats->run_side;
+  } else {
+    wire->longest_run_1 = stats->longest_run_1;
+    wire->longest_run_2 = stats->longest_run_2;
+    wire->run_side = stats->run_side;
+  }
+}
+
+void match_stats_format(const MatchStats *stats, time_t now, char *buff, size_t size) {
+  uint16_t ppm_x10 = match_stats_points_per_minute_x10(stats, now);
+  uint32_t since_last = match_stats_secs_since_last_point(stats, now);
+
+  snprintf(buff, size, "Pts/min %d.%d\nRun %d (%d)\nBest %d:%d\nLast %d:%02d",
+    ppm_x10 / 10, ppm_x10 % 10,
+    stats->run_length, stats->run_side,
+    stats->longest_run_1, stats->longest_run_2,
+    (int)(since_last / 60), (int)(since_last % 60));
+}
@@ -0,0 +1,63 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+#define MATCH_STATS_TEXT_BUFF_SIZE 64
+
+/**
+ * Side of the score the statistics refer to. The sides follow score_1
+ * and score_2 of the Score struct, not the left/right edge of the screen.
+ */
+typedef enum {
+  STATS_SIDE_NONE = 0,
+  STATS_SIDE_1 = 1,
+  STATS_SIDE_2 = 2
+} MatchStatsSide;
+
+/**
+ * Live match statistics. The accumulator is updated incrementally from
+ * the score values, one O(1) step per score change, so it never needs the
+ * history of the match; resets and swaps are told apart from points by the
+ * caller. The struct has a fixed size and is persisted as a whole.
+ */
+typedef struct {
+  time_t match_start;
+  time_t last_point_time;
+  uint16_t score_modulo;
+  uint16_t last_score_1;
+  uint16_t last_score_2;
+  uint16_t points_1;
+  uint16_t points_2;
+  uint16_t run_length;
+  uint16_t longest_run_1;
+  uint16_t longest_run_2;
+  uint8_t run_side;
+} MatchStats;
+
+/**
+ * Wire representation of the statistics, sent to the phone as a byte array.
+ */
+typedef struct __attribute__((packed)) {
+  uint16_t points_per_minute_x10;
+  uint8_t run_side;
+  uint16_t run_length;
+  uint16_t longest_run_1;
+  uint16_t longest_run_2;
+  uint32_t secs_since_last_point;
+} MatchStatsWire;
+
+void match_stats_init(MatchStats *stats, uint16_t score_1, uint16_t score_2, 
+  uint16_t score_modulo);
+void match_stats_update(MatchStats *stats, uint16_t score_1, uint16_t score_2, 
+  time_t timestamp);
+void match_stats_swap(MatchStats *stats);
+void match_stats_rebase(MatchStats *stats, uint16_t score_1, uint16_t score_2);
+uint16_t match_stats_points_per_minute_x10(const MatchStats *stats, time_t now);
+uint32_t match_stats_secs_since_last_point(const MatchStats *stats, time_t now);
+void match_stats_to_wire(const MatchStats *stats, time_t now, bool swap_sides, 
+  MatchStatsWire *wire);
+void match_stats_format(const MatchStats *stats, time_t now, char *buff, size_t size);
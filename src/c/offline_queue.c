@@ -0,0 +1,119 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "offline_queue.h"
+
+
+static inline OfflineOp *op_at(OfflineQueue *queue, uint8_t index) {
+  return &queue->ops[(queue->head + index) % OFFLINE_QUEUE_CAPACITY];
+}
+
+static void persist_queue(const OfflineQueue *queue, uint32_t persist_key) {
+  persist_write_data(persist_key, queue, sizeof(OfflineQueue));
+}
+
+void offline_queue_load(OfflineQueue *queue, uint32_t persist_key) {
+  if (persist_get_size(persist_key) == sizeof(OfflineQueue)) {
+    persist_read_data(persist_key, queue, sizeof(OfflineQueue));
+  }
+  if (persist_get_size(persist_key) != sizeof(OfflineQueue) 
+    || queue->head >= OFFLINE_QUEUE_CAPACITY || queue->count > OFFLINE_QUEUE_CAPACITY) {
+    queue->head = 0;
+    queue->count = 0;
+  }
+}
+
+/**
+ * Record a score change. The queue is compacted on the way in: a change 
+ * to the same score as the last recorded one is dropped, a change within 
+ * the same second replaces the last one and when the queue is full,
+ * the oldest change is overwritten. The latest change is never lost.
+ */
+void offline_queue_push(OfflineQueue *queue, uint32_t persist_key, 
+  uint32_t timestamp, uint16_t score_1, uint16_t score_2) {
+
+  OfflineOp *op;
+
+  if (queue->count > 0) {
+    OfflineOp *last = op_at(queue, queue->count - 1);
+
+    if (last->score_1 == score_1 && last->score_2 == score_2) {
+      return;
+    }
+    if (last->timestamp == timestamp) {
+      last->score_1 = score_1;
+      last->score_2 = score_2;
+      persist_queue(queue, persist_key);
+      return;
+    }
+  }
+
+  if (queue->count < OFFLINE_QUEUE_CAPACITY) {
+    op = op_at(queue, queue->count);
+    queue->count++;
+  } else {
+    op = op_at(queue, 0);
+    queue->head = (queue->head + 1) % OFFLINE_QUEUE_CAPACITY;
+  }
+
+  op->timestamp = timestamp;
+  op->score_1 = score_1;
+  op->score_2 = score_2;
+
+  persist_queue(queue, persist_key);
+}
+
+void offline_queue_clear(OfflineQueue *queue, uint32_t persist_key) {
+  queue->head = 0;
+  queue->count = 0;
+  persist_delete(persist_key);
+}
+
+/**
+ * Forget the count oldest changes, once the phone has got them.
+ */
+void offline_queue_drop(OfflineQueue *queue, uint32_t persist_key, uint8_t count) {
+  if (count >= queue->count) {
+    offline_queue_clear(queue, persist_key);
+    return;
+  }
+
+  queue->head = (queue->head + count) % OFFLINE_QUEUE_CAPACITY;
+  queue->count -= count;
+
+  persist_queue(queue, persist_key);
+}
+
+bool offline_queue_is_empty(const OfflineQueue *queue) {
+  return queue->count == 0;
+}
+
+const OfflineOp *offline_queue_latest(const OfflineQueue *queue) {
+  if (queue->count == 0) {
+    return NULL;
+  }
+
+  return &queue->ops[(queue->head + queue->count - 1) % OFFLINE_QUEUE_CAPACITY];
+}
+
+/**
+ * Write the recorded changes, oldest first, into buff, with timestamp_offset
+ * (seconds) added to the timestamps. Return the number of bytes written.
+ */
+uint16_t offline_queue_serialize(const OfflineQueue *queue, uint8_t *buff, uint16_t size, 
+  int32_t timestamp_offset) {
+
+  uint16_t written = 0;
+
+  for (uint8_t i = 0; i < queue->count && written + sizeof(OfflineOp) <= size; i++) {
+    OfflineOp op = queue->ops[(queue->head + i) % OFFLINE_QUEUE_CAPACITY];
+    op.timestamp += timestamp_offset;
+
+    memcpy(buff + written, &op, sizeof(OfflineOp));
+    written += sizeof(OfflineOp);
+  }
+
+  return written;
+}
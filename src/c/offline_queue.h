@@ -0,0 +1,40 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+#define OFFLINE_QUEUE_CAPACITY 16
+
+/**
+ * One score change made while the phone was not reachable. Scores are stored
+ * already in the orientation in which they are transferred to the phone.
+ * The struct is sent as is (little endian) in the batch byte array.
+ */
+typedef struct __attribute__((packed)) {
+  uint32_t timestamp;
+  uint16_t score_1;
+  uint16_t score_2;
+} OfflineOp;
+
+/**
+ * Bounded ring of offline score changes, persisted as one blob, 
+ * so it survives an app restart.
+ */
+typedef struct {
+  uint8_t head;
+  uint8_t count;
+  OfflineOp ops[OFFLINE_QUEUE_CAPACITY];
+} OfflineQueue;
+
+void offline_queue_load(OfflineQueue *queue, uint32_t persist_key);
+void offline_queue_push(OfflineQueue *queue, uint32_t persist_key, 
+  uint32_t timestamp, uint16_t score_1, uint16_t score_2);
+void offline_queue_clear(OfflineQueue *queue, uint32_t persist_key);
+void offline_queue_drop(OfflineQueue *queue, uint32_t persist_key, uint8_t count);
+bool offline_queue_is_empty(const OfflineQueue *queue);
+const OfflineOp *offline_queue_latest(const OfflineQueue *queue);
+uint16_t offline_queue_serialize(const OfflineQueue *queue, uint8_t *buff, uint16_t size, 
+  int32_t timestamp_offset);
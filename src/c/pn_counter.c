@@ -0,0 +1,301 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "pn_counter.h"
+
+
+/**
+ * Generations compare in serial number arithmetic, so they can wrap.
+ */
+static bool is_newer_generation(uint16_t generation, uint16_t than) {
+  return (int16_t)(generation - than) > 0;
+}
+
+/**
+ * Of the same generation started on two devices at once, the one of the
+ * higher origin counts as the newer.
+ */
+static bool is_newer_state(const PnCounter *state, const PnCounter *than) {
+  return is_newer_generation(state->generation, than->generation) 
+    || (state->generation == than->generation && state->origin > than->origin);
+}
+
+static PnCounterEntry *find_entry(PnCounter *counter, uint32_t device_id) {
+  for (uint8_t i = 0; i < counter->count; i++) {
+    if (counter->entries[i].device_id == device_id) {
+      return &counter->entries[i];
+    }
+  }
+
+  return NULL;
+}
+
+static PnCounterEntry *add_entry(PnCounter *counter, uint32_t device_id) {
+  if (counter->count == PN_COUNTER_MAX_DEVICES) {
+    return NULL;
+  }
+
+  PnCounterEntry *entry = &counter->entries[counter->count++];
+  memset(entry, 0, sizeof(PnCounterEntry));
+  entry->device_id = device_id;
+
+  return entry;
+}
+
+/**
+ * A new generation starting from the current scores, all of them counted
+ * as increments of this device.
+ */
+static PnCounterEntry *rebase(PnCounter *counter, uint32_t device_id) {
+  uint16_t values[PN_COUNTER_TEAMS];
+  for (uint8_t team = 0; team < PN_COUNTER_TEAMS; team++) {
+    values[team] = pn_counter_value(counter, team);
+  }
+
+  pn_counter_restart(counter, device_id);
+
+  PnCounterEntry *entry = add_entry(counter, device_id);
+  for (uint8_t team = 0; team < PN_COUNTER_TEAMS; team++) {
+    entry->inc[team] = values[team];
+  }
+
+  return entry;
+}
+
+static uint16_t write_varint(uint8_t *buff, uint16_t value) {
+  uint16_t size = 0;
+
+  while (value >= 0x80) {
+    buff[size++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  buff[size++] = (uint8_t)value;
+
+  return size;
+}
+
+static bool read_varint(const uint8_t *buff, uint16_t size, uint16_t *offset, uint16_t *value) {
+  uint32_t result = 0;
+
+  for (uint8_t shift = 0; shift < 21; shift += 7) {
+    if (*offset >= size) {
+      return false;
+    }
+
+    uint8_t byte = buff[(*offset)++];
+    result |= (uint32_t)(byte & 0x7F) << shift;
+
+    if ((byte & 0x80) == 0) {
+      if (result > UINT16_MAX) {
+        return false;
+      }
+      *value = (uint16_t)result;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Decode the whole state, false when it is malformed.
+ */
+static bool read_wire(const uint8_t *buff, uint16_t size, PnCounter *counter) {
+  uint16_t offset = 0;
+
+  if (!read_varint(buff, size, &offset, &counter->generation) || size - offset < 4) {
+    return false;
+  }
+
+  counter->origin = (uint32_t)buff[offset] | (uint32_t)buff[offset + 1] << 8
+    | (uint32_t)buff[offset + 2] << 16 | (uint32_t)buff[offset + 3] << 24;
+  offset += 4;
+
+  if (!read_varint(buff, size, &offset, &counter->match) || offset >= size) {
+    return false;
+  }
+
+  counter->count = buff[offset++];
+  if (counter->count > PN_COUNTER_MAX_DEVICES) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < counter->count; i++) {
+    PnCounterEntry *entry = &counter->entries[i];
+
+    if (size - offset < 4) {
+      return false;
+    }
+    entry->device_id = (uint32_t)buff[offset] | (uint32_t)buff[offset + 1] << 8
+      | (uint32_t)buff[offset + 2] << 16 | (uint32_t)buff[offset + 3] << 24;
+    offset += 4;
+
+    for (uint8_t team = 0; team < PN_COUNTER_TEAMS; team++) {
+      if (!read_varint(buff, size, &offset, &entry->inc[team])
+        || !read_varint(buff, size, &offset, &entry->dec[team])) {
+        return false;
+      }
+    }
+  }
+
+  return offset == size;
+}
+
+void pn_counter_init(PnCounter *counter, uint16_t modulus) {
+  memset(counter, 0, sizeof(PnCounter));
+  counter->modulus = modulus;
+}
+
+/**
+ * A new match from 0:0.
+ */
+void pn_counter_reset(PnCounter *counter, uint32_t device_id) {
+  pn_counter_restart(counter, device_id);
+  counter->match++;
+}
+
+/**
+ * A new generation from 0:0 in the same match, like the next game or set.
+ */
+void pn_counter_restart(PnCounter *counter, uint32_t device_id) {
+  counter->generation++;
+  counter->origin = device_id;
+  counter->count = 0;
+  counter->overflowed = 0;
+}
+
+uint16_t pn_counter_value(const PnCounter *counter, uint8_t team) {
+  int32_t sum = 0;
+
+  for (uint8_t i = 0; i < counter->count; i++) {
+    sum += counter->entries[i].inc[team];
+    sum -= counter->entries[i].dec[team];
+  }
+
+  sum %= counter->modulus;
+
+  return (uint16_t)(sum < 0 ? sum + counter->modulus : sum);
+}
+
+/**
+ * Record a local change of the team score to value as the shorter way
+ * round, an increment or a decrement of this device.
+ */
+void pn_counter_set(PnCounter *counter, uint32_t device_id, uint8_t team, uint16_t value) {
+  uint16_t diff = (value + counter->modulus - pn_counter_value(counter, team))
+    % counter->modulus;
+
+  if (diff == 0) {
+    return;
+  }
+
+  bool is_inc = diff <= counter->modulus / 2;
+  uint16_t step = is_inc ? diff : counter->modulus - diff;
+
+  PnCounterEntry *entry = find_entry(counter, device_id);
+  if (entry == NULL) {
+    entry = add_entry(counter, device_id);
+  }
+  if (entry == NULL || (is_inc ? entry->inc[team] : entry->dec[team]) > UINT16_MAX - step) {
+    entry = rebase(counter, device_id);
+  }
+
+  if (is_inc) {
+    entry->inc[team] += step;
+  } else {
+    entry->dec[team] += step;
+  }
+}
+
+/**
+ * Merge a received state, nothing is merged when it is malformed.
+ */
+PnCounterMerge pn_counter_merge_wire(PnCounter *counter, const uint8_t *buff, uint16_t size) {
+  PnCounter received;
+
+  if (!read_wire(buff, size, &received)) {
+    return PN_COUNTER_MERGE_MALFORMED;
+  }
+
+  if (is_newer_state(&received, counter)) {
+    // Reset or rebased elsewhere, the counts of the old generation are gone.
+    counter->generation = received.generation;
+    counter->origin = received.origin;
+    counter->match = received.match;
+    counter->count = received.count;
+    counter->overflowed = 0;
+    memcpy(counter->entries, received.entries, received.count * sizeof(PnCounterEntry));
+    return PN_COUNTER_MERGE_ADOPTED;
+  }
+
+  if (received.generation != counter->generation || received.origin != counter->origin) {
+    // Outdated or lost to this one, the sender catches up with the next
+    // state it gets.
+    return PN_COUNTER_MERGE_OUTDATED;
+  }
+
+  for (uint8_t i = 0; i < received.count; i++) {
+    const PnCounterEntry *theirs = &received.entries[i];
+    PnCounterEntry *ours = find_entry(counter, theirs->device_id);
+
+    if (ours == NULL) {
+      ours = add_entry(counter, theirs->device_id);
+    }
+    if (ours == NULL) {
+      counter->overflowed++;
+      continue;
+    }
+
+    for (uint8_t team = 0; team < PN_COUNTER_TEAMS; team++) {
+      if (theirs->inc[team] > ours->inc[team]) {
+        ours->inc[team] = theirs->inc[team];
+      }
+      if (theirs->dec[team] > ours->dec[team]) {
+        ours->dec[team] = theirs->dec[team];
+      }
+    }
+  }
+
+  return PN_COUNTER_MERGE_MERGED;
+}
+
+bool pn_counter_check_wire(const uint8_t *buff, uint16_t size) {
+  PnCounter received;
+
+  return read_wire(buff, size, &received);
+}
+
+/**
+ * Return the size written, 0 when the buffer is too small.
+ */
+uint16_t pn_counter_write_wire(const PnCounter *counter, uint8_t *buff, uint16_t size) {
+  if (size < PN_COUNTER_WIRE_MAX_SIZE) {
+    return 0;
+  }
+
+  uint16_t offset = write_varint(buff, counter->generation);
+  buff[offset++] = (uint8_t)counter->origin;
+  buff[offset++] = (uint8_t)(counter->origin >> 8);
+  buff[offset++] = (uint8_t)(counter->origin >> 16);
+  buff[offset++] = (uint8_t)(counter->origin >> 24);
+  offset += write_varint(buff + offset, counter->match);
+  buff[offset++] = counter->count;
+
+  for (uint8_t i = 0; i < counter->count; i++) {
+    const PnCounterEntry *entry = &counter->entries[i];
+
+    buff[offset++] = (uint8_t)entry->device_id;
+    buff[offset++] = (uint8_t)(entry->device_id >> 8);
+    buff[offset++] = (uint8_t)(entry->device_id >> 16);
+    buff[offset++] = (uint8_t)(entry->device_id >> 24);
+
+    for (uint8_t team = 0; team < PN_COUNTER_TEAMS; team++) {
+      offset += write_varint(buff + offset, entry->inc[team]);
+      offset += write_varint(buff + offset, entry->dec[team]);
+    }
+  }
+
+  return offset;
+}
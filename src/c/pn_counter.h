@@ -0,0 +1,85 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+#define PN_COUNTER_MAX_DEVICES 6
+#define PN_COUNTER_TEAMS 2
+
+/**
+ * Largest encoded state: generation (varint), origin (4 bytes), match
+ * (varint), device count, then per device its id (4 bytes) and the
+ * increments and decrements of both teams (varints of at most 3 bytes).
+ */
+#define PN_COUNTER_WIRE_MAX_SIZE (3 + 4 + 3 + 1 + PN_COUNTER_MAX_DEVICES \
+  * (4 + 2 * PN_COUNTER_TEAMS * 3))
+
+typedef struct {
+  uint32_t device_id;
+  uint16_t inc[PN_COUNTER_TEAMS];
+  uint16_t dec[PN_COUNTER_TEAMS];
+} PnCounterEntry;
+
+/**
+ * Score of both teams as a replicated PN-counter: every device only ever
+ * adds to its own increments and decrements, and replicas merge by taking
+ * the maximum per device, so concurrent points from several watches all
+ * count whatever the order they arrive in. A team score is the sum of the
+ * increments minus the decrements, modulo the score range, so wrapping
+ * over MAX_SCORE is just one more step.
+ *
+ * A reset starts a new generation with no counts; the newer generation wins
+ * a merge as a whole. So does a rebase, when a counter of this device would
+ * overflow: the new generation starts from the current scores. Two devices
+ * starting the same generation at once have started different ones, the
+ * one of the higher origin wins, so the counts of one are never merged
+ * with those of the other. A game or set won starts a new generation as
+ * well (a restart), so two watches winning the same one at once end up
+ * with the 0:0 of one of them instead of adding up their way down to it.
+ */
+typedef struct {
+  uint16_t generation;
+  uint16_t modulus;
+  /**
+   * Device that started the generation, 0 for the first one.
+   */
+  uint32_t origin;
+  /**
+   * Resets so far: a reset starts a new match too, a rebase goes on with it.
+   */
+  uint16_t match;
+  uint8_t count;
+  /**
+   * Devices not merged for lack of room, the score may be off by their counts.
+   */
+  uint8_t overflowed;
+  PnCounterEntry entries[PN_COUNTER_MAX_DEVICES];
+} PnCounter;
+
+typedef enum {
+  PN_COUNTER_MERGE_MALFORMED,
+  /**
+   * Of an older generation, or one that lost to this one, nothing merged.
+   */
+  PN_COUNTER_MERGE_OUTDATED,
+  /**
+   * Of the same generation, merged device by device.
+   */
+  PN_COUNTER_MERGE_MERGED,
+  /**
+   * Of a newer generation, taken over as a whole.
+   */
+  PN_COUNTER_MERGE_ADOPTED
+} PnCounterMerge;
+
+void pn_counter_init(PnCounter *counter, uint16_t modulus);
+void pn_counter_reset(PnCounter *counter, uint32_t device_id);
+void pn_counter_restart(PnCounter *counter, uint32_t device_id);
+uint16_t pn_counter_value(const PnCounter *counter, uint8_t team);
+void pn_counter_set(PnCounter *counter, uint32_t device_id, uint8_t team, uint16_t value);
+PnCounterMerge pn_counter_merge_wire(PnCounter *counter, const uint8_t *buff, uint16_t size);
+bool pn_counter_check_wire(const uint8_t *buff, uint16_t size);
+uint16_t pn_counter_write_wire(const PnCounter *counter, uint8_t *buff, uint16_t size);
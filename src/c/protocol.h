@@ -0,0 +1,173 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+/**
+ * AppMessage keys and command values shared by the watch and the phone.
+ * Integers are sent as unsigned integers, millisecond timestamps and 
+ * structs as little endian byte arrays.
+ *
+ * On connecting, the watch sends HELLO with its protocol version, the
+ * commands it sends, its buffer sizes and optional features. A phone
+ * speaking version 2 answers with its own HELLO and both sides use the
+ * features they share from then on. A HELLO from the phone that is not an
+ * answer is answered once. Without an answer in time, the watch falls back
+ * to the legacy (version 1) protocol: SET and SYNC only, without any optional
+ * feature.
+ *
+ * The HELLO inbox size tells the phone how much it may send in one burst.
+ * When the watch drops inbound messages nevertheless, a phone with BACKOFF
+ * gets told how many and to hold off for RETRY_AFTER_MS, then resend its
+ * latest score. The dropped messages themselves are NACKed to the phone.
+ *
+ * With SCORE_CRDT, SET and SYNC also carry the score as a PN-counter (see
+ * pn_counter.h), which the receiver merges instead of overwriting its score,
+ * so points scored on several watches at once all count. The plain score
+ * keys still carry the merged score.
+ *
+ * With DIGEST, the phone's answer to HELLO carries a digest of the score it
+ * holds (see state_digest.h), over the features both sides share. When it
+ * matches the watch's own and there are no offline changes to replay, the
+ * watch skips the sync, so a reconnect with nothing changed costs just the
+ * HELLO exchange.
+ *
+ * The history of the match (points, take-backs, resets, swaps, mode changes
+ * and scores set by the phone) does not go over AppMessage at all. It is
+ * logged in a data logging session tagged DATA_LOG_SCORE_EVENTS_TAG, in byte
+ * array records of EVENT_LOG_RECORD_SIZE (see event_log.h), which the system
+ * delivers to the phone in batches.
+ *
+ * With TRACE, the phone can send EXPORT_TRACE to have the watch log its
+ * trace of the recent inputs (see trace_recorder.h) in a data logging
+ * session tagged DATA_LOG_TRACE_TAG, in byte array items of
+ * TRACE_EXPORT_ITEM_SIZE. The host harness replays such a trace.
+ */
+
+#define PROTOCOL_VERSION_LEGACY 1
+#define PROTOCOL_VERSION 2
+
+/**
+ * Optional features advertised in HELLO.
+ */
+typedef enum {
+  /**
+   * Offline changes replayed in BATCH, otherwise just the latest one as SET.
+   */
+  PROTOCOL_FEATURE_BATCH = 1 << 0,
+  /**
+   * Live match statistics in SYNC.
+   */
+  PROTOCOL_FEATURE_STATS = 1 << 1,
+  /**
+   * PING answered with PONG.
+   */
+  PROTOCOL_FEATURE_PING = 1 << 2,
+  /**
+   * Score and timestamp in the one PACKED_SCORE byte array instead of the
+   * SCORE_1, SCORE_2, TIMESTAMP and TIMESTAMP_MS keys.
+   */
+  PROTOCOL_FEATURE_PACKED_SCORE = 1 << 3,
+  /**
+   * BACKOFF sent when inbound messages are dropped.
+   */
+  PROTOCOL_FEATURE_BACKOFF = 1 << 4,
+  /**
+   * SCORE_CRDT in SET, SYNC and BATCH.
+   */
+  PROTOCOL_FEATURE_SCORE_CRDT = 1 << 5,
+  /**
+   * DIGEST in the HELLO answer, the sync on connecting only when it differs.
+   */
+  PROTOCOL_FEATURE_DIGEST = 1 << 6,
+  /**
+   * SPORT in SET and SYNC, the sets and games won.
+   */
+  PROTOCOL_FEATURE_SPORT = 1 << 7,
+  /**
+   * EXPORT_TRACE answered with the trace in data logging.
+   */
+  PROTOCOL_FEATURE_TRACE = 1 << 8
+} ProtocolFeature;
+
+/**
+ * PACKED_SCORE layout: score_1 (2 bytes), score_2 (2 bytes), timestamp in ms
+ * in the shared timeline (8 bytes), all little endian.
+ */
+#define PACKED_SCORE_SIZE 12
+
+/**
+ * SPORT layout: sport id, flags (bit 0: match over), then the units won by
+ * team 1 and team 2 at the level above the points (games or sets) and at
+ * the level above that (sets), one byte each.
+ */
+#define SPORT_WIRE_SIZE 6
+
+/**
+ * "SCEV"
+ */
+#define DATA_LOG_SCORE_EVENTS_TAG 0x53434556
+
+/**
+ * "SCTR"
+ */
+#define DATA_LOG_TRACE_TAG 0x53435452
+
+typedef enum {
+  SEND_CMD_KEY = 10,
+  SEND_SCORE_1_KEY = 11,
+  SEND_SCORE_2_KEY = 12,
+  SEND_TIMESTAMP_KEY = 13,
+  SEND_STATS_KEY = 14,
+  SEND_BATCH_KEY = 15,
+  SEND_TIMESTAMP_MS_KEY = 16,
+  SEND_PING_T0_KEY = 17,
+  SEND_HELLO_VERSION_KEY = 20,
+  SEND_HELLO_COMMANDS_KEY = 21,
+  SEND_HELLO_INBOX_SIZE_KEY = 22,
+  SEND_HELLO_OUTBOX_SIZE_KEY = 23,
+  SEND_HELLO_FEATURES_KEY = 24,
+  SEND_PACKED_SCORE_KEY = 25,
+  SEND_RETRY_AFTER_MS_KEY = 26,
+  SEND_DROPPED_KEY = 27,
+  SEND_SCORE_CRDT_KEY = 28,
+  SEND_SPORT_KEY = 30
+} DictSendKey;
+
+typedef enum {
+  SEND_CMD_SET_SCORE_VAL = 1,
+  SEND_CMD_SYNC_SCORE_VAL = 2,
+  SEND_CMD_BATCH_SCORE_VAL = 3,
+  SEND_CMD_PING = 4,
+  SEND_CMD_HELLO = 5,
+  SEND_CMD_BACKOFF = 6
+} DictSendCmdVal;
+
+typedef enum {
+  RECEIVE_CMD_KEY = 10,
+  RECEIVE_SCORE_1_KEY = 11,
+  RECEIVE_SCORE_2_KEY = 12,
+  RECEIVE_TIMESTAMP_KEY = 13,
+  RECEIVE_TIMESTAMP_MS_KEY = 16,
+  RECEIVE_PING_T0_KEY = 17,
+  RECEIVE_PONG_T1_KEY = 18,
+  RECEIVE_PONG_T2_KEY = 19,
+  RECEIVE_HELLO_VERSION_KEY = 20,
+  RECEIVE_HELLO_COMMANDS_KEY = 21,
+  RECEIVE_HELLO_INBOX_SIZE_KEY = 22,
+  RECEIVE_HELLO_OUTBOX_SIZE_KEY = 23,
+  RECEIVE_HELLO_FEATURES_KEY = 24,
+  RECEIVE_PACKED_SCORE_KEY = 25,
+  RECEIVE_SCORE_CRDT_KEY = 28,
+  RECEIVE_DIGEST_KEY = 29,
+  RECEIVE_SPORT_KEY = 30
+} DictReceiveKey;
+
+typedef enum {
+  RECEIVE_CMD_SET_SCORE_VAL = 1,
+  RECEIVE_CMD_SYNC_SCORE_VAL = 2,
+  RECEIVE_CMD_PONG = 3,
+  RECEIVE_CMD_HELLO = 4,
+  RECEIVE_CMD_EXPORT_TRACE = 5
+} DictReceiveCmdVal;
@@ -0,0 +1,152 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#define REDRAW_STATS_IMPL
+#include <pebble.h>
+#include "redraw_stats.h"
+#include "build_config.h"
+#include "match_clock.h"
+
+#if SC_REDRAW_STATS
+
+/**
+ * Repainted area allowed per event, in pixels. A score change should repaint
+ * the changed score and the feedback color, not rebuild the window; a tick 
+ * only the status bar and the match clock.
+ */
+static const uint32_t redraw_budget[REDRAW_EVENT_COUNT] = {
+  [REDRAW_EVENT_INCREMENT] = 144 * 168,
+  [REDRAW_EVENT_DECREMENT] = 144 * 168,
+  [REDRAW_EVENT_RESET] = 144 * 168,
+  [REDRAW_EVENT_SWAP] = 2 * 144 * 168,
+  [REDRAW_EVENT_SETTING] = 2 * 144 * 168,
+  [REDRAW_EVENT_INBOUND] = 144 * 168,
+  [REDRAW_EVENT_TICK] = 144 * 32 + MATCH_CLOCK_WIDTH * MATCH_CLOCK_HEIGHT,
+  [REDRAW_EVENT_OTHER] = 144 * 168,
+};
+
+static const char *event_names[REDRAW_EVENT_COUNT] = {
+  [REDRAW_EVENT_INCREMENT] = "increment",
+  [REDRAW_EVENT_DECREMENT] = "decrement",
+  [REDRAW_EVENT_RESET] = "reset",
+  [REDRAW_EVENT_SWAP] = "swap",
+  [REDRAW_EVENT_SETTING] = "setting",
+  [REDRAW_EVENT_INBOUND] = "inbound",
+  [REDRAW_EVENT_TICK] = "tick",
+  [REDRAW_EVENT_OTHER] = "other",
+};
+
+static RedrawEventStats event_stats[REDRAW_EVENT_COUNT];
+
+/**
+ * The event being accounted. Layers are compared by address only, 
+ * they are never dereferenced after the event has ended.
+ */
+static struct {
+  bool is_open;
+  RedrawEvent event;
+  uint32_t marks;
+  uint32_t area;
+  uint8_t layer_count;
+  const Layer *layers[REDRAW_STATS_MAX_LAYERS];
+  uint8_t site_count;
+  const char *sites[REDRAW_STATS_MAX_SITES];
+} current;
+
+
+static void end_current_event() {
+  if (!current.is_open) {
+    return;
+  }
+  current.is_open = false;
+
+  RedrawEventStats *stats = &event_stats[current.event];
+  stats->marks += current.marks;
+  stats->layers += current.layer_count;
+  stats->area += current.area;
+  if (current.area > stats->max_area) {
+    stats->max_area = current.area;
+  }
+
+  if (current.marks == 0) {
+    return;
+  }
+
+  char sites[96] = "";
+  for (uint8_t i = 0; i < current.site_count; i++) {
+    if (i > 0) {
+      strncat(sites, " ", sizeof(sites) - strlen(sites) - 1);
+    }
+    strncat(sites, current.sites[i], sizeof(sites) - strlen(sites) - 1);
+  }
+
+  if (current.area > redraw_budget[current.event]) {
+    stats->over_budget++;
+    SC_LOG(APP_LOG_LEVEL_WARNING, "Redraw %s: %d layers, %d px over budget %d px (%s)", 
+      event_names[current.event], current.layer_count, (int)current.area, 
+      (int)redraw_budget[current.event], sites);
+  } else {
+    SC_LOG(APP_LOG_LEVEL_DEBUG, "Redraw %s: %d layers, %d px (%s)", 
+      event_names[current.event], current.layer_count, (int)current.area, sites);
+  }
+}
+
+void redraw_stats_begin(RedrawEvent event) {
+  end_current_event();
+
+  memset(&current, 0, sizeof(current));
+  current.is_open = true;
+  current.event = event;
+  event_stats[event].count++;
+}
+
+void redraw_stats_record(Layer *layer, const char *site) {
+  if (!current.is_open || layer == NULL) {
+    return;
+  }
+  current.marks++;
+
+  bool is_new_layer = true;
+  for (uint8_t i = 0; i < current.layer_count && is_new_layer; i++) {
+    is_new_layer = current.layers[i] != layer;
+  }
+  if (is_new_layer && current.layer_count < REDRAW_STATS_MAX_LAYERS) {
+    const GRect frame = layer_get_frame(layer);
+    current.layers[current.layer_count++] = layer;
+    current.area += frame.size.w * frame.size.h;
+  }
+
+  bool is_new_site = true;
+  for (uint8_t i = 0; i < current.site_count && is_new_site; i++) {
+    is_new_site = current.sites[i] != site;
+  }
+  if (is_new_site && current.site_count < REDRAW_STATS_MAX_SITES) {
+    current.sites[current.site_count++] = site;
+  }
+}
+
+const RedrawEventStats *redraw_stats_get(RedrawEvent event) {
+  return &event_stats[event];
+}
+
+const char *redraw_stats_event_name(RedrawEvent event) {
+  return event_names[event];
+}
+
+void redraw_stats_log_summary() {
+  end_current_event();
+
+  for (uint8_t i = 0; i < REDRAW_EVENT_COUNT; i++) {
+    const RedrawEventStats *stats = &event_stats[i];
+    if (stats->count == 0) {
+      continue;
+    }
+    SC_LOG(APP_LOG_LEVEL_INFO, "Redraw %s: %d events, %d marks, %d layers, %d px avg, "
+      "%d px max, %d over budget", event_names[i], (int)stats->count, (int)stats->marks,
+      (int)stats->layers, (int)(stats->area / stats->count), (int)stats->max_area, 
+      (int)stats->over_budget);
+  }
+}
+
+#endif
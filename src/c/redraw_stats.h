@@ -0,0 +1,48 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+#define REDRAW_STATS_MAX_LAYERS 16
+#define REDRAW_STATS_MAX_SITES 6
+
+/**
+ * Input events the repainting is accounted to. Repaints requested later from
+ * timers (color feedback, blinking) are charged to the event that started them.
+ */
+typedef enum {
+  REDRAW_EVENT_INCREMENT,
+  REDRAW_EVENT_DECREMENT,
+  REDRAW_EVENT_RESET,
+  REDRAW_EVENT_SWAP,
+  REDRAW_EVENT_SETTING,
+  REDRAW_EVENT_INBOUND,
+  REDRAW_EVENT_TICK,
+  REDRAW_EVENT_OTHER,
+  REDRAW_EVENT_COUNT
+} RedrawEvent;
+
+typedef struct {
+  uint32_t count;
+  uint32_t marks;
+  uint32_t layers;
+  uint32_t area;
+  uint32_t max_area;
+  uint32_t over_budget;
+} RedrawEventStats;
+
+/**
+ * Redraw accounting, compiled in with SC_REDRAW_STATS (see build_config.h).
+ * Every call that makes the firmware repaint a layer is recorded with the
+ * layer's area and the calling function. When the next event begins, the
+ * distinct layers and area of the previous one are logged and checked 
+ * against its redraw budget.
+ */
+void redraw_stats_begin(RedrawEvent event);
+void redraw_stats_record(Layer *layer, const char *site);
+const RedrawEventStats *redraw_stats_get(RedrawEvent event);
+const char *redraw_stats_event_name(RedrawEvent event);
+void redraw_stats_log_summary();
@@ -8,19 +8,35 @@
 
 
 static Window *s_main_window;
+/**
+ * Alternate view with the live match statistics.
+ */
+static Window *s_stats_window;
+static TextLayer *s_stats_text_layer = NULL;
 static CustomStatusBarLayer *custom_status_bar;
 /**
  * Displayed when the user role is PLAYER.
  */
-static TextLayer *s_my_score_text_layer = NULL;
-static TextLayer *s_opponent_score_text_layer = NULL;
+static ScoreLayer *s_my_score_layer = NULL;
+static ScoreLayer *s_opponent_score_layer = NULL;
 /**
  * Displayed when the user is REFEREE.
  */
-static TextLayer *s_whole_score_text_layer = NULL;
+static ScoreLayer *s_whole_score_layer = NULL;
+
+/**
+ * Pre-rendered digit glyphs for the score layers.
+ */
+static DigitAtlas digits_large;
+static DigitAtlas digits_small;
 
 static Layer *horizontal_ruler_layer = NULL;
 static Layer *score_counter_layer = NULL;
+/**
+ * Match and rally time, below the score.
+ */
+static TextLayer *s_match_clock_layer = NULL;
+static char match_clock_text[MATCH_CLOCK_TEXT_BUFF_SIZE];
 
 static TopBarInfo *top_bar_info;
 static Score *score;
@@ -29,18 +45,181 @@ static ButtonMode btn_mode = NORMAL_MODE;
 static SettingModeSCPosition setting_mode_sc_position;
 
 static AppTimer *blink_sc_timer = NULL;
+static AppTimer *refresh_stats_timer = NULL;
+/**
+ * A select click in NORMAL_MODE waiting whether a second one makes it a
+ * double click.
+ */
+static AppTimer *select_click_timer = NULL;
+
+/**
+ * CommitWork collected since the last commit stage.
+ */
+static uint8_t pending_commit = 0;
+static AppTimer *commit_timer = NULL;
+
+/**
+ * Saving the battery, and the score change waiting for the send window to
+ * close in the meantime.
+ */
+static LowPower low_power;
+static AppTimer *send_timer = NULL;
+/**
+ * A setting changed in SETTING_MODE is shown instead of the time.
+ */
+static bool is_setting_shown = false;
+
+/**
+ * Score events exported through data logging.
+ */
+static EventLog event_log;
+static AppTimer *event_log_timer = NULL;
 
-static bool is_larger_font_in_whole_score;
+#if SC_TRACE
+/**
+ * The trace export asked for by the phone, while the session is busy.
+ */
+static DataLoggingSessionRef trace_session = NULL;
+static AppTimer *trace_export_timer = NULL;
+#endif
+
+#if PBL_API_EXISTS(app_glance_reload)
+/**
+ * The glance text last published to the launcher.
+ */
+static char glance_text[GLANCE_BUFF_SIZE];
+static AppTimer *glance_timer = NULL;
+#endif
+
+/**
+ * ViewInvalidation collected since the last commit_view() pass.
+ */
+static uint8_t invalid_view = 0;
+/**
+ * The layout the main window layers were built for, valid while is_layout_built.
+ */
+static SettingModeSCPosition built_layout;
+static bool is_layout_built = false;
+#ifdef PBL_COLOR
+/**
+ * Requested and applied window background.
+ */
+static GColor8 bg_color;
+static GColor8 window_bg_color;
+#endif
+
+static MatchStats match_stats;
+static MatchClock match_clock;
+/**
+ * The match clock ticks every second only while the main window is shown.
+ */
+static bool is_main_window_visible = false;
+/**
+ * The launch work deferred until the first frame is on screen, see
+ * launch_timer_handler(). Until it has run, the match clock, the score CRDT
+ * and the offline queue are not loaded and the link is not open.
+ */
+static AppTimer *launch_timer = NULL;
+static bool is_launched = false;
+/**
+ * Score changes made while the phone was not connected.
+ */
+static OfflineQueue offline_queue;
+/**
+ * Number of the offline changes in the message in flight, 0 if none.
+ */
+static uint8_t offline_batch_in_flight_ops = 0;
+
+/**
+ * What the phone can do, negotiated by HELLO on every connect.
+ */
+static LinkCaps link_caps;
+static AppTimer *hello_timer = NULL;
+
+/**
+ * A reconnect soon after a disconnect waits for the link to hold.
+ */
+static AppTimer *link_timer = NULL;
+static int64_t last_disconnect_ms = 0;
+static uint16_t inbox_size;
+static uint16_t outbox_size;
+
+/**
+ * Inbound drops and the BACKOFF owed to the phone for them.
+ */
+static Backpressure backpressure;
+static AppTimer *backoff_timer = NULL;
+
+/**
+ * Round-trip time and clock offset to the phone.
+ */
+static ClockSync clock_sync;
+static AppTimer *clock_sync_timer = NULL;
+
+/**
+ * The score in the transfer orientation as a PN-counter, merged with the
+ * other watches, and the id of this watch in it.
+ */
+static PnCounter score_crdt;
+static uint32_t device_id;
+
+/**
+ * The launch state, rewritten with every point, spread over several keys.
+ * Set while the record read at launch is still under S_LAUNCH_STATE_KEY or 
+ * the keys before it.
+ */
+static StateLog launch_log;
+static bool is_launch_state_moved = false;
+
+/**
+ * The sport the match is played by and the sets and games won, in the
+ * orientation of score_1 and score_2.
+ */
+static SportState sport;
+
+static InboxDecoder inbox_decoder;
+static char stats_text[MATCH_STATS_TEXT_BUFF_SIZE];
+
+static bool is_larger_atlas_in_whole_score;
 static bool is_score_swapped = false;
 
 
-static void send_msg(DictSendCmdVal cmd_val) {
-  // If not connected, do not continue.
-  if (!connection_service_peek_pebble_app_connection()) {
-    set_bg_color_on_colored_screen(GColorPurple);
+static void write_score_crdt(DictionaryIterator *iter) {
+  if (!link_caps_has(&link_caps, PROTOCOL_FEATURE_SCORE_CRDT)) {
     return;
   }
 
+  uint8_t crdt[PN_COUNTER_WIRE_MAX_SIZE];
+  uint16_t crdt_size = pn_counter_write_wire(&score_crdt, crdt, sizeof(crdt));
+
+  Tuplet crdt_tuplet = TupletBytes(SEND_SCORE_CRDT_KEY, crdt, crdt_size);
+  dict_write_tuplet(iter, &crdt_tuplet);
+}
+
+static void write_sport(DictionaryIterator *iter) {
+  if (!link_caps_has(&link_caps, PROTOCOL_FEATURE_SPORT)) {
+    return;
+  }
+
+  uint8_t sport_bytes[SPORT_WIRE_SIZE];
+  sport_write_wire(&sport, should_swap_before_send_or_after_receive(), sport_bytes);
+
+  Tuplet sport_tuplet = TupletBytes(SEND_SPORT_KEY, sport_bytes, sizeof(sport_bytes));
+  dict_write_tuplet(iter, &sport_tuplet);
+}
+
+/**
+ * A busy outbox only means the previous message is still in flight, the
+ * caller sends again later, so it is not logged as an error.
+ */
+static uint8_t outbox_log_level(AppMessageResult result_code) {
+  return result_code == APP_MSG_BUSY ? APP_LOG_LEVEL_DEBUG : APP_LOG_LEVEL_ERROR;
+}
+
+/**
+ * Return false when the message could not be sent nor recorded offline.
+ */
+static bool send_msg(DictSendCmdVal cmd_val) {
   uint16_t score_1_to_transfer;
   uint16_t score_2_to_transfer;
   if (should_swap_before_send_or_after_receive()) {
@@ -51,31 +230,429 @@ static void send_msg(DictSendCmdVal cmd_val) {
     score_2_to_transfer = score->score_2;
   }
 
+  // If not connected, record the change to be replayed on reconnect
+  // and do not continue.
+  if (!connection_service_peek_pebble_app_connection()) {
+    if (cmd_val == SEND_CMD_SET_SCORE_VAL) {
+      offline_queue_push(&offline_queue, S_OFFLINE_QUEUE_KEY, 
+        (uint32_t)score->timestamp, score_1_to_transfer, score_2_to_transfer);
+    }
+    set_bg_color_on_colored_screen(GColorPurple);
+    return true;
+  }
+
+  // The timestamp is sent in the shared (phone) timeline.
+  int64_t timestamp_ms = clock_sync_local_to_shared_ms(&clock_sync, 
+    (int64_t)score->timestamp * 1000 + score->timestamp_ms);
+
   Tuplet cmd_tuplet = TupletInteger(SEND_CMD_KEY, (uint8_t)cmd_val);
-  Tuplet score1_tuplet = TupletInteger(SEND_SCORE_1_KEY, score_1_to_transfer);
-  Tuplet score2_tuplet = TupletInteger(SEND_SCORE_2_KEY, score_2_to_transfer);
-  Tuplet timestamp_tuplet = TupletInteger(SEND_TIMESTAMP_KEY, (unsigned int)score->timestamp);
 
   DictionaryIterator *iter;
   AppMessageResult result_code = app_message_outbox_begin(&iter);
 
   if (result_code == APP_MSG_OK) {
     dict_write_tuplet(iter, &cmd_tuplet);
-    dict_write_tuplet(iter, &score1_tuplet);
-    dict_write_tuplet(iter, &score2_tuplet);
-    dict_write_tuplet(iter, &timestamp_tuplet);
+
+    if (link_caps_has(&link_caps, PROTOCOL_FEATURE_PACKED_SCORE)) {
+      uint8_t packed[PACKED_SCORE_SIZE];
+      link_caps_write_packed_score(packed, score_1_to_transfer, score_2_to_transfer, 
+        timestamp_ms);
+
+      Tuplet packed_tuplet = TupletBytes(SEND_PACKED_SCORE_KEY, packed, sizeof(packed));
+      dict_write_tuplet(iter, &packed_tuplet);
+    } else {
+      Tuplet score1_tuplet = TupletInteger(SEND_SCORE_1_KEY, score_1_to_transfer);
+      Tuplet score2_tuplet = TupletInteger(SEND_SCORE_2_KEY, score_2_to_transfer);
+      Tuplet timestamp_tuplet = TupletInteger(SEND_TIMESTAMP_KEY, 
+        (unsigned int)(timestamp_ms / 1000));
+      Tuplet timestamp_ms_tuplet = TupletInteger(SEND_TIMESTAMP_MS_KEY, 
+        (uint16_t)(timestamp_ms % 1000));
+
+      dict_write_tuplet(iter, &score1_tuplet);
+      dict_write_tuplet(iter, &score2_tuplet);
+      dict_write_tuplet(iter, &timestamp_tuplet);
+      dict_write_tuplet(iter, &timestamp_ms_tuplet);
+    }
+
+    write_score_crdt(iter);
+    write_sport(iter);
+
+    if (cmd_val == SEND_CMD_SYNC_SCORE_VAL 
+      && link_caps_has(&link_caps, PROTOCOL_FEATURE_STATS)) {
+
+      // Sync also carries the live match statistics.
+      MatchStatsWire stats_wire;
+      match_stats_to_wire(&match_stats, time(NULL), 
+        should_swap_before_send_or_after_receive(), &stats_wire);
+
+      Tuplet stats_tuplet = TupletBytes(SEND_STATS_KEY, 
+        (const uint8_t *)&stats_wire, sizeof(stats_wire));
+      dict_write_tuplet(iter, &stats_tuplet);
+    }
 
     dict_write_end(iter);
 
     result_code = app_message_outbox_send();
 
     if (result_code != APP_MSG_OK) {
-      APP_LOG(APP_LOG_LEVEL_ERROR, "Error sending the outbox: %d", (int)result_code);
+      SC_LOG(outbox_log_level(result_code), "Error sending the outbox: %d", (int)result_code);
       set_bg_color_on_colored_screen(GColorOrange);
     } 
   } else {
-    APP_LOG(APP_LOG_LEVEL_ERROR, "Error preparing the outbox: %d", (int)result_code);
+    SC_LOG(outbox_log_level(result_code), "Error preparing the outbox: %d", (int)result_code);
   }
+
+  return result_code == APP_MSG_OK;
+}
+
+/**
+ * Replay the changes recorded while offline with their original timestamps,
+ * oldest first in batches as large as the phone takes. The legacy score keys
+ * carry the latest recorded change, so a phone without batch support still
+ * converges to the right score; such a phone gets just that as SET.
+ * Return false if there was nothing to replay or the outbox was not ready.
+ */
+static bool send_offline_batch() {
+  const OfflineOp *latest = offline_queue_latest(&offline_queue);
+
+  if (latest == NULL || offline_batch_in_flight_ops > 0) {
+    return false;
+  }
+
+  // The recorded timestamps are moved to the shared (phone) timeline.
+  int32_t timestamp_offset = clock_sync.offset_ms / 1000;
+
+  uint8_t batch[OFFLINE_QUEUE_CAPACITY * sizeof(OfflineOp)];
+  uint16_t batch_size = offline_queue_serialize(&offline_queue, batch, 
+    link_caps.batch_ops * sizeof(OfflineOp), timestamp_offset);
+
+  Tuplet cmd_tuplet = TupletInteger(SEND_CMD_KEY, 
+    (uint8_t)(batch_size > 0 ? SEND_CMD_BATCH_SCORE_VAL : SEND_CMD_SET_SCORE_VAL));
+  Tuplet score1_tuplet = TupletInteger(SEND_SCORE_1_KEY, latest->score_1);
+  Tuplet score2_tuplet = TupletInteger(SEND_SCORE_2_KEY, latest->score_2);
+  Tuplet timestamp_tuplet = TupletInteger(SEND_TIMESTAMP_KEY, 
+    (uint32_t)(latest->timestamp + timestamp_offset));
+  Tuplet batch_tuplet = TupletBytes(SEND_BATCH_KEY, batch, batch_size);
+
+  DictionaryIterator *iter;
+  AppMessageResult result_code = app_message_outbox_begin(&iter);
+
+  if (result_code != APP_MSG_OK) {
+    SC_LOG(outbox_log_level(result_code), "Error preparing the outbox: %d", (int)result_code);
+    return false;
+  }
+
+  dict_write_tuplet(iter, &cmd_tuplet);
+  dict_write_tuplet(iter, &score1_tuplet);
+  dict_write_tuplet(iter, &score2_tuplet);
+  dict_write_tuplet(iter, &timestamp_tuplet);
+  if (batch_size > 0) {
+    dict_write_tuplet(iter, &batch_tuplet);
+  }
+  write_score_crdt(iter);
+
+  dict_write_end(iter);
+
+  result_code = app_message_outbox_send();
+
+  if (result_code != APP_MSG_OK) {
+    SC_LOG(outbox_log_level(result_code), "Error sending the outbox: %d", (int)result_code);
+    set_bg_color_on_colored_screen(GColorOrange);
+    return false;
+  }
+
+  // Without a batch, the latest change stands for all of them.
+  offline_batch_in_flight_ops = batch_size > 0 
+    ? batch_size / sizeof(OfflineOp) : offline_queue.count;
+
+  SC_LOG(APP_LOG_LEVEL_INFO, "Replaying %d of %d offline changes", 
+    (int)offline_batch_in_flight_ops, (int)offline_queue.count);
+
+  return true;
+}
+
+/**
+ * After (re)connecting, the offline changes take priority over a plain sync.
+ */
+static void send_sync_or_offline_batch() {
+  if (!send_offline_batch()) {
+    send_msg(SEND_CMD_SYNC_SCORE_VAL);
+  }
+}
+
+static bool send_hello() {
+  DictionaryIterator *iter;
+  AppMessageResult result_code = app_message_outbox_begin(&iter);
+
+  if (result_code == APP_MSG_OK) {
+    link_caps_write_hello(iter, SUPPORTED_FEATURES, inbox_size, outbox_size);
+    dict_write_end(iter);
+
+    result_code = app_message_outbox_send();
+  }
+
+  if (result_code != APP_MSG_OK) {
+    SC_LOG(outbox_log_level(result_code), "Error sending hello: %d", (int)result_code);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Introduce the watch to a (re)connected phone. The score goes out once the
+ * phone answers, or in the legacy protocol when it does not in time.
+ */
+static void start_link() {
+  link_caps_init_legacy(&link_caps, outbox_size);
+
+  if (hello_timer != NULL) {
+    app_timer_cancel(hello_timer);
+    hello_timer = NULL;
+  }
+
+  if (send_hello()) {
+    hello_timer = app_timer_register(HELLO_TIMEOUT_MS, hello_timer_handler, NULL);
+  } else {
+    send_sync_or_offline_batch();
+  }
+}
+
+static void link_timer_handler(void *context) {
+  link_timer = NULL;
+
+  start_link();
+  // The clock offset of a moment ago still holds.
+  schedule_clock_sync_probe(clock_sync.samples > 0 
+    ? clock_sync_probe_interval_ms() : CLOCK_SYNC_FIRST_PROBE_MS);
+
+  commit_view();
+}
+
+static void hello_timer_handler(void *context) {
+  hello_timer = NULL;
+
+  SC_LOG(APP_LOG_LEVEL_INFO, "No hello from the phone, using the legacy protocol");
+  send_sync_or_offline_batch();
+
+  commit_view();
+}
+
+/**
+ * Whether the phone already has the score of this watch, as its digest in
+ * the HELLO answer says.
+ */
+static bool is_phone_in_sync(const InboxCommand *command) {
+  if (!(command->fields & INBOX_FIELD_DIGEST) 
+    || !link_caps_has(&link_caps, PROTOCOL_FEATURE_DIGEST) || offline_queue.count > 0) {
+    return false;
+  }
+
+  bool is_swapped = should_swap_before_send_or_after_receive();
+  uint8_t sport_bytes[SPORT_WIRE_SIZE];
+  sport_write_wire(&sport, is_swapped, sport_bytes);
+
+  StateDigest digest;
+  state_digest_compute(&digest, is_swapped ? score->score_2 : score->score_1, 
+    is_swapped ? score->score_1 : score->score_2, 
+    link_caps_has(&link_caps, PROTOCOL_FEATURE_SCORE_CRDT) ? &score_crdt : NULL,
+    link_caps_has(&link_caps, PROTOCOL_FEATURE_SPORT) ? sport_bytes : NULL);
+
+  return state_digest_equals(&digest, &command->digest);
+}
+
+static void handle_hello(const InboxCommand *command) {
+  link_caps_on_hello(&link_caps, command, SUPPORTED_FEATURES, outbox_size);
+
+  SC_LOG(APP_LOG_LEVEL_INFO, "Phone protocol v%d, features 0x%x, messages up to %d B, "
+    "batches of %d", (int)link_caps.peer_version, (unsigned int)link_caps.features, 
+    (int)link_caps.max_message_size, (int)link_caps.batch_ops);
+
+  if (hello_timer != NULL) {
+    // The answer to ours.
+    app_timer_cancel(hello_timer);
+    hello_timer = NULL;
+
+    if (is_phone_in_sync(command)) {
+      SC_LOG(APP_LOG_LEVEL_INFO, "Phone in sync, nothing to send");
+    } else {
+      send_sync_or_offline_batch();
+    }
+  } else {
+    // The phone app (re)started and introduced itself.
+    send_hello();
+  }
+}
+
+/**
+ * Tell the phone about the dropped messages and how long to hold off.
+ * With the outbox busy, try again shortly; later drops just add to the
+ * count of the BACKOFF still owed.
+ */
+static void send_backoff() {
+  if (!backpressure_is_backoff_due(&backpressure) || backoff_timer != NULL 
+    || !connection_service_peek_pebble_app_connection() 
+    || !link_caps_has(&link_caps, PROTOCOL_FEATURE_BACKOFF)) {
+    return;
+  }
+
+  DictionaryIterator *iter;
+  AppMessageResult result_code = app_message_outbox_begin(&iter);
+
+  if (result_code == APP_MSG_OK) {
+    backpressure_write_backoff(&backpressure, iter);
+    dict_write_end(iter);
+
+    result_code = app_message_outbox_send();
+  }
+
+  if (result_code != APP_MSG_OK) {
+    backoff_timer = app_timer_register(BACKOFF_SEND_RETRY_MS, backoff_timer_handler, NULL);
+  }
+}
+
+static void backoff_timer_handler(void *context) {
+  backoff_timer = NULL;
+  send_backoff();
+
+  commit_view();
+}
+
+/**
+ * Ping the phone to measure the round-trip time and the clock offset.
+ * The phone answers with a pong carrying t0 back together with its own
+ * receive (t1) and send (t2) timestamps.
+ */
+static void send_ping() {
+  if (!connection_service_peek_pebble_app_connection() 
+    || !link_caps_has(&link_caps, PROTOCOL_FEATURE_PING)) {
+    return;
+  }
+
+  int64_t t0 = clock_sync_now_ms();
+  uint8_t t0_bytes[CLOCK_SYNC_TIMESTAMP_SIZE];
+  clock_sync_write_timestamp(t0, t0_bytes);
+
+  Tuplet cmd_tuplet = TupletInteger(SEND_CMD_KEY, (uint8_t)SEND_CMD_PING);
+  Tuplet t0_tuplet = TupletBytes(SEND_PING_T0_KEY, t0_bytes, sizeof(t0_bytes));
+
+  DictionaryIterator *iter;
+  AppMessageResult result_code = app_message_outbox_begin(&iter);
+
+  if (result_code == APP_MSG_OK) {
+    dict_write_tuplet(iter, &cmd_tuplet);
+    dict_write_tuplet(iter, &t0_tuplet);
+
+    dict_write_end(iter);
+
+    result_code = app_message_outbox_send();
+  }
+
+  if (result_code != APP_MSG_OK) {
+    // Most likely a score message is still in flight, try again shortly.
+    schedule_clock_sync_probe(CLOCK_SYNC_RETRY_MS);
+    return;
+  }
+
+  clock_sync_on_probe_sent(&clock_sync, t0);
+  schedule_clock_sync_probe(CLOCK_SYNC_PROBE_TIMEOUT_MS);
+}
+
+static uint32_t clock_sync_probe_interval_ms() {
+  return low_power_is_active(&low_power) 
+    ? LOW_POWER_CLOCK_SYNC_PROBE_INTERVAL_MS : CLOCK_SYNC_PROBE_INTERVAL_MS;
+}
+
+static void schedule_clock_sync_probe(uint32_t delay_ms) {
+  if (clock_sync_timer != NULL) {
+    app_timer_cancel(clock_sync_timer);
+  }
+  clock_sync_timer = app_timer_register(delay_ms, clock_sync_timer_handler, NULL);
+}
+
+static void clock_sync_timer_handler(void *context) {
+  clock_sync_timer = NULL;
+
+  if (clock_sync_is_probe_pending(&clock_sync)) {
+    // No pong in time.
+    clock_sync_on_probe_lost(&clock_sync);
+    update_link_status();
+    schedule_clock_sync_probe(clock_sync_probe_interval_ms());
+  } else {
+    send_ping();
+  }
+
+  commit_view();
+}
+
+static void handle_pong(const InboxCommand *command, int64_t t3) {
+  if (clock_sync_on_pong(&clock_sync, 
+    command->ping_t0, command->pong_t1, command->pong_t2, t3)) {
+
+    SC_LOG(APP_LOG_LEVEL_DEBUG, "RTT %d ms, offset %d ms", 
+      (int)clock_sync.last_rtt_ms, (int)clock_sync.offset_ms);
+
+    update_link_status();
+    schedule_clock_sync_probe(clock_sync_probe_interval_ms());
+  }
+}
+
+/**
+ * Show the link quality in the status bar once it is measured.
+ */
+static void update_link_status() {
+  if (!connection_service_peek_pebble_app_connection()) {
+    strncpy(top_bar_info->connection, NO_LINK_TXT, CONN_BUFF_SIZE);
+  } else if (clock_sync.samples == 0) {
+    strncpy(top_bar_info->connection, LINKED_TXT, CONN_BUFF_SIZE);
+  } else {
+    snprintf(top_bar_info->connection, CONN_BUFF_SIZE, LINK_QUALITY_FORMAT, 
+      clock_sync.link_quality);
+  }
+
+  invalidate_view(VIEW_STATUS_LINK);
+}
+
+static void stamp_score() {
+  time_ms(&score->timestamp, &score->timestamp_ms);
+}
+
+/**
+ * Count a change of the score made on this watch into the CRDT, in the
+ * orientation the score is transferred in.
+ */
+static void record_score_change() {
+  bool is_swapped = should_swap_before_send_or_after_receive();
+
+  pn_counter_set(&score_crdt, device_id, 0, is_swapped ? score->score_2 : score->score_1);
+  pn_counter_set(&score_crdt, device_id, 1, is_swapped ? score->score_1 : score->score_2);
+}
+
+/**
+ * Team of a score on this watch (0 for score_1, 1 for score_2) in the
+ * orientation the score is transferred in.
+ */
+static uint8_t transferred_team(uint8_t team) {
+  return should_swap_before_send_or_after_receive() ? 1 - team : team;
+}
+
+/**
+ * Record an event with the current score for the export, logged in the
+ * commit stage. Call after stamp_score().
+ */
+static void log_score_event(ScoreEventType type, uint8_t detail) {
+  bool is_swapped = should_swap_before_send_or_after_receive();
+  ScoreEvent event = {
+    .timestamp_ms = clock_sync_local_to_shared_ms(&clock_sync, 
+      (int64_t)score->timestamp * 1000 + score->timestamp_ms),
+    .type = type,
+    .detail = detail,
+    .score_1 = is_swapped ? score->score_2 : score->score_1,
+    .score_2 = is_swapped ? score->score_1 : score->score_2
+  };
+
+  event_log_add(&event_log, &event);
+  schedule_commit(COMMIT_LOG_EVENTS);
 }
 
 static void horizontal_ruler_update_proc(Layer *layer, GContext *ctx) {
@@ -95,7 +672,7 @@ static void sc_update_proc(Layer *layer, GContext *ctx) {
   graphics_fill_rect(ctx, GRect(0, 0, bounds.size.w, bounds.size.h), 4, GCornersAll);
 }
 
-static int16_t calc_score_text_layer_y_coord(GRect parent_layer_bounds, 
+static int16_t calc_score_layer_y_coord(GRect parent_layer_bounds, 
   ScoreOnSmartwatch which_score, int16_t height) {
   
   int16_t y;
@@ -118,11 +695,11 @@ static int16_t calc_score_text_layer_y_coord(GRect parent_layer_bounds,
   return y;
 }
 
-static GRect init_score_text_layer(Layer *parent_layer, TextLayer **text_layer,
-  int16_t h, char *font_key, ScoreOnSmartwatch which_score) {
+static GRect init_score_layer(Layer *parent_layer, ScoreLayer **score_layer,
+  int16_t h, const DigitAtlas *atlas, ScoreOnSmartwatch which_score) {
 
   const GRect bounds = layer_get_bounds(parent_layer);
-  int16_t y = calc_score_text_layer_y_coord(bounds, which_score, h);
+  int16_t y = calc_score_layer_y_coord(bounds, which_score, h);
 
   GRect frame;
   if (which_score == WHOLE_SCORE) {
@@ -132,64 +709,61 @@ static GRect init_score_text_layer(Layer *parent_layer, TextLayer **text_layer,
       bounds.size.w - 2 * (MARGIN + SC_SHORTER_DIMENSION), h);
   }
 
-  *text_layer = text_layer_create(frame);
-  text_layer_set_text_color(*text_layer, GColorBlack);
-  text_layer_set_font(*text_layer, fonts_get_system_font(font_key));
-  text_layer_set_text_alignment(*text_layer, GTextAlignmentCenter);
-  layer_add_child(parent_layer, text_layer_get_layer(*text_layer));
+  *score_layer = score_layer_create(frame, atlas);
+  layer_add_child(parent_layer, *score_layer);
 
   return frame;
 }
 
-static void init_separate_score_text_layers(Layer *window_layer) {
-  init_score_text_layer(window_layer, &s_opponent_score_text_layer, 
-    SCORE_TEXT_RECT_HEIGHT, FONT_KEY_LECO_36_BOLD_NUMBERS, OPPONENT_SCORE);
-  init_score_text_layer(window_layer, &s_my_score_text_layer, 
-    SCORE_TEXT_RECT_HEIGHT, FONT_KEY_LECO_36_BOLD_NUMBERS, MY_SCORE);
+static void init_separate_score_layers(Layer *window_layer) {
+  init_score_layer(window_layer, &s_opponent_score_layer, 
+    SCORE_RECT_HEIGHT, &digits_large, OPPONENT_SCORE);
+  init_score_layer(window_layer, &s_my_score_layer, 
+    SCORE_RECT_HEIGHT, &digits_large, MY_SCORE);
 
-  text_layer_set_text(s_my_score_text_layer, score->score_1_text);
-  text_layer_set_text(s_opponent_score_text_layer, score->score_2_text);      
+  score_layer_set_text(s_my_score_layer, score->score_1_text);
+  score_layer_set_text(s_opponent_score_layer, score->score_2_text);      
 }
 
-static void init_whole_score_text_layer(Layer *window_layer) {
-  is_larger_font_in_whole_score = score->score_1 <= LARGER_FONT_SCORE_LIMIT 
-    || score->score_2 <= LARGER_FONT_SCORE_LIMIT;
+static void init_whole_score_layer(Layer *window_layer) {
+  is_larger_atlas_in_whole_score = score->score_1 <= LARGER_DIGITS_SCORE_LIMIT 
+    && score->score_2 <= LARGER_DIGITS_SCORE_LIMIT;
 
-  init_score_text_layer(window_layer, &s_whole_score_text_layer, 
-    WHOLE_SCORE_TEXT_RECT_HEIGHT, 
-    is_larger_font_in_whole_score ? FONT_KEY_LECO_38_BOLD_NUMBERS : FONT_KEY_LECO_32_BOLD_NUMBERS,
+  init_score_layer(window_layer, &s_whole_score_layer, 
+    WHOLE_SCORE_RECT_HEIGHT, 
+    is_larger_atlas_in_whole_score ? &digits_large : &digits_small,
     WHOLE_SCORE);
 
-  text_layer_set_text(s_whole_score_text_layer, score->whole_score_text);
+  score_layer_set_text(s_whole_score_layer, score->whole_score_text);
 }
 
-static void init_score_text_layers(Layer *window_layer) {
-  if (s_whole_score_text_layer != NULL) {
-    text_layer_destroy(s_whole_score_text_layer);
-    s_whole_score_text_layer = NULL;
+static void init_score_layers(Layer *window_layer) {
+  if (s_whole_score_layer != NULL) {
+    score_layer_destroy(s_whole_score_layer);
+    s_whole_score_layer = NULL;
   }
-  if (s_opponent_score_text_layer != NULL) {
-    text_layer_destroy(s_opponent_score_text_layer);
-    s_opponent_score_text_layer = NULL;
+  if (s_opponent_score_layer != NULL) {
+    score_layer_destroy(s_opponent_score_layer);
+    s_opponent_score_layer = NULL;
   }
-  if (s_my_score_text_layer != NULL) {
-    text_layer_destroy(s_my_score_text_layer);
-    s_my_score_text_layer = NULL;
+  if (s_my_score_layer != NULL) {
+    score_layer_destroy(s_my_score_layer);
+    s_my_score_layer = NULL;
   }
 
   // SETTING_MODE has priority
   if (btn_mode == SETTING_MODE) {
     if (setting_mode_sc_position == SC_SET_LEFT 
       || setting_mode_sc_position == SC_SET_RIGHT) {
-        init_separate_score_text_layers(window_layer);
+        init_separate_score_layers(window_layer);
     } else {
-        init_whole_score_text_layer(window_layer);
+        init_whole_score_layer(window_layer);
     }
   } else { // NORMAL_MODE
     if (score->user_role == PLAYER) {
-      init_separate_score_text_layers(window_layer);
+      init_separate_score_layers(window_layer);
     } else {
-      init_whole_score_text_layer(window_layer);
+      init_whole_score_layer(window_layer);
     }
   }
 }
@@ -266,21 +840,147 @@ static void init_score_counter_layer(Layer *window_layer) {
 }
 
 static void init_ruler_layer(Layer *window_layer) {
+  if (horizontal_ruler_layer != NULL) {
+    layer_destroy(horizontal_ruler_layer);
+    horizontal_ruler_layer = NULL;
+  }
+
   if ((btn_mode == SETTING_MODE && 
     (setting_mode_sc_position == SC_SET_LEFT || setting_mode_sc_position == SC_SET_RIGHT)) 
       || (btn_mode == NORMAL_MODE && score->user_role == PLAYER)) {
         
     const GRect bounds = layer_get_bounds(window_layer);
 
-    horizontal_ruler_layer = layer_create(GRect(MARGIN + SC_SHORTER_DIMENSION + MARGIN, 
-      (bounds.size.h - STATUS_BAR_HEIGHT) / 2 + STATUS_BAR_HEIGHT - 2, 
-      bounds.size.w - 2 * (MARGIN + SC_SHORTER_DIMENSION + MARGIN), 4));
-    layer_set_update_proc(horizontal_ruler_layer, horizontal_ruler_update_proc);
-    layer_add_child(window_layer, horizontal_ruler_layer);
-  } else {
-    if (horizontal_ruler_layer != NULL) {
-      layer_destroy(horizontal_ruler_layer);
-      horizontal_ruler_layer = NULL;
+    horizontal_ruler_layer = layer_create(GRect(MARGIN + SC_SHORTER_DIMENSION + MARGIN, 
+      (bounds.size.h - STATUS_BAR_HEIGHT) / 2 + STATUS_BAR_HEIGHT - 2, 
+      bounds.size.w - 2 * (MARGIN + SC_SHORTER_DIMENSION + MARGIN), 4));
+    layer_set_update_proc(horizontal_ruler_layer, horizontal_ruler_update_proc);
+    layer_add_child(window_layer, horizontal_ruler_layer);
+  }
+}
+
+/**
+ * Score Counter position for the NORMAL_MODE configuration.
+ */
+static SettingModeSCPosition normal_mode_sc_position() {
+  if (score->user_role == PLAYER) {
+    return score->sc_2_player_position == LEFT_EDGE ? SC_SET_LEFT : SC_SET_RIGHT;
+  } else {
+    return score->sc_2_referee_position == SAME_SIDE ? SC_SET_BOTTOM : SC_SET_TOP;
+  }
+}
+
+/**
+ * The Score Counter position determines the whole layout, in both modes.
+ */
+static SettingModeSCPosition current_layout() {
+  return btn_mode == SETTING_MODE ? setting_mode_sc_position : normal_mode_sc_position();
+}
+
+/**
+ * Below the score layers, clear of the Score Counter: at the bottom edge with
+ * the separate scores, above the bottom Score Counter with the whole score.
+ */
+static void place_match_clock_layer(Layer *window_layer) {
+  const GRect bounds = layer_get_bounds(window_layer);
+  SettingModeSCPosition layout = current_layout();
+  int16_t y;
+
+  if (layout == SC_SET_LEFT || layout == SC_SET_RIGHT) {
+    y = bounds.size.h - MATCH_CLOCK_HEIGHT;
+  } else {
+    y = bounds.size.h - MARGIN - SC_SHORTER_DIMENSION - MARGIN - MATCH_CLOCK_HEIGHT;
+  }
+
+  layer_set_frame(text_layer_get_layer(s_match_clock_layer), 
+    GRect(bounds.size.w / 2 - MATCH_CLOCK_WIDTH / 2, y, MATCH_CLOCK_WIDTH, MATCH_CLOCK_HEIGHT));
+}
+
+static void build_layout(Layer *window_layer) {
+  init_ruler_layer(window_layer);
+  init_score_counter_layer(window_layer);
+  init_score_layers(window_layer);
+  place_match_clock_layer(window_layer);
+
+  built_layout = current_layout();
+  is_layout_built = true;
+}
+
+/**
+ * Changes to the view are only marked here. They are applied by commit_view()
+ * at the end of the event, so marking the same part again is free.
+ */
+static void invalidate_view(uint8_t parts) {
+  invalid_view |= parts;
+}
+
+/**
+ * Bring the view up to date with everything marked during the event, with
+ * the least work: the layers are rebuilt only when the layout really
+ * differs from the built one, the texts and colors only set when changed.
+ */
+static void commit_view() {
+  uint8_t parts = invalid_view;
+
+  invalid_view = 0;
+
+  // Nothing to update while the main window is not loaded.
+  if (!is_layout_built) {
+    return;
+  }
+
+  Layer *window_layer = window_get_root_layer(s_main_window);
+
+  if (parts & VIEW_SCORE_TEXT) {
+    format_score_text();
+  }
+  if ((parts & VIEW_LAYOUT) && built_layout != current_layout()) {
+    build_layout(window_layer);
+    // The new score layers start with the default background.
+    parts |= VIEW_COLORS;
+  }
+  if (parts & VIEW_SCORE_TEXT) {
+    if (s_my_score_layer != NULL) {
+      score_layer_set_text(s_my_score_layer, score->score_1_text);
+    }
+    if (s_opponent_score_layer != NULL) {
+      score_layer_set_text(s_opponent_score_layer, score->score_2_text);
+    }
+    if (s_whole_score_layer != NULL) {
+      score_layer_set_text(s_whole_score_layer, score->whole_score_text);
+    }
+  }
+#ifdef PBL_COLOR
+  if (parts & VIEW_COLORS) {
+    apply_bg_color();
+  }
+#endif
+  if (parts & VIEW_STATUS_LINK) {
+    custom_status_bar_layer_set_text(custom_status_bar, CSB_TEXT_LEFT, top_bar_info->connection);
+  }
+  if (parts & VIEW_STATUS_TIME) {
+    custom_status_bar_layer_set_text(custom_status_bar, CSB_TEXT_CENTER, top_bar_info->time);
+  }
+  if (parts & VIEW_STATUS_BATTERY) {
+    custom_status_bar_layer_set_text(custom_status_bar, CSB_TEXT_RIGHT, top_bar_info->battery_charge);
+  }
+  if (parts & VIEW_MATCH_CLOCK) {
+    char text[MATCH_CLOCK_TEXT_BUFF_SIZE];
+
+    if (sport_has_units(&sport)) {
+      // The sets and games won take the place of the rally time.
+      size_t length = sport_format_units(&sport, text, sizeof(text));
+      match_clock_format_match(&match_clock, time(NULL), low_power_is_active(&low_power), 
+        text + length, sizeof(text) - length);
+    } else {
+      match_clock_format(&match_clock, time(NULL), low_power_is_active(&low_power), 
+        text, sizeof(text));
+    }
+
+    // Only the clock region is repainted, and only when the text changed.
+    if (strcmp(text, match_clock_text) != 0) {
+      strncpy(match_clock_text, text, MATCH_CLOCK_TEXT_BUFF_SIZE);
+      text_layer_set_text(s_match_clock_layer, match_clock_text);
     }
   }
 }
@@ -288,58 +988,131 @@ static void init_ruler_layer(Layer *window_layer) {
 static void main_window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
 
+  digit_atlas_load(&digits_large, RESOURCE_ID_DIGITS_LARGE, 
+    DIGITS_LARGE_WIDTH, DIGITS_LARGE_COLON_WIDTH, DIGITS_LARGE_HEIGHT);
+  digit_atlas_load(&digits_small, RESOURCE_ID_DIGITS_SMALL, 
+    DIGITS_SMALL_WIDTH, DIGITS_SMALL_COLON_WIDTH, DIGITS_SMALL_HEIGHT);
+
+#ifdef PBL_COLOR
+  bg_color = GColorWhite;
+  window_bg_color = GColorWhite;
+#endif
+
   init_status_bar(window_layer);
-  init_ruler_layer(window_layer);
-  init_score_counter_layer(window_layer);
-  init_score_text_layers(window_layer);
+
+  // Empty until the launch has loaded the clock.
+  s_match_clock_layer = text_layer_create(GRect(0, 0, MATCH_CLOCK_WIDTH, MATCH_CLOCK_HEIGHT));
+  text_layer_set_background_color(s_match_clock_layer, GColorClear);
+  text_layer_set_text_color(s_match_clock_layer, GColorBlack);
+  text_layer_set_font(s_match_clock_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD));
+  text_layer_set_text_alignment(s_match_clock_layer, GTextAlignmentCenter);
+  text_layer_set_text(s_match_clock_layer, match_clock_text);
+  layer_add_child(window_layer, text_layer_get_layer(s_match_clock_layer));
+
+  build_layout(window_layer);
 }
 
 static void main_window_unload(Window *window) {
+  is_layout_built = false;
+
   custom_status_bar_layer_destroy(custom_status_bar);
 
-  if (s_my_score_text_layer != NULL) {
-    text_layer_destroy(s_my_score_text_layer);
+  text_layer_destroy(s_match_clock_layer);
+  s_match_clock_layer = NULL;
+
+  if (s_my_score_layer != NULL) {
+    score_layer_destroy(s_my_score_layer);
+    s_my_score_layer = NULL;
   }
-  if (s_opponent_score_text_layer != NULL) {
-    text_layer_destroy(s_opponent_score_text_layer);
+  if (s_opponent_score_layer != NULL) {
+    score_layer_destroy(s_opponent_score_layer);
+    s_opponent_score_layer = NULL;
   }
-  if (s_whole_score_text_layer != NULL) {
-    text_layer_destroy(s_whole_score_text_layer);
+  if (s_whole_score_layer != NULL) {
+    score_layer_destroy(s_whole_score_layer);
+    s_whole_score_layer = NULL;
   }
+
+  digit_atlas_unload(&digits_large);
+  digit_atlas_unload(&digits_small);
   
-  if (score->user_role == PLAYER && horizontal_ruler_layer != NULL) {
+  // The ruler may be left from a SETTING_MODE layout, whatever the user role.
+  if (horizontal_ruler_layer != NULL) {
     layer_destroy(horizontal_ruler_layer);
+    horizontal_ruler_layer = NULL;
+  }
+  if (score_counter_layer != NULL) {
+    layer_destroy(score_counter_layer);
+    score_counter_layer = NULL;
   }
 
   free(top_bar_info);
   free(score);
 }
 
+static void main_window_appear(Window *window) {
+  is_main_window_visible = true;
+
+  // At launch, the clock is loaded and ticking once the first frame is shown.
+  if (is_launched) {
+    subscribe_ticks();
+    invalidate_view(VIEW_MATCH_CLOCK);
+    commit_view();
+  }
+}
+
+static void main_window_disappear(Window *window) {
+  is_main_window_visible = false;
+  subscribe_ticks();
+}
+
+/**
+ * Second ticks for the match clock while it is shown and the battery is not
+ * saved, otherwise minute ticks for the status bar time.
+ */
+static void subscribe_ticks() {
+  tick_timer_service_subscribe(is_main_window_visible && !low_power_is_active(&low_power) 
+    ? SECOND_UNIT : MINUTE_UNIT, tick_handler);
+}
+
 static void blink_sc_timer_handler(void *context) {
   layer_set_hidden(score_counter_layer, !layer_get_hidden(score_counter_layer));
   blink_sc_timer = app_timer_register(SC_BLINK_INTERVAL, blink_sc_timer_handler, NULL);
 }
 
-static void adjust_whole_score_font() {
-  // Adjusting whole score font only makes sense in REFEREE user role.
-  if (score->user_role == REFEREE) {
-    if (score->score_1 <= LARGER_FONT_SCORE_LIMIT 
-      && score->score_2 <= LARGER_FONT_SCORE_LIMIT) {
+/**
+ * The Score Counter layer is kept when the layout doesn't change, so it must
+ * not stay hidden by the last blink.
+ */
+static void stop_sc_blinking() {
+  if (blink_sc_timer != NULL) {
+    app_timer_cancel(blink_sc_timer);
+    blink_sc_timer = NULL;
+  }
+
+  if (layer_get_hidden(score_counter_layer)) {
+    layer_set_hidden(score_counter_layer, false);
+  }
+}
+
+static void adjust_whole_score_atlas() {
+  // Adjusting whole score digits only makes sense in REFEREE user role.
+  if (score->user_role == REFEREE && s_whole_score_layer != NULL) {
+    if (score->score_1 <= LARGER_DIGITS_SCORE_LIMIT 
+      && score->score_2 <= LARGER_DIGITS_SCORE_LIMIT) {
       
-      // Both score parts are below the LARGER_FONT_SCORE_LIMIT 
-      // - set the larger font if not already set.
-      if (!is_larger_font_in_whole_score) {
-        text_layer_set_font(s_whole_score_text_layer, 
-          fonts_get_system_font(FONT_KEY_LECO_38_BOLD_NUMBERS));
-        is_larger_font_in_whole_score = true;
+      // Both score parts are below the LARGER_DIGITS_SCORE_LIMIT 
+      // - set the larger digits if not already set.
+      if (!is_larger_atlas_in_whole_score) {
+        score_layer_set_atlas(s_whole_score_layer, &digits_large);
+        is_larger_atlas_in_whole_score = true;
       }
     } else {
-      // Any score part is over the larger font score limit
-      // - set the smaller font if not already set.
-      if (is_larger_font_in_whole_score) { // Change in score part to more than 2 digits
-        text_layer_set_font(s_whole_score_text_layer, 
-          fonts_get_system_font(FONT_KEY_LECO_32_BOLD_NUMBERS));
-        is_larger_font_in_whole_score = false;
+      // Any score part is over the larger digits score limit
+      // - set the smaller digits if not already set.
+      if (is_larger_atlas_in_whole_score) { // Change in score part to more than 2 digits
+        score_layer_set_atlas(s_whole_score_layer, &digits_small);
+        is_larger_atlas_in_whole_score = false;
       }
     }
   }
@@ -351,30 +1124,66 @@ static void swap_numbers(uint16_t *num1, uint16_t *num2) {
   *num2 = tmp;
 }
 
+/**
+ * A point for the team (0 for score_1, 1 for score_2) or one taken back from
+ * it, a step of the sport rules. Return false when the rules leave the score
+ * as it is, like after the last point of the match.
+ */
+static bool step_score(uint8_t team, bool is_take_back) {
+  uint16_t points[SPORT_TEAMS] = { score->score_1, score->score_2 };
+  SportStep step = is_take_back 
+    ? sport_take_back(&sport, points, team) : sport_point(&sport, points, team);
+
+  switch (step) {
+    case SPORT_STEP_IGNORED:
+      return false;
+    case SPORT_STEP_UNIT_WON:
+    case SPORT_STEP_MATCH_WON:
+      // The statistics count the winning point, not the 0:0 the next unit
+      // starts from, which would look like points taken back to them.
+      match_stats_update(&match_stats, sport.won_points[0], sport.won_points[1], time(NULL));
+      match_stats_rebase(&match_stats, points[0], points[1]);
+      match_clock_on_point(&match_clock, time(NULL));
+      // The next unit is a new CRDT generation, the caller records its score.
+      pn_counter_restart(&score_crdt, device_id);
+      schedule_commit(COMMIT_PERSIST_SPORT | COMMIT_PERSIST_CLOCK);
+      invalidate_view(VIEW_MATCH_CLOCK);
+      break;
+    case SPORT_STEP_UNIT_UNDONE:
+      // Taken back from the winning point.
+      match_stats_rebase(&match_stats, sport.won_points[0], sport.won_points[1]);
+      pn_counter_restart(&score_crdt, device_id);
+      schedule_commit(COMMIT_PERSIST_SPORT);
+      invalidate_view(VIEW_MATCH_CLOCK);
+      break;
+    default:
+      break;
+  }
+
+  score->score_1 = points[0];
+  score->score_2 = points[1];
+
+  return true;
+}
+
 static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
+  SC_REDRAW_EVENT(btn_mode == NORMAL_MODE ? REDRAW_EVENT_INCREMENT : REDRAW_EVENT_SETTING);
+  SC_TRACE_INPUT(TRACE_CLICK, TRACE_CLICK_ARG(BUTTON_ID_UP, TRACE_CLICK_SINGLE), NULL, 0);
+
   if (btn_mode == NORMAL_MODE) {
     // Increment score_2 in NORMAL_MODE
-    if (score->user_role == REFEREE) {
-      if (score->score_1 < MAX_SCORE) {
-        score->score_1 += 1;
-      } else {
-        score->score_1 = MIN_SCORE;  
-      }
-    } else {
-      if (score->score_2 < MAX_SCORE) {
-        score->score_2 += 1;
-      } else {
-        score->score_2 = MIN_SCORE;
-      }
+    if (!step_score(score->user_role == REFEREE ? 0 : 1, false)) {
+      return;
     }
 
-    adjust_whole_score_font();
+    record_score_change();
+    adjust_whole_score_atlas();
 
     render_score();
 
-    time(&score->timestamp);
-    persist_score();
-    send_msg(SEND_CMD_SET_SCORE_VAL);
+    stamp_score();
+    log_score_event(SCORE_EVENT_POINT, transferred_team(score->user_role == REFEREE ? 0 : 1));
+    schedule_commit(COMMIT_SEND_SET | COMMIT_PERSIST_SCORE);
   } else {
     // Setting Score Counter position in SETTING_MODE
     switch (setting_mode_sc_position) {
@@ -392,239 +1201,595 @@ static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
         break;
     }
 
-    Layer *window_layer = window_get_root_layer(s_main_window);
-
-    init_score_counter_layer(window_layer);
-    init_score_text_layers(window_layer);
-    init_ruler_layer(window_layer);
-
+    invalidate_view(VIEW_LAYOUT);
     reset_bg_color_callback(NULL);
   }
+
+  commit_view();
 }
 
 static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
+  SC_REDRAW_EVENT(btn_mode == NORMAL_MODE ? REDRAW_EVENT_INCREMENT : REDRAW_EVENT_SWAP);
+  SC_TRACE_INPUT(TRACE_CLICK, TRACE_CLICK_ARG(BUTTON_ID_DOWN, TRACE_CLICK_SINGLE), NULL, 0);
+
   if (btn_mode == NORMAL_MODE) {
     // Increment score_1 in NORMAL_MODE
-    if (score->user_role == REFEREE) {
-      if (score->score_2 < MAX_SCORE) {
-        score->score_2 += 1;
-      } else {
-        score->score_2 = MIN_SCORE;  
-      }
-    } else {
-      if (score->score_1 < MAX_SCORE) {
-        score->score_1 += 1;
-      } else {
-        score->score_1 = MIN_SCORE;
-      }
+    if (!step_score(score->user_role == REFEREE ? 1 : 0, false)) {
+      return;
     }
 
-    adjust_whole_score_font();
+    record_score_change();
+    adjust_whole_score_atlas();
 
-    time(&score->timestamp);
-    persist_score();
-    send_msg(SEND_CMD_SET_SCORE_VAL);
+    render_score();
+
+    stamp_score();
+    log_score_event(SCORE_EVENT_POINT, transferred_team(score->user_role == REFEREE ? 1 : 0));
+    schedule_commit(COMMIT_SEND_SET | COMMIT_PERSIST_SCORE);
   } else {
     // Swapping score in SETTING_MODE
     swap_numbers(&score->score_1, &score->score_2);
+    sport_swap(&sport);
+    match_stats_swap(&match_stats);
+    invalidate_view(VIEW_MATCH_CLOCK);
 
     is_score_swapped = !is_score_swapped;
+
+    render_score();
   }
 
-  render_score();
+  commit_view();
 }
 
 /**
- * In NORMAL_MODE, decrement score_2.
+ * In NORMAL_MODE, decrement score_2. In SETTING_MODE, switch to the next sport.
  */
 static void up_long_click_handler_down(ClickRecognizerRef recognizer, void *context) {
+  SC_REDRAW_EVENT(btn_mode == NORMAL_MODE ? REDRAW_EVENT_DECREMENT : REDRAW_EVENT_SETTING);
+  SC_TRACE_INPUT(TRACE_CLICK, TRACE_CLICK_ARG(BUTTON_ID_UP, TRACE_CLICK_LONG), NULL, 0);
+
   if (btn_mode == NORMAL_MODE) {
-    if (score->user_role == REFEREE) {
-      if (score->score_1 > MIN_SCORE) {
-        score->score_1 -= 1;
-      } else {
-        score->score_1 = MAX_SCORE;  
-      }
-    } else {
-      if (score->score_2 > MIN_SCORE) {
-        score->score_2 -= 1;
-      } else {
-        score->score_2 = MAX_SCORE;
-      }
+    if (!step_score(score->user_role == REFEREE ? 0 : 1, true)) {
+      return;
     }
 
-    adjust_whole_score_font();
+    record_score_change();
+    adjust_whole_score_atlas();
 
     render_score();
 
-    time(&score->timestamp);
-    persist_score();
-    send_msg(SEND_CMD_SET_SCORE_VAL);
+    stamp_score();
+    log_score_event(SCORE_EVENT_TAKE_BACK, 
+      transferred_team(score->user_role == REFEREE ? 0 : 1));
+    schedule_commit(COMMIT_SEND_SET | COMMIT_PERSIST_SCORE);
+  } else {
+    // The sets and games start over, the points count on by the rules of
+    // the new sport. Shown instead of the time until leaving SETTING_MODE.
+    sport_init(&sport, (sport.sport + 1) % SPORT_COUNT, MAX_SCORE + 1);
+
+    snprintf(top_bar_info->time, TIME_BUFF_SIZE, "%s", sport_name(sport.sport));
+    is_setting_shown = true;
+    invalidate_view(VIEW_STATUS_TIME | VIEW_MATCH_CLOCK);
+
+    schedule_commit(COMMIT_PERSIST_SPORT);
   }
+
+  commit_view();
 }
 
 /**
  * In NORMAL_MODE, decrement score_1.
  */
 static void down_long_click_handler_down(ClickRecognizerRef recognizer, void *context) {
+  SC_REDRAW_EVENT(REDRAW_EVENT_DECREMENT);
+  SC_TRACE_INPUT(TRACE_CLICK, TRACE_CLICK_ARG(BUTTON_ID_DOWN, TRACE_CLICK_LONG), NULL, 0);
+
   if (btn_mode == NORMAL_MODE) {
-    if (score->user_role == REFEREE) {
-      if (score->score_2 > MIN_SCORE) {
-        score->score_2 -= 1;
-      } else {
-        score->score_2 = MAX_SCORE;  
-      }
-    } else {
-      if (score->score_1 > MIN_SCORE) {
-        score->score_1 -= 1;
-      } else {
-        score->score_1 = MAX_SCORE;
-      }
+    if (!step_score(score->user_role == REFEREE ? 1 : 0, true)) {
+      return;
     }
 
-    adjust_whole_score_font();
+    record_score_change();
+    adjust_whole_score_atlas();
 
     render_score();
 
-    time(&score->timestamp);
-    persist_score();
-    send_msg(SEND_CMD_SET_SCORE_VAL);
+    stamp_score();
+    log_score_event(SCORE_EVENT_TAKE_BACK, 
+      transferred_team(score->user_role == REFEREE ? 1 : 0));
+    schedule_commit(COMMIT_SEND_SET | COMMIT_PERSIST_SCORE);
   }
+
+  commit_view();
 }
 
 static void select_click_handler(ClickRecognizerRef recognizer, void *context) {
+  SC_REDRAW_EVENT(btn_mode == NORMAL_MODE ? REDRAW_EVENT_OTHER : REDRAW_EVENT_SETTING);
+  SC_TRACE_INPUT(TRACE_CLICK, TRACE_CLICK_ARG(BUTTON_ID_SELECT, TRACE_CLICK_SINGLE), NULL, 0);
+
   if (btn_mode == NORMAL_MODE) {
-    // Re-send last score in NORMAL_MODE
-    reset_bg_color_callback(NULL);
-    send_msg(SEND_CMD_SET_SCORE_VAL);
+    if (select_click_timer != NULL) {
+      // The second click of a double click shows the match statistics.
+      app_timer_cancel(select_click_timer);
+      select_click_timer = NULL;
+      window_stack_push(s_stats_window, true);
+    } else {
+      // Re-send last score, unless a second click follows.
+      select_click_timer = app_timer_register(SELECT_DOUBLE_CLICK_MS, 
+        select_click_timer_handler, NULL);
+    }
   } else {
     // In SETTING_MODE: stop Score Counter blinking, confirm Score Counter 
     // orientation and score if swapped.
-    Layer *window_layer = window_get_root_layer(s_main_window);
-
+    SettingModeSCPosition previous_position = normal_mode_sc_position();
     set_normal_mode_cfg_from_setting_mode_cfg();
 
     btn_mode = NORMAL_MODE;
+    SC_TRACE_EVENT(TRACE_MODE, btn_mode, NULL, 0);
 
-    app_timer_cancel(blink_sc_timer);
+    stop_sc_blinking();
+    if (is_setting_shown) {
+      refresh_time_text();
+    }
 
-    init_score_counter_layer(window_layer);
-    init_score_text_layers(window_layer);
-    init_ruler_layer(window_layer);
+    invalidate_view(VIEW_LAYOUT);
 
-    time(&score->timestamp);
+    // A swapped score or a new position changes the transferred score.
+    record_score_change();
+    stamp_score();
 
+    uint8_t work = COMMIT_SEND_SET | COMMIT_PERSIST_SETTINGS;
     if (is_score_swapped) {
       // Confirm swapped score as the new score.
-      persist_score();
+      work |= COMMIT_PERSIST_SCORE | COMMIT_PERSIST_SPORT;
       is_score_swapped = false;
+      log_score_event(SCORE_EVENT_SWAP, 0);
     }
-
-    send_msg(SEND_CMD_SET_SCORE_VAL);
-
-    persist_user_role_and_sc_position();
+    if (normal_mode_sc_position() != previous_position) {
+      log_score_event(SCORE_EVENT_MODE, score->user_role << 4 | (score->user_role == PLAYER 
+        ? score->sc_2_player_position : score->sc_2_referee_position));
+    }
+    schedule_commit(work);
   }
+
+  commit_view();
 }
 
 /**
  * In NORMAL_MODE, select button long click should reset the score.
  */
 static void select_long_click_handler_down(ClickRecognizerRef recognizer, void *context) {
+  SC_REDRAW_EVENT(REDRAW_EVENT_RESET);
+  SC_TRACE_INPUT(TRACE_CLICK, TRACE_CLICK_ARG(BUTTON_ID_SELECT, TRACE_CLICK_LONG), NULL, 0);
+
   if (btn_mode == NORMAL_MODE) {
     score->score_1 = 0;
     score->score_2 = 0;
 
-    adjust_whole_score_font();
+    // A new match on all the watches, the points of this one are gone.
+    pn_counter_reset(&score_crdt, device_id);
+    reset_match_stats();
+
+    uint8_t work = COMMIT_SEND_SET | COMMIT_PERSIST_SCORE;
+    if (sport_reset(&sport)) {
+      work |= COMMIT_PERSIST_SPORT;
+    }
+
+    adjust_whole_score_atlas();
 
     render_score();
 
-    time(&score->timestamp);
-    persist_score();
-    send_msg(SEND_CMD_SET_SCORE_VAL);
+    stamp_score();
+    log_score_event(SCORE_EVENT_RESET, 0);
+    schedule_commit(work);
+  } else {
+    // In SETTING_MODE: switch between the automatic, always on and off
+    // low-power mode, shown instead of the time until leaving SETTING_MODE.
+    if (low_power_next_setting(&low_power)) {
+      on_low_power_changed();
+    }
+
+    snprintf(top_bar_info->time, TIME_BUFF_SIZE, "%s", low_power_setting_name(low_power.setting));
+    is_setting_shown = true;
+    invalidate_view(VIEW_STATUS_TIME);
+
+    schedule_commit(COMMIT_PERSIST_LOW_POWER);
   }
+
+  commit_view();
+}
+
+/**
+ * In NORMAL_MODE, a select click not followed by a second one should re-send
+ * the last score. The click is held back until then, so a double click,
+ * which shows the match statistics, does not re-send it twice.
+ */
+static void select_click_timer_handler(void *context) {
+  select_click_timer = NULL;
+
+  reset_bg_color_callback(NULL);
+  schedule_commit(COMMIT_SEND_SET | COMMIT_SEND_NOW);
 }
 
 static void back_click_handler(ClickRecognizerRef recognizer, void *context) {
+  SC_REDRAW_EVENT(REDRAW_EVENT_SETTING);
+  SC_TRACE_INPUT(TRACE_CLICK, TRACE_CLICK_ARG(BUTTON_ID_BACK, TRACE_CLICK_SINGLE), NULL, 0);
+
   if (btn_mode == NORMAL_MODE) {
     // Enter SETTING_MODE
     set_setting_mode_cfg_from_normal_mode_cfg();
 
-    blink_sc_timer = app_timer_register(SC_BLINK_INTERVAL, blink_sc_timer_handler, NULL);
+    if (!low_power_is_active(&low_power)) {
+      blink_sc_timer = app_timer_register(SC_BLINK_INTERVAL, blink_sc_timer_handler, NULL);
+    }
+
+    btn_mode = SETTING_MODE;
+    SC_TRACE_EVENT(TRACE_MODE, btn_mode, NULL, 0);
+  } else {
+    // Cancel SETTING_MODE - stop Score Counter blinking, restore last
+    // Score Counter position and restore score if swapped.
+    btn_mode = NORMAL_MODE;
+    SC_TRACE_EVENT(TRACE_MODE, btn_mode, NULL, 0);
+
+    stop_sc_blinking();
+    if (is_setting_shown) {
+      refresh_time_text();
+    }
+
+    // Take back swapping.
+    if (is_score_swapped) {
+      swap_numbers(&score->score_1, &score->score_2);
+      sport_swap(&sport);
+      match_stats_swap(&match_stats);
+      invalidate_view(VIEW_MATCH_CLOCK);
+      render_score();
+      // persist_score();
+      is_score_swapped = false;
+    }
+    
+    invalidate_view(VIEW_LAYOUT);
+    reset_bg_color_callback(NULL);
+  }
+
+  commit_view();
+}
+
+static void render_score() {
+  invalidate_view(VIEW_SCORE_TEXT);
+  reset_bg_color_callback(NULL);
+}
+
+static void format_score_text() {
+  snprintf(score->score_1_text, sizeof(score->score_1_text), "%d", score->score_1);
+  snprintf(score->score_2_text, sizeof(score->score_2_text), "%d", score->score_2);
+  snprintf(score->whole_score_text, sizeof(score->whole_score_text), "%s:%s", 
+      score->score_1_text, score->score_2_text);
+}
+
+/**
+ * The score itself goes with the launch state, see persist_launch_state().
+ * The CRDT and the statistics stay under a key each, they are too large for 
+ * the slots of the launch state log, and a CRDT lost with a crash is built 
+ * again from the score at launch.
+ */
+static void persist_score() {
+  persist_write_data(S_SCORE_CRDT_KEY, &score_crdt, sizeof(PnCounter));
+
+  // Every committed score change goes through here, so the statistics
+  // are updated from the same path.
+  time_t last_point_time = match_stats.last_point_time;
+  match_stats_update(&match_stats, score->score_1, score->score_2, score->timestamp);
+  persist_write_data(S_MATCH_STATS_KEY, &match_stats, sizeof(MatchStats));
+
+  update_match_clock(last_point_time);
+  schedule_glance_update();
+
+  refresh_stats_view();
+}
+
+/**
+ * Input handlers only update the state and the screen. Persisting and
+ * sending run in the commit stage, a zero-delay timer firing after the
+ * frame is rendered, once for all the changes made until then.
+ */
+static void schedule_commit(uint8_t work) {
+  if ((work & COMMIT_SEND_SET) && !(work & COMMIT_SEND_NOW) 
+    && low_power_is_active(&low_power)) {
+
+    // Goes out with the changes of the next few seconds, the window is not
+    // extended by them so the phone never waits longer.
+    work &= ~COMMIT_SEND_SET;
+    if (send_timer == NULL) {
+      send_timer = app_timer_register(LOW_POWER_SEND_WINDOW_MS, send_timer_handler, NULL);
+    }
+  } else if (work & COMMIT_SEND_SET && send_timer != NULL) {
+    // Sent now, the pending one with it.
+    app_timer_cancel(send_timer);
+    send_timer = NULL;
+  }
+
+  pending_commit |= work;
+
+  if (pending_commit != 0 && commit_timer == NULL) {
+    commit_timer = app_timer_register(0, commit_timer_handler, NULL);
+  }
+}
+
+static void commit_timer_handler(void *context) {
+  uint8_t work = pending_commit;
+
+  commit_timer = NULL;
+  pending_commit = 0;
+
+  // The message goes first, the phone shouldn't wait for the flash writes.
+  if (work & COMMIT_SEND_SET) {
+    send_msg(SEND_CMD_SET_SCORE_VAL);
+  }
+  if (work & (COMMIT_PERSIST_SCORE | COMMIT_PERSIST_SETTINGS | COMMIT_PERSIST_LOW_POWER)) {
+    persist_launch_state();
+  }
+  if (work & COMMIT_PERSIST_SCORE) {
+    persist_score();
+  }
+  if (work & COMMIT_PERSIST_CLOCK) {
+    persist_write_data(S_MATCH_CLOCK_KEY, &match_clock, sizeof(MatchClock));
+  }
+  if (work & COMMIT_PERSIST_SPORT) {
+    persist_write_data(S_SPORT_KEY, &sport, sizeof(SportState));
+  }
+  if (work & COMMIT_LOG_EVENTS) {
+    log_pending_events();
+  }
+
+  commit_view();
+}
+
+/**
+ * The export is never urgent, the records wait while the session is busy.
+ */
+static void log_pending_events() {
+  if (!event_log_flush(&event_log) && event_log_timer == NULL) {
+    event_log_timer = app_timer_register(EVENT_LOG_RETRY_MS, event_log_timer_handler, NULL);
+  }
+}
+
+static void event_log_timer_handler(void *context) {
+  event_log_timer = NULL;
+  log_pending_events();
+}
+
+/**
+ * End of the low-power send window. The latest score has to reach the phone,
+ * so a busy outbox is tried again shortly.
+ */
+static void send_timer_handler(void *context) {
+  send_timer = NULL;
+
+  if (!send_msg(SEND_CMD_SET_SCORE_VAL)) {
+    send_timer = app_timer_register(LOW_POWER_SEND_RETRY_MS, send_timer_handler, NULL);
+  }
+
+  commit_view();
+}
+
+/**
+ * Send the score waiting for the send window now, if there is one.
+ */
+static void flush_send() {
+  if (send_timer != NULL) {
+    app_timer_cancel(send_timer);
+    send_timer_handler(NULL);
+  }
+}
+
+/**
+ * Run the commit stage now, if there is one pending.
+ */
+static void flush_commit() {
+  if (commit_timer != NULL) {
+    app_timer_cancel(commit_timer);
+    commit_timer_handler(NULL);
+  }
+  flush_send();
+}
+
+static void init_match_stats() {
+  if (persist_get_size(S_MATCH_STATS_KEY) == sizeof(MatchStats)) {
+    persist_read_data(S_MATCH_STATS_KEY, &match_stats, sizeof(MatchStats));
+  } else {
+    match_stats_init(&match_stats, score->score_1, score->score_2, MAX_SCORE + 1);
+  }
+}
+
+/**
+ * A clock persisted before the match clock existed starts from the
+ * statistics, the wall clock taken as monotonic.
+ */
+static void init_match_clock() {
+  if (persist_get_size(S_MATCH_CLOCK_KEY) == sizeof(MatchClock)) {
+    persist_read_data(S_MATCH_CLOCK_KEY, &match_clock, sizeof(MatchClock));
+  } else {
+    match_clock_init(&match_clock);
+    match_clock.match_start = match_stats.match_start;
+    match_clock.rally_start = match_stats.last_point_time;
+  }
+
+  // Set back while the app was closed.
+  if (match_clock_observe(&match_clock, time(NULL))) {
+    persist_write_data(S_MATCH_CLOCK_KEY, &match_clock, sizeof(MatchClock));
+  }
+}
+
+/**
+ * The clock follows the points counted by the statistics: a new rally with
+ * every point. A reset stops it, see reset_match_stats().
+ */
+static void update_match_clock(time_t last_point_time) {
+  if (match_stats.last_point_time == last_point_time) {
+    return;
+  }
+
+  match_clock_on_point(&match_clock, time(NULL));
+  persist_write_data(S_MATCH_CLOCK_KEY, &match_clock, sizeof(MatchClock));
+  invalidate_view(VIEW_MATCH_CLOCK);
+}
+
+/**
+ * A new match, reset here or elsewhere. The statistics are persisted with
+ * the score.
+ */
+static void reset_match_stats() {
+  match_stats_init(&match_stats, 0, 0, MAX_SCORE + 1);
+  match_clock_reset(&match_clock);
+  invalidate_view(VIEW_MATCH_CLOCK);
+  schedule_commit(COMMIT_PERSIST_CLOCK);
+}
+
+static void stats_window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+  const GRect bounds = layer_get_bounds(window_layer);
+
+  s_stats_text_layer = text_layer_create(GRect(MARGIN, MARGIN, 
+    bounds.size.w - 2 * MARGIN, bounds.size.h - 2 * MARGIN));
+  text_layer_set_text_color(s_stats_text_layer, GColorBlack);
+  text_layer_set_font(s_stats_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
+  text_layer_set_text_alignment(s_stats_text_layer, GTextAlignmentLeft);
+  text_layer_set_text(s_stats_text_layer, stats_text);
+  layer_add_child(window_layer, text_layer_get_layer(s_stats_text_layer));
+}
+
+static void stats_window_unload(Window *window) {
+  text_layer_destroy(s_stats_text_layer);
+  s_stats_text_layer = NULL;
+}
+
+static void stats_window_appear(Window *window) {
+  refresh_stats_timer_handler(NULL);
+}
+
+static void stats_window_disappear(Window *window) {
+  if (refresh_stats_timer != NULL) {
+    app_timer_cancel(refresh_stats_timer);
+    refresh_stats_timer = NULL;
+  }
+}
+
+/**
+ * Format the statistics into the alternate view, only when it is shown.
+ */
+static void refresh_stats_view() {
+  if (s_stats_text_layer != NULL) {
+    match_stats_format(&match_stats, time(NULL), stats_text, sizeof(stats_text));
+    text_layer_set_text(s_stats_text_layer, stats_text);
+  }
+}
 
-    btn_mode = SETTING_MODE;
-  } else {
-    // Cancel SETTING_MODE - stop Score Counter blinking, restore last
-    // Score Counter position and restore score if swapped.
-    Layer *window_layer = window_get_root_layer(s_main_window);
+/**
+ * The time since the last point changes every second while the view is shown.
+ */
+static void refresh_stats_timer_handler(void *context) {
+  refresh_stats_view();
+  refresh_stats_timer = app_timer_register(low_power_is_active(&low_power) 
+    ? LOW_POWER_STATS_REFRESH_MS : STATS_REFRESH_MS, refresh_stats_timer_handler, NULL);
+}
 
-    btn_mode = NORMAL_MODE;
+static void get_launch_state(LaunchState *state) {
+  *state = (LaunchState) {
+    .score_1 = score->score_1,
+    .score_2 = score->score_2,
+    .timestamp = (int32_t)score->timestamp,
+    .user_role = score->user_role,
+    .sc_2_player_position = score->sc_2_player_position,
+    .sc_2_referee_position = score->sc_2_referee_position,
+    .low_power_setting = low_power.setting,
+  };
+}
 
-    app_timer_cancel(blink_sc_timer);
+static void persist_launch_state() {
+  LaunchState state;
+  get_launch_state(&state);
 
-    // Take back swapping.
-    if (is_score_swapped) {
-      swap_numbers(&score->score_1, &score->score_2);
-      render_score();
-      // persist_score();
-      is_score_swapped = false;
+  if (state_log_append(&launch_log, &state) && is_launch_state_moved) {
+    // Only once the log has it, a crash in between would lose the score.
+    persist_delete(S_LAUNCH_STATE_KEY);
+    for (uint32_t key = S_SCORE_1_KEY; key <= S_SC_POS_TO_REFEREE_KEY; key++) {
+      persist_delete(key);
     }
-    
-    init_score_counter_layer(window_layer);
-    init_score_text_layers(window_layer);
-    init_ruler_layer(window_layer);
-
-    reset_bg_color_callback(NULL);
+    persist_delete(S_LOW_POWER_KEY);
+    is_launch_state_moved = false;
   }
 }
 
+#if SC_TRACE
 /**
- * score_number: a bitmask of all the score parts that have changed
+ * What a replay of the trace starts from: the stored state the app launches
+ * with, the link and the battery. The match statistics and clock are left
+ * out, they don't change what the inputs do. Not in SETTING_MODE, whose
+ * changes are not stored until confirmed.
  */
-static void render_score() {
-  snprintf(score->score_1_text, sizeof(score->score_1_text), "%d", score->score_1);
-  snprintf(score->score_2_text, sizeof(score->score_2_text), "%d", score->score_2);
-  snprintf(score->whole_score_text, sizeof(score->whole_score_text), "%s:%s", 
-      score->score_1_text, score->score_2_text);
-  
-  if (s_my_score_text_layer != NULL) {
-    text_layer_set_text(s_my_score_text_layer, score->score_1_text);
-  }
-  if (s_opponent_score_text_layer != NULL) {
-    text_layer_set_text(s_opponent_score_text_layer, score->score_2_text);
+static void write_trace_checkpoint() {
+  if (!is_launched || btn_mode != NORMAL_MODE) {
+    return;
   }
-  if (s_whole_score_text_layer != NULL) {
-    text_layer_set_text(s_whole_score_text_layer, score->whole_score_text);
+
+  LaunchState state;
+  BatteryChargeState charge = battery_state_service_peek();
+  uint8_t payload[TRACE_MAX_PAYLOAD];
+  uint16_t size = 0;
+
+  get_launch_state(&state);
+  payload[size++] = charge.charge_percent;
+  // Under the key from before the launch state log, still read at launch.
+  size = trace_recorder_put_entry(payload, size, S_LAUNCH_STATE_KEY, &state, 
+    sizeof(LaunchState));
+  size = trace_recorder_put_entry(payload, size, S_DEVICE_ID_KEY, &device_id, 
+    sizeof(device_id));
+  size = trace_recorder_put_entry(payload, size, S_SPORT_KEY, &sport, sizeof(SportState));
+  size = trace_recorder_put_entry(payload, size, S_SCORE_CRDT_KEY, &score_crdt, 
+    sizeof(PnCounter));
+  if (!offline_queue_is_empty(&offline_queue)) {
+    size = trace_recorder_put_entry(payload, size, S_OFFLINE_QUEUE_KEY, &offline_queue, 
+      sizeof(OfflineQueue));
   }
 
-  reset_bg_color_callback(NULL);
+  uint8_t flags = (connection_service_peek_pebble_app_connection() 
+    ? TRACE_CHECKPOINT_CONNECTED : 0) | (charge.is_charging ? TRACE_CHECKPOINT_CHARGING : 0);
+  SC_TRACE_EVENT(TRACE_CHECKPOINT, flags, payload, size);
 }
 
-static void persist_score() {
-  persist_write_int(S_SCORE_1_KEY, score->score_1);
-  persist_write_int(S_SCORE_2_KEY, score->score_2);
-  persist_write_int(S_TIMESTAMP_KEY, score->timestamp);
+/**
+ * Log the trace for the phone. A busy session is retried, the recording is
+ * paused until the export is through.
+ */
+static void export_trace() {
+  if (trace_export_timer != NULL) {
+    // Still on it.
+    return;
+  }
+  if (trace_session == NULL) {
+    trace_session = data_logging_create(DATA_LOG_TRACE_TAG, DATA_LOGGING_BYTE_ARRAY, 
+      TRACE_EXPORT_ITEM_SIZE, false);
+  }
+
+  if (trace_recorder_export(trace_session)) {
+    if (trace_session != NULL) {
+      data_logging_finish(trace_session);
+      trace_session = NULL;
+    }
+  } else {
+    trace_export_timer = app_timer_register(EVENT_LOG_RETRY_MS, trace_export_timer_handler, 
+      NULL);
+  }
 }
 
-static void persist_user_role_and_sc_position() {
-  persist_write_int(S_USER_ROLE_KEY, score->user_role);
-  persist_write_int(S_SC_POS_TO_PLAYER_KEY, score->sc_2_player_position);
-  persist_write_int(S_SC_POS_TO_REFEREE_KEY, score->sc_2_referee_position);
+static void trace_export_timer_handler(void *context) {
+  trace_export_timer = NULL;
+  export_trace();
 }
+#endif
 
 static void set_setting_mode_cfg_from_normal_mode_cfg() {
-  if (score->user_role == PLAYER) {
-    if (score->sc_2_player_position == LEFT_EDGE) {
-      setting_mode_sc_position = SC_SET_LEFT;
-    } else {
-      setting_mode_sc_position = SC_SET_RIGHT;
-    }
-  } else {
-    if (score->sc_2_referee_position == SAME_SIDE) {
-      setting_mode_sc_position = SC_SET_BOTTOM;
-    } else {
-      setting_mode_sc_position = SC_SET_TOP;
-    }
-  }
+  setting_mode_sc_position = normal_mode_sc_position();
 }
 
 static void set_normal_mode_cfg_from_setting_mode_cfg() {
@@ -664,98 +1829,243 @@ static inline bool should_swap_before_send_or_after_receive() {
 }
 
 static void inbox_received_callback(DictionaryIterator *iter, void *context) {
-  Tuple *cmd_tuple = dict_find(iter, RECEIVE_CMD_KEY);
-
-  if (cmd_tuple) {
-    uint8_t cmd_val = cmd_tuple->value->uint8;
-
-    switch (cmd_val) {
-      case RECEIVE_CMD_SET_SCORE_VAL:
-        {
-          Tuple *score1_tuple = dict_find(iter, RECEIVE_SCORE_1_KEY);
-          Tuple *score2_tuple = dict_find(iter, RECEIVE_SCORE_2_KEY);
-          Tuple *timestamp_tuple = dict_find(iter, RECEIVE_TIMESTAMP_KEY);
-
-          if (score1_tuple && score2_tuple) {
-            if (should_swap_before_send_or_after_receive()) {
-              score->score_1 = score2_tuple->value->uint16;
-              score->score_2 = score1_tuple->value->uint16;  
-            } else {
-              score->score_1 = score1_tuple->value->uint16;
-              score->score_2 = score2_tuple->value->uint16;
-            }
-
-            if (timestamp_tuple) {
-              score->timestamp = timestamp_tuple->value->uint32;
-            } else {
-              time(&score->timestamp);
-            }
-
-            APP_LOG(APP_LOG_LEVEL_INFO, 
-              "Received score %d:%d", score->score_1, score->score_2);
-
-            render_score();
-            persist_score();
-            set_bg_color_on_colored_screen(GColorCyan);
-          } else {
-            APP_LOG(APP_LOG_LEVEL_WARNING, 
-              "Receive score command received, but no score!");
-          }
+  SC_REDRAW_EVENT(REDRAW_EVENT_INBOUND);
+  SC_TRACE_INPUT(TRACE_INBOX, 0, iter->dictionary, 
+    (uint16_t)((const uint8_t *)iter->end - (const uint8_t *)iter->dictionary));
+
+  int64_t received_ms = clock_sync_now_ms();
+  InboxCommand command;
+
+  InboxDecodeResult result = inbox_decoder_decode(&inbox_decoder, iter, &command);
+  if (result != INBOX_OK) {
+    SC_LOG(APP_LOG_LEVEL_WARNING, "Inbound message rejected: %s (%d so far)", 
+      inbox_decoder_result_name(result), inbox_decoder.rejected[result]);
+    return;
+  }
+
+  switch (command.cmd) {
+    case RECEIVE_CMD_SET_SCORE_VAL: {
+      PnCounterMerge crdt_merge = PN_COUNTER_MERGE_ADOPTED;
+
+      if (command.fields & INBOX_FIELD_SCORE_CRDT) {
+        uint16_t match = score_crdt.match;
+
+        // Merged, the points scored here meanwhile still count.
+        crdt_merge = pn_counter_merge_wire(&score_crdt, command.score_crdt, 
+          command.score_crdt_size);
+        if (score_crdt.match != match) {
+          // Reset elsewhere, the points merged since count for the new match.
+          reset_match_stats();
         }
-        break;
-      case RECEIVE_CMD_SYNC_SCORE_VAL:
-        // Sync request received, send data to the phone.
-        set_bg_color_on_colored_screen(GColorElectricUltramarine);
-        send_msg(SEND_CMD_SYNC_SCORE_VAL);
-        break;
+        command.score_1 = pn_counter_value(&score_crdt, 0);
+        command.score_2 = pn_counter_value(&score_crdt, 1);
+      }
+
+      if (should_swap_before_send_or_after_receive()) {
+        score->score_1 = command.score_2;
+        score->score_2 = command.score_1;  
+      } else {
+        score->score_1 = command.score_1;
+        score->score_2 = command.score_2;
+      }
+
+      if (!(command.fields & INBOX_FIELD_SCORE_CRDT)) {
+        // A score from a legacy phone overwrites, as if set here.
+        record_score_change();
+      }
+
+      if ((command.fields & INBOX_FIELD_SPORT) && crdt_merge != PN_COUNTER_MERGE_OUTDATED) {
+        // Sets and games go with the score CRDT generation: taken over with a
+        // newer one, merged within the same one and left when outdated.
+        // Without the CRDT, as the sender counts them.
+        if (crdt_merge == PN_COUNTER_MERGE_MERGED) {
+          sport_merge_wire(&sport, command.sport, should_swap_before_send_or_after_receive());
+        } else {
+          sport_read_wire(&sport, command.sport, should_swap_before_send_or_after_receive());
+        }
+        invalidate_view(VIEW_MATCH_CLOCK);
+        schedule_commit(COMMIT_PERSIST_SPORT);
+      }
+
+      if (command.fields & INBOX_FIELD_TIMESTAMP) {
+        // The phone timestamp is moved from the shared timeline to the watch clock.
+        int64_t timestamp_ms = clock_sync_shared_to_local_ms(&clock_sync, 
+          (int64_t)command.timestamp * 1000 + command.timestamp_ms);
+
+        score->timestamp = timestamp_ms / 1000;
+        score->timestamp_ms = timestamp_ms % 1000;
+      } else {
+        stamp_score();
+      }
+
+      SC_LOG(APP_LOG_LEVEL_INFO, 
+        "Received score %d:%d", score->score_1, score->score_2);
+
+      log_score_event(SCORE_EVENT_REMOTE, 0);
+
+      render_score();
+      set_bg_color_on_colored_screen(GColorCyan);
+      schedule_commit(COMMIT_PERSIST_SCORE);
+      break;
     }
+    case RECEIVE_CMD_SYNC_SCORE_VAL:
+      // Sync request received, send data to the phone.
+      set_bg_color_on_colored_screen(GColorElectricUltramarine);
+      send_msg(SEND_CMD_SYNC_SCORE_VAL);
+      break;
+    case RECEIVE_CMD_PONG:
+      handle_pong(&command, received_ms);
+      break;
+    case RECEIVE_CMD_HELLO:
+      handle_hello(&command);
+      break;
+#if SC_TRACE
+    case RECEIVE_CMD_EXPORT_TRACE:
+      export_trace();
+      break;
+#endif
   }
+
+  commit_view();
 }
 
 static void inbox_dropped_callback(AppMessageResult reason, void *context) {
-  APP_LOG(APP_LOG_LEVEL_ERROR, "Message dropped. Reason: %d", (int)reason);
+  SC_TRACE_INPUT(TRACE_INBOX_DROPPED, 0, &(uint16_t){ reason }, sizeof(uint16_t));
+
+  uint16_t retry_after_ms = backpressure_on_drop(&backpressure, reason, clock_sync_now_ms());
+
+  SC_LOG(APP_LOG_LEVEL_INFO, "Inbound message dropped: %s (%d so far), retry after %d ms", 
+    backpressure_reason_name(reason), (int)backpressure_drops(&backpressure, reason), 
+    (int)retry_after_ms);
+
   set_bg_color_on_colored_screen(GColorOrange);
+  send_backoff();
+  commit_view();
 }
 
 static void outbox_sent_handler(DictionaryIterator *iterator, void *context) {
+  Tuple *cmd_tuple = dict_find(iterator, SEND_CMD_KEY);
+  SC_TRACE_EVENT(TRACE_OUTBOX_SENT, cmd_tuple != NULL ? cmd_tuple->value->uint8 : 0, NULL, 0);
+
+  // Pings, hellos and backoffs are not a score update, no feedback for them.
+  if (cmd_tuple && (cmd_tuple->value->uint8 == SEND_CMD_PING 
+    || cmd_tuple->value->uint8 == SEND_CMD_HELLO 
+    || cmd_tuple->value->uint8 == SEND_CMD_BACKOFF)) {
+    return;
+  }
+
+  if (offline_batch_in_flight_ops > 0) {
+    // The phone has got these offline changes, on to the rest, if any.
+    offline_queue_drop(&offline_queue, S_OFFLINE_QUEUE_KEY, offline_batch_in_flight_ops);
+    offline_batch_in_flight_ops = 0;
+    send_offline_batch();
+  }
+
   set_bg_color_on_colored_screen(GColorGreen);
+  commit_view();
 }
 
 static void outbox_failed_handler(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
+  Tuple *cmd_tuple = dict_find(iterator, SEND_CMD_KEY);
+  SC_TRACE_EVENT(TRACE_OUTBOX_FAILED, cmd_tuple != NULL ? cmd_tuple->value->uint8 : 0, 
+    &(uint16_t){ reason }, sizeof(uint16_t));
+
+  // Keep the offline changes for the next reconnect.
+  offline_batch_in_flight_ops = 0;
+
+  // A score change sent in the low-power mode may be the last one for a
+  // while, it goes out again with the next send window.
+  if (cmd_tuple != NULL && cmd_tuple->value->uint8 == SEND_CMD_SET_SCORE_VAL 
+    && low_power_is_active(&low_power)) {
+    schedule_commit(COMMIT_SEND_SET);
+  }
+
   set_bg_color_on_colored_screen(GColorRed);
+  commit_view();
 }
 
+#ifdef PBL_COLOR
 static void reset_bg_color_callback(void *data) {
-  GColor8 bg_color = GColorWhite;
+  set_bg_color_on_colored_screen(GColorWhite);
+}
+
+/**
+ * The last color requested during the event wins.
+ */
+static void set_bg_color_on_colored_screen(GColor8 color) {
+  // No feedback in the low-power mode, a colored screen costs a full repaint.
+  bg_color = low_power_is_active(&low_power) ? GColorWhite : color;
+  invalidate_view(VIEW_COLORS);
+}
 
-  if (s_opponent_score_text_layer != NULL) {
-    text_layer_set_background_color(s_opponent_score_text_layer, bg_color);
+static void apply_bg_color() {
+  // Repainting the window background redraws the whole screen.
+  if (window_bg_color.argb != bg_color.argb) {
+    window_set_background_color(s_main_window, bg_color);
+    window_bg_color = bg_color;
   }
-  if (s_my_score_text_layer != NULL) {
-    text_layer_set_background_color(s_my_score_text_layer, bg_color);
+
+  if (s_opponent_score_layer != NULL) {
+    score_layer_set_background_color(s_opponent_score_layer, bg_color);
+  }
+  if (s_my_score_layer != NULL) {
+    score_layer_set_background_color(s_my_score_layer, bg_color);
   }
-  if (s_whole_score_text_layer != NULL) {
-    text_layer_set_background_color(s_whole_score_text_layer, bg_color);
+  if (s_whole_score_layer != NULL) {
+    score_layer_set_background_color(s_whole_score_layer, bg_color);
+  }
+}
+#endif
+
+#if PBL_API_EXISTS(app_glance_reload)
+static void schedule_glance_update() {
+  if (glance_timer == NULL) {
+    glance_timer = app_timer_register(GLANCE_UPDATE_INTERVAL_MS, glance_timer_handler, NULL);
   }
+}
 
-  window_set_background_color(s_main_window, bg_color);
+static void glance_timer_handler(void *context) {
+  glance_timer = NULL;
+  publish_glance();
 }
 
-static void set_bg_color_on_colored_screen(GColor8 color) {
-  #ifdef PBL_COLOR
-    window_set_background_color(s_main_window, color);
+/**
+ * Show the score and the link in the launcher, so checking the score doesn't
+ * take launching the app. Nothing is written when the glance is up to date.
+ */
+static void publish_glance() {
+  char text[GLANCE_BUFF_SIZE];
 
-    if (s_opponent_score_text_layer != NULL) {
-      text_layer_set_background_color(s_opponent_score_text_layer, color);
-    }
-    if (s_my_score_text_layer != NULL) {
-      text_layer_set_background_color(s_my_score_text_layer, color);
-    }
-    if (s_whole_score_text_layer != NULL) {
-      text_layer_set_background_color(s_whole_score_text_layer, color);
-    }
-  #endif
+  snprintf(text, sizeof(text), GLANCE_FORMAT, score->score_1, score->score_2, 
+    connection_service_peek_pebble_app_connection() ? LINKED_TXT : NO_LINK_TXT);
+
+  if (strcmp(text, glance_text) != 0) {
+    strncpy(glance_text, text, GLANCE_BUFF_SIZE);
+    app_glance_reload(glance_reload_callback, glance_text);
+  }
+}
+
+static void glance_reload_callback(AppGlanceReloadSession *session, size_t limit, 
+  void *context) {
+
+  if (limit < 1) {
+    return;
+  }
+
+  const AppGlanceSlice slice = {
+    .layout = {
+      .icon = APP_GLANCE_SLICE_DEFAULT_ICON,
+      .subtitle_template_string = context
+    },
+    .expiration_time = APP_GLANCE_SLICE_NO_EXPIRATION
+  };
+
+  AppGlanceResult result = app_glance_add_slice(session, slice);
+  if (result != APP_GLANCE_RESULT_SUCCESS) {
+    SC_LOG(APP_LOG_LEVEL_ERROR, "Error adding the glance slice: %d", (int)result);
+  }
 }
+#endif
 
 static void click_config_provider(void *context) {
   window_single_click_subscribe(BUTTON_ID_UP, up_click_handler);
@@ -767,76 +2077,244 @@ static void click_config_provider(void *context) {
   window_single_click_subscribe(BUTTON_ID_BACK, back_click_handler);
 }
 
-static void init_score() {
+/**
+ * Everything the first frame needs, the newest record of the launch state
+ * log. Return false when the log has none yet: the values are then read from
+ * the keys they were kept under before, or are the defaults.
+ */
+static bool load_launch_state(LaunchState *state) {
+  state_log_init(&launch_log, S_LAUNCH_LOG_KEY, sizeof(LaunchState));
+  if (state_log_load(&launch_log, state)) {
+    return true;
+  }
+
+  if (persist_read_data(S_LAUNCH_STATE_KEY, state, sizeof(LaunchState)) 
+    == sizeof(LaunchState)) {
+
+    is_launch_state_moved = true;
+    return false;
+  }
+
+  state->score_1 = persist_exists(S_SCORE_1_KEY) ? persist_read_int(S_SCORE_1_KEY) : 0;
+  state->score_2 = persist_exists(S_SCORE_2_KEY) ? persist_read_int(S_SCORE_2_KEY) : 0;
+  state->timestamp = persist_exists(S_TIMESTAMP_KEY) ? persist_read_int(S_TIMESTAMP_KEY) : 0;
+  state->user_role = persist_exists(S_USER_ROLE_KEY) 
+    ? persist_read_int(S_USER_ROLE_KEY) : PLAYER;
+  state->sc_2_player_position = persist_exists(S_SC_POS_TO_PLAYER_KEY) 
+    ? persist_read_int(S_SC_POS_TO_PLAYER_KEY) : LEFT_EDGE;
+  state->sc_2_referee_position = persist_exists(S_SC_POS_TO_REFEREE_KEY) 
+    ? persist_read_int(S_SC_POS_TO_REFEREE_KEY) : SAME_SIDE;
+  state->low_power_setting = persist_exists(S_LOW_POWER_KEY) 
+    ? persist_read_int(S_LOW_POWER_KEY) : LOW_POWER_AUTO;
+  is_launch_state_moved = true;
+
+  return false;
+}
+
+static void init_score(const LaunchState *state) {
   score = (Score *)malloc(sizeof(Score));
 
-  if (persist_exists(S_SCORE_1_KEY)) {
-    score->score_1 = persist_read_int(S_SCORE_1_KEY);
+  score->score_1 = state->score_1;
+  score->score_2 = state->score_2;
+  score->timestamp = state->timestamp;
+  score->timestamp_ms = 0;
+  score->user_role = state->user_role;
+  score->sc_2_player_position = state->sc_2_player_position;
+  score->sc_2_referee_position = state->sc_2_referee_position;
+
+  snprintf(score->score_1_text, sizeof(score->score_1_text), "%d", score->score_1);
+  snprintf(score->score_2_text, sizeof(score->score_2_text), "%d", score->score_2);
+  snprintf(score->whole_score_text, sizeof(score->whole_score_text), "%s:%s", 
+      score->score_1_text, score->score_2_text);
+}
+
+static void init_score_crdt() {
+  if (persist_exists(S_DEVICE_ID_KEY)) {
+    device_id = (uint32_t)persist_read_int(S_DEVICE_ID_KEY);
   } else {
-    score->score_1 = 0;
+    // Random, there's no serial number to tell the watches apart.
+    time_t now;
+    uint16_t now_ms;
+    time_ms(&now, &now_ms);
+    srand((unsigned int)now * 1000 + now_ms);
+
+    device_id = ((uint32_t)rand() << 16 ^ (uint32_t)rand()) | 1;
+    persist_write_int(S_DEVICE_ID_KEY, (int32_t)device_id);
   }
-  if (persist_exists(S_SCORE_2_KEY)) {
-    score->score_2 = persist_read_int(S_SCORE_2_KEY);
+
+  if (persist_get_size(S_SCORE_CRDT_KEY) == sizeof(PnCounter)) {
+    persist_read_data(S_SCORE_CRDT_KEY, &score_crdt, sizeof(PnCounter));
   } else {
-    score->score_2 = 0;
+    pn_counter_init(&score_crdt, MAX_SCORE + 1);
   }
-  if (persist_exists(S_TIMESTAMP_KEY)) {
-    score->timestamp = persist_read_int(S_TIMESTAMP_KEY);
-  } else {
-    score->timestamp = 0;
+
+  // A score persisted before the CRDT or with another orientation since.
+  record_score_change();
+}
+
+/**
+ * The plain counter until a sport is chosen in SETTING_MODE.
+ */
+static void init_sport() {
+  if (persist_read_data(S_SPORT_KEY, &sport, sizeof(SportState)) != sizeof(SportState) 
+    || sport.sport >= SPORT_COUNT) {
+
+    sport_init(&sport, SPORT_COUNTER, MAX_SCORE + 1);
   }
-  if (persist_exists(S_USER_ROLE_KEY)) {
-    score->user_role = persist_read_int(S_USER_ROLE_KEY);
-  } else {
-    score->user_role = PLAYER;
+}
+
+static void refresh_time_text() {
+  time_t now = time(NULL);
+
+  strftime(top_bar_info->time, TIME_BUFF_SIZE, "%H:%M", localtime(&now));
+  is_setting_shown = false;
+
+  invalidate_view(VIEW_STATUS_TIME);
+}
+
+static void tick_handler(struct tm *tick_time, TimeUnits changed) {
+  // A second tick only repaints the match clock. It is charged to the event
+  // still open, whose color feedback may not be over yet.
+  if (changed & MINUTE_UNIT) {
+    SC_REDRAW_EVENT(REDRAW_EVENT_TICK);
   }
-  if (persist_exists(S_SC_POS_TO_PLAYER_KEY)) {
-    score->sc_2_player_position = persist_read_int(S_SC_POS_TO_PLAYER_KEY);
-  } else {
-    score->sc_2_player_position = LEFT_EDGE;
+
+  if (match_clock_observe(&match_clock, time(NULL))) {
+    schedule_commit(COMMIT_PERSIST_CLOCK);
   }
-  if (persist_exists(S_SC_POS_TO_REFEREE_KEY)) {
-    score->sc_2_referee_position = persist_read_int(S_SC_POS_TO_REFEREE_KEY);
-  } else {
-    score->sc_2_referee_position = SAME_SIDE;
+  if (is_main_window_visible) {
+    invalidate_view(VIEW_MATCH_CLOCK);
   }
 
-  snprintf(score->score_1_text, sizeof(score->score_1_text), "%d", score->score_1);
-  snprintf(score->score_2_text, sizeof(score->score_2_text), "%d", score->score_2);
-  snprintf(score->whole_score_text, sizeof(score->whole_score_text), "%s:%s", 
-      score->score_1_text, score->score_2_text);
-}
+  if ((changed & MINUTE_UNIT) && !(low_power_is_active(&low_power) 
+    && tick_time->tm_min % LOW_POWER_TIME_STEP_MIN != 0)) {
 
-static void tick_handler(struct tm *tick_time, TimeUnits changed) {
-  // Read time into a string buffer
-  strftime(top_bar_info->time, TIME_BUFF_SIZE, "%H:%M", tick_time);
+    // Read time into a string buffer
+    strftime(top_bar_info->time, TIME_BUFF_SIZE, "%H:%M", tick_time);
+    is_setting_shown = false;
 
-  custom_status_bar_layer_set_text(custom_status_bar, CSB_TEXT_CENTER, top_bar_info->time);
+    invalidate_view(VIEW_STATUS_TIME);
+  }
+
+  commit_view();
 }
 
 static void app_connection_handler(bool connected) {
-  APP_LOG(APP_LOG_LEVEL_INFO, "Pebble app %sconnected", connected ? "" : "dis");
+  SC_REDRAW_EVENT(REDRAW_EVENT_OTHER);
+  SC_TRACE_INPUT(TRACE_CONNECTION, connected ? 1 : 0, NULL, 0);
+
+  SC_LOG(APP_LOG_LEVEL_INFO, "Pebble app %sconnected", connected ? "" : "dis");
 
-  custom_status_bar_layer_set_text(custom_status_bar, CSB_TEXT_LEFT, 
-    connected ? LINKED_TXT : NO_LINK_TXT);
+  update_link_status();
+  schedule_glance_update();
 
   if (connected) {
-    send_msg(SEND_CMD_SYNC_SCORE_VAL);
+    if (last_disconnect_ms > 0 
+      && clock_sync_now_ms() - last_disconnect_ms < LINK_DEBOUNCE_MS) {
+
+      // Flapping, a link that drops again right away is not worth a HELLO.
+      if (link_timer != NULL) {
+        app_timer_cancel(link_timer);
+      }
+      link_timer = app_timer_register(LINK_DEBOUNCE_MS, link_timer_handler, NULL);
+    } else {
+      start_link();
+      schedule_clock_sync_probe(CLOCK_SYNC_FIRST_PROBE_MS);
+    }
+  } else {
+    last_disconnect_ms = clock_sync_now_ms();
+
+    if (link_timer != NULL) {
+      app_timer_cancel(link_timer);
+      link_timer = NULL;
+    }
+    if (hello_timer != NULL) {
+      app_timer_cancel(hello_timer);
+      hello_timer = NULL;
+    }
+    if (backoff_timer != NULL) {
+      app_timer_cancel(backoff_timer);
+      backoff_timer = NULL;
+    }
+    if (clock_sync_timer != NULL) {
+      app_timer_cancel(clock_sync_timer);
+      clock_sync_timer = NULL;
+      clock_sync_on_probe_lost(&clock_sync);
+    }
+  }
+
+  commit_view();
+}
+
+/**
+ * The charge is in parentheses in the low-power mode.
+ */
+static void format_battery_text(BatteryChargeState charge) {
+  snprintf(top_bar_info->battery_charge, BATT_CHARGE_BUFF_SIZE, 
+    low_power_is_active(&low_power) ? BATT_CHARGE_LOW_POWER_FORMAT : BATT_CHARGE_FORMAT, 
+    charge.charge_percent);
+
+  invalidate_view(VIEW_STATUS_BATTERY);
+}
+
+/**
+ * Bring the blinking, the colors and the pending send in line with the
+ * low-power mode that has just turned on or off.
+ */
+static void on_low_power_changed() {
+  bool is_active = low_power_is_active(&low_power);
+
+  SC_LOG(APP_LOG_LEVEL_INFO, "Low-power mode %s", is_active ? "on" : "off");
+
+  if (btn_mode == SETTING_MODE) {
+    if (is_active) {
+      stop_sc_blinking();
+    } else if (blink_sc_timer == NULL) {
+      blink_sc_timer = app_timer_register(SC_BLINK_INTERVAL, blink_sc_timer_handler, NULL);
+    }
+  }
+
+  if (is_active) {
+    reset_bg_color_callback(NULL);
+  } else {
+    flush_send();
+    refresh_time_text();
   }
+
+  // The match clock goes down to minutes, or back to seconds.
+  subscribe_ticks();
+  invalidate_view(VIEW_MATCH_CLOCK);
+
+  format_battery_text(battery_state_service_peek());
 }
 
 static void battery_state_handler(BatteryChargeState charge) {
-  snprintf(top_bar_info->battery_charge, BATT_CHARGE_BUFF_SIZE, "%d%%", charge.charge_percent);
+  SC_REDRAW_EVENT(REDRAW_EVENT_OTHER);
+  SC_TRACE_INPUT(TRACE_BATTERY, charge.charge_percent | (charge.is_charging ? 0x80 : 0), 
+    NULL, 0);
 
-  custom_status_bar_layer_set_text(custom_status_bar, CSB_TEXT_RIGHT, top_bar_info->battery_charge);
+  if (low_power_on_battery(&low_power, charge)) {
+    on_low_power_changed();
+  }
+  format_battery_text(charge);
+
+  commit_view();
 }
 
+/**
+ * Only the bar itself for the first frame, the texts follow in
+ * fill_status_bar() once the score is shown.
+ */
 static void init_status_bar(Layer *window_layer) {
   top_bar_info = (TopBarInfo *)malloc(sizeof(TopBarInfo));
 
   custom_status_bar = custom_status_bar_layer_create(
     STATUS_BAR_HEIGHT, GColorBlack, STATUS_BAR_ICON_WIDTH_HEIGHT);
 
+  layer_add_child(window_layer, custom_status_bar);
+}
+
+static void fill_status_bar() {
   if (connection_service_peek_pebble_app_connection()) {
     strncpy(top_bar_info->connection, LINKED_TXT, CONN_BUFF_SIZE);
   } else {
@@ -845,8 +2323,7 @@ static void init_status_bar(Layer *window_layer) {
   
   clock_copy_time_string(top_bar_info->time, TIME_BUFF_SIZE);
 
-  BatteryChargeState state = battery_state_service_peek();
-  snprintf(top_bar_info->battery_charge, BATT_CHARGE_BUFF_SIZE, "%d%%", state.charge_percent);
+  format_battery_text(battery_state_service_peek());
 
   custom_status_bar_layer_set_text(custom_status_bar, CSB_TEXT_LEFT, top_bar_info->connection);
   custom_status_bar_layer_set_text(custom_status_bar, CSB_TEXT_CENTER, top_bar_info->time);
@@ -858,42 +2335,183 @@ static void init_status_bar(Layer *window_layer) {
     custom_status_bar, CSB_TEXT_CENTER, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
   custom_status_bar_layer_set_text_font(
     custom_status_bar, CSB_TEXT_RIGHT, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-
-  layer_add_child(window_layer, custom_status_bar);
 }
 
-static void init() {
-  init_score();
+/**
+ * The rest of the launch, run once the first frame with the score is on
+ * screen: the state only the later frames need, the status bar details,
+ * the system services, the link to the phone and the data logging session.
+ */
+static void launch_timer_handler(void *context) {
+  launch_timer = NULL;
+  SC_LAUNCH_MARK(LAUNCH_PHASE_FIRST_FRAME);
+
+  init_match_stats();
+  init_match_clock();
+  init_score_crdt();
+  init_sport();
+  offline_queue_load(&offline_queue, S_OFFLINE_QUEUE_KEY);
+  SC_LAUNCH_MARK(LAUNCH_PHASE_STATE_LOADED);
 
-  // Get updates when the current minute changes
-  tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
+  fill_status_bar();
 
   // Get battery state updates
   battery_state_service_subscribe(battery_state_handler);
 
-  s_main_window = window_create();
-  window_set_click_config_provider(s_main_window, click_config_provider);
-  window_set_user_data(s_main_window, score);
-  window_set_window_handlers(s_main_window, (WindowHandlers) {
-    .load = main_window_load,
-    .unload = main_window_unload,
+  s_stats_window = window_create();
+  window_set_window_handlers(s_stats_window, (WindowHandlers) {
+    .load = stats_window_load,
+    .appear = stats_window_appear,
+    .disappear = stats_window_disappear,
+    .unload = stats_window_unload,
   });
 
   app_message_register_inbox_received(inbox_received_callback);
   app_message_register_inbox_dropped(inbox_dropped_callback);
   app_message_register_outbox_sent(outbox_sent_handler);
   app_message_register_outbox_failed(outbox_failed_handler);
-  app_message_open(INBOUND_SIZE, OUTBOUND_SIZE);
+
+  // Never more than the firmware allows, the sizes are advertised in HELLO.
+  inbox_size = backpressure_inbox_size(app_message_inbox_size_maximum());
+  outbox_size = OUTBOUND_SIZE < app_message_outbox_size_maximum() 
+    ? OUTBOUND_SIZE : app_message_outbox_size_maximum();
+  app_message_open(inbox_size, outbox_size);
+  link_caps_init_legacy(&link_caps, outbox_size);
 
   // Get the updates when the connection to the Pebble app on the phone changes.
   connection_service_subscribe((ConnectionHandlers) {
     .pebble_app_connection_handler = app_connection_handler
   });
 
-  window_stack_push(s_main_window, true);
+  clock_sync_init(&clock_sync);
+  inbox_decoder_init(&inbox_decoder, MAX_SCORE);
+  backpressure_init(&backpressure);
+  event_log_open(&event_log, DATA_LOG_SCORE_EVENTS_TAG, S_EVENT_LOG_SEQ_KEY);
+  SC_LAUNCH_MARK(LAUNCH_PHASE_LINK_OPEN);
+
+  is_launched = true;
+#if SC_TRACE
+  write_trace_checkpoint();
+#endif
+
+  // Get updates when the current minute changes, every second while the
+  // main window shows the match clock.
+  subscribe_ticks();
+  invalidate_view(VIEW_MATCH_CLOCK);
+
+  if (connection_service_peek_pebble_app_connection()) {
+    // Changes left from the previous run, when the phone was not connected,
+    // go out after the hello.
+    start_link();
+    schedule_clock_sync_probe(CLOCK_SYNC_FIRST_PROBE_MS);
+  }
+
+  commit_view();
+  SC_LAUNCH_MARK(LAUNCH_PHASE_DONE);
+  SC_LAUNCH_SUMMARY();
+}
+
+/**
+ * Only what the first frame needs: the launch state, read at once, and the
+ * main window with the score. The rest waits for launch_timer_handler(),
+ * whose event comes after the one rendering the pushed window.
+ */
+static void init() {
+  LaunchState state;
+
+  SC_LAUNCH_MARK(LAUNCH_PHASE_START);
+#if SC_TRACE
+  trace_recorder_init(write_trace_checkpoint);
+#endif
+  bool is_state_stored = load_launch_state(&state);
+
+  init_score(&state);
+  low_power_init(&low_power, (LowPowerSetting)state.low_power_setting, 
+    battery_state_service_peek());
+  if (!is_state_stored) {
+    // Moved over to the log from the keys used before.
+    schedule_commit(COMMIT_PERSIST_SETTINGS);
+  }
+  SC_LAUNCH_MARK(LAUNCH_PHASE_STATE_READ);
+
+  s_main_window = window_create();
+  window_set_click_config_provider(s_main_window, click_config_provider);
+  window_set_user_data(s_main_window, score);
+  window_set_window_handlers(s_main_window, (WindowHandlers) {
+    .load = main_window_load,
+    .appear = main_window_appear,
+    .disappear = main_window_disappear,
+    .unload = main_window_unload,
+  });
+
+  // Not animated, the system already animates the app launch.
+  window_stack_push(s_main_window, false);
+  SC_LAUNCH_MARK(LAUNCH_PHASE_WINDOW_PUSHED);
+
+  launch_timer = app_timer_register(0, launch_timer_handler, NULL);
 }
 
 static void deinit() {
+  // Left before the first frame: only the state the commit below writes 
+  // back is loaded, the link, services and windows of the rest of the 
+  // launch are never set up.
+  if (launch_timer != NULL) {
+    app_timer_cancel(launch_timer);
+    launch_timer = NULL;
+    init_match_stats();
+    init_match_clock();
+    init_score_crdt();
+    init_sport();
+  }
+
+  // A select click still waiting for a second one is taken as it is.
+  if (select_click_timer != NULL) {
+    app_timer_cancel(select_click_timer);
+    select_click_timer_handler(NULL);
+  }
+
+  flush_commit();
+  SC_REDRAW_SUMMARY();
+
+  if (event_log_timer != NULL) {
+    app_timer_cancel(event_log_timer);
+    event_log_timer = NULL;
+  }
+#if SC_TRACE
+  if (trace_export_timer != NULL) {
+    // The rest of the export is lost with the app.
+    app_timer_cancel(trace_export_timer);
+    trace_export_timer = NULL;
+    data_logging_finish(trace_session);
+    trace_session = NULL;
+  }
+#endif
+  event_log_close(&event_log);
+  if (event_log.dropped > 0) {
+    SC_LOG(APP_LOG_LEVEL_WARNING, "Score events: %d logged, %d dropped", 
+      (int)event_log.logged, (int)event_log.dropped);
+  }
+
+#if PBL_API_EXISTS(app_glance_reload)
+  if (glance_timer != NULL) {
+    app_timer_cancel(glance_timer);
+    glance_timer = NULL;
+  }
+#endif
+  // The launcher shows the score the app is left with.
+  publish_glance();
+
+  if (backpressure_total_drops(&backpressure) > 0) {
+    SC_LOG(APP_LOG_LEVEL_INFO, "Inbound drops: %d busy, %d overflow, %d in total", 
+      (int)backpressure_drops(&backpressure, APP_MSG_BUSY), 
+      (int)backpressure_drops(&backpressure, APP_MSG_BUFFER_OVERFLOW), 
+      (int)backpressure_total_drops(&backpressure));
+  }
+
+  if (s_stats_window != NULL) {
+    window_destroy(s_stats_window);
+    s_stats_window = NULL;
+  }
   window_destroy(s_main_window);
 }
 
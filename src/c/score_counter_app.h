@@ -5,34 +5,97 @@
 #pragma once
 
 #include <pebble.h>
+#include "build_config.h"
+#include "match_stats.h"
+#include "match_clock.h"
+#include "offline_queue.h"
+#include "score_layer.h"
+#include "clock_sync.h"
+#include "protocol.h"
+#include "inbox_decoder.h"
+#include "link_caps.h"
+#include "backpressure.h"
+#include "pn_counter.h"
+#include "state_digest.h"
+#include "low_power.h"
+#include "event_log.h"
+#include "sport_rules.h"
+#include "state_log.h"
 
 #define MIN_SCORE 0
 #define MAX_SCORE 999
-#define LARGER_FONT_SCORE_LIMIT 99
+#define LARGER_DIGITS_SCORE_LIMIT 99
 
-#define INBOUND_SIZE 50
-#define OUTBOUND_SIZE 50
+#define OUTBOUND_SIZE 192
 
 #define RESET_BG_COLOR_MS 500
 #define SC_BLINK_INTERVAL 400
+#define STATS_REFRESH_MS 1000
+#define SELECT_DOUBLE_CLICK_MS 300
+
+#define CLOCK_SYNC_FIRST_PROBE_MS 1500
+#define CLOCK_SYNC_PROBE_INTERVAL_MS 60000
+#define CLOCK_SYNC_PROBE_TIMEOUT_MS 5000
+#define CLOCK_SYNC_RETRY_MS 500
+
+#define HELLO_TIMEOUT_MS 1500
+#define SUPPORTED_FEATURES (PROTOCOL_FEATURE_BATCH | PROTOCOL_FEATURE_STATS \
+  | PROTOCOL_FEATURE_PING | PROTOCOL_FEATURE_PACKED_SCORE | PROTOCOL_FEATURE_BACKOFF \
+  | PROTOCOL_FEATURE_SCORE_CRDT | PROTOCOL_FEATURE_DIGEST | PROTOCOL_FEATURE_SPORT \
+  | (SC_TRACE ? PROTOCOL_FEATURE_TRACE : 0))
+#define BACKOFF_SEND_RETRY_MS 50
+#define LINK_DEBOUNCE_MS 3000
+#define EVENT_LOG_RETRY_MS 1000
+
+/**
+ * The app glance follows the committed score and the link at most this often
+ * while the app runs, and once more when it exits.
+ */
+#define GLANCE_UPDATE_INTERVAL_MS 60000
+#define GLANCE_BUFF_SIZE 24
+#define GLANCE_FORMAT "%d:%d  %s"
+
+/**
+ * In the low-power mode, score changes go out together after the send window,
+ * the time on the status bar changes in steps of minutes and the link and
+ * the statistics are refreshed less often.
+ */
+#define LOW_POWER_SEND_WINDOW_MS 3000
+#define LOW_POWER_SEND_RETRY_MS 500
+#define LOW_POWER_TIME_STEP_MIN 5
+#define LOW_POWER_CLOCK_SYNC_PROBE_INTERVAL_MS 300000
+#define LOW_POWER_STATS_REFRESH_MS 5000
 
 #define MARGIN 8
 #define Y_WHOLE_SCORE_CORRECTION 10
 
 #define STATUS_BAR_HEIGHT 26
 #define STATUS_BAR_ICON_WIDTH_HEIGHT 15
-#define SCORE_TEXT_RECT_HEIGHT 36
-#define WHOLE_SCORE_TEXT_RECT_HEIGHT 38
+#define SCORE_RECT_HEIGHT 36
+#define WHOLE_SCORE_RECT_HEIGHT 38
+
+/**
+ * Cell sizes of the digit glyph atlases, see tools/gen_digit_atlas.py.
+ */
+#define DIGITS_LARGE_WIDTH 22
+#define DIGITS_LARGE_COLON_WIDTH 10
+#define DIGITS_LARGE_HEIGHT 36
+#define DIGITS_SMALL_WIDTH 17
+#define DIGITS_SMALL_COLON_WIDTH 8
+#define DIGITS_SMALL_HEIGHT 30
 
 #define SC_LONGER_DIMENSION 48
 #define SC_SHORTER_DIMENSION 12
 
 #define CONN_BUFF_SIZE 8
 #define TIME_BUFF_SIZE 12
-#define BATT_CHARGE_BUFF_SIZE 5
+#define BATT_CHARGE_BUFF_SIZE 7
 
 #define LINKED_TXT "Linked"
 #define NO_LINK_TXT "No link"
+#define LINK_QUALITY_FORMAT "L %d%%"
+#define BATT_CHARGE_FORMAT "%d%%"
+#define BATT_CHARGE_LOW_POWER_FORMAT "(%d%%)"
 
 
 /**
@@ -101,39 +164,60 @@ typedef enum {
     SC_SET_BOTTOM
 } SettingModeSCPosition;
 
-typedef enum {
-  SEND_CMD_KEY = 10,
-  SEND_SCORE_1_KEY = 11,
-  SEND_SCORE_2_KEY = 12,
-  SEND_TIMESTAMP_KEY = 13
-} DictSendKey;
-
-typedef enum {
-  SEND_CMD_SET_SCORE_VAL = 1,
-  SEND_CMD_SYNC_SCORE_VAL = 2
-} DictSendCmdVal;
-
-typedef enum {
-  RECEIVE_CMD_KEY = 10,
-  RECEIVE_SCORE_1_KEY = 11,
-  RECEIVE_SCORE_2_KEY = 12,
-  RECEIVE_TIMESTAMP_KEY = 13
-} DictReceiveKey;
-
-typedef enum {
-  RECEIVE_CMD_SET_SCORE_VAL = 1,
-  RECEIVE_CMD_SYNC_SCORE_VAL = 2
-} DictReceiveCmdVal;
-
 typedef enum {
   S_SCORE_1_KEY = 11,
   S_SCORE_2_KEY = 12,
   S_TIMESTAMP_KEY = 13,
   S_USER_ROLE_KEY = 14,
   S_SC_POS_TO_PLAYER_KEY = 15,
-  S_SC_POS_TO_REFEREE_KEY = 16
+  S_SC_POS_TO_REFEREE_KEY = 16,
+  S_MATCH_STATS_KEY = 17,
+  S_OFFLINE_QUEUE_KEY = 18,
+  S_SCORE_CRDT_KEY = 19,
+  S_DEVICE_ID_KEY = 20,
+  S_LOW_POWER_KEY = 21,
+  S_MATCH_CLOCK_KEY = 22,
+  S_LAUNCH_STATE_KEY = 23,
+  S_SPORT_KEY = 24,
+  /**
+   * First of the STATE_LOG_SLOTS keys of the launch state log, the keys up
+   * to S_LAUNCH_LOG_KEY + STATE_LOG_SLOTS - 1 are taken.
+   */
+  S_LAUNCH_LOG_KEY = 25,
+  S_EVENT_LOG_SEQ_KEY = 29
 } Storage;
 
+/**
+ * I/O deferred from the input handlers to the commit stage.
+ */
+typedef enum {
+  COMMIT_SEND_SET = 1 << 0,
+  COMMIT_PERSIST_SCORE = 1 << 1,
+  COMMIT_PERSIST_SETTINGS = 1 << 2,
+  COMMIT_PERSIST_LOW_POWER = 1 << 3,
+  COMMIT_PERSIST_CLOCK = 1 << 4,
+  COMMIT_LOG_EVENTS = 1 << 5,
+  /**
+   * With COMMIT_SEND_SET, send right away even in the low-power mode.
+   */
+  COMMIT_SEND_NOW = 1 << 6,
+  COMMIT_PERSIST_SPORT = 1 << 7
+} CommitWork;
+
+/**
+ * Parts of the main window view to be brought up to date by the next
+ * commit_view() pass.
+ */
+typedef enum {
+  VIEW_LAYOUT = 1 << 0,
+  VIEW_SCORE_TEXT = 1 << 1,
+  VIEW_COLORS = 1 << 2,
+  VIEW_STATUS_LINK = 1 << 3,
+  VIEW_STATUS_TIME = 1 << 4,
+  VIEW_STATUS_BATTERY = 1 << 5,
+  VIEW_MATCH_CLOCK = 1 << 6
+} ViewInvalidation;
+
 
 /**
  * Structs
@@ -152,36 +236,89 @@ typedef struct {
   char score_2_text[4];
   char whole_score_text[8];
   time_t timestamp;
+  uint16_t timestamp_ms;
   UserRole user_role;
   SCPositionRelativeToPlayer sc_2_player_position;
   SCPositionRelativeToReferee sc_2_referee_position;
 } Score;
 
+/**
+ * What the first frame needs, kept as one record so that a cold start takes
+ * one bounded read of the launch state log. Before, the record was kept
+ * under S_LAUNCH_STATE_KEY, and before that the values were kept under the
+ * separate keys S_SCORE_1_KEY to S_SC_POS_TO_REFEREE_KEY and S_LOW_POWER_KEY.
+ */
+typedef struct {
+  uint16_t score_1;
+  uint16_t score_2;
+  int32_t timestamp;
+  uint8_t user_role;
+  uint8_t sc_2_player_position;
+  uint8_t sc_2_referee_position;
+  uint8_t low_power_setting;
+} LaunchState;
+
 
 /**
  * Prototypes
  */
 
-static void send_msg(DictSendCmdVal cmd_val);
+static void write_score_crdt(DictionaryIterator *iter);
+static void write_sport(DictionaryIterator *iter);
+static uint8_t outbox_log_level(AppMessageResult result_code);
+static bool send_msg(DictSendCmdVal cmd_val);
+static bool send_offline_batch();
+static void send_sync_or_offline_batch();
+static bool send_hello();
+static void start_link();
+static void link_timer_handler(void *context);
+static void hello_timer_handler(void *context);
+static bool is_phone_in_sync(const InboxCommand *command);
+static void handle_hello(const InboxCommand *command);
+static void send_backoff();
+static void backoff_timer_handler(void *context);
+static void send_ping();
+static uint32_t clock_sync_probe_interval_ms();
+static void schedule_clock_sync_probe(uint32_t delay_ms);
+static void clock_sync_timer_handler(void *context);
+static void handle_pong(const InboxCommand *command, int64_t t3);
+static void update_link_status();
+static void stamp_score();
+static void record_score_change();
+static uint8_t transferred_team(uint8_t team);
+static void log_score_event(ScoreEventType type, uint8_t detail);
 static void horizontal_ruler_update_proc(Layer *layer, GContext *ctx);
 static void sc_update_proc(Layer *layer, GContext *ctx);
-static int16_t calc_score_text_layer_y_coord(GRect parent_layer_bounds, 
+static int16_t calc_score_layer_y_coord(GRect parent_layer_bounds, 
   ScoreOnSmartwatch which_score, int16_t height);
-static GRect init_score_text_layer(Layer *parent_layer, TextLayer **text_layer,
-  int16_t h, char *font_key, ScoreOnSmartwatch which_score);
-static void init_separate_score_text_layers(Layer *window_layer);
-static void init_whole_score_text_layer(Layer *window_layer);
-static void init_score_text_layers(Layer *window_layer);
+static GRect init_score_layer(Layer *parent_layer, ScoreLayer **score_layer,
+  int16_t h, const DigitAtlas *atlas, ScoreOnSmartwatch which_score);
+static void init_separate_score_layers(Layer *window_layer);
+static void init_whole_score_layer(Layer *window_layer);
+static void init_score_layers(Layer *window_layer);
 static inline void create_sc_layer_on_top(GRect bounds);
 static inline void create_sc_layer_on_right(GRect bounds);
 static inline void create_sc_layer_on_bottom(GRect bounds);
 static inline void create_sc_layer_on_left(GRect bounds);
 static void create_score_counter_layer(Layer *window_layer);
+static void init_score_counter_layer(Layer *window_layer);
+static void init_ruler_layer(Layer *window_layer);
+static SettingModeSCPosition normal_mode_sc_position();
+static SettingModeSCPosition current_layout();
+static void place_match_clock_layer(Layer *window_layer);
+static void build_layout(Layer *window_layer);
+static void invalidate_view(uint8_t parts);
+static void commit_view();
+static void stop_sc_blinking();
 static void main_window_load(Window *window);
 static void main_window_unload(Window *window);
+static void main_window_appear(Window *window);
+static void main_window_disappear(Window *window);
+static void subscribe_ticks();
 static void blink_sc_timer_handler(void *context);
-static void adjust_whole_score_font();
+static void adjust_whole_score_atlas();
 static void swap_numbers(uint16_t *num1, uint16_t *num2);
+static bool step_score(uint8_t team, bool is_take_back);
 static void up_click_handler(ClickRecognizerRef recognizer, void *context);
 static void down_click_handler(ClickRecognizerRef recognizer, void *context);
 static void up_long_click_handler_down(
@@ -190,10 +327,37 @@ static void down_long_click_handler_down(
   ClickRecognizerRef recognizer, void *context);
 static void select_click_handler(ClickRecognizerRef recognizer, void *context);
 static void select_long_click_handler_down(ClickRecognizerRef recognizer, void *context);
+static void select_click_timer_handler(void *context);
 static void back_click_handler(ClickRecognizerRef recognizer, void *context);
 static void render_score();
+static void format_score_text();
 static void persist_score();
-static void persist_user_role_and_sc_position();
+static void schedule_commit(uint8_t work);
+static void commit_timer_handler(void *context);
+static void log_pending_events();
+static void event_log_timer_handler(void *context);
+static void send_timer_handler(void *context);
+static void flush_send();
+static void flush_commit();
+static void init_match_stats();
+static void init_match_clock();
+static void update_match_clock(time_t last_point_time);
+static void reset_match_stats();
+static void init_score_crdt();
+static void init_sport();
+static void stats_window_load(Window *window);
+static void stats_window_unload(Window *window);
+static void stats_window_appear(Window *window);
+static void stats_window_disappear(Window *window);
+static void refresh_stats_view();
+static void refresh_stats_timer_handler(void *context);
+static void get_launch_state(LaunchState *state);
+static void persist_launch_state();
+#if SC_TRACE
+static void write_trace_checkpoint();
+static void export_trace();
+static void trace_export_timer_handler(void *context);
+#endif
 static void set_setting_mode_cfg_from_normal_mode_cfg();
 static void set_normal_mode_cfg_from_setting_mode_cfg();
 static inline bool should_swap_before_send_or_after_receive();
@@ -202,13 +366,38 @@ static void inbox_dropped_callback(AppMessageResult reason, void *context);
 static void outbox_sent_handler(DictionaryIterator *iterator, void *context);
 static void outbox_failed_handler(DictionaryIterator *iterator, 
     AppMessageResult reason, void *context);
+#ifdef PBL_COLOR
 static void reset_bg_color_callback(void *data);
 static void set_bg_color_on_colored_screen(GColor8 color);
+static void apply_bg_color();
+#else
+// The color feedback has no effect on black and white platforms,
+// so the calls are compiled out there.
+#define reset_bg_color_callback(data)
+#define set_bg_color_on_colored_screen(color)
+#endif
+#if PBL_API_EXISTS(app_glance_reload)
+static void schedule_glance_update();
+static void glance_timer_handler(void *context);
+static void publish_glance();
+static void glance_reload_callback(AppGlanceReloadSession *session, size_t limit, 
+  void *context);
+#else
+// No app glances on aplite, the launcher shows just the app name.
+#define schedule_glance_update()
+#define publish_glance()
+#endif
 static void click_config_provider(void *context);
-static void init_score();
+static bool load_launch_state(LaunchState *state);
+static void init_score(const LaunchState *state);
+static void refresh_time_text();
 static void tick_handler(struct tm *tick_time, TimeUnits changed);
 static void app_connection_handler(bool connected);
+static void format_battery_text(BatteryChargeState charge);
+static void on_low_power_changed();
 static void battery_state_handler(BatteryChargeState charge);
-static void init_status_bar();
+static void init_status_bar(Layer *window_layer);
+static void fill_status_bar();
+static void launch_timer_handler(void *context);
 static void init();
 static void deinit();
\ No newline at end of file
@@ -0,0 +1,150 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "score_layer.h"
+#include "build_config.h"
+
+
+typedef struct {
+  const DigitAtlas *atlas;
+  GColor bg_color;
+  char text[SCORE_LAYER_TEXT_BUFF_SIZE];
+} ScoreLayerData;
+
+static void score_layer_update_proc(Layer *layer, GContext *ctx);
+
+
+bool digit_atlas_load(DigitAtlas *atlas, uint32_t resource_id, 
+  uint8_t digit_width, uint8_t colon_width, uint8_t height) {
+
+  atlas->bitmap = gbitmap_create_with_resource(resource_id);
+  if (atlas->bitmap == NULL) {
+    SC_LOG(APP_LOG_LEVEL_ERROR, "Couldn't load the digit atlas %d", (int)resource_id);
+    return false;
+  }
+
+  atlas->digit_width = digit_width;
+  atlas->colon_width = colon_width;
+  atlas->height = height;
+
+  for (uint8_t i = 0; i < DIGIT_ATLAS_COLON_GLYPH; i++) {
+    atlas->glyphs[i] = gbitmap_create_as_sub_bitmap(atlas->bitmap, 
+      GRect(i * digit_width, 0, digit_width, height));
+  }
+  atlas->glyphs[DIGIT_ATLAS_COLON_GLYPH] = gbitmap_create_as_sub_bitmap(atlas->bitmap, 
+    GRect(DIGIT_ATLAS_COLON_GLYPH * digit_width, 0, colon_width, height));
+
+  return true;
+}
+
+void digit_atlas_unload(DigitAtlas *atlas) {
+  for (uint8_t i = 0; i < DIGIT_ATLAS_GLYPH_COUNT; i++) {
+    if (atlas->glyphs[i] != NULL) {
+      gbitmap_destroy(atlas->glyphs[i]);
+      atlas->glyphs[i] = NULL;
+    }
+  }
+  if (atlas->bitmap != NULL) {
+    gbitmap_destroy(atlas->bitmap);
+    atlas->bitmap = NULL;
+  }
+}
+
+ScoreLayer *score_layer_create(GRect frame, const DigitAtlas *atlas) {
+  ScoreLayer *score_layer = layer_create_with_data(frame, sizeof(ScoreLayerData));
+  if (score_layer == NULL) {
+    SC_LOG(APP_LOG_LEVEL_ERROR, "OOM Couldn't create score layer.");
+    return NULL;
+  }
+
+  ScoreLayerData *data = (ScoreLayerData *)layer_get_data(score_layer);
+  data->atlas = atlas;
+  data->bg_color = GColorWhite;
+  data->text[0] = '\0';
+
+  layer_set_update_proc(score_layer, score_layer_update_proc);
+
+  return score_layer;
+}
+
+void score_layer_destroy(ScoreLayer *score_layer) {
+  layer_destroy(score_layer);
+}
+
+/**
+ * The text is copied, so the layer is marked dirty only when it really changes.
+ */
+void score_layer_set_text(ScoreLayer *score_layer, const char *text) {
+  ScoreLayerData *data = (ScoreLayerData *)layer_get_data(score_layer);
+
+  if (strncmp(data->text, text, SCORE_LAYER_TEXT_BUFF_SIZE) != 0) {
+    strncpy(data->text, text, SCORE_LAYER_TEXT_BUFF_SIZE - 1);
+    data->text[SCORE_LAYER_TEXT_BUFF_SIZE - 1] = '\0';
+    layer_mark_dirty(score_layer);
+  }
+}
+
+/**
+ * Scaling the score is just a switch to another atlas, there is no font 
+ * lookup and no text relayout.
+ */
+void score_layer_set_atlas(ScoreLayer *score_layer, const DigitAtlas *atlas) {
+  ScoreLayerData *data = (ScoreLayerData *)layer_get_data(score_layer);
+
+  if (data->atlas != atlas) {
+    data->atlas = atlas;
+    layer_mark_dirty(score_layer);
+  }
+}
+
+void score_layer_set_background_color(ScoreLayer *score_layer, GColor color) {
+  ScoreLayerData *data = (ScoreLayerData *)layer_get_data(score_layer);
+
+  if (data->bg_color.argb != color.argb) {
+    data->bg_color = color;
+    layer_mark_dirty(score_layer);
+  }
+}
+
+static void score_layer_update_proc(Layer *layer, GContext *ctx) {
+  ScoreLayerData *data = (ScoreLayerData *)layer_get_data(layer);
+  const DigitAtlas *atlas = data->atlas;
+  const GRect bounds = layer_get_bounds(layer);
+
+  graphics_context_set_fill_color(ctx, data->bg_color);
+  graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+
+  if (atlas == NULL || atlas->bitmap == NULL) {
+    return;
+  }
+
+  // All cells have a constant width, so the layout is just a sum of widths.
+  int16_t width = 0;
+  for (const char *c = data->text; *c != '\0'; c++) {
+    width += *c == ':' ? atlas->colon_width : atlas->digit_width;
+  }
+
+  GRect cell = GRect((bounds.size.w - width) / 2, (bounds.size.h - atlas->height) / 2, 
+    0, atlas->height);
+
+  graphics_context_set_compositing_mode(ctx, PBL_IF_COLOR_ELSE(GCompOpSet, GCompOpAssign));
+
+  for (const char *c = data->text; *c != '\0'; c++) {
+    uint8_t glyph;
+
+    if (*c == ':') {
+      glyph = DIGIT_ATLAS_COLON_GLYPH;
+      cell.size.w = atlas->colon_width;
+    } else if (*c >= '0' && *c <= '9') {
+      glyph = *c - '0';
+      cell.size.w = atlas->digit_width;
+    } else {
+      continue;
+    }
+
+    graphics_draw_bitmap_in_rect(ctx, atlas->glyphs[glyph], cell);
+    cell.origin.x += cell.size.w;
+  }
+}
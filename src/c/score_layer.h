@@ -0,0 +1,41 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+#define DIGIT_ATLAS_GLYPH_COUNT 11
+#define DIGIT_ATLAS_COLON_GLYPH 10
+#define SCORE_LAYER_TEXT_BUFF_SIZE 8
+
+/**
+ * Pre-rendered digit glyphs loaded from one bitmap resource: a row of
+ * fixed-width cells with the digits 0-9 followed by a colon cell.
+ * The glyphs are sub-bitmaps sharing the atlas bitmap data, so they are
+ * created only once, when the atlas is loaded.
+ */
+typedef struct {
+  GBitmap *bitmap;
+  GBitmap *glyphs[DIGIT_ATLAS_GLYPH_COUNT];
+  uint8_t digit_width;
+  uint8_t colon_width;
+  uint8_t height;
+} DigitAtlas;
+
+/**
+ * Layer rendering a score text ("12", "7:15") by blitting glyphs from
+ * a DigitAtlas into fixed cells, centered in the layer.
+ */
+typedef struct Layer ScoreLayer;
+
+bool digit_atlas_load(DigitAtlas *atlas, uint32_t resource_id, 
+  uint8_t digit_width, uint8_t colon_width, uint8_t height);
+void digit_atlas_unload(DigitAtlas *atlas);
+
+ScoreLayer *score_layer_create(GRect frame, const DigitAtlas *atlas);
+void score_layer_destroy(ScoreLayer *score_layer);
+void score_layer_set_text(ScoreLayer *score_layer, const char *text);
+void score_layer_set_atlas(ScoreLayer *score_layer, const DigitAtlas *atlas);
+void score_layer_set_background_color(ScoreLayer *score_layer, GColor color);
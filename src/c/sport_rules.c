@@ -0,0 +1,266 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "sport_rules.h"
+
+
+static bool is_unit_won(const SportStage *stage, uint16_t own, uint16_t other) {
+  return stage->to_win > 0 && ((own >= stage->to_win && own >= other + stage->win_by) 
+    || (stage->cap > 0 && own >= stage->cap));
+}
+
+/**
+ * The stage of the level below the given one, as the units won at the level
+ * decide.
+ */
+static uint8_t child_stage(const SportProgress *progress, uint8_t level) {
+  const SportStage *stage = &sport_stages[progress->stage[level]];
+  const uint8_t *units = progress->units[level - 1];
+
+  if (stage->tie_at > 0 && units[0] == stage->tie_at && units[1] == stage->tie_at) {
+    return stage->tie_child;
+  }
+
+  return stage->child;
+}
+
+/**
+ * The stages below the top one follow from the units won.
+ */
+static void select_stages(SportProgress *progress, const SportDescription *sport) {
+  memset(progress->stage, SPORT_NO_STAGE, sizeof(progress->stage));
+  progress->stage[sport->levels - 1] = sport->top_stage;
+
+  for (uint8_t level = sport->levels - 1; level > 0; level--) {
+    progress->stage[level - 1] = child_stage(progress, level);
+  }
+}
+
+void sport_init(SportState *state, SportId sport, uint16_t modulus) {
+  memset(state, 0, sizeof(SportState));
+  state->sport = sport;
+  state->modulus = modulus;
+  state->undo_team = SPORT_NO_TEAM;
+  select_stages(&state->progress, &sport_descriptions[sport]);
+}
+
+/**
+ * A new match of the same sport. Return false when there was nothing to
+ * reset.
+ */
+bool sport_reset(SportState *state) {
+  SportState fresh;
+  sport_init(&fresh, state->sport, state->modulus);
+
+  if (memcmp(&fresh.progress, &state->progress, sizeof(SportProgress)) == 0 
+    && state->undo_team == SPORT_NO_TEAM) {
+    return false;
+  }
+
+  *state = fresh;
+
+  return true;
+}
+
+/**
+ * One table step: the point, then up the levels as long as the won unit
+ * wins the one above. The units below the level that goes on start over.
+ */
+SportStep sport_point(SportState *state, uint16_t points[SPORT_TEAMS], uint8_t team) {
+  SportProgress *progress = &state->progress;
+  const SportDescription *sport = &sport_descriptions[state->sport];
+  uint8_t other = 1 - team;
+
+  if (progress->is_over) {
+    return SPORT_STEP_IGNORED;
+  }
+
+  uint16_t before[SPORT_TEAMS] = { points[0], points[1] };
+  points[team] = (points[team] + 1) % state->modulus;
+
+  if (!is_unit_won(&sport_stages[progress->stage[0]], points[team], points[other])) {
+    return SPORT_STEP_POINT;
+  }
+
+  state->undo = *progress;
+  memcpy(state->undo_points, before, sizeof(before));
+  memcpy(state->won_points, points, sizeof(state->won_points));
+  state->undo_team = team;
+
+  uint8_t level = 1;
+  while (level < sport->levels) {
+    uint8_t *units = progress->units[level - 1];
+    units[team]++;
+    if (!is_unit_won(&sport_stages[progress->stage[level]], units[team], units[other])) {
+      break;
+    }
+    level++;
+  }
+
+  if (level == sport->levels) {
+    // The final score stays on.
+    progress->is_over = true;
+    return SPORT_STEP_MATCH_WON;
+  }
+
+  for (; level > 0; level--) {
+    progress->stage[level - 1] = child_stage(progress, level);
+    if (level > 1) {
+      memset(progress->units[level - 2], 0, SPORT_TEAMS);
+    }
+  }
+  points[0] = 0;
+  points[1] = 0;
+
+  return SPORT_STEP_UNIT_WON;
+}
+
+/**
+ * Take a point back. Only the plain counter wraps under 0, a unit won is
+ * only taken back right after, with the points it left.
+ */
+SportStep sport_take_back(SportState *state, uint16_t points[SPORT_TEAMS], uint8_t team) {
+  SportProgress *progress = &state->progress;
+  uint16_t left[SPORT_TEAMS] = { 0, 0 };
+
+  if (progress->is_over) {
+    memcpy(left, state->won_points, sizeof(left));
+  }
+
+  if (state->undo_team == team && points[0] == left[0] && points[1] == left[1]) {
+    *progress = state->undo;
+    memcpy(points, state->undo_points, sizeof(state->undo_points));
+    state->undo_team = SPORT_NO_TEAM;
+    return SPORT_STEP_UNIT_UNDONE;
+  }
+
+  if (progress->is_over) {
+    return SPORT_STEP_IGNORED;
+  }
+
+  if (points[team] > 0) {
+    points[team]--;
+  } else if (sport_stages[progress->stage[0]].to_win == 0) {
+    points[team] = state->modulus - 1;
+  } else {
+    return SPORT_STEP_IGNORED;
+  }
+
+  return SPORT_STEP_POINT;
+}
+
+/**
+ * The units follow the points when the score is swapped.
+ */
+void sport_swap(SportState *state) {
+  for (uint8_t level = 0; level < SPORT_LEVELS - 1; level++) {
+    uint8_t *units = state->progress.units[level];
+    uint8_t *undo_units = state->undo.units[level];
+    uint8_t swapped = units[0];
+    units[0] = units[1];
+    units[1] = swapped;
+    swapped = undo_units[0];
+    undo_units[0] = undo_units[1];
+    undo_units[1] = swapped;
+  }
+
+  uint16_t swapped_points = state->undo_points[0];
+  state->undo_points[0] = state->undo_points[1];
+  state->undo_points[1] = swapped_points;
+  swapped_points = state->won_points[0];
+  state->won_points[0] = state->won_points[1];
+  state->won_points[1] = swapped_points;
+
+  if (state->undo_team != SPORT_NO_TEAM) {
+    state->undo_team = 1 - state->undo_team;
+  }
+}
+
+bool sport_has_units(const SportState *state) {
+  return sport_descriptions[state->sport].levels > 1;
+}
+
+/**
+ * The units won at each level above the points, the top one first, each
+ * followed by a space, e.g. "1:0 4:3 " for sets and games. Nothing for the
+ * plain counter. Return the length written.
+ */
+size_t sport_format_units(const SportState *state, char *buff, size_t size) {
+  size_t length = 0;
+
+  buff[0] = '\0';
+  for (uint8_t level = sport_descriptions[state->sport].levels - 1; level > 0; level--) {
+    const uint8_t *units = state->progress.units[level - 1];
+    int written = snprintf(buff + length, size - length, "%d:%d ", units[0], units[1]);
+    if (written < 0 || (size_t)written >= size - length) {
+      return strlen(buff);
+    }
+    length += written;
+  }
+
+  return length;
+}
+
+const char *sport_name(SportId sport) {
+  return sport_descriptions[sport].name;
+}
+
+void sport_write_wire(const SportState *state, bool swap_teams, uint8_t *buff) {
+  buff[0] = state->sport;
+  buff[1] = state->progress.is_over ? 1 : 0;
+
+  for (uint8_t level = 0; level < SPORT_LEVELS - 1; level++) {
+    const uint8_t *units = state->progress.units[level];
+    buff[2 + level * SPORT_TEAMS] = units[swap_teams ? 1 : 0];
+    buff[3 + level * SPORT_TEAMS] = units[swap_teams ? 0 : 1];
+  }
+}
+
+bool sport_check_wire(const uint8_t *buff, uint16_t size) {
+  return size == SPORT_WIRE_SIZE && buff[0] < SPORT_COUNT && buff[1] <= 1;
+}
+
+/**
+ * Take over the match from another watch. What it takes back is up to it.
+ */
+void sport_read_wire(SportState *state, const uint8_t *buff, bool swap_teams) {
+  sport_init(state, buff[0], state->modulus);
+  state->progress.is_over = buff[1] != 0;
+
+  for (uint8_t level = 0; level < SPORT_LEVELS - 1; level++) {
+    uint8_t *units = state->progress.units[level];
+    units[swap_teams ? 1 : 0] = buff[2 + level * SPORT_TEAMS];
+    units[swap_teams ? 0 : 1] = buff[3 + level * SPORT_TEAMS];
+  }
+
+  select_stages(&state->progress, &sport_descriptions[state->sport]);
+}
+
+/**
+ * Merge the match of another watch in the same score CRDT generation, where
+ * both count the same units: each of them the larger of the two, so two
+ * watches recording the same unit won end up with it once.
+ */
+void sport_merge_wire(SportState *state, const uint8_t *buff, bool swap_teams) {
+  if (buff[0] != state->sport) {
+    sport_read_wire(state, buff, swap_teams);
+    return;
+  }
+
+  state->progress.is_over |= buff[1] != 0;
+
+  for (uint8_t level = 0; level < SPORT_LEVELS - 1; level++) {
+    uint8_t *units = state->progress.units[level];
+    uint8_t theirs[SPORT_TEAMS] = { buff[2 + level * SPORT_TEAMS], buff[3 + level * SPORT_TEAMS] };
+    for (uint8_t team = 0; team < SPORT_TEAMS; team++) {
+      uint8_t their_units = theirs[swap_teams ? 1 - team : team];
+      if (their_units > units[team]) {
+        units[team] = their_units;
+      }
+    }
+  }
+
+  select_stages(&state->progress, &sport_descriptions[state->sport]);
+}
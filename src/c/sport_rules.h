@@ -0,0 +1,98 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+#include "protocol.h"
+#include "sport_tables.h"
+
+#define SPORT_TEAMS 2
+/**
+ * The points and at most two levels above them, e.g. games and sets.
+ */
+#define SPORT_LEVELS 3
+#define SPORT_NO_STAGE 0xFF
+#define SPORT_NO_TEAM 0xFF
+
+/**
+ * Rules of one level of a sport, see tools/gen_sport_rules.py. A unit of
+ * the level is won with to_win points (or units of the level below),
+ * win_by clear of the other team, or outright at cap. The units of the
+ * level below are played with child, or with tie_child once both teams
+ * have won tie_at units of this level.
+ */
+typedef struct {
+  /**
+   * 0 for a level never won, the plain counter.
+   */
+  uint8_t to_win;
+  uint8_t win_by;
+  uint8_t cap;
+  uint8_t child;
+  uint8_t tie_at;
+  uint8_t tie_child;
+} SportStage;
+
+typedef struct {
+  const char *name;
+  uint8_t top_stage;
+  uint8_t levels;
+} SportDescription;
+
+extern const SportStage sport_stages[SPORT_STAGE_COUNT];
+extern const SportDescription sport_descriptions[SPORT_COUNT];
+
+/**
+ * Where the match stands above the points.
+ */
+typedef struct {
+  /**
+   * Stage in play at each level, the points first, SPORT_NO_STAGE above
+   * the top level of the sport.
+   */
+  uint8_t stage[SPORT_LEVELS];
+  /**
+   * Units won by each team at each level above the points.
+   */
+  uint8_t units[SPORT_LEVELS - 1][SPORT_TEAMS];
+  bool is_over;
+} SportProgress;
+
+/**
+ * A match of a sport, stepped point by point through the stage table. The
+ * points themselves are the caller's score, which the steps update, wrapped
+ * over at the modulus like the plain counter. The last point that won a
+ * unit can be taken back, as long as the points are where it left them.
+ */
+typedef struct {
+  uint8_t sport;
+  uint16_t modulus;
+  SportProgress progress;
+  SportProgress undo;
+  uint16_t undo_points[SPORT_TEAMS];
+  uint16_t won_points[SPORT_TEAMS];
+  uint8_t undo_team;
+} SportState;
+
+typedef enum {
+  SPORT_STEP_IGNORED,
+  SPORT_STEP_POINT,
+  SPORT_STEP_UNIT_WON,
+  SPORT_STEP_MATCH_WON,
+  SPORT_STEP_UNIT_UNDONE
+} SportStep;
+
+void sport_init(SportState *state, SportId sport, uint16_t modulus);
+bool sport_reset(SportState *state);
+SportStep sport_point(SportState *state, uint16_t points[SPORT_TEAMS], uint8_t team);
+SportStep sport_take_back(SportState *state, uint16_t points[SPORT_TEAMS], uint8_t team);
+void sport_swap(SportState *state);
+bool sport_has_units(const SportState *state);
+size_t sport_format_units(const SportState *state, char *buff, size_t size);
+const char *sport_name(SportId sport);
+void sport_write_wire(const SportState *state, bool swap_teams, uint8_t *buff);
+bool sport_check_wire(const uint8_t *buff, uint16_t size);
+void sport_read_wire(SportState *state, const uint8_t *buff, bool swap_teams);
+void sport_merge_wire(SportState *state, const uint8_t *buff, bool swap_teams);
@@ -0,0 +1,31 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Generated by tools/gen_sport_rules.py, do not edit.
+ */
+
+#include <pebble.h>
+#include "sport_rules.h"
+
+
+const SportStage sport_stages[SPORT_STAGE_COUNT] = {
+  /*  0 */ { 0, 1, 0, SPORT_NO_STAGE, 0, SPORT_NO_STAGE },
+  /*  1 */ { 25, 2, 0, SPORT_NO_STAGE, 0, SPORT_NO_STAGE },
+  /*  2 */ { 15, 2, 0, SPORT_NO_STAGE, 0, SPORT_NO_STAGE },
+  /*  3 */ { 3, 1, 0, 1, 2, 2 },
+  /*  4 */ { 4, 2, 0, SPORT_NO_STAGE, 0, SPORT_NO_STAGE },
+  /*  5 */ { 7, 2, 0, SPORT_NO_STAGE, 0, SPORT_NO_STAGE },
+  /*  6 */ { 6, 2, 7, 4, 6, 5 },
+  /*  7 */ { 2, 1, 0, 6, 0, SPORT_NO_STAGE },
+  /*  8 */ { 21, 2, 30, SPORT_NO_STAGE, 0, SPORT_NO_STAGE },
+  /*  9 */ { 2, 1, 0, 8, 0, SPORT_NO_STAGE },
+};
+
+const SportDescription sport_descriptions[SPORT_COUNT] = {
+  [SPORT_COUNTER] = { "Counter", 0, 1 },
+  [SPORT_VOLLEYBALL] = { "Volleyball", 3, 2 },
+  [SPORT_TENNIS] = { "Tennis", 7, 3 },
+  [SPORT_BADMINTON] = { "Badminton", 9, 2 },
+};
@@ -0,0 +1,19 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Generated by tools/gen_sport_rules.py, do not edit.
+ */
+
+#pragma once
+
+typedef enum {
+  SPORT_COUNTER,
+  SPORT_VOLLEYBALL,
+  SPORT_TENNIS,
+  SPORT_BADMINTON,
+  SPORT_COUNT
+} SportId;
+
+#define SPORT_STAGE_COUNT 10
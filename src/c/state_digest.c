@@ -0,0 +1,81 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "state_digest.h"
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+
+static uint32_t hash_bytes(uint32_t hash, const uint8_t *buff, uint16_t size) {
+  for (uint16_t i = 0; i < size; i++) {
+    hash ^= buff[i];
+    hash *= FNV_PRIME;
+  }
+
+  return hash;
+}
+
+/**
+ * Insertion sort, there are a few entries at most.
+ */
+static void sort_entries(PnCounter *crdt) {
+  for (uint8_t i = 1; i < crdt->count; i++) {
+    PnCounterEntry entry = crdt->entries[i];
+    uint8_t j = i;
+
+    for (; j > 0 && crdt->entries[j - 1].device_id > entry.device_id; j--) {
+      crdt->entries[j] = crdt->entries[j - 1];
+    }
+    crdt->entries[j] = entry;
+  }
+}
+
+/**
+ * The crdt is NULL when the link does not share SCORE_CRDT, the sport (of
+ * SPORT_WIRE_SIZE bytes, as sent) when it does not share SPORT.
+ */
+void state_digest_compute(StateDigest *digest, uint16_t score_1, uint16_t score_2, 
+  const PnCounter *crdt, const uint8_t *sport) {
+
+  uint8_t scores[4] = {
+    (uint8_t)score_1, (uint8_t)(score_1 >> 8), (uint8_t)score_2, (uint8_t)(score_2 >> 8)
+  };
+  uint32_t hash = hash_bytes(FNV_OFFSET_BASIS, scores, sizeof(scores));
+
+  if (crdt != NULL) {
+    PnCounter sorted = *crdt;
+    sort_entries(&sorted);
+
+    uint8_t wire[PN_COUNTER_WIRE_MAX_SIZE];
+    hash = hash_bytes(hash, wire, pn_counter_write_wire(&sorted, wire, sizeof(wire)));
+  }
+  if (sport != NULL) {
+    hash = hash_bytes(hash, sport, SPORT_WIRE_SIZE);
+  }
+
+  digest->version = crdt != NULL ? crdt->generation : 0;
+  digest->hash = hash;
+}
+
+bool state_digest_equals(const StateDigest *digest, const StateDigest *other) {
+  return digest->version == other->version && digest->hash == other->hash;
+}
+
+void state_digest_write(const StateDigest *digest, uint8_t *buff) {
+  buff[0] = (uint8_t)digest->version;
+  buff[1] = (uint8_t)(digest->version >> 8);
+  for (uint8_t i = 0; i < 4; i++) {
+    buff[2 + i] = (uint8_t)(digest->hash >> (8 * i));
+  }
+}
+
+void state_digest_read(const uint8_t *buff, StateDigest *digest) {
+  digest->version = (uint16_t)(buff[0] | buff[1] << 8);
+  digest->hash = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    digest->hash |= (uint32_t)buff[2 + i] << (8 * i);
+  }
+}
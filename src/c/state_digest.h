@@ -0,0 +1,34 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+#include "pn_counter.h"
+#include "protocol.h"
+
+/**
+ * DIGEST layout: version (2 bytes), hash (4 bytes), little endian.
+ */
+#define STATE_DIGEST_SIZE 6
+
+/**
+ * Short summary of the score state both sides of the link hold, so a
+ * reconnect can tell whether there is anything to transfer at all.
+ * The version is the match (the score CRDT generation, 0 without the CRDT),
+ * the hash is a 32-bit FNV-1a of the score in the transferred orientation,
+ * followed by the encoded CRDT and the encoded SPORT state when the link
+ * shares them. The CRDT entries are hashed by device id, as the order they
+ * were added in differs between the replicas of the same state.
+ */
+typedef struct {
+  uint16_t version;
+  uint32_t hash;
+} StateDigest;
+
+void state_digest_compute(StateDigest *digest, uint16_t score_1, uint16_t score_2, 
+  const PnCounter *crdt, const uint8_t *sport);
+bool state_digest_equals(const StateDigest *digest, const StateDigest *other);
+void state_digest_write(const StateDigest *digest, uint8_t *buff);
+void state_digest_read(const uint8_t *buff, StateDigest *digest);
@@ -0,0 +1,118 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "state_log.h"
+
+
+/**
+ * Sequence numbers compare in serial number arithmetic, so they can wrap.
+ */
+static bool is_newer_seq(uint16_t seq, uint16_t than) {
+  return (int16_t)(seq - than) > 0;
+}
+
+static uint16_t fletcher16(const uint8_t *buff, uint16_t size) {
+  uint16_t sum_1 = 0;
+  uint16_t sum_2 = 0;
+
+  for (uint16_t i = 0; i < size; i++) {
+    sum_1 = (sum_1 + buff[i]) % 255;
+    sum_2 = (sum_2 + sum_1) % 255;
+  }
+
+  return (uint16_t)(sum_2 << 8 | sum_1);
+}
+
+static uint8_t slot_size(const StateLog *log) {
+  return log->record_size + STATE_LOG_SLOT_OVERHEAD;
+}
+
+/**
+ * Read a slot, false when it is empty, of another size or fails its checksum.
+ */
+static bool read_slot(const StateLog *log, uint8_t slot, uint8_t *buff, uint16_t *seq) {
+  uint8_t size = slot_size(log);
+
+  if (persist_read_data(log->first_key + slot, buff, size) != size) {
+    return false;
+  }
+
+  uint16_t checksum = fletcher16(buff, size - 2);
+  if ((buff[size - 2] | buff[size - 1] << 8) != checksum) {
+    return false;
+  }
+
+  *seq = (uint16_t)(buff[0] | buff[1] << 8);
+
+  return true;
+}
+
+/**
+ * Record size at most STATE_LOG_MAX_RECORD_SIZE.
+ */
+void state_log_init(StateLog *log, uint32_t first_key, uint8_t record_size) {
+  log->first_key = first_key;
+  log->record_size = record_size;
+  log->next_slot = 0;
+  log->next_seq = 0;
+}
+
+/**
+ * Find the newest valid record, the next one goes to the slot after it.
+ * Return false when there is none, the record is then left as it is.
+ */
+bool state_log_load(StateLog *log, void *record) {
+  uint8_t buff[STATE_LOG_MAX_RECORD_SIZE + STATE_LOG_SLOT_OVERHEAD];
+  uint8_t newest[STATE_LOG_MAX_RECORD_SIZE + STATE_LOG_SLOT_OVERHEAD];
+  bool is_found = false;
+  uint16_t newest_seq = 0;
+
+  for (uint8_t slot = 0; slot < STATE_LOG_SLOTS; slot++) {
+    uint16_t seq;
+
+    if (!read_slot(log, slot, buff, &seq) || (is_found && !is_newer_seq(seq, newest_seq))) {
+      continue;
+    }
+    memcpy(newest, buff, slot_size(log));
+    newest_seq = seq;
+    log->next_slot = (slot + 1) % STATE_LOG_SLOTS;
+    is_found = true;
+  }
+
+  if (!is_found) {
+    return false;
+  }
+
+  memcpy(record, newest + 2, log->record_size);
+  log->next_seq = newest_seq + 1;
+
+  return true;
+}
+
+/**
+ * Write the record to the next slot. Return false when the storage refused
+ * it, the slot is then tried again with the next record.
+ */
+bool state_log_append(StateLog *log, const void *record) {
+  uint8_t buff[STATE_LOG_MAX_RECORD_SIZE + STATE_LOG_SLOT_OVERHEAD];
+  uint8_t size = slot_size(log);
+
+  buff[0] = (uint8_t)log->next_seq;
+  buff[1] = (uint8_t)(log->next_seq >> 8);
+  memcpy(buff + 2, record, log->record_size);
+
+  uint16_t checksum = fletcher16(buff, size - 2);
+  buff[size - 2] = (uint8_t)checksum;
+  buff[size - 1] = (uint8_t)(checksum >> 8);
+
+  if (persist_write_data(log->first_key + log->next_slot, buff, size) != size) {
+    return false;
+  }
+
+  log->next_slot = (log->next_slot + 1) % STATE_LOG_SLOTS;
+  log->next_seq++;
+
+  return true;
+}
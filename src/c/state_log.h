@@ -0,0 +1,38 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+/**
+ * Storage keys a log takes, from its first key on.
+ */
+#define STATE_LOG_SLOTS 4
+#define STATE_LOG_MAX_RECORD_SIZE 32
+
+/**
+ * Slot layout: sequence number (2 bytes), the record, Fletcher-16 checksum
+ * of both (2 bytes), little endian.
+ */
+#define STATE_LOG_SLOT_OVERHEAD 4
+
+/**
+ * A fixed-size record appended round-robin over STATE_LOG_SLOTS storage
+ * keys instead of being rewritten under one, so the writes are spread over
+ * the slots and the storage taken stays the same. Every slot holds one
+ * version of the record with its sequence number; the newest valid one is
+ * found by reading the slots once. A write cut short leaves a slot failing
+ * its checksum, the record before it is read instead.
+ */
+typedef struct {
+  uint32_t first_key;
+  uint8_t record_size;
+  uint8_t next_slot;
+  uint16_t next_seq;
+} StateLog;
+
+void state_log_init(StateLog *log, uint32_t first_key, uint8_t record_size);
+bool state_log_load(StateLog *log, void *record);
+bool state_log_append(StateLog *log, const void *record);
@@ -0,0 +1,203 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <pebble.h>
+#include "trace_recorder.h"
+#include "build_config.h"
+
+#if SC_TRACE
+
+static uint8_t ring[TRACE_RING_SIZE];
+/**
+ * Offset of the oldest record and the bytes taken by the records.
+ */
+static uint16_t head;
+static uint16_t used;
+/**
+ * Records overwritten by newer ones.
+ */
+static uint16_t overwritten;
+static int64_t start_ms;
+
+static TraceCheckpointHandler checkpoint_handler;
+static uint16_t since_checkpoint;
+static bool is_checkpoint_due;
+
+/**
+ * Offset in the export stream of the next item to log, while exporting.
+ */
+static uint16_t export_offset;
+static bool is_exporting;
+
+
+static int64_t now_ms() {
+  time_t now;
+  uint16_t now_ms;
+
+  time_ms(&now, &now_ms);
+
+  return (int64_t)now * 1000 + now_ms;
+}
+
+static void ring_write(uint16_t offset, const uint8_t *data, uint16_t size) {
+  for (uint16_t i = 0; i < size; i++) {
+    ring[(offset + i) % TRACE_RING_SIZE] = data[i];
+  }
+}
+
+static uint16_t record_size_at(uint16_t offset) {
+  return TRACE_RECORD_HEADER_SIZE + (ring[(offset + 6) % TRACE_RING_SIZE] 
+    | ring[(offset + 7) % TRACE_RING_SIZE] << 8);
+}
+
+static void drop_oldest() {
+  uint16_t size = record_size_at(head);
+
+  head = (head + size) % TRACE_RING_SIZE;
+  used -= size;
+  if (overwritten < UINT16_MAX) {
+    overwritten++;
+  }
+}
+
+void trace_recorder_init(TraceCheckpointHandler handler) {
+  head = 0;
+  used = 0;
+  overwritten = 0;
+  start_ms = now_ms();
+  checkpoint_handler = handler;
+  since_checkpoint = 0;
+  is_checkpoint_due = true;
+  is_exporting = false;
+}
+
+/**
+ * Append a record, overwriting the oldest ones it needs the room of. Nothing
+ * is recorded while the trace is being exported.
+ */
+void trace_recorder_add(TraceType type, uint8_t arg, const void *data, uint16_t size) {
+  if (is_exporting) {
+    return;
+  }
+  if (size > TRACE_MAX_PAYLOAD) {
+    size = TRACE_MAX_PAYLOAD;
+  }
+
+  uint16_t record_size = TRACE_RECORD_HEADER_SIZE + size;
+  while (used + record_size > TRACE_RING_SIZE) {
+    drop_oldest();
+  }
+
+  uint32_t ms = (uint32_t)(now_ms() - start_ms);
+  uint8_t header[TRACE_RECORD_HEADER_SIZE] = {
+    (uint8_t)ms, (uint8_t)(ms >> 8), (uint8_t)(ms >> 16), (uint8_t)(ms >> 24),
+    (uint8_t)type, arg, (uint8_t)size, (uint8_t)(size >> 8)
+  };
+  uint16_t offset = (head + used) % TRACE_RING_SIZE;
+
+  ring_write(offset, header, sizeof(header));
+  ring_write(offset + TRACE_RECORD_HEADER_SIZE, data, size);
+  used += record_size;
+
+  if (type == TRACE_CHECKPOINT) {
+    since_checkpoint = 0;
+    is_checkpoint_due = false;
+  } else {
+    since_checkpoint += record_size;
+    if (since_checkpoint >= TRACE_CHECKPOINT_INTERVAL) {
+      is_checkpoint_due = true;
+    }
+  }
+}
+
+/**
+ * An input the app is about to handle, after the checkpoint when due.
+ */
+void trace_recorder_add_input(TraceType type, uint8_t arg, const void *data, uint16_t size) {
+  if (is_checkpoint_due && checkpoint_handler != NULL && !is_exporting) {
+    checkpoint_handler();
+  }
+
+  trace_recorder_add(type, arg, data, size);
+}
+
+/**
+ * Append a storage entry to a checkpoint payload. Return the offset after it.
+ */
+uint16_t trace_recorder_put_entry(uint8_t *buff, uint16_t offset, uint8_t key, 
+  const void *data, uint8_t size) {
+
+  buff[offset] = key;
+  buff[offset + 1] = size;
+  memcpy(buff + offset + 2, data, size);
+
+  return offset + 2 + size;
+}
+
+static void write_export_header(uint8_t *buff) {
+  memcpy(buff, TRACE_MAGIC, 4);
+  buff[4] = TRACE_FORMAT_VERSION;
+  buff[5] = 0;
+  buff[6] = (uint8_t)overwritten;
+  buff[7] = (uint8_t)(overwritten >> 8);
+  for (uint8_t i = 0; i < 8; i++) {
+    buff[8 + i] = (uint8_t)(start_ms >> (8 * i));
+  }
+}
+
+/**
+ * One data logging item of the export stream: the header, the records from
+ * the oldest one, then zeros.
+ */
+static void read_export_item(uint16_t offset, uint8_t *item) {
+  uint8_t header[TRACE_EXPORT_HEADER_SIZE];
+
+  write_export_header(header);
+  for (uint16_t i = 0; i < TRACE_EXPORT_ITEM_SIZE; i++) {
+    uint16_t stream_offset = offset + i;
+
+    if (stream_offset < TRACE_EXPORT_HEADER_SIZE) {
+      item[i] = header[stream_offset];
+    } else if (stream_offset - TRACE_EXPORT_HEADER_SIZE < used) {
+      item[i] = ring[(head + stream_offset - TRACE_EXPORT_HEADER_SIZE) % TRACE_RING_SIZE];
+    } else {
+      item[i] = 0;
+    }
+  }
+}
+
+/**
+ * Log the trace in the session, item by item. Return false when the session
+ * is busy: call again later, the export goes on from where it stopped and
+ * the recording stays paused until then.
+ */
+bool trace_recorder_export(DataLoggingSessionRef session) {
+  uint16_t stream_size = TRACE_EXPORT_HEADER_SIZE + used;
+
+  if (!is_exporting) {
+    is_exporting = true;
+    export_offset = 0;
+  }
+
+  while (session != NULL && export_offset < stream_size) {
+    uint8_t item[TRACE_EXPORT_ITEM_SIZE];
+    read_export_item(export_offset, item);
+
+    DataLoggingResult result = data_logging_log(session, item, 1);
+    if (result == DATA_LOGGING_BUSY) {
+      return false;
+    }
+    if (result != DATA_LOGGING_SUCCESS) {
+      // Full or closed, the rest won't get through.
+      break;
+    }
+    export_offset += TRACE_EXPORT_ITEM_SIZE;
+  }
+
+  is_exporting = false;
+
+  return true;
+}
+
+#endif
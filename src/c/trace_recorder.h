@@ -0,0 +1,124 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include <pebble.h>
+
+/**
+ * Bytes of records kept, the oldest records are overwritten first.
+ */
+#if defined(PBL_PLATFORM_APLITE)
+#define TRACE_RING_SIZE 1024
+#else
+#define TRACE_RING_SIZE 2048
+#endif
+
+/**
+ * Record layout: milliseconds since the start of the trace (4 bytes),
+ * TraceType (1 byte), argument (1 byte), payload size (2 bytes), then the
+ * payload. Longer payloads are cut to TRACE_MAX_PAYLOAD.
+ */
+#define TRACE_RECORD_HEADER_SIZE 8
+#define TRACE_MAX_PAYLOAD 320
+
+/**
+ * Export layout: "SCTR", TRACE_FORMAT_VERSION (1 byte), reserved (1 byte),
+ * records overwritten before the export (2 bytes), wall clock time in ms of
+ * the trace start (8 bytes), then the records oldest first. They end with
+ * the data or with a record of type TRACE_END, the zero padding of the last
+ * data logging item. All little endian.
+ */
+#define TRACE_EXPORT_HEADER_SIZE 16
+#define TRACE_EXPORT_ITEM_SIZE 64
+#define TRACE_FORMAT_VERSION 1
+#define TRACE_MAGIC "SCTR"
+
+/**
+ * A checkpoint is due after this many bytes of records since the last one,
+ * so the ring still holds one when it has wrapped.
+ */
+#define TRACE_CHECKPOINT_INTERVAL (TRACE_RING_SIZE / 4)
+
+#define TRACE_CLICK_ARG(button, kind) ((button) | (kind) << 4)
+#define TRACE_CLICK_BUTTON(arg) ((arg) & 0x0F)
+#define TRACE_CLICK_KIND(arg) ((arg) >> 4)
+
+typedef enum {
+  TRACE_END = 0,
+  /**
+   * What a replay starts from. Argument: TraceCheckpointFlags. Payload: the
+   * battery charge in percent (1 byte), then storage entries, each the key
+   * (1 byte), the size (1 byte) and the stored data.
+   */
+  TRACE_CHECKPOINT = 1,
+  /**
+   * Argument: TRACE_CLICK_ARG() of the ButtonId and the TraceClickKind.
+   */
+  TRACE_CLICK = 2,
+  /**
+   * Argument: the ButtonMode entered.
+   */
+  TRACE_MODE = 3,
+  /**
+   * Payload: the inbound dictionary as received.
+   */
+  TRACE_INBOX = 4,
+  /**
+   * Payload: the AppMessageResult (2 bytes).
+   */
+  TRACE_INBOX_DROPPED = 5,
+  /**
+   * Argument: the command sent.
+   */
+  TRACE_OUTBOX_SENT = 6,
+  /**
+   * Argument: the command not sent. Payload: the AppMessageResult (2 bytes).
+   */
+  TRACE_OUTBOX_FAILED = 7,
+  /**
+   * Argument: 1 when connected to the phone.
+   */
+  TRACE_CONNECTION = 8,
+  /**
+   * Argument: the charge in percent, the highest bit set while charging.
+   */
+  TRACE_BATTERY = 9,
+  TRACE_TYPE_COUNT
+} TraceType;
+
+typedef enum {
+  TRACE_CLICK_SINGLE = 0,
+  TRACE_CLICK_LONG = 1
+} TraceClickKind;
+
+typedef enum {
+  TRACE_CHECKPOINT_CONNECTED = 1 << 0,
+  TRACE_CHECKPOINT_CHARGING = 1 << 1
+} TraceCheckpointFlags;
+
+/**
+ * Adds the checkpoint, or leaves it for the next input when the app is in
+ * no state to be replayed from.
+ */
+typedef void (*TraceCheckpointHandler)(void);
+
+/**
+ * Trace of the inputs, compiled in with SC_TRACE (see build_config.h): the
+ * clicks, the inbound messages and the changes of the link and the battery,
+ * with the mode switches and the outbox results they led to. Records are
+ * written to a fixed ring in RAM, nothing is stored or sent until the trace
+ * is exported.
+ *
+ * Before an input, the checkpoint handler is asked for a checkpoint when
+ * one is due, so the oldest part of the ring left always starts the replay
+ * from the state the inputs were made in. The link negotiated with the
+ * phone is not part of it, a replay from a later checkpoint says HELLO anew.
+ */
+void trace_recorder_init(TraceCheckpointHandler checkpoint_handler);
+void trace_recorder_add(TraceType type, uint8_t arg, const void *data, uint16_t size);
+void trace_recorder_add_input(TraceType type, uint8_t arg, const void *data, uint16_t size);
+uint16_t trace_recorder_put_entry(uint8_t *buff, uint16_t offset, uint8_t key, 
+  const void *data, uint8_t size);
+bool trace_recorder_export(DataLoggingSessionRef session);
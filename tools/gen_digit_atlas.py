@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+Generates the pre-rendered digit glyph atlases used by the score layer.
+
+Each atlas is one row of fixed-size cells: the digits 0-9 followed by a narrower
+colon cell. The glyphs are drawn as seven-segment digits, black on a transparent
+background for color platforms (~color) and black on white for black and white
+platforms (~bw).
+
+The cell sizes must match the DIGITS_* defines in src/c/score_counter_app.h.
+
+Usage: python3 tools/gen_digit_atlas.py
+"""
+import os
+import struct
+import zlib
+
+OUT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'resources', 'images')
+
+# name: (digit width, colon width, height, segment thickness)
+ATLASES = {
+    'digits_large': (22, 10, 36, 4),
+    'digits_small': (17, 8, 30, 3),
+}
+
+#     a
+#   f   b
+#     g
+#   e   c
+#     d
+SEGMENTS = {
+    '0': 'abcdef', '1': 'bc', '2': 'abged', '3': 'abgcd', '4': 'fgbc',
+    '5': 'afgcd', '6': 'afgedc', '7': 'abc', '8': 'abcdefg', '9': 'abcdfg',
+}
+
+
+def fill(pixels, x0, y0, x1, y1):
+    for y in range(y0, y1):
+        for x in range(x0, x1):
+            pixels[y][x] = 1
+
+
+def draw_digit(pixels, x_off, w, h, t, digit):
+    # One pixel of spacing on each side of the cell, one pixel gap between segments.
+    left, right = x_off + 1, x_off + w - 1
+    top, bottom = 0, h
+    mid = h // 2
+    segments = {
+        'a': (left + 1, top, right - 1, top + t),
+        'd': (left + 1, bottom - t, right - 1, bottom),
+        'g': (left + 1, mid - t // 2, right - 1, mid - t // 2 + t),
+        'f': (left, top + 1, left + t, mid - 1),
+        'b': (right - t, top + 1, right, mid - 1),
+        'e': (left, mid + 1, left + t, bottom - 1),
+        'c': (right - t, mid + 1, right, bottom - 1),
+    }
+    for segment in SEGMENTS[digit]:
+        fill(pixels, *segments[segment])
+
+
+def draw_colon(pixels, x_off, w, h, t):
+    x0 = x_off + (w - t) // 2
+    fill(pixels, x0, h // 3 - t // 2, x0 + t, h // 3 - t // 2 + t)
+    fill(pixels, x0, h * 2 // 3 - t // 2, x0 + t, h * 2 // 3 - t // 2 + t)
+
+
+def png_chunk(tag, data):
+    chunk = tag + data
+    return struct.pack('>I', len(data)) + chunk + struct.pack('>I', zlib.crc32(chunk) & 0xffffffff)
+
+
+def write_png(path, pixels, color):
+    """
+    Writes a 1-bit PNG. Ink pixels are black, the rest is transparent (color)
+    or white (bw).
+    """
+    h, w = len(pixels), len(pixels[0])
+    raw = b''
+    for row in pixels:
+        raw += b'\x00'
+        for x in range(0, w, 8):
+            byte = 0
+            for bit in range(8):
+                ink = x + bit < w and row[x + bit]
+                # Palette index 1 is black ink (color), grayscale 0 is black (bw).
+                value = (1 if ink else 0) if color else (0 if ink else 1)
+                byte |= value << (7 - bit)
+            raw += bytes([byte])
+
+    png = b'\x89PNG\r\n\x1a\n'
+    if color:
+        png += png_chunk(b'IHDR', struct.pack('>IIBBBBB', w, h, 1, 3, 0, 0, 0))
+        png += png_chunk(b'PLTE', bytes([255, 255, 255, 0, 0, 0]))
+        png += png_chunk(b'tRNS', bytes([0, 255]))
+    else:
+        png += png_chunk(b'IHDR', struct.pack('>IIBBBBB', w, h, 1, 0, 0, 0, 0))
+    png += png_chunk(b'IDAT', zlib.compress(raw, 9))
+    png += png_chunk(b'IEND', b'')
+
+    with open(path, 'wb') as f:
+        f.write(png)
+
+
+def main():
+    os.makedirs(OUT_DIR, exist_ok=True)
+    for name, (w, colon_w, h, t) in ATLASES.items():
+        atlas_w = 10 * w + colon_w
+        pixels = [[0] * atlas_w for _ in range(h)]
+        for i, digit in enumerate('0123456789'):
+            draw_digit(pixels, i * w, w, h, t, digit)
+        draw_colon(pixels, 10 * w, colon_w, h, t)
+
+        write_png(os.path.join(OUT_DIR, '{}~color.png'.format(name)), pixels, True)
+        write_png(os.path.join(OUT_DIR, '{}~bw.png'.format(name)), pixels, False)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Generates the sport rule tables used by the rules engine (src/c/sport_rules.c).
+
+Each sport is described as a list of levels from the points up: the points
+win a game or set, those win the level above and so on, the top level wins
+the match. A level is won with 'to_win' units of the level below, 'win_by'
+of them clear of the other side, or outright at 'cap'. A 'tie' plays the
+level below with its own rules once both sides have won 'at' units of the
+level, like the tie-break at 6:6 games in tennis or the shorter deciding
+set in volleyball.
+
+Every level becomes a stage in one table shared by all sports, a tie another
+stage. A stage refers to the stages of the level below, so the engine steps
+through the table without knowing the sport.
+
+The tables are checked in. With --check, nothing is written, it fails
+when the checked-in tables differ from what it would generate, which the
+build runs (see wscript and tools/host/Makefile).
+
+Usage: python3 tools/gen_sport_rules.py [--check]
+"""
+import os
+import sys
+
+SRC_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src', 'c')
+
+# The plain counter comes first, the default. Its points are never won.
+SPORTS = [
+    ('counter', 'Counter', [
+        dict(to_win=0),
+    ]),
+    ('volleyball', 'Volleyball', [
+        dict(to_win=25, win_by=2),
+        dict(to_win=3, tie=dict(at=2, to_win=15, win_by=2)),
+    ]),
+    ('tennis', 'Tennis', [
+        dict(to_win=4, win_by=2),
+        dict(to_win=6, win_by=2, cap=7, tie=dict(at=6, to_win=7, win_by=2)),
+        dict(to_win=2),
+    ]),
+    ('badminton', 'Badminton', [
+        dict(to_win=21, win_by=2, cap=30),
+        dict(to_win=2),
+    ]),
+]
+
+# Levels per sport, the points included, see SPORT_LEVELS.
+MAX_LEVELS = 3
+NO_STAGE = 0xFF
+
+HEADER = """/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Generated by tools/gen_sport_rules.py, do not edit.
+ */
+"""
+
+
+def stage_row(rules, child, tie_at=0, tie_child=NO_STAGE):
+    return (rules['to_win'], rules.get('win_by', 1), rules.get('cap', 0), child, tie_at, tie_child)
+
+
+def compile_sport(levels, stages):
+    """
+    Append the stages of one sport, the points first, and return the index
+    of its top stage.
+    """
+    if not 1 <= len(levels) <= MAX_LEVELS:
+        raise ValueError('1 to {} levels per sport'.format(MAX_LEVELS))
+
+    below = NO_STAGE
+    for rules in levels:
+        tie = rules.get('tie')
+        tie_at, tie_child = 0, NO_STAGE
+        if tie is not None:
+            # The tie stage stands in for the regular stage of the level below.
+            tie_at = tie['at']
+            tie_child = len(stages)
+            stages.append(stage_row(tie, *stages[below][3:]))
+        stages.append(stage_row(rules, below, tie_at, tie_child))
+        below = len(stages) - 1
+
+    for row in stages:
+        if any(value > 0xFF for value in row):
+            raise ValueError('stage values are single bytes')
+    return below
+
+
+def generate():
+    """
+    Return the contents of the generated files by file name.
+    """
+    stages = []
+    sports = []
+    for key, name, levels in SPORTS:
+        top = compile_sport(levels, stages)
+        sports.append((key, name, top, len(levels)))
+
+    header = [HEADER, '\n#pragma once\n\n', 'typedef enum {\n']
+    for key, _, _, _ in sports:
+        header.append('  SPORT_{},\n'.format(key.upper()))
+    header.append('  SPORT_COUNT\n} SportId;\n\n')
+    header.append('#define SPORT_STAGE_COUNT {}\n'.format(len(stages)))
+
+    source = [HEADER, '\n#include <pebble.h>\n#include "sport_rules.h"\n\n\n']
+    source.append('const SportStage sport_stages[SPORT_STAGE_COUNT] = {\n')
+    for i, row in enumerate(stages):
+        source.append('  /* {:2d} */ {{ {}, {}, {}, {}, {}, {} }},\n'.format(
+            i, *(('SPORT_NO_STAGE' if value == NO_STAGE and field in (3, 5) else str(value))
+                 for field, value in enumerate(row))))
+    source.append('};\n\n')
+    source.append('const SportDescription sport_descriptions[SPORT_COUNT] = {\n')
+    for key, name, top, levels in sports:
+        source.append('  [SPORT_{}] = {{ "{}", {}, {} }},\n'.format(key.upper(), name, top, levels))
+    source.append('};\n')
+
+    return {'sport_tables.h': ''.join(header), 'sport_tables.c': ''.join(source)}
+
+
+def main(argv):
+    is_check = argv == ['--check']
+    if argv and not is_check:
+        sys.exit('Usage: python3 tools/gen_sport_rules.py [--check]')
+
+    stale = []
+    for file_name, contents in generate().items():
+        path = os.path.join(SRC_DIR, file_name)
+        if is_check:
+            with open(path) as current:
+                if current.read() != contents:
+                    stale.append(file_name)
+        else:
+            with open(path, 'w') as out:
+                out.write(contents)
+
+    if stale:
+        sys.exit('{} out of date, run tools/gen_sport_rules.py'.format(', '.join(stale)))
+
+
+if __name__ == '__main__':
+    main(sys.argv[1:])
@@ -0,0 +1,295 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <stdarg.h>
+#include "alloc_track.h"
+#include "host.h"
+
+
+typedef struct {
+  const char *file;
+  int line;
+  AllocKind kind;
+} AllocSite;
+
+typedef struct {
+  const void *ptr;
+  uint16_t site;
+  AllocKind kind;
+  size_t bytes;
+  /**
+   * NULL when owned by the app.
+   */
+  const Window *owner;
+  bool is_reported;
+} AllocRecord;
+
+static const char *kind_names[ALLOC_KIND_COUNT] = {
+  [ALLOC_KIND_HEAP] = "heap block",
+  [ALLOC_KIND_LAYER] = "Layer",
+  [ALLOC_KIND_TEXT_LAYER] = "TextLayer",
+  [ALLOC_KIND_BITMAP_LAYER] = "BitmapLayer",
+  [ALLOC_KIND_BITMAP] = "GBitmap",
+  [ALLOC_KIND_WINDOW] = "Window",
+};
+
+static AllocSite s_sites[ALLOC_TRACK_MAX_SITES];
+static uint16_t s_site_count;
+
+static AllocRecord *s_records;
+static uint32_t s_record_count;
+static uint32_t s_record_capacity;
+
+static uint32_t s_violations;
+static size_t s_heap_bytes;
+static size_t s_peak_heap_bytes;
+
+
+static const char *basename_of(const char *path) {
+  const char *slash = strrchr(path, '/');
+  return slash != NULL ? slash + 1 : path;
+}
+
+static void report(const char *file, int line, const char *fmt, ...) {
+  s_violations++;
+  fprintf(stderr, "LEAK CHECK %s:%d: ", basename_of(file), line);
+
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+static uint16_t site_index(const char *file, int line, AllocKind kind) {
+  for (uint16_t i = 0; i < s_site_count; i++) {
+    if (s_sites[i].line == line && strcmp(s_sites[i].file, file) == 0) {
+      return i;
+    }
+  }
+  if (s_site_count == ALLOC_TRACK_MAX_SITES) {
+    fprintf(stderr, "LEAK CHECK: more than %d allocation sites\n", ALLOC_TRACK_MAX_SITES);
+    exit(2);
+  }
+  s_sites[s_site_count] = (AllocSite) { .file = file, .line = line, .kind = kind };
+  return s_site_count++;
+}
+
+static void track(void *ptr, AllocKind kind, size_t bytes, const char *file, int line) {
+  if (ptr == NULL) {
+    return;
+  }
+  if (s_record_count == s_record_capacity) {
+    s_record_capacity = s_record_capacity > 0 ? 2 * s_record_capacity : 64;
+    s_records = realloc(s_records, s_record_capacity * sizeof(AllocRecord));
+  }
+  s_records[s_record_count++] = (AllocRecord) {
+    .ptr = ptr,
+    .site = site_index(file, line, kind),
+    .kind = kind,
+    .bytes = bytes,
+    .owner = kind == ALLOC_KIND_WINDOW ? NULL : window_stack_get_top_window(),
+  };
+
+  s_heap_bytes += bytes;
+  if (s_heap_bytes > s_peak_heap_bytes) {
+    s_peak_heap_bytes = s_heap_bytes;
+  }
+}
+
+/**
+ * Returns false when the object can't be destroyed: not live or of another kind.
+ */
+static bool untrack(void *ptr, AllocKind kind, const char *file, int line) {
+  if (ptr == NULL) {
+    return kind == ALLOC_KIND_HEAP;
+  }
+  for (uint32_t i = 0; i < s_record_count; i++) {
+    AllocRecord *record = &s_records[i];
+    if (record->ptr != ptr) {
+      continue;
+    }
+    if (record->kind != kind) {
+      const AllocSite *site = &s_sites[record->site];
+      report(file, line, "%s created at %s:%d destroyed as %s", kind_names[record->kind],
+        basename_of(site->file), site->line, kind_names[kind]);
+      return false;
+    }
+    s_heap_bytes -= record->bytes;
+    *record = s_records[--s_record_count];
+    return true;
+  }
+  report(file, line, "destroying a %s that is not live, double free?", kind_names[kind]);
+  return false;
+}
+
+/**
+ * Objects owned by the window must be gone once it has unloaded.
+ */
+static void window_unloaded(Window *window) {
+  for (uint32_t i = 0; i < s_record_count; i++) {
+    AllocRecord *record = &s_records[i];
+    if (record->owner == window && !record->is_reported) {
+      const AllocSite *site = &s_sites[record->site];
+      record->is_reported = true;
+      report(site->file, site->line, "%s outlives its window", kind_names[record->kind]);
+    }
+  }
+}
+
+void alloc_track_init(void) {
+  host_set_window_unloaded_handler(window_unloaded);
+}
+
+void alloc_track_snapshot(AllocSnapshot *snapshot) {
+  memset(snapshot, 0, sizeof(AllocSnapshot));
+  snapshot->site_count = s_site_count;
+  for (uint32_t i = 0; i < s_record_count; i++) {
+    snapshot->live[s_records[i].site]++;
+  }
+}
+
+uint32_t alloc_track_check_growth(const AllocSnapshot *before, uint32_t cycles) {
+  AllocSnapshot after;
+  alloc_track_snapshot(&after);
+
+  uint32_t growing_sites = 0;
+  for (uint16_t i = 0; i < after.site_count; i++) {
+    uint32_t live_before = i < before->site_count ? before->live[i] : 0;
+    if (after.live[i] > live_before) {
+      report(s_sites[i].file, s_sites[i].line, "%s keeps piling up (+%u after %u cycles)",
+        kind_names[s_sites[i].kind], after.live[i] - live_before, cycles);
+      growing_sites++;
+    }
+  }
+  return growing_sites;
+}
+
+uint32_t alloc_track_check_exit(void) {
+  uint32_t leaked = 0;
+  for (uint32_t i = 0; i < s_record_count; i++) {
+    AllocRecord *record = &s_records[i];
+    if (!record->is_reported) {
+      const AllocSite *site = &s_sites[record->site];
+      record->is_reported = true;
+      report(site->file, site->line, "%s outlives the app", kind_names[record->kind]);
+    }
+    leaked++;
+  }
+  return leaked;
+}
+
+uint32_t alloc_track_violations(void) {
+  return s_violations;
+}
+
+uint32_t alloc_track_live_count(void) {
+  return s_record_count;
+}
+
+uint32_t alloc_track_peak_heap_bytes(void) {
+  return (uint32_t)s_peak_heap_bytes;
+}
+
+void alloc_track_print_live(FILE *out) {
+  AllocSnapshot snapshot;
+  alloc_track_snapshot(&snapshot);
+
+  for (uint16_t i = 0; i < snapshot.site_count; i++) {
+    if (snapshot.live[i] > 0) {
+      fprintf(out, "  %4u x %-12s %s:%d\n", snapshot.live[i], kind_names[s_sites[i].kind],
+        basename_of(s_sites[i].file), s_sites[i].line);
+    }
+  }
+}
+
+void *alloc_track_malloc(size_t size, const char *file, int line) {
+  void *ptr = malloc(size);
+  track(ptr, ALLOC_KIND_HEAP, size, file, line);
+  return ptr;
+}
+
+void alloc_track_free(void *ptr, const char *file, int line) {
+  if (untrack(ptr, ALLOC_KIND_HEAP, file, line)) {
+    free(ptr);
+  }
+}
+
+Layer *alloc_track_layer_create(GRect frame, const char *file, int line) {
+  Layer *layer = layer_create(frame);
+  track(layer, ALLOC_KIND_LAYER, 0, file, line);
+  return layer;
+}
+
+Layer *alloc_track_layer_create_with_data(GRect frame, size_t data_size,
+  const char *file, int line) {
+
+  Layer *layer = layer_create_with_data(frame, data_size);
+  track(layer, ALLOC_KIND_LAYER, data_size, file, line);
+  return layer;
+}
+
+void alloc_track_layer_destroy(Layer *layer, const char *file, int line) {
+  if (layer != NULL && untrack(layer, ALLOC_KIND_LAYER, file, line)) {
+    layer_destroy(layer);
+  }
+}
+
+TextLayer *alloc_track_text_layer_create(GRect frame, const char *file, int line) {
+  TextLayer *text_layer = text_layer_create(frame);
+  track(text_layer, ALLOC_KIND_TEXT_LAYER, 0, file, line);
+  return text_layer;
+}
+
+void alloc_track_text_layer_destroy(TextLayer *text_layer, const char *file, int line) {
+  if (text_layer != NULL && untrack(text_layer, ALLOC_KIND_TEXT_LAYER, file, line)) {
+    text_layer_destroy(text_layer);
+  }
+}
+
+BitmapLayer *alloc_track_bitmap_layer_create(GRect frame, const char *file, int line) {
+  BitmapLayer *bitmap_layer = bitmap_layer_create(frame);
+  track(bitmap_layer, ALLOC_KIND_BITMAP_LAYER, 0, file, line);
+  return bitmap_layer;
+}
+
+void alloc_track_bitmap_layer_destroy(BitmapLayer *bitmap_layer, const char *file, int line) {
+  if (bitmap_layer != NULL && untrack(bitmap_layer, ALLOC_KIND_BITMAP_LAYER, file, line)) {
+    bitmap_layer_destroy(bitmap_layer);
+  }
+}
+
+GBitmap *alloc_track_gbitmap_create_with_resource(uint32_t resource_id,
+  const char *file, int line) {
+
+  GBitmap *bitmap = gbitmap_create_with_resource(resource_id);
+  track(bitmap, ALLOC_KIND_BITMAP, 0, file, line);
+  return bitmap;
+}
+
+GBitmap *alloc_track_gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect,
+  const char *file, int line) {
+
+  GBitmap *bitmap = gbitmap_create_as_sub_bitmap(base_bitmap, sub_rect);
+  track(bitmap, ALLOC_KIND_BITMAP, 0, file, line);
+  return bitmap;
+}
+
+void alloc_track_gbitmap_destroy(GBitmap *bitmap, const char *file, int line) {
+  if (bitmap != NULL && untrack(bitmap, ALLOC_KIND_BITMAP, file, line)) {
+    gbitmap_destroy(bitmap);
+  }
+}
+
+Window *alloc_track_window_create(const char *file, int line) {
+  Window *window = window_create();
+  track(window, ALLOC_KIND_WINDOW, 0, file, line);
+  return window;
+}
+
+void alloc_track_window_destroy(Window *window, const char *file, int line) {
+  if (window != NULL && untrack(window, ALLOC_KIND_WINDOW, file, line)) {
+    window_destroy(window);
+  }
+}
@@ -0,0 +1,68 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include "pebble.h"
+
+/**
+ * Allocation tracking for the app running on the host harness.
+ *
+ * alloc_track_shim.h is force-included into the app sources, so their calls
+ * to malloc/free and the layer, bitmap and window constructors/destructors
+ * land here with the call site. Every live object is attributed to the site
+ * that created it and owned by the window on top of the stack at that time
+ * (or by the app, when no window was shown yet).
+ *
+ * An object still alive when its owning window unloads, or when the app
+ * exits, is a violation. So is destroying an object that is not live
+ * (double free) or with the destructor of a different kind.
+ */
+
+typedef enum {
+  ALLOC_KIND_HEAP,
+  ALLOC_KIND_LAYER,
+  ALLOC_KIND_TEXT_LAYER,
+  ALLOC_KIND_BITMAP_LAYER,
+  ALLOC_KIND_BITMAP,
+  ALLOC_KIND_WINDOW,
+  ALLOC_KIND_COUNT
+} AllocKind;
+
+#define ALLOC_TRACK_MAX_SITES 64
+
+/**
+ * Live objects per creating call site, to detect growth over repeated cycles.
+ */
+typedef struct {
+  uint16_t site_count;
+  uint32_t live[ALLOC_TRACK_MAX_SITES];
+} AllocSnapshot;
+
+void alloc_track_init(void);
+void alloc_track_snapshot(AllocSnapshot *snapshot);
+uint32_t alloc_track_check_growth(const AllocSnapshot *before, uint32_t cycles);
+uint32_t alloc_track_check_exit(void);
+uint32_t alloc_track_violations(void);
+uint32_t alloc_track_live_count(void);
+uint32_t alloc_track_peak_heap_bytes(void);
+void alloc_track_print_live(FILE *out);
+
+void *alloc_track_malloc(size_t size, const char *file, int line);
+void alloc_track_free(void *ptr, const char *file, int line);
+Layer *alloc_track_layer_create(GRect frame, const char *file, int line);
+Layer *alloc_track_layer_create_with_data(GRect frame, size_t data_size,
+  const char *file, int line);
+void alloc_track_layer_destroy(Layer *layer, const char *file, int line);
+TextLayer *alloc_track_text_layer_create(GRect frame, const char *file, int line);
+void alloc_track_text_layer_destroy(TextLayer *text_layer, const char *file, int line);
+BitmapLayer *alloc_track_bitmap_layer_create(GRect frame, const char *file, int line);
+void alloc_track_bitmap_layer_destroy(BitmapLayer *bitmap_layer, const char *file, int line);
+GBitmap *alloc_track_gbitmap_create_with_resource(uint32_t resource_id,
+  const char *file, int line);
+GBitmap *alloc_track_gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect,
+  const char *file, int line);
+void alloc_track_gbitmap_destroy(GBitmap *bitmap, const char *file, int line);
+Window *alloc_track_window_create(const char *file, int line);
+void alloc_track_window_destroy(Window *window, const char *file, int line);
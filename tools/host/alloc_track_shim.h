@@ -0,0 +1,33 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+/**
+ * Force-included (-include) into the app sources of the leak check build.
+ * The SDK headers come first, so the macros below don't touch declarations.
+ */
+
+#include "pebble.h"
+#include "alloc_track.h"
+
+#define malloc(size) alloc_track_malloc((size), __FILE__, __LINE__)
+#define free(ptr) alloc_track_free((ptr), __FILE__, __LINE__)
+#define layer_create(frame) alloc_track_layer_create((frame), __FILE__, __LINE__)
+#define layer_create_with_data(frame, data_size) \
+  alloc_track_layer_create_with_data((frame), (data_size), __FILE__, __LINE__)
+#define layer_destroy(layer) alloc_track_layer_destroy((layer), __FILE__, __LINE__)
+#define text_layer_create(frame) alloc_track_text_layer_create((frame), __FILE__, __LINE__)
+#define text_layer_destroy(text_layer) \
+  alloc_track_text_layer_destroy((text_layer), __FILE__, __LINE__)
+#define bitmap_layer_create(frame) alloc_track_bitmap_layer_create((frame), __FILE__, __LINE__)
+#define bitmap_layer_destroy(bitmap_layer) \
+  alloc_track_bitmap_layer_destroy((bitmap_layer), __FILE__, __LINE__)
+#define gbitmap_create_with_resource(resource_id) \
+  alloc_track_gbitmap_create_with_resource((resource_id), __FILE__, __LINE__)
+#define gbitmap_create_as_sub_bitmap(base_bitmap, sub_rect) \
+  alloc_track_gbitmap_create_as_sub_bitmap((base_bitmap), (sub_rect), __FILE__, __LINE__)
+#define gbitmap_destroy(bitmap) alloc_track_gbitmap_destroy((bitmap), __FILE__, __LINE__)
+#define window_create() alloc_track_window_create(__FILE__, __LINE__)
+#define window_destroy(window) alloc_track_window_destroy((window), __FILE__, __LINE__)
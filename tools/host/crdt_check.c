@@ -0,0 +1,260 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Score CRDT check.
+ *
+ * Runs the score CRDT (see pn_counter.h) through cases a single watch never
+ * hits: two watches rebasing at once, whose states then cross on the link.
+ * Both replicas have to end up with the same score, and the points counted
+ * before the rebase must not be counted twice. The same goes for two
+ * watches winning the same set at once, whose sets won (see sport_rules.h)
+ * have to count it once. Replicas of the same state built in another order
+ * have to have the same digest (see state_digest.h), and the sets won are
+ * part of it.
+ * It fails when any of the cases does not hold.
+ *
+ * Usage: crdt_check
+ */
+
+#include "host.h"
+#include "pn_counter.h"
+#include "sport_rules.h"
+#include "state_digest.h"
+
+
+#define MODULUS 1000
+
+typedef struct {
+  uint32_t cases;
+  uint32_t failures;
+} CrdtCheck;
+
+static void expect(CrdtCheck *check, bool is_true, const char *what) {
+  check->cases++;
+  if (!is_true) {
+    printf("Failed: %s\n", what);
+    check->failures++;
+  }
+}
+
+static void merge(PnCounter *counter, const PnCounter *from) {
+  uint8_t wire[PN_COUNTER_WIRE_MAX_SIZE];
+  uint16_t size = pn_counter_write_wire(from, wire, sizeof(wire));
+
+  pn_counter_merge_wire(counter, wire, size);
+}
+
+static bool is_same_score(const PnCounter *counter, const PnCounter *other) {
+  return pn_counter_value(counter, 0) == pn_counter_value(other, 0)
+    && pn_counter_value(counter, 1) == pn_counter_value(other, 1);
+}
+
+/**
+ * A court full of watches, each with a point for the first team, so the
+ * next watch to score finds no room for itself and rebases.
+ */
+static void fill_devices(PnCounter *counter) {
+  pn_counter_init(counter, MODULUS);
+
+  for (uint32_t device_id = 1; device_id <= PN_COUNTER_MAX_DEVICES; device_id++) {
+    pn_counter_set(counter, 100 + device_id, 0, pn_counter_value(counter, 0) + 1);
+  }
+}
+
+static void check_concurrent_rebase(CrdtCheck *check) {
+  PnCounter a;
+  PnCounter b;
+  fill_devices(&a);
+  b = a;
+
+  // Both score on a full court before hearing of each other.
+  pn_counter_set(&a, 1, 0, pn_counter_value(&a, 0) + 1);
+  pn_counter_set(&b, 2, 1, pn_counter_value(&b, 1) + 1);
+  expect(check, a.generation == b.generation,
+    "both rebases start the same generation");
+
+  PnCounter a_then_b = a;
+  merge(&a_then_b, &b);
+  PnCounter b_then_a = b;
+  merge(&b_then_a, &a);
+
+  expect(check, is_same_score(&a_then_b, &b_then_a),
+    "concurrent rebases converge whatever the merge order");
+  expect(check, pn_counter_value(&a_then_b, 0) <= PN_COUNTER_MAX_DEVICES + 1,
+    "concurrent rebases do not count the points before them twice");
+
+  // The winner stays put, the loser adopts it.
+  PnCounter winner = a_then_b;
+  merge(&a_then_b, &a);
+  merge(&a_then_b, &b);
+  expect(check, is_same_score(&a_then_b, &winner),
+    "merging the rebased states again changes nothing");
+
+  // Points scored after the rebase on either side still count.
+  pn_counter_set(&a_then_b, 1, 0, pn_counter_value(&a_then_b, 0) + 1);
+  pn_counter_set(&b_then_a, 2, 1, pn_counter_value(&b_then_a, 1) + 1);
+  PnCounter a_after = a_then_b;
+  merge(&a_then_b, &b_then_a);
+  merge(&b_then_a, &a_after);
+  expect(check, is_same_score(&a_then_b, &b_then_a)
+    && pn_counter_value(&a_then_b, 0) == pn_counter_value(&winner, 0) + 1
+    && pn_counter_value(&a_then_b, 1) == pn_counter_value(&winner, 1) + 1,
+    "points after concurrent rebases merge as usual");
+}
+
+typedef struct {
+  uint32_t device_id;
+  PnCounter crdt;
+  SportState sport;
+} Watch;
+
+/**
+ * A point as the app scores it: a step of the sport rules, a new generation
+ * with a unit won, then the score recorded.
+ */
+static void score_point(Watch *watch, uint8_t team) {
+  uint16_t points[SPORT_TEAMS] = {
+    pn_counter_value(&watch->crdt, 0), pn_counter_value(&watch->crdt, 1)
+  };
+  SportStep step = sport_point(&watch->sport, points, team);
+
+  if (step == SPORT_STEP_UNIT_WON || step == SPORT_STEP_MATCH_WON) {
+    pn_counter_restart(&watch->crdt, watch->device_id);
+  }
+  for (uint8_t i = 0; i < SPORT_TEAMS; i++) {
+    pn_counter_set(&watch->crdt, watch->device_id, i, points[i]);
+  }
+}
+
+/**
+ * A SET with the CRDT and SPORT as the app takes it.
+ */
+static void receive(Watch *watch, const Watch *from) {
+  uint8_t wire[PN_COUNTER_WIRE_MAX_SIZE];
+  uint8_t sport_wire[SPORT_WIRE_SIZE];
+  uint16_t size = pn_counter_write_wire(&from->crdt, wire, sizeof(wire));
+  sport_write_wire(&from->sport, false, sport_wire);
+
+  switch (pn_counter_merge_wire(&watch->crdt, wire, size)) {
+    case PN_COUNTER_MERGE_ADOPTED:
+      sport_read_wire(&watch->sport, sport_wire, false);
+      break;
+    case PN_COUNTER_MERGE_MERGED:
+      sport_merge_wire(&watch->sport, sport_wire, false);
+      break;
+    default:
+      break;
+  }
+}
+
+static bool is_same_match(const Watch *watch, const Watch *other) {
+  return is_same_score(&watch->crdt, &other->crdt)
+    && memcmp(&watch->sport.progress, &other->sport.progress, sizeof(SportProgress)) == 0;
+}
+
+static void check_concurrent_set_win(CrdtCheck *check) {
+  Watch a = { .device_id = 1 };
+  pn_counter_init(&a.crdt, MODULUS);
+  sport_init(&a.sport, SPORT_VOLLEYBALL, MODULUS);
+  for (uint8_t i = 0; i < 24 + 20; i++) {
+    score_point(&a, i < 24 ? 0 : 1);
+  }
+
+  // The set point is won on both watches before they hear of each other.
+  Watch b = a;
+  b.device_id = 2;
+  score_point(&a, 0);
+  score_point(&b, 0);
+
+  Watch a_then_b = a;
+  receive(&a_then_b, &b);
+  Watch b_then_a = b;
+  receive(&b_then_a, &a);
+
+  expect(check, is_same_match(&a_then_b, &b_then_a),
+    "concurrent set wins converge whatever the merge order");
+  expect(check, pn_counter_value(&a_then_b.crdt, 0) == 0
+    && pn_counter_value(&a_then_b.crdt, 1) == 0,
+    "concurrent set wins start the next set from 0:0 once");
+  expect(check, a_then_b.sport.progress.units[0][0] == 1
+    && a_then_b.sport.progress.units[0][1] == 0,
+    "concurrent set wins count the set once");
+
+  // A point of the next set on one, and one of the old set on a third
+  // watch that did not hear of the set won yet.
+  Watch c = a;
+  c.device_id = 3;
+  score_point(&a_then_b, 1);
+  score_point(&c, 1);
+  receive(&a_then_b, &c);
+  receive(&c, &a_then_b);
+  expect(check, is_same_match(&a_then_b, &c)
+    && pn_counter_value(&c.crdt, 1) == 1 && c.sport.progress.units[0][0] == 1,
+    "a point of the set already won does not count in the next one");
+}
+
+static void check_digest_order(CrdtCheck *check) {
+  PnCounter a;
+  PnCounter b;
+  pn_counter_init(&a, MODULUS);
+  pn_counter_init(&b, MODULUS);
+
+  // The same points of three watches, merged in the opposite order.
+  PnCounter watches[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    pn_counter_init(&watches[i], MODULUS);
+    pn_counter_set(&watches[i], 300 - i, i % 2, i + 1);
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    merge(&a, &watches[i]);
+    merge(&b, &watches[2 - i]);
+  }
+
+  StateDigest a_digest;
+  StateDigest b_digest;
+  state_digest_compute(&a_digest, pn_counter_value(&a, 0), pn_counter_value(&a, 1), &a, NULL);
+  state_digest_compute(&b_digest, pn_counter_value(&b, 0), pn_counter_value(&b, 1), &b, NULL);
+
+  expect(check, is_same_score(&a, &b) && a.entries[0].device_id != b.entries[0].device_id,
+    "the replicas hold the same state in another order");
+  expect(check, state_digest_equals(&a_digest, &b_digest),
+    "the same state in another order has the same digest");
+
+  // A point more on one of them does tell them apart.
+  pn_counter_set(&b, 300, 0, pn_counter_value(&b, 0) + 1);
+  state_digest_compute(&b_digest, pn_counter_value(&b, 0), pn_counter_value(&b, 1), &b, NULL);
+  expect(check, !state_digest_equals(&a_digest, &b_digest),
+    "another state has another digest");
+
+  // So does another set won with the same points.
+  SportState sport;
+  uint8_t sport_bytes[SPORT_WIRE_SIZE];
+  uint8_t other_sport_bytes[SPORT_WIRE_SIZE];
+  sport_init(&sport, SPORT_VOLLEYBALL, MODULUS);
+  sport_write_wire(&sport, false, sport_bytes);
+  sport.progress.units[0][1]++;
+  sport_write_wire(&sport, false, other_sport_bytes);
+  state_digest_compute(&a_digest, pn_counter_value(&a, 0), pn_counter_value(&a, 1), &a,
+    sport_bytes);
+  state_digest_compute(&b_digest, pn_counter_value(&a, 0), pn_counter_value(&a, 1), &a,
+    other_sport_bytes);
+  expect(check, !state_digest_equals(&a_digest, &b_digest),
+    "another sport state has another digest");
+}
+
+int main(int argc, char *argv[]) {
+  CrdtCheck check = { 0 };
+
+  check_concurrent_rebase(&check);
+  check_concurrent_set_win(&check);
+  check_digest_order(&check);
+
+  if (check.failures > 0) {
+    printf("FAILED: %u of %u cases\n", check.failures, check.cases);
+    return 1;
+  }
+  printf("OK: %u cases\n", check.cases);
+  return 0;
+}
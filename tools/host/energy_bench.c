@@ -0,0 +1,395 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Energy-model benchmark.
+ *
+ * Plays a scripted volleyball match against the real app on the host harness
+ * and counts what costs battery on the watch: wakeups, redraws (and the area
+ * asked to be repainted), flash writes and Bluetooth messages. The counts are
+ * weighted by a cost table to estimate the energy spent per match. The costs
+ * are rough defaults meant to compare builds with each other, not absolute
+ * measurements; override them with --costs FILE or --cost name=value.
+ *
+ * The battery starts the match at 80 % and drains by a percent every few
+ * minutes; start it lower with --battery N to see the low-power mode at work.
+ *
+ * Usage: energy_bench [--sets N] [--seed N] [--battery N] [--costs FILE]
+ *                     [--cost name=value] [--csv] [--verbose]
+ */
+
+#include <getopt.h>
+#include "host.h"
+#include "protocol.h"
+#include "clock_sync.h"
+
+
+#define SUPPLY_VOLTAGE 3.8
+#define POINTS_TO_WIN_SET 25
+#define PARTNER_POINT_PERCENT 10
+#define MISTAKE_PERCENT 4
+#define BATTERY_DRAIN_INTERVAL_MS (5 * 60 * 1000)
+#define SET_BREAK_MS (2 * 60 * 1000)
+#define STATS_VIEW_MS (10 * 1000)
+#define DISCONNECT_AFTER_POINTS 8
+#define DISCONNECT_MS (3 * 60 * 1000)
+
+typedef enum {
+  COST_WAKEUP,
+  COST_RENDER,
+  COST_DIRTY_KPX,
+  COST_FLASH_WRITE,
+  COST_FLASH_KB,
+  COST_BLE_MSG_OUT,
+  COST_BLE_MSG_IN,
+  COST_BLE_KB,
+  COST_COUNT
+} CostId;
+
+typedef struct {
+  const char *name;
+  const char *unit;
+  double uj_per_unit;
+} Cost;
+
+/**
+ * Default energy cost per unit, in microjoules.
+ */
+static Cost s_costs[COST_COUNT] = {
+  [COST_WAKEUP] = { "wakeup", "wakeup", 25.0 },
+  [COST_RENDER] = { "render", "pass", 180.0 },
+  [COST_DIRTY_KPX] = { "dirty_kpx", "1000 px", 12.0 },
+  [COST_FLASH_WRITE] = { "flash_write", "write", 90.0 },
+  [COST_FLASH_KB] = { "flash_kb", "KiB", 60.0 },
+  [COST_BLE_MSG_OUT] = { "ble_msg_out", "message", 700.0 },
+  [COST_BLE_MSG_IN] = { "ble_msg_in", "message", 450.0 },
+  [COST_BLE_KB] = { "ble_kb", "KiB", 150.0 },
+};
+
+typedef struct {
+  uint32_t rng;
+  uint8_t sets;
+  uint8_t charge_percent;
+  uint32_t points;
+  uint32_t partner_points;
+  uint32_t mistakes;
+  int64_t start_ms;
+  int64_t end_ms;
+  uint16_t score_1;
+  uint16_t score_2;
+} Match;
+
+static uint32_t next_random(Match *match, uint32_t bound) {
+  // xorshift32
+  match->rng ^= match->rng << 13;
+  match->rng ^= match->rng >> 17;
+  match->rng ^= match->rng << 5;
+  return match->rng % bound;
+}
+
+/**
+ * The phone acknowledges everything, answers pings and forwards the points
+ * recorded on the partner's device.
+ */
+static void phone_outbox_handler(const uint8_t *data, uint16_t size, void *context) {
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, data, size);
+
+  Tuple *cmd_tuple = dict_find(&iter, SEND_CMD_KEY);
+  Tuple *t0_tuple = dict_find(&iter, SEND_PING_T0_KEY);
+  if (cmd_tuple == NULL || cmd_tuple->value->uint8 != SEND_CMD_PING || t0_tuple == NULL) {
+    return;
+  }
+
+  uint8_t t_bytes[8];
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_PONG);
+  dict_write_data(&iter, RECEIVE_PING_T0_KEY, t0_tuple->value->data, t0_tuple->length);
+  clock_sync_write_timestamp(host_now_ms(), t_bytes);
+  dict_write_data(&iter, RECEIVE_PONG_T1_KEY, t_bytes, sizeof(t_bytes));
+  dict_write_data(&iter, RECEIVE_PONG_T2_KEY, t_bytes, sizeof(t_bytes));
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+static void phone_send_partner_point(const Match *match) {
+  DictionaryIterator iter;
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_SET_SCORE_VAL);
+  dict_write_uint16(&iter, RECEIVE_SCORE_1_KEY, match->score_1);
+  dict_write_uint16(&iter, RECEIVE_SCORE_2_KEY, match->score_2);
+  dict_write_uint32(&iter, RECEIVE_TIMESTAMP_KEY, (uint32_t)(host_now_ms() / 1000));
+  dict_write_uint16(&iter, RECEIVE_TIMESTAMP_MS_KEY, (uint16_t)(host_now_ms() % 1000));
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+static void battery_drain(void *context) {
+  uint8_t *charge_percent = context;
+  if (*charge_percent > 0) {
+    (*charge_percent)--;
+  }
+  host_set_battery(*charge_percent, false);
+  host_schedule(BATTERY_DRAIN_INTERVAL_MS, battery_drain, context);
+}
+
+static void phone_back_in_range(void *context) {
+  host_set_connected(true);
+}
+
+static bool is_set_over(const Match *match) {
+  uint16_t high = match->score_1 > match->score_2 ? match->score_1 : match->score_2;
+  uint16_t low = match->score_1 > match->score_2 ? match->score_2 : match->score_1;
+
+  return high >= POINTS_TO_WIN_SET && high - low >= 2;
+}
+
+static void play_point(Match *match) {
+  // Rally, then the point is recorded on this watch or on the partner's one.
+  host_advance(10000 + next_random(match, 30000));
+
+  bool is_first_side = next_random(match, 2) == 0;
+  if (is_first_side) {
+    match->score_1++;
+  } else {
+    match->score_2++;
+  }
+  match->points++;
+
+  if (next_random(match, 100) < PARTNER_POINT_PERCENT) {
+    match->partner_points++;
+    phone_send_partner_point(match);
+    return;
+  }
+
+  if (next_random(match, 100) < MISTAKE_PERCENT) {
+    // Wrong button, noticed a moment later and taken back.
+    ButtonId wrong = is_first_side ? BUTTON_ID_UP : BUTTON_ID_DOWN;
+    match->mistakes++;
+    host_click(wrong);
+    host_advance(2000);
+    host_long_click(wrong);
+    host_advance(500);
+  }
+  host_click(is_first_side ? BUTTON_ID_DOWN : BUTTON_ID_UP);
+}
+
+static void play_match(void *context) {
+  Match *match = context;
+
+  match->start_ms = host_now_ms();
+  host_set_battery(match->charge_percent, false);
+  host_schedule(BATTERY_DRAIN_INTERVAL_MS, battery_drain, &match->charge_percent);
+
+  for (uint8_t set = 0; set < match->sets; set++) {
+    uint32_t set_points = 0;
+
+    while (!is_set_over(match)) {
+      play_point(match);
+      set_points++;
+
+      // The phone goes out of range for a while in the middle set.
+      if (set == 1 && set_points == DISCONNECT_AFTER_POINTS) {
+        host_set_connected(false);
+        host_schedule(DISCONNECT_MS, phone_back_in_range, NULL);
+      }
+    }
+
+    // Set break: a look at the statistics, then a reset for the next set.
+    host_advance(20000);
+    host_multi_click(BUTTON_ID_SELECT, 2);
+    host_advance(STATS_VIEW_MS);
+    host_click(BUTTON_ID_BACK);
+    host_advance(SET_BREAK_MS);
+
+    if (set + 1 < match->sets) {
+      host_long_click(BUTTON_ID_SELECT);
+      match->score_1 = 0;
+      match->score_2 = 0;
+    }
+  }
+
+  host_advance(5000);
+  match->end_ms = host_now_ms();
+}
+
+static bool set_cost(const char *name, double uj_per_unit) {
+  for (int i = 0; i < COST_COUNT; i++) {
+    if (strcmp(s_costs[i].name, name) == 0) {
+      s_costs[i].uj_per_unit = uj_per_unit;
+      return true;
+    }
+  }
+  fprintf(stderr, "Unknown cost '%s'\n", name);
+  return false;
+}
+
+static bool parse_cost(const char *assignment) {
+  char name[32];
+  double value;
+
+  if (sscanf(assignment, " %31[a-z_] = %lf", name, &value) != 2) {
+    fprintf(stderr, "Invalid cost '%s', expected name=value\n", assignment);
+    return false;
+  }
+  return set_cost(name, value);
+}
+
+/**
+ * One "name = value" per line, '#' starts a comment.
+ */
+static bool load_costs(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    perror(path);
+    return false;
+  }
+
+  char line[128];
+  bool is_ok = true;
+  while (is_ok && fgets(line, sizeof(line), file) != NULL) {
+    char *comment = strchr(line, '#');
+    if (comment != NULL) {
+      *comment = '\0';
+    }
+    if (strspn(line, " \t\r\n") != strlen(line)) {
+      is_ok = parse_cost(line);
+    }
+  }
+  fclose(file);
+
+  return is_ok;
+}
+
+static void counts_from(const HostCounters *counters, double counts[COST_COUNT]) {
+  counts[COST_WAKEUP] = counters->wakeups;
+  counts[COST_RENDER] = counters->render_passes;
+  counts[COST_DIRTY_KPX] = counters->dirty_area / 1000.0;
+  counts[COST_FLASH_WRITE] = counters->flash_writes;
+  counts[COST_FLASH_KB] = counters->flash_bytes / 1024.0;
+  counts[COST_BLE_MSG_OUT] = counters->msgs_out;
+  counts[COST_BLE_MSG_IN] = counters->msgs_in;
+  counts[COST_BLE_KB] = (counters->bytes_out + counters->bytes_in) / 1024.0;
+}
+
+static void print_report(const Match *match, const HostCounters *counters) {
+  double counts[COST_COUNT];
+  double energy_uj[COST_COUNT];
+  double total_uj = 0;
+
+  counts_from(counters, counts);
+  for (int i = 0; i < COST_COUNT; i++) {
+    energy_uj[i] = counts[i] * s_costs[i].uj_per_unit;
+    total_uj += energy_uj[i];
+  }
+
+  int64_t duration_s = (match->end_ms - match->start_ms) / 1000;
+  printf("Simulated match: %d sets, %u points (%u from the partner, %u corrected), "
+    "%02d:%02d:%02d\n\n", match->sets, match->points, match->partner_points, match->mistakes,
+    (int)(duration_s / 3600), (int)(duration_s / 60 % 60), (int)(duration_s % 60));
+
+  printf("%-12s %10s %10s %-8s %10s %6s\n", "cost", "count", "uJ/unit", "unit", "mJ", "share");
+  for (int i = 0; i < COST_COUNT; i++) {
+    printf("%-12s %10.1f %10.1f %-8s %10.2f %5.1f%%\n", s_costs[i].name, counts[i],
+      s_costs[i].uj_per_unit, s_costs[i].unit, energy_uj[i] / 1000.0,
+      total_uj > 0 ? 100.0 * energy_uj[i] / total_uj : 0.0);
+  }
+  printf("%-12s %43.2f\n\n", "total", total_uj / 1000.0);
+
+  printf("Per point: %.1f uJ, %.2f wakeups, %.2f redraws, %.2f flash writes, "
+    "%.2f messages\n", total_uj / match->points, (double)counters->wakeups / match->points,
+    (double)counters->render_passes / match->points,
+    (double)counters->flash_writes / match->points,
+    (double)(counters->msgs_out + counters->msgs_in) / match->points);
+  printf("Charge: %.2f uAh at %.1f V\n", total_uj / SUPPLY_VOLTAGE / 3600.0, SUPPLY_VOLTAGE);
+  printf("Events: %u clicks, %u ticks, %u timer firings, %u service events, "
+    "%u layer redraws, %u failed sends, %u dropped\n", counters->clicks, counters->ticks,
+    counters->timer_firings, counters->service_events, counters->layer_redraws,
+    counters->msgs_out_failed, counters->msgs_in_dropped);
+  printf("Data logging: %u score events (%u B)\n", counters->data_log_items,
+    counters->data_log_bytes);
+  printf("App glance: %u updates, \"%s\"\n", counters->glance_reloads, host_glance_subtitle());
+}
+
+static void print_csv(const Match *match, const HostCounters *counters) {
+  double counts[COST_COUNT];
+  double total_uj = 0;
+
+  counts_from(counters, counts);
+  printf("points,wakeups,render_passes,dirty_kpx,flash_writes,flash_bytes,"
+    "msgs_out,msgs_in,ble_bytes,total_uj\n");
+  for (int i = 0; i < COST_COUNT; i++) {
+    total_uj += counts[i] * s_costs[i].uj_per_unit;
+  }
+  printf("%u,%u,%u,%.1f,%u,%u,%u,%u,%u,%.0f\n", match->points, counters->wakeups,
+    counters->render_passes, counts[COST_DIRTY_KPX], counters->flash_writes,
+    counters->flash_bytes, counters->msgs_out, counters->msgs_in,
+    counters->bytes_out + counters->bytes_in, total_uj);
+}
+
+int main(int argc, char *argv[]) {
+  Match match = { .rng = 1, .sets = 3, .charge_percent = 80 };
+  bool is_csv = false;
+
+  static const struct option options[] = {
+    { "sets", required_argument, NULL, 's' },
+    { "seed", required_argument, NULL, 'r' },
+    { "battery", required_argument, NULL, 'b' },
+    { "costs", required_argument, NULL, 'f' },
+    { "cost", required_argument, NULL, 'c' },
+    { "csv", no_argument, NULL, 'x' },
+    { "verbose", no_argument, NULL, 'v' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "s:r:b:f:c:xv", options, NULL)) != -1) {
+    switch (opt) {
+      case 's':
+        match.sets = (uint8_t)atoi(optarg);
+        break;
+      case 'r':
+        match.rng = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'b':
+        match.charge_percent = (uint8_t)atoi(optarg);
+        break;
+      case 'f':
+        if (!load_costs(optarg)) {
+          return 2;
+        }
+        break;
+      case 'c':
+        if (!parse_cost(optarg)) {
+          return 2;
+        }
+        break;
+      case 'x':
+        is_csv = true;
+        break;
+      case 'v':
+        host_set_log_level(APP_LOG_LEVEL_DEBUG_VERBOSE);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [--sets N] [--seed N] [--battery N] [--costs FILE] "
+          "[--cost name=value] [--csv] [--verbose]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (match.sets == 0 || match.rng == 0 || match.charge_percent > 100) {
+    fprintf(stderr, "Sets and seed have to be positive, the battery at most 100 %%\n");
+    return 2;
+  }
+
+  host_set_outbox_handler(phone_outbox_handler, NULL);
+  host_run_app(play_match, &match);
+
+  if (is_csv) {
+    print_csv(&match, host_counters());
+  } else {
+    print_report(&match, host_counters());
+  }
+
+  return 0;
+}
@@ -0,0 +1,265 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Flapping link benchmark.
+ *
+ * The Bluetooth link to the phone keeps dropping for a moment and coming
+ * back, as it does in a venue full of radios. A stand-in phone answers the
+ * app's HELLO with the digest of the score it holds, answers pings and keeps
+ * the score (and the score CRDT) the app sends it. Now and then a point is
+ * scored on the watch while the link is up.
+ *
+ * Reported are the messages over the link per reconnect, split by command,
+ * and whether the phone ends up with the score of the watch. With
+ * --no-digest the phone leaves DIGEST out of its HELLO, so the app syncs on
+ * every reconnect.
+ *
+ * Usage: flap_bench [--cycles N] [--down-ms N] [--up-ms N] [--points-every N]
+ *                   [--no-digest] [--csv] [--verbose]
+ */
+
+#include <getopt.h>
+#include "host.h"
+#include "protocol.h"
+#include "clock_sync.h"
+#include "link_caps.h"
+#include "pn_counter.h"
+#include "state_digest.h"
+
+
+#define SETTLE_MS 5000
+#define PHONE_INBOX_SIZE 512
+#define PHONE_MAX_SCORE 999
+
+typedef struct {
+  uint16_t cycles;
+  uint32_t down_ms;
+  uint32_t up_ms;
+  uint16_t points_every;
+  bool is_digest;
+
+  uint16_t score_1;
+  uint16_t score_2;
+  PnCounter crdt;
+
+  uint32_t points;
+  uint32_t hellos;
+  uint32_t syncs;
+  uint32_t pings;
+  uint32_t other;
+} Bench;
+
+static void phone_send_hello(const Bench *bench) {
+  uint32_t features = PROTOCOL_FEATURE_BATCH | PROTOCOL_FEATURE_PING
+    | PROTOCOL_FEATURE_PACKED_SCORE | PROTOCOL_FEATURE_SCORE_CRDT
+    | (bench->is_digest ? PROTOCOL_FEATURE_DIGEST : 0);
+
+  DictionaryIterator iter;
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_HELLO);
+  dict_write_uint8(&iter, RECEIVE_HELLO_VERSION_KEY, PROTOCOL_VERSION);
+  dict_write_uint32(&iter, RECEIVE_HELLO_COMMANDS_KEY, (1 << RECEIVE_CMD_SET_SCORE_VAL)
+    | (1 << RECEIVE_CMD_PONG) | (1 << RECEIVE_CMD_HELLO));
+  dict_write_uint16(&iter, RECEIVE_HELLO_INBOX_SIZE_KEY, PHONE_INBOX_SIZE);
+  dict_write_uint32(&iter, RECEIVE_HELLO_FEATURES_KEY, features);
+
+  if (bench->is_digest) {
+    StateDigest digest;
+    uint8_t digest_bytes[STATE_DIGEST_SIZE];
+    state_digest_compute(&digest, bench->score_1, bench->score_2, &bench->crdt, NULL);
+    state_digest_write(&digest, digest_bytes);
+    dict_write_data(&iter, RECEIVE_DIGEST_KEY, digest_bytes, sizeof(digest_bytes));
+  }
+
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+static void phone_send_pong(const Tuple *t0_tuple) {
+  DictionaryIterator iter;
+  uint8_t t_bytes[CLOCK_SYNC_TIMESTAMP_SIZE];
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_PONG);
+  dict_write_data(&iter, RECEIVE_PING_T0_KEY, t0_tuple->value->data, t0_tuple->length);
+  clock_sync_write_timestamp(host_now_ms(), t_bytes);
+  dict_write_data(&iter, RECEIVE_PONG_T1_KEY, t_bytes, sizeof(t_bytes));
+  dict_write_data(&iter, RECEIVE_PONG_T2_KEY, t_bytes, sizeof(t_bytes));
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+/**
+ * SET, SYNC and BATCH: the CRDT is merged, otherwise the score taken over.
+ */
+static void phone_take_score(Bench *bench, DictionaryIterator *iter) {
+  Tuple *crdt_tuple = dict_find(iter, SEND_SCORE_CRDT_KEY);
+  Tuple *packed_tuple = dict_find(iter, SEND_PACKED_SCORE_KEY);
+  Tuple *score1_tuple = dict_find(iter, SEND_SCORE_1_KEY);
+  Tuple *score2_tuple = dict_find(iter, SEND_SCORE_2_KEY);
+
+  if (crdt_tuple != NULL) {
+    pn_counter_merge_wire(&bench->crdt, crdt_tuple->value->data, crdt_tuple->length);
+    bench->score_1 = pn_counter_value(&bench->crdt, 0);
+    bench->score_2 = pn_counter_value(&bench->crdt, 1);
+  } else if (packed_tuple != NULL) {
+    int64_t timestamp_ms;
+    link_caps_read_packed_score(packed_tuple->value->data, &bench->score_1, &bench->score_2,
+      &timestamp_ms);
+  } else if (score1_tuple != NULL && score2_tuple != NULL) {
+    bench->score_1 = score1_tuple->value->uint16;
+    bench->score_2 = score2_tuple->value->uint16;
+  }
+}
+
+static void phone_outbox_handler(const uint8_t *data, uint16_t size, void *context) {
+  Bench *bench = context;
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, data, size);
+
+  Tuple *cmd_tuple = dict_find(&iter, SEND_CMD_KEY);
+  if (cmd_tuple == NULL) {
+    return;
+  }
+
+  switch (cmd_tuple->value->uint8) {
+    case SEND_CMD_HELLO:
+      bench->hellos++;
+      phone_send_hello(bench);
+      break;
+    case SEND_CMD_SET_SCORE_VAL:
+    case SEND_CMD_SYNC_SCORE_VAL:
+    case SEND_CMD_BATCH_SCORE_VAL:
+      bench->syncs++;
+      phone_take_score(bench, &iter);
+      break;
+    case SEND_CMD_PING: {
+      bench->pings++;
+      Tuple *t0_tuple = dict_find(&iter, SEND_PING_T0_KEY);
+      if (t0_tuple != NULL) {
+        phone_send_pong(t0_tuple);
+      }
+      break;
+    }
+    default:
+      bench->other++;
+      break;
+  }
+}
+
+static void run_bench(void *context) {
+  Bench *bench = context;
+
+  // Let the first HELLO exchange and sync go by.
+  host_advance(SETTLE_MS);
+  host_reset_counters();
+  bench->hellos = bench->syncs = bench->pings = bench->other = 0;
+
+  for (uint16_t i = 0; i < bench->cycles; i++) {
+    host_set_connected(false);
+    host_advance(bench->down_ms);
+    host_set_connected(true);
+
+    if (bench->points_every > 0 && i % bench->points_every == bench->points_every - 1) {
+      host_advance(bench->up_ms / 2);
+      host_click(bench->points % 2 == 0 ? BUTTON_ID_UP : BUTTON_ID_DOWN);
+      bench->points++;
+      host_advance(bench->up_ms - bench->up_ms / 2);
+    } else {
+      host_advance(bench->up_ms);
+    }
+  }
+
+  host_advance(SETTLE_MS);
+}
+
+static void print_report(const Bench *bench, bool is_csv) {
+  const HostCounters *counters = host_counters();
+  double per_cycle = bench->cycles > 0 ? 1.0 / bench->cycles : 0;
+  bool is_converged = bench->score_1 + bench->score_2 == bench->points;
+
+  if (is_csv) {
+    printf("cycles,points,hellos,syncs,pings,other,msgs_out,msgs_in,bytes_out,"
+      "msgs_per_reconnect,converged\n");
+    printf("%u,%u,%u,%u,%u,%u,%u,%u,%u,%.2f,%d\n", bench->cycles, bench->points,
+      bench->hellos, bench->syncs, bench->pings, bench->other, counters->msgs_out,
+      counters->msgs_in, counters->bytes_out,
+      (counters->msgs_out + counters->msgs_in) * per_cycle, is_converged);
+    return;
+  }
+
+  printf("Reconnects: %u, down %u ms, up %u ms, %u points scored\n", bench->cycles,
+    bench->down_ms, bench->up_ms, bench->points);
+  printf("Watch sent: %u hellos, %u syncs, %u pings, %u other\n", bench->hellos,
+    bench->syncs, bench->pings, bench->other);
+  printf("Messages:   %u out (%u B), %u in, %.2f per reconnect\n", counters->msgs_out,
+    counters->bytes_out, counters->msgs_in,
+    (counters->msgs_out + counters->msgs_in) * per_cycle);
+  printf("Phone:      %u:%u, %s\n", bench->score_1, bench->score_2,
+    is_converged ? "converged" : "diverged");
+}
+
+int main(int argc, char *argv[]) {
+  static Bench bench = {
+    .cycles = 100, .down_ms = 500, .up_ms = 5000, .points_every = 10, .is_digest = true
+  };
+  bool is_csv = false;
+
+  static const struct option options[] = {
+    { "cycles", required_argument, NULL, 'n' },
+    { "down-ms", required_argument, NULL, 'd' },
+    { "up-ms", required_argument, NULL, 'u' },
+    { "points-every", required_argument, NULL, 'p' },
+    { "no-digest", no_argument, NULL, 'g' },
+    { "csv", no_argument, NULL, 'x' },
+    { "verbose", no_argument, NULL, 'v' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "n:d:u:p:gxv", options, NULL)) != -1) {
+    switch (opt) {
+      case 'n':
+        bench.cycles = (uint16_t)atoi(optarg);
+        break;
+      case 'd':
+        bench.down_ms = (uint32_t)atoi(optarg);
+        break;
+      case 'u':
+        bench.up_ms = (uint32_t)atoi(optarg);
+        break;
+      case 'p':
+        bench.points_every = (uint16_t)atoi(optarg);
+        break;
+      case 'g':
+        bench.is_digest = false;
+        break;
+      case 'x':
+        is_csv = true;
+        break;
+      case 'v':
+        host_set_log_level(APP_LOG_LEVEL_DEBUG_VERBOSE);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [--cycles N] [--down-ms N] [--up-ms N] "
+          "[--points-every N] [--no-digest] [--csv] [--verbose]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (bench.cycles == 0 || bench.up_ms == 0
+    || (bench.points_every > 0 && bench.cycles / bench.points_every > PHONE_MAX_SCORE)) {
+
+    fprintf(stderr, "Cycles and up time have to be positive, at most %d points\n",
+      PHONE_MAX_SCORE);
+    return 2;
+  }
+
+  pn_counter_init(&bench.crdt, PHONE_MAX_SCORE + 1);
+  host_set_outbox_handler(phone_outbox_handler, &bench);
+  host_run_app(run_bench, &bench);
+
+  print_report(&bench, is_csv);
+
+  return 0;
+}
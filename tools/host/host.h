@@ -0,0 +1,145 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+#include "pebble.h"
+
+/**
+ * Host harness for running the watch app on Linux.
+ *
+ * Time is virtual: nothing happens until the scenario advances the clock,
+ * which fires the due app timers and tick events in order. Every event
+ * delivered to the app counts as one wakeup and is followed by a render pass
+ * of the top window, if any layer was marked dirty.
+ *
+ * The scenario runs inside app_event_loop(), so the app's own main() is
+ * used unchanged (compiled as pebble_app_main()).
+ */
+
+#define HOST_SCREEN_WIDTH 144
+#define HOST_SCREEN_HEIGHT 168
+#define HOST_DEFAULT_EPOCH 1700000000
+#define HOST_DEFAULT_LINK_LATENCY_MS 60
+
+typedef struct {
+  uint32_t wakeups;
+  uint32_t clicks;
+  uint32_t ticks;
+  uint32_t timer_firings;
+  uint32_t service_events;
+  uint32_t render_passes;
+  uint32_t layer_redraws;
+  uint64_t dirty_area;
+  uint32_t draw_ops;
+  uint64_t pixels_drawn;
+  uint32_t flash_writes;
+  uint32_t flash_bytes;
+  uint32_t flash_reads;
+  uint32_t flash_lookups;
+  uint32_t msgs_out;
+  uint32_t bytes_out;
+  uint32_t msgs_out_failed;
+  uint32_t msgs_in;
+  uint32_t bytes_in;
+  uint32_t msgs_in_dropped;
+  uint32_t data_log_items;
+  uint32_t data_log_bytes;
+  uint32_t glance_reloads;
+  uint32_t layers_created;
+  uint32_t animated_pushes;
+  uint32_t app_message_opens;
+} HostCounters;
+
+typedef void (*HostScenario)(void *context);
+typedef void (*HostCallback)(void *context);
+typedef void (*HostOutboxHandler)(const uint8_t *data, uint16_t size, void *context);
+typedef void (*HostInboxResultHandler)(AppMessageResult result, const uint8_t *data,
+  uint16_t size, void *context);
+typedef void (*HostWindowHandler)(Window *window);
+typedef void (*HostDataLoggingHandler)(uint32_t tag, const uint8_t *data, uint32_t num_items,
+  uint16_t item_length, void *context);
+
+/**
+ * Run the app's main() with the given scenario as its event loop.
+ */
+int host_run_app(HostScenario scenario, void *context);
+
+/**
+ * Forget all windows, timers, subscriptions, storage and counters.
+ */
+void host_reset(void);
+/**
+ * Forget all windows, timers, subscriptions and counters but keep the
+ * storage, as the watch does between two launches of the app.
+ */
+void host_restart(void);
+void host_reset_counters(void);
+const HostCounters *host_counters(void);
+/**
+ * Counters as they were when the app's first frame was rendered, and when
+ * that was: the work done before the user sees anything.
+ */
+const HostCounters *host_first_frame_counters(void);
+int64_t host_first_frame_ms(void);
+void host_set_log_level(uint8_t log_level);
+
+/**
+ * Virtual clock
+ */
+void host_set_time(time_t epoch, uint16_t ms);
+int64_t host_now_ms(void);
+void host_advance(uint32_t ms);
+void host_schedule(uint32_t delay_ms, HostCallback callback, void *context);
+bool host_app_exited(void);
+
+/**
+ * Called after a window's unload handler, whatever removed the window.
+ */
+void host_set_window_unloaded_handler(HostWindowHandler handler);
+
+/**
+ * Input and system events
+ */
+void host_click(ButtonId button_id);
+void host_long_click(ButtonId button_id);
+void host_multi_click(ButtonId button_id, uint8_t count);
+void host_set_connected(bool connected);
+void host_set_battery(uint8_t charge_percent, bool is_charging);
+
+/**
+ * Phone side of the AppMessage link. Outbound messages are handed to the
+ * outbox handler after the link latency and acknowledged after twice that.
+ *
+ * The inbox size maximum stands in for the platform's
+ * app_message_inbox_size_maximum(), to be set before the app runs.
+ * Inbound messages are queued in the inbox as long as they fit; each takes
+ * the app the inbox processing time, 0 (the default) delivers them right
+ * away. A message that does not fit is dropped with APP_MSG_BUSY, or with
+ * APP_MSG_BUFFER_OVERFLOW when larger than the whole inbox. Messages sent
+ * with host_send_to_watch() are ACKed or NACKed to the inbox result handler
+ * after twice the link latency.
+ */
+void host_set_link_latency_ms(uint32_t latency_ms);
+void host_set_outbox_handler(HostOutboxHandler handler, void *context);
+void host_set_inbox_size_maximum(uint32_t size);
+void host_set_inbox_processing_ms(uint32_t processing_ms);
+void host_set_inbox_result_handler(HostInboxResultHandler handler, void *context);
+bool host_deliver_inbox(const uint8_t *data, uint16_t size);
+AppMessageResult host_deliver_inbox_result(const uint8_t *data, uint16_t size);
+void host_send_to_watch(const uint8_t *data, uint16_t size);
+
+/**
+ * Phone side of data logging. Logged items are handed to the handler right
+ * away, as if the system delivered them; data_logging_log() answers with the
+ * set result (DATA_LOGGING_SUCCESS by default) and hands nothing over
+ * otherwise.
+ */
+void host_set_data_logging_handler(HostDataLoggingHandler handler, void *context);
+void host_set_data_logging_result(DataLoggingResult result);
+
+/**
+ * Subtitle of the first slice of the last app glance reload, "" before any.
+ */
+const char *host_glance_subtitle(void);
@@ -0,0 +1,347 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Inbound burst benchmark.
+ *
+ * A stand-in phone pushes bursts of score updates to the app, as it does
+ * when the other team's referee scores quickly. The app takes the inbox
+ * processing time for every message, so a burst piles up in its inbox and
+ * whatever does not fit is dropped and NACKed. The phone answers the app's
+ * HELLO, sends the packed score, holds off for as long as a BACKOFF says and
+ * resends the latest score when a message was NACKed.
+ *
+ * An update is lost when no message with it, or a later score, made it into
+ * the app. The converge time runs from the last update of a burst until the
+ * phone has the ACK for it. With --legacy the phone ignores the HELLO and
+ * never resends, as the version 1 phone does. --inbox-max caps the inbox
+ * the platform allows the app.
+ *
+ * Usage: inbox_bench [--bursts N] [--burst-size N] [--burst-gap-ms N]
+ *                    [--processing-ms N] [--inbox-max N] [--link-ms N]
+ *                    [--legacy] [--csv] [--verbose]
+ */
+
+#include <getopt.h>
+#include "host.h"
+#include "protocol.h"
+#include "link_caps.h"
+
+
+#define MAX_BURSTS 1024
+/**
+ * score_1 counts the updates, within the app's MAX_SCORE.
+ */
+#define MAX_UPDATES 999
+#define BURST_SETTLE_MS 5000
+#define PHONE_RETRY_MS 100
+#define PHONE_INBOX_SIZE 512
+
+typedef struct {
+  uint16_t bursts;
+  uint8_t burst_size;
+  uint16_t burst_gap_ms;
+  bool is_legacy;
+
+  bool is_hello_answered;
+  /**
+   * The latest score of the phone, score_1 counts the updates.
+   */
+  uint16_t sent_seq;
+  uint16_t acked_seq;
+  int64_t last_update_ms;
+  int64_t hold_until_ms;
+  bool is_resend_scheduled;
+
+  uint32_t updates;
+  uint32_t messages;
+  uint32_t acked;
+  uint32_t nacked[2];
+  uint32_t resends;
+  uint32_t backoffs;
+  uint32_t max_retry_after_ms;
+  uint32_t lost;
+  uint32_t converge_ms[MAX_BURSTS];
+  uint32_t converged;
+} Bench;
+
+static void phone_send_hello() {
+  DictionaryIterator iter;
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_HELLO);
+  dict_write_uint8(&iter, RECEIVE_HELLO_VERSION_KEY, PROTOCOL_VERSION);
+  dict_write_uint32(&iter, RECEIVE_HELLO_COMMANDS_KEY,
+    (1 << RECEIVE_CMD_SET_SCORE_VAL) | (1 << RECEIVE_CMD_HELLO));
+  dict_write_uint16(&iter, RECEIVE_HELLO_INBOX_SIZE_KEY, PHONE_INBOX_SIZE);
+  dict_write_uint32(&iter, RECEIVE_HELLO_FEATURES_KEY,
+    PROTOCOL_FEATURE_PACKED_SCORE | PROTOCOL_FEATURE_BACKOFF);
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+/**
+ * The latest score, packed once the app has answered the HELLO.
+ */
+static void phone_send_score(Bench *bench) {
+  DictionaryIterator iter;
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_SET_SCORE_VAL);
+
+  if (bench->is_hello_answered) {
+    uint8_t packed[PACKED_SCORE_SIZE];
+    link_caps_write_packed_score(packed, bench->sent_seq, 0, host_now_ms());
+    dict_write_data(&iter, RECEIVE_PACKED_SCORE_KEY, packed, sizeof(packed));
+  } else {
+    int64_t now_ms = host_now_ms();
+    dict_write_uint16(&iter, RECEIVE_SCORE_1_KEY, bench->sent_seq);
+    dict_write_uint16(&iter, RECEIVE_SCORE_2_KEY, 0);
+    dict_write_uint32(&iter, RECEIVE_TIMESTAMP_KEY, (uint32_t)(now_ms / 1000));
+    dict_write_uint16(&iter, RECEIVE_TIMESTAMP_MS_KEY, (uint16_t)(now_ms % 1000));
+  }
+
+  bench->messages++;
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+static void phone_resend(void *context) {
+  Bench *bench = context;
+  bench->is_resend_scheduled = false;
+
+  if (bench->acked_seq < bench->sent_seq) {
+    bench->resends++;
+    phone_send_score(bench);
+  }
+}
+
+/**
+ * Resend the latest score once the hold-off is over, at most one pending.
+ */
+static void schedule_resend(Bench *bench, uint32_t delay_ms) {
+  if (bench->is_resend_scheduled) {
+    return;
+  }
+
+  int64_t at_ms = host_now_ms() + delay_ms;
+  if (at_ms < bench->hold_until_ms) {
+    at_ms = bench->hold_until_ms;
+  }
+  bench->is_resend_scheduled = true;
+  host_schedule((uint32_t)(at_ms - host_now_ms()), phone_resend, bench);
+}
+
+static void phone_update(Bench *bench) {
+  bench->sent_seq++;
+  bench->updates++;
+  bench->last_update_ms = host_now_ms();
+
+  if (host_now_ms() < bench->hold_until_ms) {
+    // Held off, the resend carries this update too.
+    schedule_resend(bench, 0);
+  } else {
+    phone_send_score(bench);
+  }
+}
+
+static void phone_outbox_handler(const uint8_t *data, uint16_t size, void *context) {
+  Bench *bench = context;
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, data, size);
+
+  Tuple *cmd_tuple = dict_find(&iter, SEND_CMD_KEY);
+  if (cmd_tuple == NULL || bench->is_legacy) {
+    return;
+  }
+
+  if (cmd_tuple->value->uint8 == SEND_CMD_HELLO) {
+    bench->is_hello_answered = true;
+    phone_send_hello();
+  } else if (cmd_tuple->value->uint8 == SEND_CMD_BACKOFF) {
+    Tuple *retry_after_tuple = dict_find(&iter, SEND_RETRY_AFTER_MS_KEY);
+    uint32_t retry_after_ms = retry_after_tuple != NULL ? retry_after_tuple->value->uint16 : 0;
+
+    bench->backoffs++;
+    bench->hold_until_ms = host_now_ms() + retry_after_ms;
+    if (retry_after_ms > bench->max_retry_after_ms) {
+      bench->max_retry_after_ms = retry_after_ms;
+    }
+  }
+}
+
+static uint16_t message_seq(const uint8_t *data, uint16_t size) {
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, data, size);
+
+  Tuple *cmd_tuple = dict_find(&iter, RECEIVE_CMD_KEY);
+  if (cmd_tuple == NULL || cmd_tuple->value->uint8 != RECEIVE_CMD_SET_SCORE_VAL) {
+    return 0;
+  }
+
+  Tuple *packed_tuple = dict_find(&iter, RECEIVE_PACKED_SCORE_KEY);
+  if (packed_tuple != NULL) {
+    uint16_t score_1;
+    uint16_t score_2;
+    int64_t timestamp_ms;
+    link_caps_read_packed_score(packed_tuple->value->data, &score_1, &score_2, &timestamp_ms);
+    return score_1;
+  }
+
+  Tuple *score1_tuple = dict_find(&iter, RECEIVE_SCORE_1_KEY);
+  return score1_tuple != NULL ? score1_tuple->value->uint16 : 0;
+}
+
+static void phone_inbox_result(AppMessageResult result, const uint8_t *data, uint16_t size,
+  void *context) {
+
+  Bench *bench = context;
+  uint16_t seq = message_seq(data, size);
+  if (seq == 0) {
+    return;
+  }
+
+  if (result == APP_MSG_OK) {
+    bench->acked++;
+    if (seq > bench->acked_seq) {
+      bench->acked_seq = seq;
+      if (seq == bench->sent_seq && bench->converged < MAX_BURSTS) {
+        bench->converge_ms[bench->converged++] = (uint32_t)(host_now_ms() - bench->last_update_ms);
+      }
+    }
+    return;
+  }
+
+  bench->nacked[result == APP_MSG_BUSY ? 0 : 1]++;
+  if (!bench->is_legacy) {
+    schedule_resend(bench, PHONE_RETRY_MS);
+  }
+}
+
+static void run_bench(void *context) {
+  Bench *bench = context;
+
+  // Let the HELLO exchange and the first sync go by.
+  host_advance(BURST_SETTLE_MS);
+
+  for (uint16_t i = 0; i < bench->bursts; i++) {
+    for (uint8_t j = 0; j < bench->burst_size; j++) {
+      phone_update(bench);
+      host_advance(bench->burst_gap_ms);
+    }
+    host_advance(BURST_SETTLE_MS);
+
+    bench->lost += bench->sent_seq - bench->acked_seq;
+    // Lost updates are not waited for in the next burst.
+    bench->acked_seq = bench->sent_seq;
+  }
+}
+
+static int compare_uint32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void print_report(Bench *bench, bool is_csv) {
+  qsort(bench->converge_ms, bench->converged, sizeof(uint32_t), compare_uint32);
+  uint32_t p50 = bench->converged > 0 ? bench->converge_ms[(bench->converged - 1) / 2] : 0;
+  uint32_t max = bench->converged > 0 ? bench->converge_ms[bench->converged - 1] : 0;
+  const HostCounters *counters = host_counters();
+
+  if (is_csv) {
+    printf("updates,messages,acked,dropped_busy,dropped_other,resends,backoffs,"
+      "max_retry_after_ms,lost,converge_p50_ms,converge_max_ms,wakeups\n");
+    printf("%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", bench->updates, bench->messages,
+      bench->acked, bench->nacked[0], bench->nacked[1], bench->resends, bench->backoffs,
+      bench->max_retry_after_ms, bench->lost, p50, max, counters->wakeups);
+    return;
+  }
+
+  printf("Updates:   %u in %u bursts, %u messages, %u acked\n", bench->updates,
+    bench->bursts, bench->messages, bench->acked);
+  printf("Dropped:   %u busy, %u other\n", bench->nacked[0], bench->nacked[1]);
+  printf("Recovery:  %u resends, %u backoffs, retry after up to %u ms\n", bench->resends,
+    bench->backoffs, bench->max_retry_after_ms);
+  printf("Lost:      %u updates\n", bench->lost);
+  printf("Converge:  p50 %u ms, max %u ms\n", p50, max);
+  printf("Wakeups:   %u\n", counters->wakeups);
+}
+
+int main(int argc, char *argv[]) {
+  static Bench bench = { .bursts = 50, .burst_size = 10, .burst_gap_ms = 10 };
+  uint32_t processing_ms = 40;
+  uint32_t inbox_max = 0;
+  uint32_t link_ms = HOST_DEFAULT_LINK_LATENCY_MS;
+  bool is_csv = false;
+
+  static const struct option options[] = {
+    { "bursts", required_argument, NULL, 'b' },
+    { "burst-size", required_argument, NULL, 'n' },
+    { "burst-gap-ms", required_argument, NULL, 'g' },
+    { "processing-ms", required_argument, NULL, 'p' },
+    { "inbox-max", required_argument, NULL, 'i' },
+    { "link-ms", required_argument, NULL, 'l' },
+    { "legacy", no_argument, NULL, 'o' },
+    { "csv", no_argument, NULL, 'x' },
+    { "verbose", no_argument, NULL, 'v' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "b:n:g:p:i:l:oxv", options, NULL)) != -1) {
+    switch (opt) {
+      case 'b':
+        bench.bursts = (uint16_t)atoi(optarg);
+        break;
+      case 'n':
+        bench.burst_size = (uint8_t)atoi(optarg);
+        break;
+      case 'g':
+        bench.burst_gap_ms = (uint16_t)atoi(optarg);
+        break;
+      case 'p':
+        processing_ms = (uint32_t)atoi(optarg);
+        break;
+      case 'i':
+        inbox_max = (uint32_t)atoi(optarg);
+        break;
+      case 'l':
+        link_ms = (uint32_t)atoi(optarg);
+        break;
+      case 'o':
+        bench.is_legacy = true;
+        break;
+      case 'x':
+        is_csv = true;
+        break;
+      case 'v':
+        host_set_log_level(APP_LOG_LEVEL_DEBUG_VERBOSE);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [--bursts N] [--burst-size N] [--burst-gap-ms N] "
+          "[--processing-ms N] [--inbox-max N] [--link-ms N] [--legacy] [--csv] [--verbose]\n",
+          argv[0]);
+        return 2;
+    }
+  }
+  if (bench.burst_size == 0 || bench.bursts > MAX_BURSTS
+    || (uint32_t)bench.bursts * bench.burst_size > MAX_UPDATES) {
+
+    fprintf(stderr, "The burst size has to be positive, at most %d bursts "
+      "and %d updates\n", MAX_BURSTS, MAX_UPDATES);
+    return 2;
+  }
+
+  if (inbox_max > 0) {
+    host_set_inbox_size_maximum(inbox_max);
+  }
+  host_set_link_latency_ms(link_ms);
+  host_set_inbox_processing_ms(processing_ms);
+  host_set_outbox_handler(phone_outbox_handler, &bench);
+  host_set_inbox_result_handler(phone_inbox_result, &bench);
+  host_run_app(run_bench, &bench);
+
+  print_report(&bench, is_csv);
+
+  return 0;
+}
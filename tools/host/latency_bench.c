@@ -0,0 +1,458 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * End-to-end latency benchmark.
+ *
+ * Measures the time from a button press on the watch to the new score on the
+ * Score Counter display. The app runs on the host harness, its messages go
+ * through a stand-in for the phone bridge to a stand-in display, which
+ * timestamps their arrival. The display expects the score in its own
+ * orientation, so it applies the same swap rules as the app: the score is
+ * swapped for a player with the Score Counter on the right and for a referee
+ * on the same side as the Score Counter. A score shown the other way round
+ * counts as a mismatch.
+ *
+ * Every user role and Score Counter position is measured for single presses
+ * and for bursts of quick presses. A press is done once the display shows a
+ * score that includes it; presses the display never gets to see within
+ * PRESS_TIMEOUT_MS are lost. Time is virtual: the latency is made of the
+ * watch link latency, the bridge and the display hop, plus whatever the app
+ * defers or retries, not the CPU time of the handlers.
+ *
+ * The bridge answers the app's HELLO and takes the packed score, unless
+ * --legacy makes it a phone of the version 1 protocol.
+ *
+ * Usage: latency_bench [--presses N] [--bursts N] [--burst-size N] [--burst-gap-ms N]
+ *                      [--link-ms N] [--legacy] [--seed N] [--csv] [--verbose]
+ */
+
+#include <getopt.h>
+#include "host.h"
+#include "protocol.h"
+#include "clock_sync.h"
+#include "link_caps.h"
+
+
+#define MAX_PRESSES 2048
+#define PRESS_TIMEOUT_MS 5000
+#define SETTLE_MS 3000
+#define BRIDGE_MIN_MS 5
+#define BRIDGE_JITTER_MS 20
+#define DISPLAY_HOP_MIN_MS 15
+#define DISPLAY_HOP_JITTER_MS 45
+#define BRIDGE_INBOX_SIZE 512
+
+typedef enum {
+  PRESS_SINGLE,
+  PRESS_BURST,
+  PRESS_MODE_COUNT
+} PressMode;
+
+/**
+ * The Score Counter positions in the SETTING_MODE order, UP goes to the next.
+ */
+typedef enum {
+  LAYOUT_PLAYER_LEFT,
+  LAYOUT_REFEREE_OPPOSITE,
+  LAYOUT_PLAYER_RIGHT,
+  LAYOUT_REFEREE_SAME,
+  LAYOUT_COUNT
+} Layout;
+
+typedef struct {
+  int64_t pressed_ms;
+  uint16_t display_1;
+  uint16_t display_2;
+  bool is_done;
+} Press;
+
+typedef struct {
+  uint32_t samples_ms[MAX_PRESSES];
+  uint32_t count;
+  uint32_t lost;
+  uint32_t mismatched;
+} LatencyStats;
+
+typedef struct {
+  uint32_t rng;
+  uint16_t presses;
+  uint16_t bursts;
+  uint8_t burst_size;
+  uint16_t burst_gap_ms;
+  bool is_legacy;
+
+  Layout layout;
+  /**
+   * Score on the watch, in its own orientation.
+   */
+  uint16_t score_1;
+  uint16_t score_2;
+  Press pending[MAX_PRESSES];
+  uint16_t pending_count;
+  LatencyStats stats[LAYOUT_COUNT][PRESS_MODE_COUNT];
+  LatencyStats *current;
+} Bench;
+
+typedef struct {
+  Bench *bench;
+  uint16_t score_1;
+  uint16_t score_2;
+} DisplayUpdate;
+
+static const char *layout_names[LAYOUT_COUNT] = {
+  [LAYOUT_PLAYER_LEFT] = "player/left",
+  [LAYOUT_REFEREE_OPPOSITE] = "referee/opposite",
+  [LAYOUT_PLAYER_RIGHT] = "player/right",
+  [LAYOUT_REFEREE_SAME] = "referee/same",
+};
+
+static const char *mode_names[PRESS_MODE_COUNT] = {
+  [PRESS_SINGLE] = "single",
+  [PRESS_BURST] = "burst",
+};
+
+static uint32_t next_random(Bench *bench, uint32_t bound) {
+  // xorshift32
+  bench->rng ^= bench->rng << 13;
+  bench->rng ^= bench->rng >> 17;
+  bench->rng ^= bench->rng << 5;
+  return bench->rng % bound;
+}
+
+static bool is_referee(Layout layout) {
+  return layout == LAYOUT_REFEREE_OPPOSITE || layout == LAYOUT_REFEREE_SAME;
+}
+
+/**
+ * The same rule as should_swap_before_send_or_after_receive() in NORMAL_MODE.
+ */
+static bool is_swapped_on_display(Layout layout) {
+  return layout == LAYOUT_PLAYER_RIGHT || layout == LAYOUT_REFEREE_SAME;
+}
+
+/**
+ * The display shows the score, once whatever the bench still waits for is in.
+ */
+static void display_show(void *context) {
+  DisplayUpdate *update = context;
+  Bench *bench = update->bench;
+  int64_t now_ms = host_now_ms();
+
+  for (uint16_t i = 0; i < bench->pending_count; i++) {
+    Press *press = &bench->pending[i];
+    if (press->is_done || bench->current == NULL) {
+      continue;
+    }
+    if (update->score_1 >= press->display_1 && update->score_2 >= press->display_2) {
+      press->is_done = true;
+      bench->current->samples_ms[bench->current->count++] = (uint32_t)(now_ms - press->pressed_ms);
+    } else if (update->score_1 > press->display_1 || update->score_2 > press->display_2) {
+      // Ahead on one side, behind on the other: shown the other way round.
+      press->is_done = true;
+      bench->current->mismatched++;
+    }
+  }
+
+  free(update);
+}
+
+static void bridge_send_hello() {
+  DictionaryIterator iter;
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_HELLO);
+  dict_write_uint8(&iter, RECEIVE_HELLO_VERSION_KEY, PROTOCOL_VERSION);
+  dict_write_uint32(&iter, RECEIVE_HELLO_COMMANDS_KEY,
+    (1 << RECEIVE_CMD_SET_SCORE_VAL) | (1 << RECEIVE_CMD_PONG) | (1 << RECEIVE_CMD_HELLO));
+  dict_write_uint16(&iter, RECEIVE_HELLO_INBOX_SIZE_KEY, BRIDGE_INBOX_SIZE);
+  dict_write_uint32(&iter, RECEIVE_HELLO_FEATURES_KEY, PROTOCOL_FEATURE_BATCH
+    | PROTOCOL_FEATURE_PING | PROTOCOL_FEATURE_PACKED_SCORE);
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+/**
+ * The bridge answers hellos and pings and passes SET and SYNC on to the
+ * display, after its own processing time and the hop to the display.
+ */
+static void bridge_outbox_handler(const uint8_t *data, uint16_t size, void *context) {
+  Bench *bench = context;
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, data, size);
+
+  Tuple *cmd_tuple = dict_find(&iter, SEND_CMD_KEY);
+  if (cmd_tuple == NULL) {
+    return;
+  }
+
+  if (cmd_tuple->value->uint8 == SEND_CMD_HELLO) {
+    if (!bench->is_legacy) {
+      bridge_send_hello();
+    }
+    return;
+  }
+
+  if (cmd_tuple->value->uint8 == SEND_CMD_PING) {
+    Tuple *t0_tuple = dict_find(&iter, SEND_PING_T0_KEY);
+    if (t0_tuple == NULL) {
+      return;
+    }
+
+    uint8_t t_bytes[CLOCK_SYNC_TIMESTAMP_SIZE];
+    uint8_t buff[64];
+    dict_write_begin(&iter, buff, sizeof(buff));
+    dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_PONG);
+    dict_write_data(&iter, RECEIVE_PING_T0_KEY, t0_tuple->value->data, t0_tuple->length);
+    clock_sync_write_timestamp(host_now_ms(), t_bytes);
+    dict_write_data(&iter, RECEIVE_PONG_T1_KEY, t_bytes, sizeof(t_bytes));
+    dict_write_data(&iter, RECEIVE_PONG_T2_KEY, t_bytes, sizeof(t_bytes));
+    host_send_to_watch(buff, dict_write_end(&iter));
+    return;
+  }
+
+  uint16_t score_1;
+  uint16_t score_2;
+  Tuple *packed_tuple = dict_find(&iter, SEND_PACKED_SCORE_KEY);
+  Tuple *score1_tuple = dict_find(&iter, SEND_SCORE_1_KEY);
+  Tuple *score2_tuple = dict_find(&iter, SEND_SCORE_2_KEY);
+
+  if (packed_tuple != NULL && packed_tuple->length == PACKED_SCORE_SIZE) {
+    int64_t timestamp_ms;
+    link_caps_read_packed_score(packed_tuple->value->data, &score_1, &score_2, &timestamp_ms);
+  } else if (score1_tuple != NULL && score2_tuple != NULL) {
+    score_1 = score1_tuple->value->uint16;
+    score_2 = score2_tuple->value->uint16;
+  } else {
+    return;
+  }
+
+  DisplayUpdate *update = malloc(sizeof(DisplayUpdate));
+  update->bench = bench;
+  update->score_1 = score_1;
+  update->score_2 = score_2;
+
+  uint32_t delay_ms = BRIDGE_MIN_MS + next_random(bench, BRIDGE_JITTER_MS + 1)
+    + DISPLAY_HOP_MIN_MS + next_random(bench, DISPLAY_HOP_JITTER_MS + 1);
+  host_schedule(delay_ms, display_show, update);
+}
+
+/**
+ * UP adds to the opponent of a player and to score_1 of a referee,
+ * DOWN the other way round.
+ */
+static void press(Bench *bench, ButtonId button_id) {
+  bool is_up = button_id == BUTTON_ID_UP;
+
+  if (is_up != is_referee(bench->layout)) {
+    bench->score_2++;
+  } else {
+    bench->score_1++;
+  }
+
+  Press *press = &bench->pending[bench->pending_count++];
+  press->pressed_ms = host_now_ms();
+  press->is_done = false;
+  if (is_swapped_on_display(bench->layout)) {
+    press->display_1 = bench->score_2;
+    press->display_2 = bench->score_1;
+  } else {
+    press->display_1 = bench->score_1;
+    press->display_2 = bench->score_2;
+  }
+
+  host_click(button_id);
+}
+
+/**
+ * Wait for the presses in flight, the ones not shown until then are lost.
+ */
+static void settle(Bench *bench) {
+  host_advance(PRESS_TIMEOUT_MS);
+
+  for (uint16_t i = 0; i < bench->pending_count; i++) {
+    if (!bench->pending[i].is_done) {
+      bench->current->lost++;
+    }
+  }
+  bench->pending_count = 0;
+}
+
+/**
+ * Through SETTING_MODE to the layout, then a fresh score.
+ */
+static void switch_layout(Bench *bench, Layout layout) {
+  bench->current = NULL;
+
+  host_click(BUTTON_ID_BACK);
+  host_advance(500);
+  for (uint8_t i = 0; i < (layout - bench->layout + LAYOUT_COUNT) % LAYOUT_COUNT; i++) {
+    host_click(BUTTON_ID_UP);
+    host_advance(300);
+  }
+  host_click(BUTTON_ID_SELECT);
+  host_advance(SETTLE_MS);
+
+  host_long_click(BUTTON_ID_SELECT);
+  host_advance(SETTLE_MS);
+
+  bench->layout = layout;
+  bench->score_1 = 0;
+  bench->score_2 = 0;
+}
+
+static ButtonId random_button(Bench *bench) {
+  return next_random(bench, 2) == 0 ? BUTTON_ID_UP : BUTTON_ID_DOWN;
+}
+
+static void run_single_presses(Bench *bench) {
+  bench->current = &bench->stats[bench->layout][PRESS_SINGLE];
+
+  for (uint16_t i = 0; i < bench->presses; i++) {
+    press(bench, random_button(bench));
+    host_advance(1000 + next_random(bench, 2000));
+
+    if (bench->pending_count == MAX_PRESSES) {
+      settle(bench);
+    }
+  }
+  settle(bench);
+}
+
+static void run_bursts(Bench *bench) {
+  bench->current = &bench->stats[bench->layout][PRESS_BURST];
+
+  for (uint16_t i = 0; i < bench->bursts; i++) {
+    ButtonId button_id = random_button(bench);
+
+    for (uint8_t j = 0; j < bench->burst_size; j++) {
+      press(bench, button_id);
+      host_advance(bench->burst_gap_ms);
+    }
+    settle(bench);
+  }
+}
+
+static void run_bench(void *context) {
+  Bench *bench = context;
+
+  // Let the first clock sync probe go by.
+  host_advance(SETTLE_MS);
+
+  for (Layout layout = 0; layout < LAYOUT_COUNT; layout++) {
+    switch_layout(bench, layout);
+    run_single_presses(bench);
+
+    switch_layout(bench, layout);
+    run_bursts(bench);
+  }
+}
+
+static int compare_uint32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(const LatencyStats *stats, uint8_t percent) {
+  if (stats->count == 0) {
+    return 0;
+  }
+  return stats->samples_ms[(stats->count - 1) * percent / 100];
+}
+
+static void print_report(Bench *bench, bool is_csv) {
+  if (is_csv) {
+    printf("layout,mode,presses,p50_ms,p90_ms,p99_ms,max_ms,lost,mismatched\n");
+  } else {
+    printf("%-17s %-7s %7s %7s %7s %7s %7s %5s %10s\n", "layout", "mode", "presses",
+      "p50 ms", "p90 ms", "p99 ms", "max ms", "lost", "mismatched");
+  }
+
+  for (Layout layout = 0; layout < LAYOUT_COUNT; layout++) {
+    for (PressMode mode = 0; mode < PRESS_MODE_COUNT; mode++) {
+      LatencyStats *stats = &bench->stats[layout][mode];
+      qsort(stats->samples_ms, stats->count, sizeof(uint32_t), compare_uint32);
+
+      uint32_t presses = stats->count + stats->lost + stats->mismatched;
+      uint32_t max = stats->count > 0 ? stats->samples_ms[stats->count - 1] : 0;
+      printf(is_csv ? "%s,%s,%u,%u,%u,%u,%u,%u,%u\n"
+        : "%-17s %-7s %7u %7u %7u %7u %7u %5u %10u\n",
+        layout_names[layout], mode_names[mode], presses, percentile(stats, 50),
+        percentile(stats, 90), percentile(stats, 99), max, stats->lost, stats->mismatched);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  static Bench bench = {
+    .rng = 1, .presses = 200, .bursts = 40, .burst_size = 5, .burst_gap_ms = 80
+  };
+  uint32_t link_ms = HOST_DEFAULT_LINK_LATENCY_MS;
+  bool is_csv = false;
+
+  static const struct option options[] = {
+    { "presses", required_argument, NULL, 'p' },
+    { "bursts", required_argument, NULL, 'b' },
+    { "burst-size", required_argument, NULL, 'n' },
+    { "burst-gap-ms", required_argument, NULL, 'g' },
+    { "link-ms", required_argument, NULL, 'l' },
+    { "legacy", no_argument, NULL, 'o' },
+    { "seed", required_argument, NULL, 'r' },
+    { "csv", no_argument, NULL, 'x' },
+    { "verbose", no_argument, NULL, 'v' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:b:n:g:l:or:xv", options, NULL)) != -1) {
+    switch (opt) {
+      case 'p':
+        bench.presses = (uint16_t)atoi(optarg);
+        break;
+      case 'b':
+        bench.bursts = (uint16_t)atoi(optarg);
+        break;
+      case 'n':
+        bench.burst_size = (uint8_t)atoi(optarg);
+        break;
+      case 'g':
+        bench.burst_gap_ms = (uint16_t)atoi(optarg);
+        break;
+      case 'l':
+        link_ms = (uint32_t)atoi(optarg);
+        break;
+      case 'o':
+        bench.is_legacy = true;
+        break;
+      case 'r':
+        bench.rng = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'x':
+        is_csv = true;
+        break;
+      case 'v':
+        host_set_log_level(APP_LOG_LEVEL_DEBUG_VERBOSE);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [--presses N] [--bursts N] [--burst-size N] "
+          "[--burst-gap-ms N] [--link-ms N] [--legacy] [--seed N] [--csv] [--verbose]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (bench.rng == 0 || bench.burst_size == 0 || bench.burst_size > MAX_PRESSES
+    || bench.presses > MAX_PRESSES || (uint32_t)bench.bursts * bench.burst_size > MAX_PRESSES) {
+
+    fprintf(stderr, "The seed and burst size have to be positive, at most %d presses "
+      "per mode\n", MAX_PRESSES);
+    return 2;
+  }
+
+  host_set_link_latency_ms(link_ms);
+  host_set_outbox_handler(bridge_outbox_handler, &bench);
+  host_run_app(run_bench, &bench);
+
+  print_report(&bench, is_csv);
+
+  return 0;
+}
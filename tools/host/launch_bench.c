@@ -0,0 +1,251 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Cold-start benchmark.
+ *
+ * A first run of the app scores a few points, swaps the score and changes
+ * the Score Counter position, so the storage holds what a real match leaves
+ * behind. The app is then launched again on the same storage, and the work
+ * done before its first frame is counted: storage lookups and reads, layers
+ * created, AppMessage opened and whether the window slides in animated.
+ * Weighted by a per-platform cost table, the counts estimate the time to
+ * the first score on screen. The costs are rough defaults meant to compare
+ * builds with each other, not measurements; override them with
+ * --cost name=value.
+ *
+ * Also reported is the work done after the first frame, until the app
+ * has said HELLO to the phone, so work moved out of the way of the first
+ * frame is not mistaken for work saved.
+ *
+ * Usage: launch_bench [--points N] [--cost name=value] [--csv] [--verbose]
+ */
+
+#include <getopt.h>
+#include "host.h"
+#include "protocol.h"
+
+
+#define SETTLE_MS 5000
+
+typedef enum {
+  COST_FLASH_LOOKUP,
+  COST_FLASH_READ,
+  COST_LAYER,
+  COST_RENDER,
+  COST_APP_MESSAGE_OPEN,
+  COST_PUSH_ANIMATION,
+  COST_COUNT
+} CostId;
+
+typedef struct {
+  const char *name;
+  const char *unit;
+  double ms_per_unit;
+} Cost;
+
+/**
+ * Default time cost per unit, in milliseconds. Aplite has the slowest CPU
+ * and flash, diorite the fastest flash of the black & white platforms.
+ */
+#if defined(HOST_PLATFORM_APLITE)
+static Cost s_costs[COST_COUNT] = {
+  [COST_FLASH_LOOKUP] = { "flash_lookup", "lookup", 1.5 },
+  [COST_FLASH_READ] = { "flash_read", "read", 2.0 },
+  [COST_LAYER] = { "layer", "layer", 0.15 },
+  [COST_RENDER] = { "render", "pass", 12.0 },
+  [COST_APP_MESSAGE_OPEN] = { "app_msg_open", "open", 4.0 },
+  [COST_PUSH_ANIMATION] = { "push_anim", "push", 250.0 },
+};
+#elif defined(HOST_PLATFORM_BW)
+static Cost s_costs[COST_COUNT] = {
+  [COST_FLASH_LOOKUP] = { "flash_lookup", "lookup", 0.6 },
+  [COST_FLASH_READ] = { "flash_read", "read", 0.8 },
+  [COST_LAYER] = { "layer", "layer", 0.05 },
+  [COST_RENDER] = { "render", "pass", 6.0 },
+  [COST_APP_MESSAGE_OPEN] = { "app_msg_open", "open", 2.0 },
+  [COST_PUSH_ANIMATION] = { "push_anim", "push", 250.0 },
+};
+#else
+static Cost s_costs[COST_COUNT] = {
+  [COST_FLASH_LOOKUP] = { "flash_lookup", "lookup", 1.0 },
+  [COST_FLASH_READ] = { "flash_read", "read", 1.4 },
+  [COST_LAYER] = { "layer", "layer", 0.08 },
+  [COST_RENDER] = { "render", "pass", 9.0 },
+  [COST_APP_MESSAGE_OPEN] = { "app_msg_open", "open", 3.0 },
+  [COST_PUSH_ANIMATION] = { "push_anim", "push", 250.0 },
+};
+#endif
+
+typedef struct {
+  uint16_t points;
+  int64_t hello_ms;
+  HostCounters first_frame;
+  HostCounters launched;
+} Bench;
+
+static void phone_outbox_handler(const uint8_t *data, uint16_t size, void *context) {
+  Bench *bench = context;
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, data, size);
+
+  Tuple *cmd_tuple = dict_find(&iter, SEND_CMD_KEY);
+  if (cmd_tuple != NULL && cmd_tuple->value->uint8 == SEND_CMD_HELLO && bench->hello_ms < 0) {
+    bench->hello_ms = host_now_ms();
+    bench->launched = *host_counters();
+  }
+}
+
+/**
+ * A match under way: points for both teams, a swap and the Score Counter
+ * moved to the right edge in the setting mode.
+ */
+static void play_first_run(void *context) {
+  Bench *bench = context;
+
+  host_advance(SETTLE_MS);
+  for (uint16_t i = 0; i < bench->points; i++) {
+    host_click(i % 3 == 2 ? BUTTON_ID_DOWN : BUTTON_ID_UP);
+    host_advance(4000);
+  }
+  host_multi_click(BUTTON_ID_SELECT, 2);
+  host_advance(1000);
+
+  host_long_click(BUTTON_ID_SELECT);
+  host_click(BUTTON_ID_DOWN);
+  host_click(BUTTON_ID_SELECT);
+  host_advance(SETTLE_MS);
+}
+
+static void run_cold_start(void *context) {
+  Bench *bench = context;
+
+  bench->first_frame = *host_first_frame_counters();
+  host_advance(SETTLE_MS);
+}
+
+static bool set_cost(const char *name, double ms_per_unit) {
+  for (int i = 0; i < COST_COUNT; i++) {
+    if (strcmp(s_costs[i].name, name) == 0) {
+      s_costs[i].ms_per_unit = ms_per_unit;
+      return true;
+    }
+  }
+  fprintf(stderr, "Unknown cost '%s'\n", name);
+  return false;
+}
+
+static bool parse_cost(const char *assignment) {
+  char name[32];
+  double value;
+
+  if (sscanf(assignment, " %31[a-z_] = %lf", name, &value) != 2) {
+    fprintf(stderr, "Invalid cost '%s', expected name=value\n", assignment);
+    return false;
+  }
+  return set_cost(name, value);
+}
+
+static void counts_from(const HostCounters *counters, double counts[COST_COUNT]) {
+  counts[COST_FLASH_LOOKUP] = counters->flash_lookups;
+  counts[COST_FLASH_READ] = counters->flash_reads;
+  counts[COST_LAYER] = counters->layers_created;
+  counts[COST_RENDER] = counters->render_passes;
+  counts[COST_APP_MESSAGE_OPEN] = counters->app_message_opens;
+  counts[COST_PUSH_ANIMATION] = counters->animated_pushes;
+}
+
+static double estimate_ms(const HostCounters *counters) {
+  double counts[COST_COUNT];
+  double total_ms = 0;
+
+  counts_from(counters, counts);
+  for (int i = 0; i < COST_COUNT; i++) {
+    total_ms += counts[i] * s_costs[i].ms_per_unit;
+  }
+
+  return total_ms;
+}
+
+static void print_report(const Bench *bench, bool is_csv) {
+  double first_counts[COST_COUNT];
+  double launched_counts[COST_COUNT];
+  double first_ms = estimate_ms(&bench->first_frame);
+
+  counts_from(&bench->first_frame, first_counts);
+  counts_from(&bench->launched, launched_counts);
+
+  if (is_csv) {
+    printf("lookups,reads,layers,app_msg_opens,animated_pushes,first_score_ms,"
+      "launched_lookups,launched_reads,hello_after_ms\n");
+    printf("%u,%u,%u,%u,%u,%.1f,%u,%u,%lld\n", bench->first_frame.flash_lookups,
+      bench->first_frame.flash_reads, bench->first_frame.layers_created,
+      bench->first_frame.app_message_opens, bench->first_frame.animated_pushes, first_ms,
+      bench->launched.flash_lookups, bench->launched.flash_reads,
+      (long long)(bench->hello_ms - host_first_frame_ms()));
+    return;
+  }
+
+  printf("Cold start after %u points\n\n", bench->points);
+  printf("%-14s %8s %8s %-8s %10s\n", "cost", "first", "launched", "unit", "ms/unit");
+  for (int i = 0; i < COST_COUNT; i++) {
+    printf("%-14s %8.0f %8.0f %-8s %10.2f\n", s_costs[i].name, first_counts[i],
+      launched_counts[i], s_costs[i].unit, s_costs[i].ms_per_unit);
+  }
+  printf("\nTime to first score: %.1f ms (estimated)\n", first_ms);
+  if (bench->hello_ms >= 0) {
+    printf("HELLO to the phone:  %lld ms after the first frame\n",
+      (long long)(bench->hello_ms - host_first_frame_ms()));
+  } else {
+    printf("HELLO to the phone:  never\n");
+  }
+}
+
+int main(int argc, char *argv[]) {
+  static Bench bench = { .points = 12, .hello_ms = -1 };
+  bool is_csv = false;
+
+  static const struct option options[] = {
+    { "points", required_argument, NULL, 'p' },
+    { "cost", required_argument, NULL, 'c' },
+    { "csv", no_argument, NULL, 'x' },
+    { "verbose", no_argument, NULL, 'v' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:c:xv", options, NULL)) != -1) {
+    switch (opt) {
+      case 'p':
+        bench.points = (uint16_t)atoi(optarg);
+        break;
+      case 'c':
+        if (!parse_cost(optarg)) {
+          return 2;
+        }
+        break;
+      case 'x':
+        is_csv = true;
+        break;
+      case 'v':
+        host_set_log_level(APP_LOG_LEVEL_DEBUG_VERBOSE);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [--points N] [--cost name=value] [--csv] [--verbose]\n",
+          argv[0]);
+        return 2;
+    }
+  }
+
+  host_run_app(play_first_run, &bench);
+
+  // The second launch starts from the storage the first one left.
+  host_restart();
+  host_set_outbox_handler(phone_outbox_handler, &bench);
+  host_run_app(run_cold_start, &bench);
+
+  print_report(&bench, is_csv);
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Leak check.
+ *
+ * Drives the app (built with the allocation tracking shim, see alloc_track.h)
+ * through every layout and mode switch many times: SETTING_MODE entered,
+ * cycled through all positions, swapped, confirmed or cancelled, player and
+ * referee layouts, score changes and the stats window. It fails when an
+ * object outlives its window or the app, when objects created at one call
+ * site keep piling up over the cycles, or on a double or mismatched destroy.
+ *
+ * Usage: leak_check [--cycles N] [--verbose]
+ */
+
+#include <getopt.h>
+#include "host.h"
+#include "alloc_track.h"
+
+
+#define STEP_MS 300
+
+typedef struct {
+  uint32_t cycles;
+  uint32_t live_after_warmup;
+  uint32_t live_after_cycles;
+} LeakCheck;
+
+static void press(ButtonId button_id) {
+  host_click(button_id);
+  host_advance(STEP_MS);
+}
+
+static void cycle_layouts() {
+  // All SETTING_MODE positions, a swap and back, confirmed.
+  press(BUTTON_ID_BACK);
+  for (int i = 0; i < 4; i++) {
+    press(BUTTON_ID_UP);
+  }
+  press(BUTTON_ID_DOWN);
+  press(BUTTON_ID_DOWN);
+  press(BUTTON_ID_SELECT);
+
+  // Over to the referee layout and back to the player one.
+  press(BUTTON_ID_BACK);
+  press(BUTTON_ID_UP);
+  press(BUTTON_ID_SELECT);
+  press(BUTTON_ID_BACK);
+  for (int i = 0; i < 3; i++) {
+    press(BUTTON_ID_UP);
+  }
+  press(BUTTON_ID_SELECT);
+
+  // SETTING_MODE cancelled with a pending swap.
+  press(BUTTON_ID_BACK);
+  press(BUTTON_ID_UP);
+  press(BUTTON_ID_DOWN);
+  press(BUTTON_ID_BACK);
+}
+
+static void cycle_scoring() {
+  press(BUTTON_ID_UP);
+  press(BUTTON_ID_DOWN);
+  host_long_click(BUTTON_ID_UP);
+  host_advance(1500);
+
+  host_multi_click(BUTTON_ID_SELECT, 2);
+  host_advance(2500);
+  press(BUTTON_ID_BACK);
+
+  host_long_click(BUTTON_ID_SELECT);
+  host_advance(1500);
+}
+
+static void run_scenario(void *context) {
+  LeakCheck *check = context;
+
+  // The first cycle creates whatever is created lazily once.
+  cycle_layouts();
+  cycle_scoring();
+
+  AllocSnapshot warmed_up;
+  alloc_track_snapshot(&warmed_up);
+  check->live_after_warmup = alloc_track_live_count();
+
+  for (uint32_t i = 0; i < check->cycles; i++) {
+    cycle_layouts();
+    cycle_scoring();
+  }
+
+  check->live_after_cycles = alloc_track_live_count();
+  alloc_track_check_growth(&warmed_up, check->cycles);
+
+  printf("Live objects after %u cycles:\n", check->cycles);
+  alloc_track_print_live(stdout);
+}
+
+int main(int argc, char *argv[]) {
+  LeakCheck check = { .cycles = 25 };
+
+  static const struct option options[] = {
+    { "cycles", required_argument, NULL, 'c' },
+    { "verbose", no_argument, NULL, 'v' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "c:v", options, NULL)) != -1) {
+    switch (opt) {
+      case 'c':
+        check.cycles = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'v':
+        host_set_log_level(APP_LOG_LEVEL_DEBUG_VERBOSE);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [--cycles N] [--verbose]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  alloc_track_init();
+  host_run_app(run_scenario, &check);
+  alloc_track_check_exit();
+
+  printf("Live objects: %u after warm-up, %u after %u cycles; peak heap %u bytes\n",
+    check.live_after_warmup, check.live_after_cycles, check.cycles,
+    alloc_track_peak_heap_bytes());
+
+  uint32_t violations = alloc_track_violations();
+  if (violations > 0) {
+    printf("FAILED: %u violations\n", violations);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Legacy link check.
+ *
+ * A version 1 phone never answers the app's HELLO. Once the HELLO times out,
+ * the app has to stick to the legacy protocol: just SET and SYNC with the
+ * keys of version 1, no BATCH, PING or any other optional feature, however
+ * long the link stays up and whatever was scored while it was down. Points
+ * are scored on the watch with the link up and down, and the stand-in phone
+ * keeps the score the app sends it. It fails on anything but HELLO, SET and
+ * SYNC or on an optional key, and when the phone ends up with another score
+ * than the watch.
+ *
+ * Usage: link_check [--cycles N] [--verbose]
+ */
+
+#include <getopt.h>
+#include "host.h"
+#include "protocol.h"
+
+
+#define STEP_MS 300
+#define UP_MS 60000
+#define DOWN_MS 10000
+
+typedef struct {
+  uint16_t cycles;
+
+  uint16_t score_1;
+  uint16_t score_2;
+  uint32_t points;
+
+  uint32_t hellos;
+  uint32_t sets;
+  uint32_t syncs;
+  uint32_t violations;
+} LinkCheck;
+
+static const uint32_t s_optional_keys[] = {
+  SEND_STATS_KEY, SEND_BATCH_KEY, SEND_PING_T0_KEY, SEND_PACKED_SCORE_KEY,
+  SEND_RETRY_AFTER_MS_KEY, SEND_DROPPED_KEY, SEND_SCORE_CRDT_KEY, SEND_SPORT_KEY
+};
+
+static void fail(LinkCheck *check, const char *what, int value) {
+  printf("Legacy phone got %s %d\n", what, value);
+  check->violations++;
+}
+
+static void phone_outbox_handler(const uint8_t *data, uint16_t size, void *context) {
+  LinkCheck *check = context;
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, data, size);
+
+  Tuple *cmd_tuple = dict_find(&iter, SEND_CMD_KEY);
+  if (cmd_tuple == NULL) {
+    fail(check, "a message without command, size", size);
+    return;
+  }
+
+  uint8_t cmd = cmd_tuple->value->uint8;
+  switch (cmd) {
+    case SEND_CMD_HELLO:
+      // Never answered.
+      check->hellos++;
+      return;
+    case SEND_CMD_SET_SCORE_VAL:
+    case SEND_CMD_SYNC_SCORE_VAL: {
+      cmd == SEND_CMD_SET_SCORE_VAL ? check->sets++ : check->syncs++;
+      Tuple *score1_tuple = dict_find(&iter, SEND_SCORE_1_KEY);
+      Tuple *score2_tuple = dict_find(&iter, SEND_SCORE_2_KEY);
+      if (score1_tuple == NULL || score2_tuple == NULL) {
+        fail(check, "a score without the score keys, command", cmd);
+        return;
+      }
+      check->score_1 = score1_tuple->value->uint16;
+      check->score_2 = score2_tuple->value->uint16;
+      break;
+    }
+    default:
+      fail(check, "command", cmd);
+      return;
+  }
+
+  for (size_t i = 0; i < sizeof(s_optional_keys) / sizeof(s_optional_keys[0]); i++) {
+    if (dict_find(&iter, s_optional_keys[i]) != NULL) {
+      fail(check, "key", (int)s_optional_keys[i]);
+    }
+  }
+}
+
+static void score_point(LinkCheck *check) {
+  host_click(check->points % 2 == 0 ? BUTTON_ID_UP : BUTTON_ID_DOWN);
+  check->points++;
+  host_advance(STEP_MS);
+}
+
+static void run_check(void *context) {
+  LinkCheck *check = context;
+
+  for (uint16_t i = 0; i < check->cycles; i++) {
+    // Past the HELLO timeout and the clock sync probes.
+    host_advance(UP_MS / 2);
+    score_point(check);
+    host_advance(UP_MS / 2);
+
+    // Several changes recorded offline, replayed on reconnecting.
+    host_set_connected(false);
+    host_advance(DOWN_MS / 2);
+    for (int j = 0; j < 3; j++) {
+      score_point(check);
+    }
+    host_advance(DOWN_MS / 2);
+    host_set_connected(true);
+  }
+
+  host_advance(UP_MS);
+}
+
+int main(int argc, char *argv[]) {
+  static LinkCheck check = { .cycles = 5 };
+
+  static const struct option options[] = {
+    { "cycles", required_argument, NULL, 'c' },
+    { "verbose", no_argument, NULL, 'v' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "c:v", options, NULL)) != -1) {
+    switch (opt) {
+      case 'c':
+        check.cycles = (uint16_t)atoi(optarg);
+        break;
+      case 'v':
+        host_set_log_level(APP_LOG_LEVEL_DEBUG_VERBOSE);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [--cycles N] [--verbose]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  host_set_outbox_handler(phone_outbox_handler, &check);
+  host_run_app(run_check, &check);
+
+  printf("Reconnects: %u, %u points scored\n", check.cycles, check.points);
+  printf("Watch sent: %u hellos, %u sets, %u syncs\n", check.hellos, check.sets,
+    check.syncs);
+  printf("Phone:      %u:%u\n", check.score_1, check.score_2);
+
+  if (check.score_1 + check.score_2 != check.points) {
+    printf("Legacy phone diverged from the watch\n");
+    check.violations++;
+  }
+  if (check.violations > 0) {
+    printf("FAILED: %u violations\n", check.violations);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,975 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Load generator.
+ *
+ * Runs many simulated watches against a local stand-in relay (the phone
+ * shared by the watches of one court), to see how the protocol scales with
+ * the number of watches. The watches speak the app's AppMessage dictionaries
+ * with the DictSendKey/DictReceiveKey keys, decode what they receive with the
+ * app's inbox decoder and keep their clock in sync with the app's ClockSync.
+ *
+ * Each watch has its own TCP connection to the relay and a skewed clock.
+ * The watches are spread over a pool of worker threads, each serving its
+ * share with poll(). A watch pings the relay, then keeps scoring points at
+ * random for the duration of the run, sending SET with its score. The relay
+ * keeps the last written score of every court (by the timestamp in the
+ * shared timeline) and forwards an accepted SET to the whole court, the
+ * sender included as the acknowledgement. A rejected one is answered with
+ * the court score.
+ *
+ * With --crdt the watches send their PN-counter state with the score
+ * instead, as the app does when the phone shares SCORE_CRDT. The relay
+ * merges it into the court state and forwards the merged state to the whole
+ * court, nothing is rejected.
+ *
+ * For every instance count, reported are the scoring throughput, the tail
+ * latency of a score from one watch to the others, the time all the
+ * courts take to converge once the scoring stops and the points the
+ * converged scores miss.
+ *
+ * Usage: load_gen [--instances N,N,...] [--workers N] [--court-size N]
+ *                 [--rate POINTS_PER_S] [--seconds N] [--seed N] [--crdt] [--csv]
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "pebble.h"
+#include "protocol.h"
+#include "clock_sync.h"
+#include "inbox_decoder.h"
+#include "pn_counter.h"
+
+
+#define MAX_INSTANCE_COUNTS 16
+#define MAX_SCORE 999
+#define MAX_CLOCK_SKEW_MS 2000
+#define PING_INTERVAL_MS 1000
+#define WARM_UP_MS 300
+#define CONVERGE_TIMEOUT_MS 10000
+#define POLL_SLICE_MS 5
+#define DICT_BUFF_SIZE 192
+#define CONN_BUFF_SIZE 2048
+
+/**
+ * Every dictionary travels over the relay socket in an envelope. The origin
+ * watch and time are not part of the protocol, they are there to measure
+ * the latency.
+ */
+typedef struct __attribute__((__packed__)) {
+  uint16_t size;
+  uint16_t watch;
+  int64_t origin_ns;
+} Envelope;
+
+typedef struct {
+  int fd;
+  uint16_t len;
+  uint8_t buff[CONN_BUFF_SIZE];
+} Conn;
+
+typedef struct {
+  uint16_t id;
+  Conn conn;
+  int32_t skew_ms;
+  uint16_t score_1;
+  uint16_t score_2;
+  /**
+   * Packed score_1 << 16 | score_2, read by the main thread.
+   */
+  atomic_uint shown_score;
+  int64_t next_point_ns;
+  int64_t next_ping_ns;
+  ClockSync clock_sync;
+  InboxDecoder decoder;
+  PnCounter crdt;
+  uint32_t rng;
+} SimWatch;
+
+typedef struct {
+  /**
+   * Packed score_1 << 16 | score_2, read by the main thread.
+   */
+  atomic_uint score;
+  int64_t timestamp_ms;
+  uint16_t watch;
+  PnCounter crdt;
+  /**
+   * Points scored on the court's watches per team, modulo the score range.
+   */
+  atomic_uint scored[PN_COUNTER_TEAMS];
+} Court;
+
+typedef struct {
+  uint32_t *samples_us;
+  uint32_t count;
+  uint32_t capacity;
+} Latencies;
+
+typedef struct {
+  struct LoadRun *run;
+  uint16_t first_watch;
+  uint16_t watch_count;
+  Latencies latencies;
+  uint32_t points;
+  pthread_t thread;
+} Worker;
+
+typedef struct LoadRun {
+  uint16_t instances;
+  uint16_t court_size;
+  uint16_t worker_count;
+  double rate;
+  uint32_t seconds;
+  uint32_t seed;
+  bool is_crdt;
+
+  int listen_fd;
+  uint16_t port;
+  SimWatch *watches;
+  Court *courts;
+  Conn *relay_conns;
+  int *watch_fds;
+  Worker *workers;
+
+  atomic_bool is_scoring;
+  atomic_bool is_stopping;
+  atomic_uint registered;
+  atomic_uint frames_relayed;
+} LoadRun;
+
+typedef struct {
+  uint16_t instances;
+  double points_per_s;
+  double frames_per_s;
+  double p50_ms;
+  double p99_ms;
+  double p999_ms;
+  double max_ms;
+  int64_t converge_ms;
+  uint32_t lost_points;
+  double rtt_ms;
+} LoadResult;
+
+
+static int64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * The relay clock is the shared timeline.
+ */
+static int64_t relay_now_ms() {
+  return now_ns() / 1000000;
+}
+
+static int64_t watch_now_ms(const SimWatch *watch) {
+  return relay_now_ms() + watch->skew_ms;
+}
+
+static uint32_t next_random(uint32_t *rng, uint32_t bound) {
+  // xorshift32
+  uint32_t x = *rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *rng = x;
+  return x % bound;
+}
+
+/**
+ * Exponentially distributed gap between the points of one watch.
+ */
+static int64_t next_point_gap_ns(SimWatch *watch, double rate) {
+  double u = (next_random(&watch->rng, 1000000) + 1) / 1000001.0;
+  return (int64_t)(-log(u) / rate * 1e9);
+}
+
+static inline uint32_t pack_score(uint16_t score_1, uint16_t score_2) {
+  return (uint32_t)score_1 << 16 | score_2;
+}
+
+static void write_crdt(DictionaryIterator *iter, uint32_t key, const PnCounter *crdt) {
+  uint8_t wire[PN_COUNTER_WIRE_MAX_SIZE];
+  uint16_t size = pn_counter_write_wire(crdt, wire, sizeof(wire));
+
+  Tuplet crdt_tuplet = TupletBytes(key, wire, size);
+  dict_write_tuplet(iter, &crdt_tuplet);
+}
+
+static void latencies_add(Latencies *latencies, uint32_t sample_us) {
+  if (latencies->count == latencies->capacity) {
+    latencies->capacity = latencies->capacity > 0 ? 2 * latencies->capacity : 1024;
+    latencies->samples_us = realloc(latencies->samples_us,
+      latencies->capacity * sizeof(uint32_t));
+  }
+  latencies->samples_us[latencies->count++] = sample_us;
+}
+
+static int compare_uint32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static double percentile_ms(const Latencies *latencies, double percentile) {
+  if (latencies->count == 0) {
+    return 0;
+  }
+  uint32_t i = (uint32_t)(percentile / 100 * (latencies->count - 1) + 0.5);
+  return latencies->samples_us[i] / 1000.0;
+}
+
+/**
+ * Blocking send of one enveloped dictionary.
+ */
+static bool send_frame(int fd, uint16_t watch, int64_t origin_ns,
+  const uint8_t *dict, uint16_t size) {
+
+  uint8_t frame[sizeof(Envelope) + DICT_BUFF_SIZE];
+  Envelope envelope = { .size = size, .watch = watch, .origin_ns = origin_ns };
+
+  memcpy(frame, &envelope, sizeof(envelope));
+  memcpy(frame + sizeof(envelope), dict, size);
+
+  size_t total = sizeof(envelope) + size;
+  size_t sent = 0;
+  while (sent < total) {
+    ssize_t n = send(fd, frame + sent, total - sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    sent += (size_t)n;
+  }
+  return true;
+}
+
+typedef void (*FrameHandler)(void *context, const Envelope *envelope,
+  DictionaryIterator *iter);
+
+/**
+ * Read what is available on the connection and hand over the complete frames.
+ * Return false when the peer has gone.
+ */
+static bool conn_receive(Conn *conn, FrameHandler handler, void *context) {
+  ssize_t n = recv(conn->fd, conn->buff + conn->len, sizeof(conn->buff) - conn->len, 0);
+  if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN)) {
+    return false;
+  }
+  if (n > 0) {
+    conn->len += (uint16_t)n;
+  }
+
+  uint16_t offset = 0;
+  while (conn->len - offset >= (int)sizeof(Envelope)) {
+    Envelope envelope;
+    memcpy(&envelope, conn->buff + offset, sizeof(envelope));
+    if (envelope.size > DICT_BUFF_SIZE) {
+      fprintf(stderr, "Malformed frame of %u bytes\n", envelope.size);
+      return false;
+    }
+    if (conn->len - offset < (int)(sizeof(envelope) + envelope.size)) {
+      break;
+    }
+
+    // The dictionary is copied out to keep the tuples aligned the way the
+    // firmware delivers them.
+    uint8_t dict[DICT_BUFF_SIZE];
+    memcpy(dict, conn->buff + offset + sizeof(envelope), envelope.size);
+
+    DictionaryIterator iter;
+    dict_read_begin_from_buffer(&iter, dict, envelope.size);
+    handler(context, &envelope, &iter);
+
+    offset += sizeof(envelope) + envelope.size;
+  }
+
+  memmove(conn->buff, conn->buff + offset, conn->len - offset);
+  conn->len -= offset;
+  return true;
+}
+
+
+/**
+ * Relay
+ */
+
+static void relay_send_score(LoadRun *run, uint16_t to_watch, const Court *court,
+  const Envelope *origin) {
+
+  uint32_t packed = atomic_load(&court->score);
+  Tuplet cmd_tuplet = TupletInteger(RECEIVE_CMD_KEY, (uint8_t)RECEIVE_CMD_SET_SCORE_VAL);
+  Tuplet score1_tuplet = TupletInteger(RECEIVE_SCORE_1_KEY, (uint16_t)(packed >> 16));
+  Tuplet score2_tuplet = TupletInteger(RECEIVE_SCORE_2_KEY, (uint16_t)(packed & 0xFFFF));
+  Tuplet timestamp_tuplet = TupletInteger(RECEIVE_TIMESTAMP_KEY,
+    (uint32_t)(court->timestamp_ms / 1000));
+  Tuplet timestamp_ms_tuplet = TupletInteger(RECEIVE_TIMESTAMP_MS_KEY,
+    (uint16_t)(court->timestamp_ms % 1000));
+
+  uint8_t dict[DICT_BUFF_SIZE];
+  DictionaryIterator iter;
+  dict_write_begin(&iter, dict, sizeof(dict));
+  dict_write_tuplet(&iter, &cmd_tuplet);
+  dict_write_tuplet(&iter, &score1_tuplet);
+  dict_write_tuplet(&iter, &score2_tuplet);
+  dict_write_tuplet(&iter, &timestamp_tuplet);
+  dict_write_tuplet(&iter, &timestamp_ms_tuplet);
+  if (run->is_crdt) {
+    write_crdt(&iter, RECEIVE_SCORE_CRDT_KEY, &court->crdt);
+  }
+  uint32_t size = dict_write_end(&iter);
+
+  if (send_frame(run->watch_fds[to_watch], origin->watch, origin->origin_ns, dict,
+    (uint16_t)size)) {
+
+    atomic_fetch_add(&run->frames_relayed, 1);
+  }
+}
+
+static void relay_send_pong(LoadRun *run, uint16_t to_watch, const Tuple *t0_tuple,
+  int64_t t1) {
+
+  uint8_t t1_bytes[CLOCK_SYNC_TIMESTAMP_SIZE];
+  uint8_t t2_bytes[CLOCK_SYNC_TIMESTAMP_SIZE];
+  clock_sync_write_timestamp(t1, t1_bytes);
+  clock_sync_write_timestamp(relay_now_ms(), t2_bytes);
+
+  Tuplet cmd_tuplet = TupletInteger(RECEIVE_CMD_KEY, (uint8_t)RECEIVE_CMD_PONG);
+  Tuplet t0_tuplet = TupletBytes(RECEIVE_PING_T0_KEY, t0_tuple->value->data, t0_tuple->length);
+  Tuplet t1_tuplet = TupletBytes(RECEIVE_PONG_T1_KEY, t1_bytes, sizeof(t1_bytes));
+  Tuplet t2_tuplet = TupletBytes(RECEIVE_PONG_T2_KEY, t2_bytes, sizeof(t2_bytes));
+
+  uint8_t dict[DICT_BUFF_SIZE];
+  DictionaryIterator iter;
+  dict_write_begin(&iter, dict, sizeof(dict));
+  dict_write_tuplet(&iter, &cmd_tuplet);
+  dict_write_tuplet(&iter, &t0_tuplet);
+  dict_write_tuplet(&iter, &t1_tuplet);
+  dict_write_tuplet(&iter, &t2_tuplet);
+  uint32_t size = dict_write_end(&iter);
+
+  send_frame(run->watch_fds[to_watch], to_watch, now_ns(), dict, (uint16_t)size);
+}
+
+/**
+ * SET and SYNC carry the watch score. With --crdt, the CRDT state is merged
+ * into the court's. Otherwise, the later one in the shared timeline
+ * wins (ties broken by the watch id) and goes to the whole court, the sender
+ * of an outdated score gets the court score back. The sender needs its own
+ * score back too: an older score forwarded to it may have overwritten it
+ * meanwhile.
+ */
+static void relay_handle_score(LoadRun *run, const Envelope *envelope,
+  DictionaryIterator *iter) {
+
+  Tuple *score1_tuple = dict_find(iter, SEND_SCORE_1_KEY);
+  Tuple *score2_tuple = dict_find(iter, SEND_SCORE_2_KEY);
+  Tuple *timestamp_tuple = dict_find(iter, SEND_TIMESTAMP_KEY);
+  Tuple *timestamp_ms_tuple = dict_find(iter, SEND_TIMESTAMP_MS_KEY);
+  if (score1_tuple == NULL || score2_tuple == NULL || timestamp_tuple == NULL) {
+    return;
+  }
+
+  int64_t timestamp_ms = (int64_t)timestamp_tuple->value->uint32 * 1000
+    + (timestamp_ms_tuple != NULL ? timestamp_ms_tuple->value->uint16 : 0);
+
+  uint16_t court_index = envelope->watch / run->court_size;
+  Court *court = &run->courts[court_index];
+  uint16_t score_1 = score1_tuple->value->uint16;
+  uint16_t score_2 = score2_tuple->value->uint16;
+
+  Tuple *crdt_tuple = dict_find(iter, SEND_SCORE_CRDT_KEY);
+  if (run->is_crdt && crdt_tuple != NULL) {
+    // Merged, so there is nothing outdated to reject.
+    pn_counter_merge_wire(&court->crdt, crdt_tuple->value->data, crdt_tuple->length);
+    score_1 = pn_counter_value(&court->crdt, 0);
+    score_2 = pn_counter_value(&court->crdt, 1);
+  } else if (timestamp_ms < court->timestamp_ms
+    || (timestamp_ms == court->timestamp_ms && envelope->watch <= court->watch)) {
+
+    relay_send_score(run, envelope->watch, court, envelope);
+    return;
+  }
+
+  atomic_store(&court->score, pack_score(score_1, score_2));
+  court->timestamp_ms = timestamp_ms;
+  court->watch = envelope->watch;
+
+  uint16_t first = court_index * run->court_size;
+  for (uint16_t i = first; i < first + run->court_size && i < run->instances; i++) {
+    relay_send_score(run, i, court, envelope);
+  }
+}
+
+static void relay_handle_frame(void *context, const Envelope *envelope,
+  DictionaryIterator *iter) {
+
+  LoadRun *run = context;
+  int64_t received_ms = relay_now_ms();
+
+  Tuple *cmd_tuple = dict_find(iter, SEND_CMD_KEY);
+  if (cmd_tuple == NULL || envelope->watch >= run->instances) {
+    return;
+  }
+
+  switch (cmd_tuple->value->uint8) {
+    case SEND_CMD_SYNC_SCORE_VAL:
+      // The first thing a watch sends after connecting.
+      atomic_fetch_add(&run->registered, 1);
+      relay_handle_score(run, envelope, iter);
+      break;
+    case SEND_CMD_SET_SCORE_VAL:
+      relay_handle_score(run, envelope, iter);
+      break;
+    case SEND_CMD_PING: {
+      Tuple *t0_tuple = dict_find(iter, SEND_PING_T0_KEY);
+      if (t0_tuple != NULL && t0_tuple->length == CLOCK_SYNC_TIMESTAMP_SIZE) {
+        relay_send_pong(run, envelope->watch, t0_tuple, received_ms);
+      }
+      break;
+    }
+  }
+}
+
+static void *relay_thread(void *context) {
+  LoadRun *run = context;
+  struct pollfd *fds = calloc(run->instances, sizeof(struct pollfd));
+
+  for (uint16_t i = 0; i < run->instances; i++) {
+    fds[i] = (struct pollfd) { .fd = run->relay_conns[i].fd, .events = POLLIN };
+  }
+
+  while (!atomic_load(&run->is_stopping)) {
+    int ready = poll(fds, run->instances, POLL_SLICE_MS);
+    for (uint16_t i = 0; i < run->instances && ready > 0; i++) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      ready--;
+      if (!conn_receive(&run->relay_conns[i], relay_handle_frame, run)) {
+        fds[i].fd = -1;
+      }
+    }
+  }
+
+  free(fds);
+  return NULL;
+}
+
+
+/**
+ * Simulated watch
+ */
+
+static void watch_send(SimWatch *watch, DictionaryIterator *iter, uint8_t *dict) {
+  uint32_t size = dict_write_end(iter);
+  send_frame(watch->conn.fd, watch->id, now_ns(), dict, (uint16_t)size);
+}
+
+/**
+ * Same dictionary as the app's send_msg().
+ */
+static void watch_send_score(SimWatch *watch, DictSendCmdVal cmd_val, int64_t local_ms,
+  bool is_crdt) {
+
+  int64_t timestamp_ms = local_ms > 0
+    ? clock_sync_local_to_shared_ms(&watch->clock_sync, local_ms) : 0;
+
+  Tuplet cmd_tuplet = TupletInteger(SEND_CMD_KEY, (uint8_t)cmd_val);
+  Tuplet score1_tuplet = TupletInteger(SEND_SCORE_1_KEY, watch->score_1);
+  Tuplet score2_tuplet = TupletInteger(SEND_SCORE_2_KEY, watch->score_2);
+  Tuplet timestamp_tuplet = TupletInteger(SEND_TIMESTAMP_KEY,
+    (unsigned int)(timestamp_ms / 1000));
+  Tuplet timestamp_ms_tuplet = TupletInteger(SEND_TIMESTAMP_MS_KEY,
+    (uint16_t)(timestamp_ms % 1000));
+
+  uint8_t dict[DICT_BUFF_SIZE];
+  DictionaryIterator iter;
+  dict_write_begin(&iter, dict, sizeof(dict));
+  dict_write_tuplet(&iter, &cmd_tuplet);
+  dict_write_tuplet(&iter, &score1_tuplet);
+  dict_write_tuplet(&iter, &score2_tuplet);
+  dict_write_tuplet(&iter, &timestamp_tuplet);
+  dict_write_tuplet(&iter, &timestamp_ms_tuplet);
+  if (is_crdt) {
+    write_crdt(&iter, SEND_SCORE_CRDT_KEY, &watch->crdt);
+  }
+  watch_send(watch, &iter, dict);
+}
+
+static void watch_send_ping(SimWatch *watch) {
+  int64_t t0 = watch_now_ms(watch);
+  uint8_t t0_bytes[CLOCK_SYNC_TIMESTAMP_SIZE];
+  clock_sync_write_timestamp(t0, t0_bytes);
+
+  Tuplet cmd_tuplet = TupletInteger(SEND_CMD_KEY, (uint8_t)SEND_CMD_PING);
+  Tuplet t0_tuplet = TupletBytes(SEND_PING_T0_KEY, t0_bytes, sizeof(t0_bytes));
+
+  uint8_t dict[DICT_BUFF_SIZE];
+  DictionaryIterator iter;
+  dict_write_begin(&iter, dict, sizeof(dict));
+  dict_write_tuplet(&iter, &cmd_tuplet);
+  dict_write_tuplet(&iter, &t0_tuplet);
+  watch_send(watch, &iter, dict);
+
+  clock_sync_on_probe_sent(&watch->clock_sync, t0);
+}
+
+/**
+ * A point scored on this watch, UP or DOWN click in NORMAL_MODE.
+ */
+static void watch_score_point(LoadRun *run, SimWatch *watch) {
+  uint8_t team = (uint8_t)next_random(&watch->rng, 2);
+  if (team == 0) {
+    watch->score_1 = watch->score_1 < MAX_SCORE ? watch->score_1 + 1 : 0;
+  } else {
+    watch->score_2 = watch->score_2 < MAX_SCORE ? watch->score_2 + 1 : 0;
+  }
+  atomic_store(&watch->shown_score, pack_score(watch->score_1, watch->score_2));
+  atomic_fetch_add(&run->courts[watch->id / run->court_size].scored[team], 1);
+
+  // The device ids of the app are random, any distinct ones will do here.
+  pn_counter_set(&watch->crdt, watch->id + 1u, 0, watch->score_1);
+  pn_counter_set(&watch->crdt, watch->id + 1u, 1, watch->score_2);
+
+  watch_send_score(watch, SEND_CMD_SET_SCORE_VAL, watch_now_ms(watch), run->is_crdt);
+}
+
+typedef struct {
+  Worker *worker;
+  SimWatch *watch;
+} WatchContext;
+
+static void watch_handle_frame(void *context, const Envelope *envelope,
+  DictionaryIterator *iter) {
+
+  WatchContext *watch_context = context;
+  SimWatch *watch = watch_context->watch;
+  InboxCommand command;
+
+  if (inbox_decoder_decode(&watch->decoder, iter, &command) != INBOX_OK) {
+    return;
+  }
+
+  switch (command.cmd) {
+    case RECEIVE_CMD_SET_SCORE_VAL:
+      if (command.fields & INBOX_FIELD_SCORE_CRDT) {
+        pn_counter_merge_wire(&watch->crdt, command.score_crdt, command.score_crdt_size);
+        command.score_1 = pn_counter_value(&watch->crdt, 0);
+        command.score_2 = pn_counter_value(&watch->crdt, 1);
+      }
+      watch->score_1 = command.score_1;
+      watch->score_2 = command.score_2;
+      atomic_store(&watch->shown_score, pack_score(watch->score_1, watch->score_2));
+
+      // Acknowledgements are a round trip, only the scores from the other
+      // watches count.
+      if (envelope->watch != watch->id) {
+        latencies_add(&watch_context->worker->latencies,
+          (uint32_t)((now_ns() - envelope->origin_ns) / 1000));
+      }
+      break;
+    case RECEIVE_CMD_PONG:
+      clock_sync_on_pong(&watch->clock_sync, command.ping_t0, command.pong_t1,
+        command.pong_t2, watch_now_ms(watch));
+      break;
+  }
+}
+
+static void *worker_thread(void *context) {
+  Worker *worker = context;
+  LoadRun *run = worker->run;
+  SimWatch *watches = &run->watches[worker->first_watch];
+  struct pollfd *fds = calloc(worker->watch_count, sizeof(struct pollfd));
+
+  for (uint16_t i = 0; i < worker->watch_count; i++) {
+    fds[i] = (struct pollfd) { .fd = watches[i].conn.fd, .events = POLLIN };
+
+    // As the app does on connecting: sync, then measure the link.
+    watch_send_score(&watches[i], SEND_CMD_SYNC_SCORE_VAL, 0, run->is_crdt);
+    watch_send_ping(&watches[i]);
+    watches[i].next_ping_ns = now_ns() + (int64_t)PING_INTERVAL_MS * 1000000;
+  }
+
+  bool was_scoring = false;
+  while (!atomic_load(&run->is_stopping)) {
+    int ready = poll(fds, worker->watch_count, 1);
+    for (uint16_t i = 0; i < worker->watch_count && ready > 0; i++) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      ready--;
+      WatchContext watch_context = { .worker = worker, .watch = &watches[i] };
+      if (!conn_receive(&watches[i].conn, watch_handle_frame, &watch_context)) {
+        fds[i].fd = -1;
+      }
+    }
+
+    bool is_scoring = atomic_load(&run->is_scoring);
+    int64_t now = now_ns();
+    for (uint16_t i = 0; i < worker->watch_count; i++) {
+      SimWatch *watch = &watches[i];
+
+      if (is_scoring && !was_scoring) {
+        watch->next_point_ns = now + next_point_gap_ns(watch, run->rate);
+      } else if (is_scoring && now >= watch->next_point_ns) {
+        watch_score_point(run, watch);
+        worker->points++;
+        watch->next_point_ns = now + next_point_gap_ns(watch, run->rate);
+      }
+      if (now >= watch->next_ping_ns) {
+        watch_send_ping(watch);
+        watch->next_ping_ns = now + (int64_t)PING_INTERVAL_MS * 1000000;
+      }
+    }
+    was_scoring = is_scoring;
+  }
+
+  free(fds);
+  return NULL;
+}
+
+
+/**
+ * Run
+ */
+
+static bool open_relay_socket(LoadRun *run) {
+  run->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+  socklen_t addr_len = sizeof(addr);
+
+  if (run->listen_fd < 0
+    || bind(run->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+    || listen(run->listen_fd, SOMAXCONN) != 0
+    || getsockname(run->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+
+    perror("relay socket");
+    return false;
+  }
+  run->port = ntohs(addr.sin_port);
+  return true;
+}
+
+/**
+ * Connect every watch and accept it on the relay side. The relay learns the
+ * watch id from the envelope of its first frame.
+ */
+static bool connect_watches(LoadRun *run) {
+  struct sockaddr_in addr = {
+    .sin_family = AF_INET,
+    .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    .sin_port = htons(run->port)
+  };
+  int no_delay = 1;
+
+  for (uint16_t i = 0; i < run->instances; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      perror("watch socket");
+      return false;
+    }
+    int relay_fd = accept(run->listen_fd, NULL, NULL);
+    if (relay_fd < 0) {
+      perror("relay accept");
+      return false;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    setsockopt(relay_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    SimWatch *watch = &run->watches[i];
+    watch->id = i;
+    watch->conn.fd = fd;
+    watch->rng = run->seed * 2654435761u + i + 1;
+    watch->skew_ms = (int32_t)next_random(&watch->rng, 2 * MAX_CLOCK_SKEW_MS + 1)
+      - MAX_CLOCK_SKEW_MS;
+    clock_sync_init(&watch->clock_sync);
+    inbox_decoder_init(&watch->decoder, MAX_SCORE);
+    pn_counter_init(&watch->crdt, MAX_SCORE + 1);
+
+    run->relay_conns[i].fd = relay_fd;
+    run->watch_fds[i] = relay_fd;
+  }
+  return true;
+}
+
+static bool is_converged(LoadRun *run) {
+  for (uint16_t i = 0; i < run->instances; i++) {
+    const Court *court = &run->courts[i / run->court_size];
+    if (atomic_load(&run->watches[i].shown_score) != atomic_load(&court->score)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Points the converged court scores miss, the ones overwritten by a
+ * concurrent score.
+ */
+static uint32_t lost_points(LoadRun *run) {
+  uint16_t court_count = (run->instances + run->court_size - 1) / run->court_size;
+  uint32_t lost = 0;
+
+  for (uint16_t i = 0; i < court_count; i++) {
+    uint32_t packed = atomic_load(&run->courts[i].score);
+    uint16_t scores[PN_COUNTER_TEAMS] = { packed >> 16, packed & 0xFFFF };
+
+    for (uint8_t team = 0; team < PN_COUNTER_TEAMS; team++) {
+      uint32_t scored = atomic_load(&run->courts[i].scored[team]) % (MAX_SCORE + 1);
+      lost += (scored + MAX_SCORE + 1 - scores[team]) % (MAX_SCORE + 1);
+    }
+  }
+  return lost;
+}
+
+static void sleep_ms(uint32_t ms) {
+  struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000 };
+  nanosleep(&ts, NULL);
+}
+
+static bool run_load(LoadRun *run, LoadResult *result) {
+  run->watches = calloc(run->instances, sizeof(SimWatch));
+  uint16_t court_count = (run->instances + run->court_size - 1) / run->court_size;
+  run->courts = calloc(court_count, sizeof(Court));
+  for (uint16_t i = 0; i < court_count; i++) {
+    pn_counter_init(&run->courts[i].crdt, MAX_SCORE + 1);
+  }
+  run->relay_conns = calloc(run->instances, sizeof(Conn));
+  run->watch_fds = calloc(run->instances, sizeof(int));
+  run->workers = calloc(run->worker_count, sizeof(Worker));
+  atomic_init(&run->is_scoring, false);
+  atomic_init(&run->is_stopping, false);
+  atomic_init(&run->registered, 0);
+  atomic_init(&run->frames_relayed, 0);
+
+  if (!open_relay_socket(run) || !connect_watches(run)) {
+    return false;
+  }
+
+  pthread_t relay;
+  pthread_create(&relay, NULL, relay_thread, run);
+
+  uint16_t per_worker = run->instances / run->worker_count;
+  uint16_t extra = run->instances % run->worker_count;
+  uint16_t first = 0;
+  for (uint16_t i = 0; i < run->worker_count; i++) {
+    Worker *worker = &run->workers[i];
+    worker->run = run;
+    worker->first_watch = first;
+    worker->watch_count = per_worker + (i < extra ? 1 : 0);
+    first += worker->watch_count;
+    pthread_create(&worker->thread, NULL, worker_thread, worker);
+  }
+
+  while (atomic_load(&run->registered) < run->instances) {
+    sleep_ms(1);
+  }
+  // Give the first pings time to come back.
+  sleep_ms(WARM_UP_MS);
+
+  uint32_t frames_before = atomic_load(&run->frames_relayed);
+  int64_t start_ns = now_ns();
+  atomic_store(&run->is_scoring, true);
+  sleep_ms(run->seconds * 1000);
+  atomic_store(&run->is_scoring, false);
+  int64_t stop_ns = now_ns();
+  uint32_t frames = atomic_load(&run->frames_relayed) - frames_before;
+
+  result->converge_ms = -1;
+  while (now_ns() - stop_ns < (int64_t)CONVERGE_TIMEOUT_MS * 1000000) {
+    if (is_converged(run)) {
+      result->converge_ms = (now_ns() - stop_ns) / 1000000;
+      break;
+    }
+    sleep_ms(1);
+  }
+  result->lost_points = lost_points(run);
+
+  atomic_store(&run->is_stopping, true);
+  pthread_join(relay, NULL);
+
+  Latencies all = { 0 };
+  uint32_t points = 0;
+  for (uint16_t i = 0; i < run->worker_count; i++) {
+    Worker *worker = &run->workers[i];
+    pthread_join(worker->thread, NULL);
+    points += worker->points;
+    for (uint32_t j = 0; j < worker->latencies.count; j++) {
+      latencies_add(&all, worker->latencies.samples_us[j]);
+    }
+    free(worker->latencies.samples_us);
+  }
+  qsort(all.samples_us, all.count, sizeof(uint32_t), compare_uint32);
+
+  double rtt_sum = 0;
+  for (uint16_t i = 0; i < run->instances; i++) {
+    rtt_sum += run->watches[i].clock_sync.rtt_ms;
+    close(run->watches[i].conn.fd);
+    close(run->relay_conns[i].fd);
+  }
+  close(run->listen_fd);
+
+  double elapsed_s = (stop_ns - start_ns) / 1e9;
+  result->instances = run->instances;
+  result->points_per_s = points / elapsed_s;
+  result->frames_per_s = frames / elapsed_s;
+  result->p50_ms = percentile_ms(&all, 50);
+  result->p99_ms = percentile_ms(&all, 99);
+  result->p999_ms = percentile_ms(&all, 99.9);
+  result->max_ms = all.count > 0 ? all.samples_us[all.count - 1] / 1000.0 : 0;
+  result->rtt_ms = rtt_sum / run->instances;
+
+  free(all.samples_us);
+  free(run->watches);
+  free(run->courts);
+  free(run->relay_conns);
+  free(run->watch_fds);
+  free(run->workers);
+  return true;
+}
+
+static void print_result(const LoadResult *result, bool is_csv) {
+  char converge[16];
+  if (result->converge_ms >= 0) {
+    snprintf(converge, sizeof(converge), "%lld", (long long)result->converge_ms);
+  } else {
+    strcpy(converge, is_csv ? "" : "timeout");
+  }
+
+  if (is_csv) {
+    printf("%u,%.1f,%.1f,%.3f,%.3f,%.3f,%.3f,%s,%u,%.1f\n", result->instances,
+      result->points_per_s, result->frames_per_s, result->p50_ms, result->p99_ms,
+      result->p999_ms, result->max_ms, converge, result->lost_points, result->rtt_ms);
+  } else {
+    printf("%9u %9.1f %9.1f %8.2f %8.2f %8.2f %8.2f %11s %11u %8.1f\n", result->instances,
+      result->points_per_s, result->frames_per_s, result->p50_ms, result->p99_ms,
+      result->p999_ms, result->max_ms, converge, result->lost_points, result->rtt_ms);
+  }
+  fflush(stdout);
+}
+
+static uint8_t parse_instances(const char *list, uint16_t counts[MAX_INSTANCE_COUNTS]) {
+  uint8_t n = 0;
+  const char *cursor = list;
+
+  while (*cursor != '\0' && n < MAX_INSTANCE_COUNTS) {
+    char *end;
+    unsigned long count = strtoul(cursor, &end, 10);
+    if (end == cursor || count == 0 || count > UINT16_MAX) {
+      return 0;
+    }
+    counts[n++] = (uint16_t)count;
+    cursor = *end == ',' ? end + 1 : end;
+  }
+  return n;
+}
+
+int main(int argc, char *argv[]) {
+  uint16_t counts[MAX_INSTANCE_COUNTS] = { 25, 50, 100, 200, 400 };
+  uint8_t count_n = 5;
+  long workers = sysconf(_SC_NPROCESSORS_ONLN);
+  LoadRun settings = { .court_size = 4, .rate = 1.0, .seconds = 5, .seed = 1 };
+  bool is_csv = false;
+
+  static const struct option options[] = {
+    { "instances", required_argument, NULL, 'n' },
+    { "workers", required_argument, NULL, 'w' },
+    { "court-size", required_argument, NULL, 'c' },
+    { "rate", required_argument, NULL, 'r' },
+    { "seconds", required_argument, NULL, 's' },
+    { "seed", required_argument, NULL, 'e' },
+    { "crdt", no_argument, NULL, 'd' },
+    { "csv", no_argument, NULL, 'x' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "n:w:c:r:s:e:dx", options, NULL)) != -1) {
+    switch (opt) {
+      case 'n':
+        count_n = parse_instances(optarg, counts);
+        break;
+      case 'w':
+        workers = atol(optarg);
+        break;
+      case 'c':
+        settings.court_size = (uint16_t)atoi(optarg);
+        break;
+      case 'r':
+        settings.rate = atof(optarg);
+        break;
+      case 's':
+        settings.seconds = (uint32_t)atoi(optarg);
+        break;
+      case 'e':
+        settings.seed = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        settings.is_crdt = true;
+        break;
+      case 'x':
+        is_csv = true;
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [--instances N,N,...] [--workers N] [--court-size N] "
+          "[--rate POINTS_PER_S] [--seconds N] [--seed N] [--crdt] [--csv]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (count_n == 0 || workers <= 0 || settings.court_size == 0 || settings.rate <= 0
+    || settings.seconds == 0) {
+
+    fprintf(stderr, "Instances, workers, court size, rate and seconds have to be positive\n");
+    return 2;
+  }
+  if (settings.is_crdt && settings.court_size > PN_COUNTER_MAX_DEVICES) {
+    fprintf(stderr, "A court shares a score CRDT of at most %u watches\n",
+      PN_COUNTER_MAX_DEVICES);
+    return 2;
+  }
+
+  if (is_csv) {
+    printf("instances,points_per_s,frames_per_s,p50_ms,p99_ms,p999_ms,max_ms,"
+      "converge_ms,lost_points,rtt_ms\n");
+  } else {
+    printf("Courts of %u watches, %.2f points/s per watch, %u s per run, %s scores\n\n",
+      settings.court_size, settings.rate, settings.seconds,
+      settings.is_crdt ? "merged" : "last written");
+    printf("%9s %9s %9s %8s %8s %8s %8s %11s %11s %8s\n", "instances", "points/s",
+      "frames/s", "p50 ms", "p99 ms", "p99.9 ms", "max ms", "converge ms", "lost points",
+      "rtt ms");
+  }
+
+  for (uint8_t i = 0; i < count_n; i++) {
+    LoadRun run = settings;
+    LoadResult result;
+
+    run.instances = counts[i];
+    run.worker_count = (uint16_t)(workers < counts[i] ? workers : counts[i]);
+
+    if (!run_load(&run, &result)) {
+      return 1;
+    }
+    print_result(&result, is_csv);
+  }
+
+  return 0;
+}
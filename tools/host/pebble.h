@@ -0,0 +1,459 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#pragma once
+
+/**
+ * Host (Linux) stand-in for the subset of the Pebble SDK the app uses.
+ * The app sources are compiled unchanged against this header and run on
+ * a virtual clock driven by the host harness, see host.h.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Platform. Color (basalt) unless HOST_PLATFORM_BW is defined (aplite, diorite).
+ * PBL_API_EXISTS(api) is true for the APIs with a HOST_API_EXISTS_ define.
+ */
+#ifdef HOST_PLATFORM_BW
+#define PBL_BW 1
+#define PBL_IF_COLOR_ELSE(if_true, if_false) (if_false)
+#else
+#define PBL_COLOR 1
+#define PBL_IF_COLOR_ELSE(if_true, if_false) (if_true)
+#endif
+#ifndef HOST_PLATFORM_APLITE
+#define HOST_API_EXISTS_app_glance_reload 1
+#endif
+#define PBL_API_EXISTS(api) HOST_API_EXISTS_ ## api
+
+/**
+ * The virtual clock replaces the system clock.
+ */
+time_t host_time(time_t *tloc);
+#define time(tloc) host_time(tloc)
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms);
+void clock_copy_time_string(char *buffer, uint8_t size);
+
+/**
+ * Logging
+ */
+typedef enum {
+  APP_LOG_LEVEL_ERROR = 1,
+  APP_LOG_LEVEL_WARNING = 50,
+  APP_LOG_LEVEL_INFO = 100,
+  APP_LOG_LEVEL_DEBUG = 200,
+  APP_LOG_LEVEL_DEBUG_VERBOSE = 255
+} AppLogLevel;
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, 
+  const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+#define APP_LOG(level, fmt, args...) app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+/**
+ * Geometry and colors
+ */
+typedef struct { int16_t x; int16_t y; } GPoint;
+typedef struct { int16_t w; int16_t h; } GSize;
+typedef struct { GPoint origin; GSize size; } GRect;
+
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GSize(w, h) ((GSize){(w), (h)})
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GPointZero GPoint(0, 0)
+#define GRectZero GRect(0, 0, 0, 0)
+
+typedef union { uint8_t argb; } GColor8;
+typedef GColor8 GColor;
+
+#define GColorClear ((GColor8){.argb = 0x00})
+#define GColorBlack ((GColor8){.argb = 0xC0})
+#define GColorWhite ((GColor8){.argb = 0xFF})
+#define GColorRed ((GColor8){.argb = 0xF0})
+#define GColorOrange ((GColor8){.argb = 0xF4})
+#define GColorYellow ((GColor8){.argb = 0xFC})
+#define GColorGreen ((GColor8){.argb = 0xCC})
+#define GColorCyan ((GColor8){.argb = 0xCF})
+#define GColorPurple ((GColor8){.argb = 0xE2})
+#define GColorElectricUltramarine ((GColor8){.argb = 0xD3})
+#define GColorDarkGray ((GColor8){.argb = 0xD5})
+#define GColorLightGray ((GColor8){.argb = 0xEA})
+
+typedef enum { GCornerNone = 0, GCornersAll = 15 } GCornerMask;
+typedef enum { GTextAlignmentLeft, GTextAlignmentCenter, GTextAlignmentRight } GTextAlignment;
+#define GAlignLeft GTextAlignmentLeft
+#define GAlignRight GTextAlignmentRight
+typedef enum { 
+  GTextOverflowModeWordWrap, GTextOverflowModeTrailingEllipsis, GTextOverflowModeFill 
+} GTextOverflowMode;
+typedef enum { GCompOpAssign, GCompOpAssignInverted, GCompOpOr, GCompOpAnd, GCompOpClear, 
+  GCompOpSet } GCompOp;
+
+/**
+ * Layers, windows and graphics
+ */
+typedef struct Layer Layer;
+typedef struct Window Window;
+typedef struct TextLayer TextLayer;
+typedef struct BitmapLayer BitmapLayer;
+typedef struct GBitmap GBitmap;
+typedef struct GContext GContext;
+typedef const char *GFont;
+
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+
+Layer *layer_create(GRect frame);
+Layer *layer_create_with_data(GRect frame, size_t data_size);
+void layer_destroy(Layer *layer);
+void *layer_get_data(const Layer *layer);
+void layer_mark_dirty(Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_set_frame(Layer *layer, GRect frame);
+GRect layer_get_frame(const Layer *layer);
+GRect layer_get_bounds(const Layer *layer);
+void layer_add_child(Layer *parent, Layer *child);
+void layer_remove_from_parent(Layer *child);
+void layer_set_hidden(Layer *layer, bool hidden);
+bool layer_get_hidden(const Layer *layer);
+
+TextLayer *text_layer_create(GRect frame);
+void text_layer_destroy(TextLayer *text_layer);
+Layer *text_layer_get_layer(TextLayer *text_layer);
+void text_layer_set_text(TextLayer *text_layer, const char *text);
+const char *text_layer_get_text(TextLayer *text_layer);
+void text_layer_set_font(TextLayer *text_layer, GFont font);
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment);
+void text_layer_set_text_color(TextLayer *text_layer, GColor color);
+void text_layer_set_background_color(TextLayer *text_layer, GColor color);
+
+BitmapLayer *bitmap_layer_create(GRect frame);
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer);
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer);
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap);
+void bitmap_layer_set_background_color(BitmapLayer *bitmap_layer, GColor color);
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id);
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect);
+void gbitmap_destroy(GBitmap *bitmap);
+GRect gbitmap_get_bounds(const GBitmap *bitmap);
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_text_color(GContext *ctx, GColor color);
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width);
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, 
+  GCornerMask corner_mask);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box, 
+  GTextOverflowMode overflow_mode, GTextAlignment alignment, void *layout);
+
+#define FONT_KEY_GOTHIC_14 "RESOURCE_ID_GOTHIC_14"
+#define FONT_KEY_GOTHIC_14_BOLD "RESOURCE_ID_GOTHIC_14_BOLD"
+#define FONT_KEY_GOTHIC_18 "RESOURCE_ID_GOTHIC_18"
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+#define FONT_KEY_GOTHIC_24_BOLD "RESOURCE_ID_GOTHIC_24_BOLD"
+#define FONT_KEY_LECO_32_BOLD_NUMBERS "RESOURCE_ID_LECO_32_BOLD_NUMBERS"
+#define FONT_KEY_LECO_36_BOLD_NUMBERS "RESOURCE_ID_LECO_36_BOLD_NUMBERS"
+#define FONT_KEY_LECO_38_BOLD_NUMBERS "RESOURCE_ID_LECO_38_BOLD_NUMBERS"
+GFont fonts_get_system_font(const char *font_key);
+
+/**
+ * App resources, as generated by the SDK from package.json.
+ */
+#define RESOURCE_ID_DIGITS_LARGE 1
+#define RESOURCE_ID_DIGITS_SMALL 2
+
+typedef void (*WindowHandler)(Window *window);
+typedef struct {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+
+typedef void (*ClickConfigProvider)(void *context);
+
+Window *window_create(void);
+void window_destroy(Window *window);
+Layer *window_get_root_layer(const Window *window);
+void window_set_background_color(Window *window, GColor background_color);
+void window_set_user_data(Window *window, void *data);
+void *window_get_user_data(const Window *window);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+void window_set_click_config_provider(Window *window, ClickConfigProvider click_config_provider);
+void window_stack_push(Window *window, bool animated);
+Window *window_stack_pop(bool animated);
+Window *window_stack_get_top_window(void);
+bool window_stack_contains_window(Window *window);
+
+/**
+ * Buttons
+ */
+typedef enum {
+  BUTTON_ID_BACK = 0,
+  BUTTON_ID_UP,
+  BUTTON_ID_SELECT,
+  BUTTON_ID_DOWN,
+  NUM_BUTTONS
+} ButtonId;
+
+typedef void *ClickRecognizerRef;
+typedef void (*ClickHandler)(ClickRecognizerRef recognizer, void *context);
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler);
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, 
+  ClickHandler down_handler, ClickHandler up_handler);
+void window_multi_click_subscribe(ButtonId button_id, uint8_t min_clicks, uint8_t max_clicks, 
+  uint16_t timeout, bool last_click_only, ClickHandler handler);
+
+/**
+ * Timers
+ */
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data);
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer *timer_handle);
+
+/**
+ * Persistent storage
+ */
+#define PERSIST_DATA_MAX_LENGTH 256
+#define E_DOES_NOT_EXIST (-9)
+
+bool persist_exists(const uint32_t key);
+int persist_get_size(const uint32_t key);
+int32_t persist_read_int(const uint32_t key);
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size);
+int persist_write_int(const uint32_t key, const int32_t value);
+int persist_write_data(const uint32_t key, const void *data, const size_t size);
+int persist_delete(const uint32_t key);
+
+/**
+ * Data logging
+ */
+typedef struct DataLoggingSession *DataLoggingSessionRef;
+
+typedef enum {
+  DATA_LOGGING_BYTE_ARRAY = 0,
+  DATA_LOGGING_UINT = 2,
+  DATA_LOGGING_INT = 3
+} DataLoggingItemType;
+
+typedef enum {
+  DATA_LOGGING_SUCCESS = 0,
+  DATA_LOGGING_BUSY,
+  DATA_LOGGING_FULL,
+  DATA_LOGGING_NOT_FOUND,
+  DATA_LOGGING_CLOSED,
+  DATA_LOGGING_INVALID_PARAMS,
+  DATA_LOGGING_INTERNAL_ERR
+} DataLoggingResult;
+
+DataLoggingSessionRef data_logging_create(uint32_t tag, DataLoggingItemType item_type,
+  uint16_t item_length, bool resume);
+void data_logging_finish(DataLoggingSessionRef logging_session);
+DataLoggingResult data_logging_log(DataLoggingSessionRef logging_session, const void *data,
+  uint32_t num_items);
+
+/**
+ * App glance
+ */
+#if PBL_API_EXISTS(app_glance_reload)
+#define APP_GLANCE_SLICE_DEFAULT_ICON ((uint32_t)0)
+#define APP_GLANCE_SLICE_NO_EXPIRATION ((time_t)0)
+
+typedef struct AppGlanceReloadSession AppGlanceReloadSession;
+
+typedef struct {
+  struct {
+    uint32_t icon;
+    const char *subtitle_template_string;
+  } layout;
+  time_t expiration_time;
+} AppGlanceSlice;
+
+typedef enum {
+  APP_GLANCE_RESULT_SUCCESS = 0,
+  APP_GLANCE_RESULT_INVALID_TEMPLATE_STRING = 1 << 0,
+  APP_GLANCE_RESULT_TEMPLATE_STRING_TOO_LONG = 1 << 1,
+  APP_GLANCE_RESULT_INVALID_ICON = 1 << 2,
+  APP_GLANCE_RESULT_SLICE_CAPACITY_EXCEEDED = 1 << 3,
+  APP_GLANCE_RESULT_EXPIRES_IN_THE_PAST = 1 << 4,
+  APP_GLANCE_RESULT_INVALID_SESSION = 1 << 5
+} AppGlanceResult;
+
+typedef void (*AppGlanceReloadCallback)(AppGlanceReloadSession *session, size_t limit,
+  void *context);
+
+void app_glance_reload(AppGlanceReloadCallback callback, void *context);
+AppGlanceResult app_glance_add_slice(AppGlanceReloadSession *session, AppGlanceSlice slice);
+#endif
+
+/**
+ * Dictionary
+ */
+typedef enum {
+  TUPLE_BYTE_ARRAY = 0,
+  TUPLE_CSTRING = 1,
+  TUPLE_UINT = 2,
+  TUPLE_INT = 3
+} TupleType;
+
+typedef struct __attribute__((__packed__)) {
+  uint32_t key;
+  TupleType type:8;
+  uint16_t length;
+  union {
+    uint8_t data[0];
+    char cstring[0];
+    uint8_t uint8;
+    uint16_t uint16;
+    uint32_t uint32;
+    int8_t int8;
+    int16_t int16;
+    int32_t int32;
+  } value[];
+} Tuple;
+
+typedef struct {
+  uint8_t *dictionary;
+  const uint8_t *end;
+  Tuple *cursor;
+} DictionaryIterator;
+
+typedef struct {
+  TupleType type;
+  uint32_t key;
+  union {
+    struct { const uint8_t *data; const uint16_t length; } bytes;
+    struct { const char *data; const uint16_t length; } cstring;
+    struct { uint32_t storage; const uint16_t width; } integer;
+  };
+} Tuplet;
+
+#define IS_SIGNED(var) (((__typeof__(var))-1) < 0)
+#define TupletInteger(_key, _integer) \
+  ((const Tuplet) { .type = IS_SIGNED(_integer) ? TUPLE_INT : TUPLE_UINT, .key = _key, \
+    .integer = { .storage = (uint32_t)(_integer), .width = sizeof(_integer) }})
+#define TupletBytes(_key, _data, _length) \
+  ((const Tuplet) { .type = TUPLE_BYTE_ARRAY, .key = _key, \
+    .bytes = { .data = _data, .length = _length }})
+#define TupletCString(_key, _cstring) \
+  ((const Tuplet) { .type = TUPLE_CSTRING, .key = _key, \
+    .cstring = { .data = _cstring, .length = _cstring ? strlen(_cstring) + 1 : 0 }})
+
+typedef enum {
+  DICT_OK = 0,
+  DICT_NOT_ENOUGH_STORAGE = 1 << 1,
+  DICT_INVALID_ARGS = 1 << 2
+} DictionaryResult;
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t *const buffer, 
+  const uint16_t size);
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, 
+  const uint8_t *const data, const uint16_t size);
+DictionaryResult dict_write_int(DictionaryIterator *iter, const uint32_t key, 
+  const void *integer, const uint8_t width_bytes, const bool is_signed);
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, 
+  const uint8_t value);
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, 
+  const uint16_t value);
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, 
+  const uint32_t value);
+DictionaryResult dict_write_tuplet(DictionaryIterator *iter, const Tuplet *const tuplet);
+uint32_t dict_write_end(DictionaryIterator *iter);
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t *const buffer, 
+  const uint16_t size);
+Tuple *dict_read_first(DictionaryIterator *iter);
+Tuple *dict_read_next(DictionaryIterator *iter);
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key);
+
+/**
+ * AppMessage
+ */
+typedef enum {
+  APP_MSG_OK = 0,
+  APP_MSG_SEND_TIMEOUT = 1 << 1,
+  APP_MSG_SEND_REJECTED = 1 << 2,
+  APP_MSG_NOT_CONNECTED = 1 << 3,
+  APP_MSG_APP_NOT_RUNNING = 1 << 4,
+  APP_MSG_INVALID_ARGS = 1 << 5,
+  APP_MSG_BUSY = 1 << 6,
+  APP_MSG_BUFFER_OVERFLOW = 1 << 7,
+  APP_MSG_ALREADY_RELEASED = 1 << 9,
+  APP_MSG_CALLBACK_ALREADY_REGISTERED = 1 << 10,
+  APP_MSG_CALLBACK_NOT_REGISTERED = 1 << 11,
+  APP_MSG_OUT_OF_MEMORY = 1 << 12,
+  APP_MSG_CLOSED = 1 << 13,
+  APP_MSG_INTERNAL_ERROR = 1 << 14,
+  APP_MSG_INVALID_STATE = 1 << 15
+} AppMessageResult;
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void *context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator *iterator, AppMessageResult reason, 
+  void *context);
+
+AppMessageInboxReceived app_message_register_inbox_received(
+  AppMessageInboxReceived received_callback);
+AppMessageInboxDropped app_message_register_inbox_dropped(
+  AppMessageInboxDropped dropped_callback);
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback);
+AppMessageOutboxFailed app_message_register_outbox_failed(
+  AppMessageOutboxFailed failed_callback);
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+uint32_t app_message_inbox_size_maximum(void);
+uint32_t app_message_outbox_size_maximum(void);
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator);
+AppMessageResult app_message_outbox_send(void);
+
+/**
+ * Event services
+ */
+typedef void (*ConnectionHandler)(bool connected);
+typedef struct {
+  ConnectionHandler pebble_app_connection_handler;
+  ConnectionHandler pebblekit_connection_handler;
+} ConnectionHandlers;
+
+bool connection_service_peek_pebble_app_connection(void);
+void connection_service_subscribe(ConnectionHandlers conn_handlers);
+void connection_service_unsubscribe(void);
+
+typedef struct {
+  uint8_t charge_percent;
+  bool is_charging;
+  bool is_plugged;
+} BatteryChargeState;
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+
+BatteryChargeState battery_state_service_peek(void);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+
+typedef enum {
+  SECOND_UNIT = 1 << 0,
+  MINUTE_UNIT = 1 << 1,
+  HOUR_UNIT = 1 << 2,
+  DAY_UNIT = 1 << 3,
+  MONTH_UNIT = 1 << 4,
+  YEAR_UNIT = 1 << 5
+} TimeUnits;
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+
+void app_event_loop(void);
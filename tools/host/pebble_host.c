@@ -0,0 +1,1660 @@
+/**
+ * Author: Marek Jankech
+ */
+
+#include <stdarg.h>
+#include "host.h"
+
+
+#define HOST_MAX_WINDOWS 8
+#define HOST_MAX_PERSIST_KEYS 256
+#define HOST_MAX_DATA_LOGGING_SESSIONS 4
+#define HOST_GLANCE_SUBTITLE_SIZE 151
+#define HOST_MESSAGE_SIZE_MAXIMUM 8200
+
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  LayerUpdateProc update_proc;
+  bool hidden;
+  bool dirty;
+  void *data;
+};
+
+struct TextLayer {
+  Layer layer;
+  const char *text;
+  GFont font;
+  GColor text_color;
+  GColor background_color;
+  GTextAlignment alignment;
+};
+
+struct BitmapLayer {
+  Layer layer;
+  const GBitmap *bitmap;
+  GColor background_color;
+};
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+  ClickConfigProvider click_config_provider;
+  void *user_data;
+  GColor background_color;
+  bool is_loaded;
+};
+
+struct GBitmap {
+  GRect bounds;
+};
+
+struct GContext {
+  GColor stroke_color;
+  GColor fill_color;
+  GColor text_color;
+};
+
+typedef enum {
+  HOST_EVENT_APP_TIMER,
+  HOST_EVENT_HOST
+} HostEventKind;
+
+/**
+ * App timers and host events share one queue ordered by due time. Like the
+ * firmware, timer handles are ids, so cancelling a timer that has already
+ * fired is harmless.
+ */
+typedef struct HostEvent {
+  int64_t due_ms;
+  uint32_t id;
+  HostEventKind kind;
+  AppTimerCallback callback;
+  void *data;
+  struct HostEvent *next;
+} HostEvent;
+
+typedef struct {
+  ClickHandler single;
+  ClickHandler long_down;
+  ClickHandler long_up;
+  ClickHandler multi;
+  uint8_t multi_min_clicks;
+  uint8_t multi_max_clicks;
+} HostClickConfig;
+
+typedef struct {
+  bool is_used;
+  uint32_t key;
+  uint16_t size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} HostPersistEntry;
+
+typedef struct {
+  AppMessageResult result;
+  uint16_t size;
+  uint8_t data[];
+} HostMessage;
+
+static struct {
+  int64_t now_ms;
+  HostEvent *events;
+  uint32_t next_event_id;
+  uint8_t log_level;
+  bool is_exited;
+
+  Window *window_stack[HOST_MAX_WINDOWS];
+  uint8_t window_count;
+  HostClickConfig clicks[NUM_BUTTONS];
+
+  HostPersistEntry persist[HOST_MAX_PERSIST_KEYS];
+
+  bool is_connected;
+  BatteryChargeState battery;
+  ConnectionHandler connection_handler;
+  BatteryStateHandler battery_handler;
+  TickHandler tick_handler;
+  TimeUnits tick_units;
+
+  AppMessageInboxReceived inbox_received;
+  AppMessageInboxDropped inbox_dropped;
+  AppMessageOutboxSent outbox_sent;
+  AppMessageOutboxFailed outbox_failed;
+  uint8_t *inbox;
+  uint32_t inbox_size;
+  uint32_t inbox_size_maximum;
+  uint32_t inbox_queued_bytes;
+  uint32_t inbox_processing_ms;
+  int64_t inbox_busy_until_ms;
+  HostInboxResultHandler inbox_result_handler;
+  void *inbox_result_handler_context;
+  uint8_t *outbox;
+  uint32_t outbox_size;
+  DictionaryIterator outbox_iter;
+  bool is_outbox_open;
+  bool is_outbox_in_flight;
+  uint16_t outbox_in_flight_size;
+  uint32_t link_latency_ms;
+  HostOutboxHandler outbox_handler;
+  void *outbox_handler_context;
+  HostWindowHandler window_unloaded_handler;
+
+  struct DataLoggingSession {
+    bool is_open;
+    uint32_t tag;
+    uint16_t item_length;
+  } data_logging_sessions[HOST_MAX_DATA_LOGGING_SESSIONS];
+  DataLoggingResult data_logging_result;
+  HostDataLoggingHandler data_logging_handler;
+  void *data_logging_handler_context;
+
+  char glance_subtitle[HOST_GLANCE_SUBTITLE_SIZE];
+
+  HostCounters counters;
+  HostCounters first_frame_counters;
+  int64_t first_frame_ms;
+} s_host;
+
+static void host_init_defaults(void);
+static void host_render(void);
+
+
+/* ------------------------------------------------------------------------ */
+/* Harness                                                                  */
+/* ------------------------------------------------------------------------ */
+
+static HostScenario s_scenario;
+static void *s_scenario_context;
+static bool s_is_initialized;
+
+int pebble_app_main(void);
+
+int host_run_app(HostScenario scenario, void *context) {
+  if (!s_is_initialized) {
+    host_init_defaults();
+  }
+  s_scenario = scenario;
+  s_scenario_context = context;
+  s_host.is_exited = false;
+
+  return pebble_app_main();
+}
+
+void app_event_loop(void) {
+  host_render();
+  s_host.first_frame_counters = s_host.counters;
+  s_host.first_frame_ms = s_host.now_ms;
+  if (s_scenario != NULL) {
+    s_scenario(s_scenario_context);
+  }
+  s_host.is_exited = true;
+}
+
+static void host_init_defaults(void) {
+  s_is_initialized = true;
+  s_host.now_ms = (int64_t)HOST_DEFAULT_EPOCH * 1000;
+  s_host.log_level = APP_LOG_LEVEL_WARNING;
+  s_host.is_connected = true;
+  s_host.battery = (BatteryChargeState) { .charge_percent = 80 };
+  s_host.link_latency_ms = HOST_DEFAULT_LINK_LATENCY_MS;
+  s_host.inbox_size_maximum = HOST_MESSAGE_SIZE_MAXIMUM;
+}
+
+void host_reset(void) {
+  while (s_host.events != NULL) {
+    HostEvent *event = s_host.events;
+    s_host.events = event->next;
+    free(event);
+  }
+  free(s_host.inbox);
+  free(s_host.outbox);
+  memset(&s_host, 0, sizeof(s_host));
+  host_init_defaults();
+}
+
+void host_restart(void) {
+  HostPersistEntry *persist = malloc(sizeof(s_host.persist));
+  memcpy(persist, s_host.persist, sizeof(s_host.persist));
+  int64_t now_ms = s_host.now_ms;
+
+  host_reset();
+  memcpy(s_host.persist, persist, sizeof(s_host.persist));
+  s_host.now_ms = now_ms;
+  free(persist);
+}
+
+void host_reset_counters(void) {
+  memset(&s_host.counters, 0, sizeof(s_host.counters));
+}
+
+const HostCounters *host_counters(void) {
+  return &s_host.counters;
+}
+
+const HostCounters *host_first_frame_counters(void) {
+  return &s_host.first_frame_counters;
+}
+
+int64_t host_first_frame_ms(void) {
+  return s_host.first_frame_ms;
+}
+
+void host_set_log_level(uint8_t log_level) {
+  if (!s_is_initialized) {
+    host_init_defaults();
+  }
+  s_host.log_level = log_level;
+}
+
+bool host_app_exited(void) {
+  return s_host.is_exited;
+}
+
+void host_set_window_unloaded_handler(HostWindowHandler handler) {
+  if (!s_is_initialized) {
+    host_init_defaults();
+  }
+  s_host.window_unloaded_handler = handler;
+}
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number,
+  const char *fmt, ...) {
+
+  if (log_level > s_host.log_level) {
+    return;
+  }
+
+  const char *basename = strrchr(src_filename, '/');
+  fprintf(stderr, "[%lld.%03d] %s:%d ", (long long)(s_host.now_ms / 1000),
+    (int)(s_host.now_ms % 1000), basename ? basename + 1 : src_filename, src_line_number);
+
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* Virtual clock and event queue                                            */
+/* ------------------------------------------------------------------------ */
+
+void host_set_time(time_t epoch, uint16_t ms) {
+  if (!s_is_initialized) {
+    host_init_defaults();
+  }
+  s_host.now_ms = (int64_t)epoch * 1000 + ms;
+}
+
+int64_t host_now_ms(void) {
+  return s_host.now_ms;
+}
+
+time_t host_time(time_t *tloc) {
+  time_t now = (time_t)(s_host.now_ms / 1000);
+  if (tloc != NULL) {
+    *tloc = now;
+  }
+  return now;
+}
+
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms) {
+  uint16_t ms = (uint16_t)(s_host.now_ms % 1000);
+  if (t_utc != NULL) {
+    *t_utc = (time_t)(s_host.now_ms / 1000);
+  }
+  if (out_ms != NULL) {
+    *out_ms = ms;
+  }
+  return ms;
+}
+
+void clock_copy_time_string(char *buffer, uint8_t size) {
+  time_t now = host_time(NULL);
+  struct tm tm_now;
+  gmtime_r(&now, &tm_now);
+  strftime(buffer, size, "%H:%M", &tm_now);
+}
+
+static void host_insert(HostEvent *event) {
+  HostEvent **link = &s_host.events;
+  while (*link != NULL && (*link)->due_ms <= event->due_ms) {
+    link = &(*link)->next;
+  }
+  event->next = *link;
+  *link = event;
+}
+
+static HostEvent *host_enqueue(uint32_t delay_ms, HostEventKind kind,
+  AppTimerCallback callback, void *data) {
+
+  HostEvent *event = malloc(sizeof(HostEvent));
+  event->due_ms = s_host.now_ms + delay_ms;
+  event->id = ++s_host.next_event_id;
+  event->kind = kind;
+  event->callback = callback;
+  event->data = data;
+  host_insert(event);
+
+  return event;
+}
+
+static HostEvent *host_dequeue(AppTimer *timer_handle) {
+  const uint32_t id = (uint32_t)(uintptr_t)timer_handle;
+  for (HostEvent **link = &s_host.events; *link != NULL; link = &(*link)->next) {
+    if ((*link)->id == id && (*link)->kind == HOST_EVENT_APP_TIMER) {
+      HostEvent *event = *link;
+      *link = event->next;
+      return event;
+    }
+  }
+  return NULL;
+}
+
+void host_schedule(uint32_t delay_ms, HostCallback callback, void *context) {
+  host_enqueue(delay_ms, HOST_EVENT_HOST, callback, context);
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback,
+  void *callback_data) {
+
+  HostEvent *event = host_enqueue(timeout_ms, HOST_EVENT_APP_TIMER, callback, callback_data);
+  return (AppTimer *)(uintptr_t)event->id;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+  HostEvent *event = host_dequeue(timer_handle);
+  if (event == NULL) {
+    return false;
+  }
+  event->due_ms = s_host.now_ms + new_timeout_ms;
+  host_insert(event);
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+  free(host_dequeue(timer_handle));
+}
+
+static void host_wakeup(void) {
+  s_host.counters.wakeups++;
+}
+
+static TimeUnits host_units_changed(const struct tm *tm_now) {
+  TimeUnits changed = SECOND_UNIT;
+  if (tm_now->tm_sec == 0) {
+    changed |= MINUTE_UNIT;
+    if (tm_now->tm_min == 0) {
+      changed |= HOUR_UNIT;
+      if (tm_now->tm_hour == 0) {
+        changed |= DAY_UNIT;
+        if (tm_now->tm_mday == 1) {
+          changed |= MONTH_UNIT;
+          if (tm_now->tm_mon == 0) {
+            changed |= YEAR_UNIT;
+          }
+        }
+      }
+    }
+  }
+  return changed;
+}
+
+static int64_t host_next_tick_ms(void) {
+  if (s_host.tick_handler == NULL) {
+    return INT64_MAX;
+  }
+  int64_t step_ms = (s_host.tick_units & SECOND_UNIT) ? 1000 : 60000;
+
+  return (s_host.now_ms / step_ms + 1) * step_ms;
+}
+
+static void host_fire_tick(void) {
+  time_t now = host_time(NULL);
+  struct tm tm_now;
+  gmtime_r(&now, &tm_now);
+
+  TimeUnits changed = host_units_changed(&tm_now);
+  if (changed & s_host.tick_units) {
+    host_wakeup();
+    s_host.counters.ticks++;
+    s_host.tick_handler(&tm_now, changed);
+    host_render();
+  }
+}
+
+void host_advance(uint32_t ms) {
+  const int64_t target_ms = s_host.now_ms + ms;
+
+  while (!s_host.is_exited) {
+    int64_t next_tick_ms = host_next_tick_ms();
+    int64_t next_event_ms = s_host.events != NULL ? s_host.events->due_ms : INT64_MAX;
+
+    if (next_tick_ms > target_ms && next_event_ms > target_ms) {
+      break;
+    }
+    if (next_event_ms <= next_tick_ms) {
+      HostEvent *event = s_host.events;
+      s_host.events = event->next;
+      s_host.now_ms = event->due_ms;
+
+      AppTimerCallback callback = event->callback;
+      void *data = event->data;
+      HostEventKind kind = event->kind;
+      free(event);
+
+      if (kind == HOST_EVENT_APP_TIMER) {
+        host_wakeup();
+        s_host.counters.timer_firings++;
+        callback(data);
+        host_render();
+      } else {
+        callback(data);
+      }
+    } else {
+      s_host.now_ms = next_tick_ms;
+      host_fire_tick();
+    }
+  }
+
+  if (s_host.now_ms < target_ms) {
+    s_host.now_ms = target_ms;
+  }
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* Layers and graphics                                                      */
+/* ------------------------------------------------------------------------ */
+
+static void host_layer_init(Layer *layer, GRect frame) {
+  memset(layer, 0, sizeof(Layer));
+  s_host.counters.layers_created++;
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+}
+
+Layer *layer_create(GRect frame) {
+  return layer_create_with_data(frame, 0);
+}
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+  Layer *layer = malloc(sizeof(Layer) + data_size);
+  if (layer == NULL) {
+    return NULL;
+  }
+  host_layer_init(layer, frame);
+  layer->data = data_size > 0 ? (void *)(layer + 1) : NULL;
+  if (data_size > 0) {
+    memset(layer->data, 0, data_size);
+  }
+  return layer;
+}
+
+void layer_remove_from_parent(Layer *child) {
+  if (child == NULL || child->parent == NULL) {
+    return;
+  }
+  Layer **link = &child->parent->first_child;
+  while (*link != NULL && *link != child) {
+    link = &(*link)->next_sibling;
+  }
+  if (*link == child) {
+    *link = child->next_sibling;
+  }
+  layer_mark_dirty(child->parent);
+  child->parent = NULL;
+  child->next_sibling = NULL;
+}
+
+static void host_layer_detach_children(Layer *layer) {
+  Layer *child = layer->first_child;
+  while (child != NULL) {
+    Layer *next = child->next_sibling;
+    child->parent = NULL;
+    child->next_sibling = NULL;
+    child = next;
+  }
+  layer->first_child = NULL;
+}
+
+void layer_destroy(Layer *layer) {
+  if (layer == NULL) {
+    return;
+  }
+  layer_remove_from_parent(layer);
+  host_layer_detach_children(layer);
+  free(layer);
+}
+
+void *layer_get_data(const Layer *layer) {
+  return layer->data;
+}
+
+void layer_mark_dirty(Layer *layer) {
+  if (layer != NULL) {
+    layer->dirty = true;
+  }
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+  layer->frame = frame;
+  layer->bounds.size = frame.size;
+  layer_mark_dirty(layer);
+}
+
+GRect layer_get_frame(const Layer *layer) {
+  return layer->frame;
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  return layer->bounds;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  if (child->parent != NULL) {
+    layer_remove_from_parent(child);
+  }
+  child->parent = parent;
+  child->next_sibling = NULL;
+
+  Layer **link = &parent->first_child;
+  while (*link != NULL) {
+    link = &(*link)->next_sibling;
+  }
+  *link = child;
+  layer_mark_dirty(child);
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+  if (layer->hidden != hidden) {
+    layer->hidden = hidden;
+    layer_mark_dirty(layer->parent != NULL ? layer->parent : layer);
+  }
+}
+
+bool layer_get_hidden(const Layer *layer) {
+  return layer->hidden;
+}
+
+static void host_text_layer_update_proc(Layer *layer, GContext *ctx) {
+  TextLayer *text_layer = (TextLayer *)layer;
+
+  if (text_layer->background_color.argb != GColorClear.argb) {
+    graphics_context_set_fill_color(ctx, text_layer->background_color);
+    graphics_fill_rect(ctx, layer->bounds, 0, GCornerNone);
+  }
+  if (text_layer->text != NULL && text_layer->text[0] != '\0') {
+    graphics_context_set_text_color(ctx, text_layer->text_color);
+    graphics_draw_text(ctx, text_layer->text, text_layer->font, layer->bounds,
+      GTextOverflowModeWordWrap, text_layer->alignment, NULL);
+  }
+}
+
+TextLayer *text_layer_create(GRect frame) {
+  TextLayer *text_layer = calloc(1, sizeof(TextLayer));
+  if (text_layer == NULL) {
+    return NULL;
+  }
+  host_layer_init(&text_layer->layer, frame);
+  text_layer->layer.update_proc = host_text_layer_update_proc;
+  text_layer->text_color = GColorBlack;
+  text_layer->background_color = GColorWhite;
+  text_layer->font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+  if (text_layer == NULL) {
+    return;
+  }
+  layer_remove_from_parent(&text_layer->layer);
+  host_layer_detach_children(&text_layer->layer);
+  free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+  return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+  text_layer->text = text;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+  return text_layer->text;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+  text_layer->font = font;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+  text_layer->alignment = text_alignment;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+  text_layer->text_color = color;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+  text_layer->background_color = color;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+static void host_bitmap_layer_update_proc(Layer *layer, GContext *ctx) {
+  BitmapLayer *bitmap_layer = (BitmapLayer *)layer;
+
+  if (bitmap_layer->background_color.argb != GColorClear.argb) {
+    graphics_context_set_fill_color(ctx, bitmap_layer->background_color);
+    graphics_fill_rect(ctx, layer->bounds, 0, GCornerNone);
+  }
+  if (bitmap_layer->bitmap != NULL) {
+    graphics_draw_bitmap_in_rect(ctx, bitmap_layer->bitmap, layer->bounds);
+  }
+}
+
+BitmapLayer *bitmap_layer_create(GRect frame) {
+  BitmapLayer *bitmap_layer = calloc(1, sizeof(BitmapLayer));
+  if (bitmap_layer == NULL) {
+    return NULL;
+  }
+  host_layer_init(&bitmap_layer->layer, frame);
+  bitmap_layer->layer.update_proc = host_bitmap_layer_update_proc;
+  return bitmap_layer;
+}
+
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer) {
+  if (bitmap_layer == NULL) {
+    return;
+  }
+  layer_remove_from_parent(&bitmap_layer->layer);
+  host_layer_detach_children(&bitmap_layer->layer);
+  free(bitmap_layer);
+}
+
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer) {
+  return (Layer *)&bitmap_layer->layer;
+}
+
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap) {
+  bitmap_layer->bitmap = bitmap;
+  layer_mark_dirty(&bitmap_layer->layer);
+}
+
+void bitmap_layer_set_background_color(BitmapLayer *bitmap_layer, GColor color) {
+  bitmap_layer->background_color = color;
+  layer_mark_dirty(&bitmap_layer->layer);
+}
+
+/**
+ * Sizes of the app's bitmap resources, see package.json.
+ */
+static const struct {
+  uint32_t resource_id;
+  GSize size;
+} s_resource_sizes[] = {
+  { RESOURCE_ID_DIGITS_LARGE, { 230, 36 } },
+  { RESOURCE_ID_DIGITS_SMALL, { 178, 30 } },
+};
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+  for (size_t i = 0; i < sizeof(s_resource_sizes) / sizeof(s_resource_sizes[0]); i++) {
+    if (s_resource_sizes[i].resource_id == resource_id) {
+      GBitmap *bitmap = malloc(sizeof(GBitmap));
+      bitmap->bounds = (GRect) { GPointZero, s_resource_sizes[i].size };
+      return bitmap;
+    }
+  }
+  return NULL;
+}
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect) {
+  GBitmap *bitmap = malloc(sizeof(GBitmap));
+  bitmap->bounds = sub_rect;
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  free(bitmap);
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+  return bitmap->bounds;
+}
+
+GFont fonts_get_system_font(const char *font_key) {
+  return font_key;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke_color = color;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+  ctx->text_color = color;
+}
+
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width) {
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+}
+
+static void host_count_draw(int32_t pixels) {
+  s_host.counters.draw_ops++;
+  s_host.counters.pixels_drawn += pixels > 0 ? pixels : 0;
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  host_count_draw(abs(p1.x - p0.x) + abs(p1.y - p0.y) + 1);
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius,
+  GCornerMask corner_mask) {
+
+  host_count_draw((int32_t)rect.size.w * rect.size.h);
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  host_count_draw((int32_t)rect.size.w * rect.size.h);
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box,
+  GTextOverflowMode overflow_mode, GTextAlignment alignment, void *layout) {
+
+  host_count_draw((int32_t)box.size.w * box.size.h);
+}
+
+static uint32_t host_collect_dirty_area(Layer *layer) {
+  uint32_t area = 0;
+  if (layer->dirty) {
+    area += (uint32_t)layer->frame.size.w * layer->frame.size.h;
+    layer->dirty = false;
+  }
+  for (Layer *child = layer->first_child; child != NULL; child = child->next_sibling) {
+    area += host_collect_dirty_area(child);
+  }
+  return area;
+}
+
+static void host_render_layer(Layer *layer, GContext *ctx) {
+  if (layer->hidden) {
+    return;
+  }
+  if (layer->update_proc != NULL) {
+    s_host.counters.layer_redraws++;
+    layer->update_proc(layer, ctx);
+  }
+  for (Layer *child = layer->first_child; child != NULL; child = child->next_sibling) {
+    host_render_layer(child, ctx);
+  }
+}
+
+/**
+ * Like the firmware, a dirty layer anywhere causes the whole window to be
+ * rendered again. The dirty area is what the app asked to be repainted.
+ */
+static void host_render(void) {
+  if (s_host.window_count == 0) {
+    return;
+  }
+  Window *window = s_host.window_stack[s_host.window_count - 1];
+  uint32_t dirty_area = host_collect_dirty_area(&window->root);
+  if (dirty_area == 0) {
+    return;
+  }
+
+  const uint32_t screen_area = HOST_SCREEN_WIDTH * HOST_SCREEN_HEIGHT;
+  s_host.counters.render_passes++;
+  s_host.counters.dirty_area += dirty_area < screen_area ? dirty_area : screen_area;
+
+  GContext ctx = { 0 };
+  graphics_context_set_fill_color(&ctx, window->background_color);
+  graphics_fill_rect(&ctx, window->root.bounds, 0, GCornerNone);
+  host_render_layer(&window->root, &ctx);
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* Windows and buttons                                                      */
+/* ------------------------------------------------------------------------ */
+
+Window *window_create(void) {
+  Window *window = calloc(1, sizeof(Window));
+  host_layer_init(&window->root, GRect(0, 0, HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT));
+  window->background_color = GColorWhite;
+  return window;
+}
+
+static int host_window_stack_index(Window *window) {
+  for (int i = 0; i < s_host.window_count; i++) {
+    if (s_host.window_stack[i] == window) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void host_configure_clicks(Window *window) {
+  memset(s_host.clicks, 0, sizeof(s_host.clicks));
+  if (window != NULL && window->click_config_provider != NULL) {
+    window->click_config_provider(window);
+  }
+}
+
+static void host_window_appear(Window *window) {
+  host_configure_clicks(window);
+  if (window->handlers.appear != NULL) {
+    window->handlers.appear(window);
+  }
+  layer_mark_dirty(&window->root);
+}
+
+static void host_window_remove(Window *window) {
+  int index = host_window_stack_index(window);
+  if (index < 0) {
+    return;
+  }
+  bool was_top = index == s_host.window_count - 1;
+
+  if (was_top && window->handlers.disappear != NULL) {
+    window->handlers.disappear(window);
+  }
+  memmove(&s_host.window_stack[index], &s_host.window_stack[index + 1],
+    (s_host.window_count - index - 1) * sizeof(Window *));
+  s_host.window_count--;
+
+  if (window->is_loaded) {
+    if (window->handlers.unload != NULL) {
+      window->handlers.unload(window);
+    }
+    if (s_host.window_unloaded_handler != NULL) {
+      s_host.window_unloaded_handler(window);
+    }
+  }
+  window->is_loaded = false;
+
+  if (was_top) {
+    if (s_host.window_count > 0) {
+      host_window_appear(s_host.window_stack[s_host.window_count - 1]);
+    } else {
+      host_configure_clicks(NULL);
+      s_host.is_exited = true;
+    }
+  }
+}
+
+void window_destroy(Window *window) {
+  if (window == NULL) {
+    return;
+  }
+  host_window_remove(window);
+  host_layer_detach_children(&window->root);
+  free(window);
+}
+
+Layer *window_get_root_layer(const Window *window) {
+  return (Layer *)&window->root;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+  window->background_color = background_color;
+  layer_mark_dirty(&window->root);
+}
+
+void window_set_user_data(Window *window, void *data) {
+  window->user_data = data;
+}
+
+void *window_get_user_data(const Window *window) {
+  return window->user_data;
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+void window_set_click_config_provider(Window *window,
+  ClickConfigProvider click_config_provider) {
+
+  window->click_config_provider = click_config_provider;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  if (host_window_stack_index(window) >= 0 || s_host.window_count == HOST_MAX_WINDOWS) {
+    return;
+  }
+  if (s_host.window_count > 0) {
+    Window *previous = s_host.window_stack[s_host.window_count - 1];
+    if (previous->handlers.disappear != NULL) {
+      previous->handlers.disappear(previous);
+    }
+  }
+  s_host.window_stack[s_host.window_count++] = window;
+  if (animated) {
+    s_host.counters.animated_pushes++;
+  }
+
+  if (!window->is_loaded) {
+    window->is_loaded = true;
+    if (window->handlers.load != NULL) {
+      window->handlers.load(window);
+    }
+  }
+  host_window_appear(window);
+}
+
+Window *window_stack_pop(bool animated) {
+  if (s_host.window_count == 0) {
+    return NULL;
+  }
+  Window *window = s_host.window_stack[s_host.window_count - 1];
+  host_window_remove(window);
+  return window;
+}
+
+Window *window_stack_get_top_window(void) {
+  return s_host.window_count > 0 ? s_host.window_stack[s_host.window_count - 1] : NULL;
+}
+
+bool window_stack_contains_window(Window *window) {
+  return host_window_stack_index(window) >= 0;
+}
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler) {
+  s_host.clicks[button_id].single = handler;
+}
+
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms,
+  ClickHandler down_handler, ClickHandler up_handler) {
+
+  s_host.clicks[button_id].long_down = down_handler;
+  s_host.clicks[button_id].long_up = up_handler;
+}
+
+void window_multi_click_subscribe(ButtonId button_id, uint8_t min_clicks, uint8_t max_clicks,
+  uint16_t timeout, bool last_click_only, ClickHandler handler) {
+
+  s_host.clicks[button_id].multi = handler;
+  s_host.clicks[button_id].multi_min_clicks = min_clicks;
+  s_host.clicks[button_id].multi_max_clicks = max_clicks;
+}
+
+static void host_dispatch_click(ClickHandler handler) {
+  host_wakeup();
+  s_host.counters.clicks++;
+  if (handler != NULL) {
+    handler(NULL, window_stack_get_top_window());
+  }
+  host_render();
+}
+
+void host_click(ButtonId button_id) {
+  ClickHandler handler = s_host.clicks[button_id].single;
+  if (handler == NULL && button_id == BUTTON_ID_BACK) {
+    host_wakeup();
+    s_host.counters.clicks++;
+    window_stack_pop(true);
+    host_render();
+    return;
+  }
+  host_dispatch_click(handler);
+}
+
+void host_long_click(ButtonId button_id) {
+  host_dispatch_click(s_host.clicks[button_id].long_down);
+  if (s_host.clicks[button_id].long_up != NULL) {
+    s_host.clicks[button_id].long_up(NULL, window_stack_get_top_window());
+    host_render();
+  }
+}
+
+void host_multi_click(ButtonId button_id, uint8_t count) {
+  const HostClickConfig *config = &s_host.clicks[button_id];
+  if (config->multi != NULL
+    && count >= config->multi_min_clicks && count <= config->multi_max_clicks) {
+      host_dispatch_click(config->multi);
+  } else {
+    for (uint8_t i = 0; i < count; i++) {
+      host_click(button_id);
+    }
+  }
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* Persistent storage                                                       */
+/* ------------------------------------------------------------------------ */
+
+static HostPersistEntry *host_persist_find(uint32_t key) {
+  for (int i = 0; i < HOST_MAX_PERSIST_KEYS; i++) {
+    if (s_host.persist[i].is_used && s_host.persist[i].key == key) {
+      return &s_host.persist[i];
+    }
+  }
+  return NULL;
+}
+
+bool persist_exists(const uint32_t key) {
+  s_host.counters.flash_lookups++;
+  return host_persist_find(key) != NULL;
+}
+
+int persist_get_size(const uint32_t key) {
+  s_host.counters.flash_lookups++;
+  HostPersistEntry *entry = host_persist_find(key);
+  return entry != NULL ? entry->size : E_DOES_NOT_EXIST;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+  int32_t value = 0;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+  HostPersistEntry *entry = host_persist_find(key);
+  if (entry == NULL) {
+    return E_DOES_NOT_EXIST;
+  }
+  s_host.counters.flash_reads++;
+  size_t size = entry->size < buffer_size ? entry->size : buffer_size;
+  memcpy(buffer, entry->data, size);
+  return (int)size;
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+  HostPersistEntry *entry = host_persist_find(key);
+  if (entry == NULL) {
+    for (int i = 0; i < HOST_MAX_PERSIST_KEYS && entry == NULL; i++) {
+      if (!s_host.persist[i].is_used) {
+        entry = &s_host.persist[i];
+      }
+    }
+    if (entry == NULL) {
+      return E_DOES_NOT_EXIST;
+    }
+  }
+  size_t written = size < PERSIST_DATA_MAX_LENGTH ? size : PERSIST_DATA_MAX_LENGTH;
+  entry->is_used = true;
+  entry->key = key;
+  entry->size = (uint16_t)written;
+  memcpy(entry->data, data, written);
+
+  s_host.counters.flash_writes++;
+  s_host.counters.flash_bytes += written;
+  return (int)written;
+}
+
+int persist_delete(const uint32_t key) {
+  HostPersistEntry *entry = host_persist_find(key);
+  if (entry == NULL) {
+    return E_DOES_NOT_EXIST;
+  }
+  entry->is_used = false;
+  s_host.counters.flash_writes++;
+  return 0;
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* Data logging                                                             */
+/* ------------------------------------------------------------------------ */
+
+DataLoggingSessionRef data_logging_create(uint32_t tag, DataLoggingItemType item_type,
+  uint16_t item_length, bool resume) {
+
+  for (int i = 0; i < HOST_MAX_DATA_LOGGING_SESSIONS; i++) {
+    struct DataLoggingSession *session = &s_host.data_logging_sessions[i];
+    if (!session->is_open) {
+      session->is_open = true;
+      session->tag = tag;
+      session->item_length = item_type == DATA_LOGGING_BYTE_ARRAY ? item_length : 4;
+      return session;
+    }
+  }
+  return NULL;
+}
+
+void data_logging_finish(DataLoggingSessionRef logging_session) {
+  if (logging_session != NULL) {
+    logging_session->is_open = false;
+  }
+}
+
+DataLoggingResult data_logging_log(DataLoggingSessionRef logging_session, const void *data,
+  uint32_t num_items) {
+
+  if (logging_session == NULL || data == NULL || num_items == 0) {
+    return DATA_LOGGING_INVALID_PARAMS;
+  }
+  if (!logging_session->is_open) {
+    return DATA_LOGGING_CLOSED;
+  }
+  if (s_host.data_logging_result != DATA_LOGGING_SUCCESS) {
+    return s_host.data_logging_result;
+  }
+
+  s_host.counters.data_log_items += num_items;
+  s_host.counters.data_log_bytes += num_items * logging_session->item_length;
+  if (s_host.data_logging_handler != NULL) {
+    s_host.data_logging_handler(logging_session->tag, data, num_items,
+      logging_session->item_length, s_host.data_logging_handler_context);
+  }
+  return DATA_LOGGING_SUCCESS;
+}
+
+void host_set_data_logging_handler(HostDataLoggingHandler handler, void *context) {
+  s_host.data_logging_handler = handler;
+  s_host.data_logging_handler_context = context;
+}
+
+void host_set_data_logging_result(DataLoggingResult result) {
+  s_host.data_logging_result = result;
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* App glance                                                               */
+/* ------------------------------------------------------------------------ */
+
+#if PBL_API_EXISTS(app_glance_reload)
+struct AppGlanceReloadSession {
+  uint8_t slice_count;
+};
+
+void app_glance_reload(AppGlanceReloadCallback callback, void *context) {
+  AppGlanceReloadSession session = { 0 };
+
+  s_host.counters.glance_reloads++;
+  s_host.counters.flash_writes++;
+  s_host.glance_subtitle[0] = '\0';
+  if (callback != NULL) {
+    callback(&session, 1, context);
+  }
+}
+
+AppGlanceResult app_glance_add_slice(AppGlanceReloadSession *session, AppGlanceSlice slice) {
+  if (session == NULL) {
+    return APP_GLANCE_RESULT_INVALID_SESSION;
+  }
+  if (session->slice_count == 1) {
+    return APP_GLANCE_RESULT_SLICE_CAPACITY_EXCEEDED;
+  }
+  const char *subtitle = slice.layout.subtitle_template_string;
+  if (subtitle != NULL && strlen(subtitle) >= HOST_GLANCE_SUBTITLE_SIZE) {
+    return APP_GLANCE_RESULT_TEMPLATE_STRING_TOO_LONG;
+  }
+  session->slice_count++;
+  snprintf(s_host.glance_subtitle, sizeof(s_host.glance_subtitle), "%s",
+    subtitle != NULL ? subtitle : "");
+  return APP_GLANCE_RESULT_SUCCESS;
+}
+#endif
+
+const char *host_glance_subtitle(void) {
+  return s_host.glance_subtitle;
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* Dictionary                                                               */
+/* ------------------------------------------------------------------------ */
+
+#define HOST_TUPLE_HEADER_SIZE sizeof(Tuple)
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t *const buffer,
+  const uint16_t size) {
+
+  if (iter == NULL || buffer == NULL || size < 1) {
+    return DICT_INVALID_ARGS;
+  }
+  buffer[0] = 0;
+  iter->dictionary = buffer;
+  iter->end = buffer + size;
+  iter->cursor = (Tuple *)(buffer + 1);
+  return DICT_OK;
+}
+
+static DictionaryResult host_dict_write(DictionaryIterator *iter, uint32_t key,
+  TupleType type, const void *value, uint16_t length) {
+
+  uint8_t *cursor = (uint8_t *)iter->cursor;
+  if (cursor + HOST_TUPLE_HEADER_SIZE + length > iter->end) {
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  Tuple *tuple = iter->cursor;
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = length;
+  memcpy(tuple->value, value, length);
+
+  iter->dictionary[0]++;
+  iter->cursor = (Tuple *)(cursor + HOST_TUPLE_HEADER_SIZE + length);
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key,
+  const uint8_t *const data, const uint16_t size) {
+
+  return host_dict_write(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_int(DictionaryIterator *iter, const uint32_t key,
+  const void *integer, const uint8_t width_bytes, const bool is_signed) {
+
+  if (width_bytes != 1 && width_bytes != 2 && width_bytes != 4) {
+    return DICT_INVALID_ARGS;
+  }
+  return host_dict_write(iter, key, is_signed ? TUPLE_INT : TUPLE_UINT, integer, width_bytes);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key,
+  const uint8_t value) {
+
+  return dict_write_int(iter, key, &value, sizeof(value), false);
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key,
+  const uint16_t value) {
+
+  return dict_write_int(iter, key, &value, sizeof(value), false);
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key,
+  const uint32_t value) {
+
+  return dict_write_int(iter, key, &value, sizeof(value), false);
+}
+
+DictionaryResult dict_write_tuplet(DictionaryIterator *iter, const Tuplet *const tuplet) {
+  switch (tuplet->type) {
+    case TUPLE_BYTE_ARRAY:
+      return dict_write_data(iter, tuplet->key, tuplet->bytes.data, tuplet->bytes.length);
+    case TUPLE_CSTRING:
+      return host_dict_write(iter, tuplet->key, TUPLE_CSTRING,
+        tuplet->cstring.data, tuplet->cstring.length);
+    case TUPLE_UINT:
+    case TUPLE_INT: {
+      uint8_t width = (uint8_t)tuplet->integer.width;
+      uint32_t storage = tuplet->integer.storage;
+      return dict_write_int(iter, tuplet->key, &storage, width, tuplet->type == TUPLE_INT);
+    }
+  }
+  return DICT_INVALID_ARGS;
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter) {
+  iter->end = (uint8_t *)iter->cursor;
+  return (uint32_t)(iter->end - iter->dictionary);
+}
+
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t *const buffer,
+  const uint16_t size) {
+
+  iter->dictionary = (uint8_t *)buffer;
+  iter->end = buffer + size;
+  return dict_read_first(iter);
+}
+
+static Tuple *host_dict_tuple_at(const DictionaryIterator *iter, uint8_t *cursor) {
+  if (cursor + HOST_TUPLE_HEADER_SIZE > iter->end) {
+    return NULL;
+  }
+  Tuple *tuple = (Tuple *)cursor;
+  if (cursor + HOST_TUPLE_HEADER_SIZE + tuple->length > iter->end) {
+    return NULL;
+  }
+  return tuple;
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+  if (iter->dictionary[0] == 0) {
+    iter->cursor = NULL;
+    return NULL;
+  }
+  iter->cursor = host_dict_tuple_at(iter, iter->dictionary + 1);
+  return iter->cursor;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+  if (iter->cursor == NULL) {
+    return NULL;
+  }
+  uint8_t *next = (uint8_t *)iter->cursor + HOST_TUPLE_HEADER_SIZE + iter->cursor->length;
+  iter->cursor = host_dict_tuple_at(iter, next);
+  return iter->cursor;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  DictionaryIterator copy = *iter;
+  for (Tuple *tuple = dict_read_first(&copy); tuple != NULL; tuple = dict_read_next(&copy)) {
+    if (tuple->key == key) {
+      return tuple;
+    }
+  }
+  return NULL;
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* AppMessage                                                               */
+/* ------------------------------------------------------------------------ */
+
+AppMessageInboxReceived app_message_register_inbox_received(
+  AppMessageInboxReceived received_callback) {
+
+  AppMessageInboxReceived previous = s_host.inbox_received;
+  s_host.inbox_received = received_callback;
+  return previous;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(
+  AppMessageInboxDropped dropped_callback) {
+
+  AppMessageInboxDropped previous = s_host.inbox_dropped;
+  s_host.inbox_dropped = dropped_callback;
+  return previous;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+  AppMessageOutboxSent previous = s_host.outbox_sent;
+  s_host.outbox_sent = sent_callback;
+  return previous;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(
+  AppMessageOutboxFailed failed_callback) {
+
+  AppMessageOutboxFailed previous = s_host.outbox_failed;
+  s_host.outbox_failed = failed_callback;
+  return previous;
+}
+
+uint32_t app_message_inbox_size_maximum(void) {
+  return s_host.inbox_size_maximum;
+}
+
+uint32_t app_message_outbox_size_maximum(void) {
+  return HOST_MESSAGE_SIZE_MAXIMUM;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  if (s_host.inbox != NULL) {
+    return APP_MSG_INVALID_STATE;
+  }
+  s_host.counters.app_message_opens++;
+  if (size_inbound > s_host.inbox_size_maximum || size_outbound > HOST_MESSAGE_SIZE_MAXIMUM) {
+    return APP_MSG_OUT_OF_MEMORY;
+  }
+  s_host.inbox_size = size_inbound;
+  s_host.outbox_size = size_outbound;
+  s_host.inbox = malloc(size_inbound);
+  s_host.outbox = malloc(size_outbound);
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  if (s_host.outbox == NULL) {
+    return APP_MSG_INVALID_STATE;
+  }
+  if (s_host.is_outbox_in_flight) {
+    return APP_MSG_BUSY;
+  }
+  dict_write_begin(&s_host.outbox_iter, s_host.outbox, (uint16_t)s_host.outbox_size);
+  s_host.is_outbox_open = true;
+  *iterator = &s_host.outbox_iter;
+  return APP_MSG_OK;
+}
+
+static void host_outbox_result(void *context) {
+  s_host.is_outbox_in_flight = false;
+
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, s_host.outbox, s_host.outbox_in_flight_size);
+
+  host_wakeup();
+  if (s_host.is_connected) {
+    if (s_host.outbox_sent != NULL) {
+      s_host.outbox_sent(&iter, NULL);
+    }
+  } else {
+    s_host.counters.msgs_out_failed++;
+    if (s_host.outbox_failed != NULL) {
+      s_host.outbox_failed(&iter, APP_MSG_NOT_CONNECTED, NULL);
+    }
+  }
+  host_render();
+}
+
+static void host_outbox_deliver(void *context) {
+  if (s_host.is_connected && s_host.outbox_handler != NULL) {
+    s_host.outbox_handler(s_host.outbox, s_host.outbox_in_flight_size,
+      s_host.outbox_handler_context);
+  }
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  if (!s_host.is_outbox_open) {
+    return APP_MSG_INVALID_STATE;
+  }
+  s_host.is_outbox_open = false;
+  s_host.is_outbox_in_flight = true;
+  s_host.outbox_in_flight_size = (uint16_t)((uint8_t *)s_host.outbox_iter.cursor
+    - s_host.outbox_iter.dictionary);
+
+  s_host.counters.msgs_out++;
+  s_host.counters.bytes_out += s_host.outbox_in_flight_size;
+
+  host_schedule(s_host.link_latency_ms, host_outbox_deliver, NULL);
+  host_schedule(2 * s_host.link_latency_ms, host_outbox_result, NULL);
+  return APP_MSG_OK;
+}
+
+void host_set_link_latency_ms(uint32_t latency_ms) {
+  if (!s_is_initialized) {
+    host_init_defaults();
+  }
+  s_host.link_latency_ms = latency_ms;
+}
+
+void host_set_outbox_handler(HostOutboxHandler handler, void *context) {
+  s_host.outbox_handler = handler;
+  s_host.outbox_handler_context = context;
+}
+
+void host_set_inbox_size_maximum(uint32_t size) {
+  if (!s_is_initialized) {
+    host_init_defaults();
+  }
+  s_host.inbox_size_maximum = size < HOST_MESSAGE_SIZE_MAXIMUM ? size : HOST_MESSAGE_SIZE_MAXIMUM;
+}
+
+void host_set_inbox_processing_ms(uint32_t processing_ms) {
+  s_host.inbox_processing_ms = processing_ms;
+}
+
+void host_set_inbox_result_handler(HostInboxResultHandler handler, void *context) {
+  s_host.inbox_result_handler = handler;
+  s_host.inbox_result_handler_context = context;
+}
+
+static HostMessage *host_message_create(const uint8_t *data, uint16_t size) {
+  HostMessage *message = malloc(sizeof(HostMessage) + size);
+  message->result = APP_MSG_OK;
+  message->size = size;
+  memcpy(message->data, data, size);
+  return message;
+}
+
+static void host_inbox_receive(const uint8_t *data, uint16_t size) {
+  host_wakeup();
+  memcpy(s_host.inbox, data, size);
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, s_host.inbox, size);
+  if (s_host.inbox_received != NULL) {
+    s_host.inbox_received(&iter, NULL);
+  }
+  host_render();
+}
+
+static void host_inbox_dequeue(void *context) {
+  HostMessage *message = context;
+  s_host.inbox_queued_bytes -= message->size;
+  host_inbox_receive(message->data, message->size);
+  free(message);
+}
+
+bool host_deliver_inbox(const uint8_t *data, uint16_t size) {
+  return host_deliver_inbox_result(data, size) == APP_MSG_OK;
+}
+
+AppMessageResult host_deliver_inbox_result(const uint8_t *data, uint16_t size) {
+  s_host.counters.msgs_in++;
+  s_host.counters.bytes_in += size;
+
+  AppMessageResult result = APP_MSG_OK;
+  if (s_host.inbox == NULL) {
+    result = APP_MSG_INVALID_STATE;
+  } else if (size > s_host.inbox_size) {
+    result = APP_MSG_BUFFER_OVERFLOW;
+  } else if (s_host.inbox_queued_bytes + size > s_host.inbox_size) {
+    result = APP_MSG_BUSY;
+  }
+
+  if (result != APP_MSG_OK) {
+    host_wakeup();
+    s_host.counters.msgs_in_dropped++;
+    if (s_host.inbox_dropped != NULL) {
+      s_host.inbox_dropped(result, NULL);
+    }
+    host_render();
+    return result;
+  }
+
+  if (s_host.inbox_processing_ms == 0) {
+    host_inbox_receive(data, size);
+    return APP_MSG_OK;
+  }
+
+  // Queued until the app is done with the messages before it.
+  if (s_host.inbox_busy_until_ms < s_host.now_ms) {
+    s_host.inbox_busy_until_ms = s_host.now_ms;
+  }
+  s_host.inbox_busy_until_ms += s_host.inbox_processing_ms;
+  s_host.inbox_queued_bytes += size;
+  host_schedule((uint32_t)(s_host.inbox_busy_until_ms - s_host.now_ms), host_inbox_dequeue,
+    host_message_create(data, size));
+  return APP_MSG_OK;
+}
+
+static void host_inbox_result(void *context) {
+  HostMessage *message = context;
+  if (s_host.inbox_result_handler != NULL) {
+    s_host.inbox_result_handler(message->result, message->data, message->size,
+      s_host.inbox_result_handler_context);
+  }
+  free(message);
+}
+
+static void host_inbox_delivery(void *context) {
+  HostMessage *message = context;
+  if (s_host.is_connected) {
+    message->result = host_deliver_inbox_result(message->data, message->size);
+  } else {
+    message->result = APP_MSG_NOT_CONNECTED;
+  }
+  // Acknowledged (or not) back to the phone after the link latency.
+  host_schedule(s_host.link_latency_ms, host_inbox_result, message);
+}
+
+void host_send_to_watch(const uint8_t *data, uint16_t size) {
+  host_schedule(s_host.link_latency_ms, host_inbox_delivery, host_message_create(data, size));
+}
+
+
+/* ------------------------------------------------------------------------ */
+/* Event services                                                           */
+/* ------------------------------------------------------------------------ */
+
+bool connection_service_peek_pebble_app_connection(void) {
+  return s_host.is_connected;
+}
+
+void connection_service_subscribe(ConnectionHandlers conn_handlers) {
+  s_host.connection_handler = conn_handlers.pebble_app_connection_handler;
+}
+
+void connection_service_unsubscribe(void) {
+  s_host.connection_handler = NULL;
+}
+
+void host_set_connected(bool connected) {
+  if (s_host.is_connected == connected) {
+    return;
+  }
+  s_host.is_connected = connected;
+  if (s_host.connection_handler != NULL) {
+    host_wakeup();
+    s_host.counters.service_events++;
+    s_host.connection_handler(connected);
+    host_render();
+  }
+}
+
+BatteryChargeState battery_state_service_peek(void) {
+  return s_host.battery;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+  s_host.battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+  s_host.battery_handler = NULL;
+}
+
+void host_set_battery(uint8_t charge_percent, bool is_charging) {
+  s_host.battery = (BatteryChargeState) {
+    .charge_percent = charge_percent,
+    .is_charging = is_charging,
+    .is_plugged = is_charging
+  };
+  if (s_host.battery_handler != NULL) {
+    host_wakeup();
+    s_host.counters.service_events++;
+    s_host.battery_handler(s_host.battery);
+    host_render();
+  }
+}
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+  s_host.tick_units = tick_units;
+  s_host.tick_handler = handler;
+}
+
+void tick_timer_service_unsubscribe(void) {
+  s_host.tick_handler = NULL;
+  s_host.tick_units = 0;
+}
@@ -0,0 +1,645 @@
+/**
+ * Author: Marek Jankech
+ */
+
+/**
+ * Trace capture and replay.
+ *
+ * With --capture, a scripted session is played and its trace written to
+ * FILE, as the phone would get it with EXPORT_TRACE: a stand-in phone
+ * answers the HELLO and takes the score, points are scored, the score
+ * swapped, the Score Counter moved in the setting mode, the phone sets the
+ * score and the link drops for a moment.
+ *
+ * Otherwise the trace in FILE is replayed: the app is launched at the
+ * oldest checkpoint left in the trace, on the storage, link and battery the
+ * checkpoint holds, and the recorded clicks, inbound messages, link and
+ * battery changes are made again at the recorded times. Reported is the
+ * work each kind of input led to, until the next input: wakeups, render
+ * passes, layer redraws, flash writes and messages sent. The replayed app
+ * is then asked for its own trace, which has to match the recorded one from
+ * the checkpoint on, the checkpoints aside; the exit status is 1 when not.
+ * The link to the phone is negotiated anew by the replayed app, so when the
+ * trace no longer starts at the launch of the app, the messages sent are
+ * left out of the comparison.
+ *
+ * Usage: trace_replay --capture FILE [--points N] [--verbose]
+ *        trace_replay [--csv] [--verbose] FILE
+ */
+
+#include <getopt.h>
+#include "host.h"
+#include "protocol.h"
+#include "trace_recorder.h"
+
+
+#define SETTLE_MS 5000
+#define PHONE_INBOX_SIZE 512
+/**
+ * Large enough for the export of the largest ring of any platform.
+ */
+#define TRACE_FILE_MAX_SIZE (TRACE_EXPORT_HEADER_SIZE + 4096 + TRACE_EXPORT_ITEM_SIZE)
+#define TRACE_MAX_RECORDS (4096 / TRACE_RECORD_HEADER_SIZE)
+
+typedef struct {
+  uint32_t ms;
+  uint8_t type;
+  uint8_t arg;
+  uint16_t size;
+  const uint8_t *payload;
+} Record;
+
+typedef struct {
+  uint8_t data[TRACE_FILE_MAX_SIZE];
+  uint32_t size;
+  uint16_t overwritten;
+  int64_t start_ms;
+  Record records[TRACE_MAX_RECORDS];
+  uint16_t count;
+} Trace;
+
+typedef struct {
+  uint32_t inputs;
+  HostCounters work;
+} Profile;
+
+typedef struct {
+  const Trace *input;
+  Trace output;
+  uint16_t checkpoint;
+  uint32_t skipped;
+  Profile profiles[TRACE_TYPE_COUNT];
+  int last_type;
+  HostCounters last_counters;
+} Replay;
+
+typedef struct {
+  uint16_t points;
+  Trace trace;
+} Capture;
+
+static const char *type_names[TRACE_TYPE_COUNT] = {
+  [TRACE_END] = "end",
+  [TRACE_CHECKPOINT] = "checkpoint",
+  [TRACE_CLICK] = "click",
+  [TRACE_MODE] = "mode",
+  [TRACE_INBOX] = "inbox",
+  [TRACE_INBOX_DROPPED] = "inbox_dropped",
+  [TRACE_OUTBOX_SENT] = "outbox_sent",
+  [TRACE_OUTBOX_FAILED] = "outbox_failed",
+  [TRACE_CONNECTION] = "connection",
+  [TRACE_BATTERY] = "battery",
+};
+
+/**
+ * Exported items are appended as they come, the score events logged in
+ * their own session are left out.
+ */
+static void collect_trace(uint32_t tag, const uint8_t *data, uint32_t num_items,
+  uint16_t item_length, void *context) {
+
+  Trace *trace = context;
+  uint32_t size = num_items * item_length;
+
+  if (tag != DATA_LOG_TRACE_TAG) {
+    return;
+  }
+  if (trace->size + size > sizeof(trace->data)) {
+    size = sizeof(trace->data) - trace->size;
+  }
+  memcpy(trace->data + trace->size, data, size);
+  trace->size += size;
+}
+
+static uint16_t read_u16(const uint8_t *buff) {
+  return (uint16_t)(buff[0] | buff[1] << 8);
+}
+
+/**
+ * Split the export into records, false when it is no trace.
+ */
+static bool parse_trace(Trace *trace) {
+  const uint8_t *data = trace->data;
+
+  if (trace->size < TRACE_EXPORT_HEADER_SIZE || memcmp(data, TRACE_MAGIC, 4) != 0) {
+    fprintf(stderr, "Not a trace\n");
+    return false;
+  }
+  if (data[4] != TRACE_FORMAT_VERSION) {
+    fprintf(stderr, "Trace format %u, expected %u\n", data[4], TRACE_FORMAT_VERSION);
+    return false;
+  }
+
+  trace->overwritten = read_u16(data + 6);
+  trace->start_ms = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    trace->start_ms |= (int64_t)data[8 + i] << (8 * i);
+  }
+
+  trace->count = 0;
+  uint32_t offset = TRACE_EXPORT_HEADER_SIZE;
+  while (offset + TRACE_RECORD_HEADER_SIZE <= trace->size) {
+    Record *record = &trace->records[trace->count];
+    record->ms = (uint32_t)data[offset] | (uint32_t)data[offset + 1] << 8
+      | (uint32_t)data[offset + 2] << 16 | (uint32_t)data[offset + 3] << 24;
+    record->type = data[offset + 4];
+    record->arg = data[offset + 5];
+    record->size = read_u16(data + offset + 6);
+    record->payload = data + offset + TRACE_RECORD_HEADER_SIZE;
+
+    if (record->type == TRACE_END) {
+      break;
+    }
+    if (record->type >= TRACE_TYPE_COUNT || trace->count == TRACE_MAX_RECORDS
+      || offset + TRACE_RECORD_HEADER_SIZE + record->size > trace->size) {
+
+      fprintf(stderr, "Corrupt record at byte %u\n", offset);
+      return false;
+    }
+    trace->count++;
+    offset += TRACE_RECORD_HEADER_SIZE + record->size;
+  }
+
+  return true;
+}
+
+static bool is_input(uint8_t type) {
+  return type == TRACE_CLICK || type == TRACE_INBOX || type == TRACE_INBOX_DROPPED
+    || type == TRACE_CONNECTION || type == TRACE_BATTERY;
+}
+
+/**
+ * The phone asking for the trace, not part of the session traced.
+ */
+static bool is_export_request(const Record *record) {
+  if (record->type != TRACE_INBOX) {
+    return false;
+  }
+
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, record->payload, record->size);
+  Tuple *cmd_tuple = dict_find(&iter, RECEIVE_CMD_KEY);
+
+  return cmd_tuple != NULL && cmd_tuple->value->uint8 == RECEIVE_CMD_EXPORT_TRACE;
+}
+
+static int find_checkpoint(const Trace *trace) {
+  for (uint16_t i = 0; i < trace->count; i++) {
+    if (trace->records[i].type == TRACE_CHECKPOINT) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static void send_export_request(bool is_over_link) {
+  DictionaryIterator iter;
+  uint8_t buff[16];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_EXPORT_TRACE);
+
+  if (is_over_link) {
+    host_send_to_watch(buff, dict_write_end(&iter));
+  } else {
+    host_deliver_inbox(buff, dict_write_end(&iter));
+  }
+}
+
+static void advance_to(int64_t ms) {
+  int64_t delay_ms = ms - host_now_ms();
+
+  host_advance(delay_ms > 0 ? (uint32_t)delay_ms : 0);
+}
+
+/**
+ * Capture
+ */
+
+static void phone_send_hello() {
+  DictionaryIterator iter;
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_HELLO);
+  dict_write_uint8(&iter, RECEIVE_HELLO_VERSION_KEY, PROTOCOL_VERSION);
+  dict_write_uint32(&iter, RECEIVE_HELLO_COMMANDS_KEY, (1 << RECEIVE_CMD_SET_SCORE_VAL)
+    | (1 << RECEIVE_CMD_HELLO) | (1 << RECEIVE_CMD_EXPORT_TRACE));
+  dict_write_uint16(&iter, RECEIVE_HELLO_INBOX_SIZE_KEY, PHONE_INBOX_SIZE);
+  dict_write_uint32(&iter, RECEIVE_HELLO_FEATURES_KEY,
+    PROTOCOL_FEATURE_PACKED_SCORE | PROTOCOL_FEATURE_TRACE);
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+static void phone_send_score(uint16_t score_1, uint16_t score_2) {
+  int64_t now_ms = host_now_ms();
+
+  DictionaryIterator iter;
+  uint8_t buff[64];
+  dict_write_begin(&iter, buff, sizeof(buff));
+  dict_write_uint8(&iter, RECEIVE_CMD_KEY, RECEIVE_CMD_SET_SCORE_VAL);
+  dict_write_uint16(&iter, RECEIVE_SCORE_1_KEY, score_1);
+  dict_write_uint16(&iter, RECEIVE_SCORE_2_KEY, score_2);
+  dict_write_uint32(&iter, RECEIVE_TIMESTAMP_KEY, (uint32_t)(now_ms / 1000));
+  dict_write_uint16(&iter, RECEIVE_TIMESTAMP_MS_KEY, (uint16_t)(now_ms % 1000));
+  host_send_to_watch(buff, dict_write_end(&iter));
+}
+
+static void phone_outbox_handler(const uint8_t *data, uint16_t size, void *context) {
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, data, size);
+
+  Tuple *cmd_tuple = dict_find(&iter, SEND_CMD_KEY);
+  if (cmd_tuple != NULL && cmd_tuple->value->uint8 == SEND_CMD_HELLO) {
+    phone_send_hello();
+  }
+}
+
+static void run_capture(void *context) {
+  Capture *capture = context;
+
+  host_advance(SETTLE_MS);
+  for (uint16_t i = 0; i < capture->points; i++) {
+    host_click(i % 3 == 2 ? BUTTON_ID_DOWN : BUTTON_ID_UP);
+    host_advance(3000);
+  }
+  host_long_click(BUTTON_ID_UP);
+  host_advance(1000);
+  host_multi_click(BUTTON_ID_SELECT, 2);
+  host_advance(1000);
+
+  host_long_click(BUTTON_ID_SELECT);
+  host_click(BUTTON_ID_DOWN);
+  host_click(BUTTON_ID_SELECT);
+  host_advance(SETTLE_MS);
+
+  host_set_battery(70, false);
+  phone_send_score(capture->points / 2 + 1, capture->points / 3);
+  host_advance(SETTLE_MS);
+
+  host_set_connected(false);
+  host_advance(2000);
+  host_click(BUTTON_ID_UP);
+  host_advance(2000);
+  host_set_connected(true);
+  host_advance(SETTLE_MS);
+
+  send_export_request(true);
+  host_advance(SETTLE_MS);
+}
+
+static int capture_trace(const char *path, Capture *capture) {
+  host_set_outbox_handler(phone_outbox_handler, NULL);
+  host_set_data_logging_handler(collect_trace, &capture->trace);
+  host_run_app(run_capture, capture);
+
+  if (!parse_trace(&capture->trace)) {
+    return 1;
+  }
+
+  FILE *file = fopen(path, "wb");
+  if (file == NULL || fwrite(capture->trace.data, 1, capture->trace.size, file)
+    != capture->trace.size) {
+
+    fprintf(stderr, "Cannot write %s\n", path);
+    if (file != NULL) {
+      fclose(file);
+    }
+    return 1;
+  }
+  fclose(file);
+
+  printf("Captured %u records (%u B) to %s\n", capture->trace.count, capture->trace.size,
+    path);
+
+  return 0;
+}
+
+/**
+ * Replay
+ */
+
+static void add_work(HostCounters *total, const HostCounters *from, const HostCounters *to) {
+  total->wakeups += to->wakeups - from->wakeups;
+  total->render_passes += to->render_passes - from->render_passes;
+  total->layer_redraws += to->layer_redraws - from->layer_redraws;
+  total->flash_writes += to->flash_writes - from->flash_writes;
+  total->msgs_out += to->msgs_out - from->msgs_out;
+}
+
+/**
+ * The work since the last input goes to it.
+ */
+static void close_input(Replay *replay) {
+  if (replay->last_type >= 0) {
+    add_work(&replay->profiles[replay->last_type].work, &replay->last_counters,
+      host_counters());
+  }
+  replay->last_counters = *host_counters();
+}
+
+static bool replay_input(const Record *record) {
+  switch (record->type) {
+    case TRACE_CLICK: {
+      ButtonId button_id = TRACE_CLICK_BUTTON(record->arg);
+
+      switch (TRACE_CLICK_KIND(record->arg)) {
+        case TRACE_CLICK_LONG:
+          host_long_click(button_id);
+          break;
+        default:
+          host_click(button_id);
+          break;
+      }
+      return true;
+    }
+    case TRACE_INBOX:
+      host_deliver_inbox(record->payload, record->size);
+      return true;
+    case TRACE_CONNECTION:
+      host_set_connected(record->arg != 0);
+      return true;
+    case TRACE_BATTERY:
+      host_set_battery(record->arg & 0x7F, (record->arg & 0x80) != 0);
+      return true;
+    default:
+      // A dropped message is gone, there is nothing to deliver again.
+      return false;
+  }
+}
+
+static void run_replay(void *context) {
+  Replay *replay = context;
+  const Trace *trace = replay->input;
+
+  replay->last_type = -1;
+  replay->last_counters = *host_counters();
+
+  for (uint16_t i = replay->checkpoint + 1; i < trace->count; i++) {
+    const Record *record = &trace->records[i];
+
+    if (!is_input(record->type) || is_export_request(record)) {
+      continue;
+    }
+
+    advance_to(trace->start_ms + record->ms);
+    close_input(replay);
+    if (replay_input(record)) {
+      replay->profiles[record->type].inputs++;
+      replay->last_type = record->type;
+    } else {
+      replay->skipped++;
+      replay->last_type = -1;
+    }
+  }
+
+  host_advance(SETTLE_MS);
+  close_input(replay);
+
+  send_export_request(false);
+  host_advance(SETTLE_MS);
+}
+
+/**
+ * Storage, link and battery as in the checkpoint.
+ */
+static void restore_checkpoint(const Record *checkpoint) {
+  const uint8_t *payload = checkpoint->payload;
+  uint16_t offset = 1;
+
+  host_set_battery(payload[0], (checkpoint->arg & TRACE_CHECKPOINT_CHARGING) != 0);
+  host_set_connected((checkpoint->arg & TRACE_CHECKPOINT_CONNECTED) != 0);
+
+  while (offset + 2 <= checkpoint->size) {
+    uint8_t key = payload[offset];
+    uint8_t size = payload[offset + 1];
+
+    persist_write_data(key, payload + offset + 2, size);
+    offset += 2 + size;
+  }
+}
+
+static bool is_link_result(uint8_t type) {
+  return type == TRACE_OUTBOX_SENT || type == TRACE_OUTBOX_FAILED;
+}
+
+/**
+ * Records to compare, from the wall clock time on: the checkpoints and the
+ * export request left out.
+ */
+static uint16_t comparable_records(const Trace *trace, int64_t from_ms, bool is_link_compared,
+  const Record **records) {
+
+  uint16_t count = 0;
+
+  for (uint16_t i = 0; i < trace->count; i++) {
+    const Record *record = &trace->records[i];
+
+    if (trace->start_ms + record->ms < from_ms || record->type == TRACE_CHECKPOINT
+      || is_export_request(record) || (!is_link_compared && is_link_result(record->type))) {
+      continue;
+    }
+    records[count++] = record;
+  }
+
+  return count;
+}
+
+static bool is_same_record(const Trace *trace_a, const Record *a, const Trace *trace_b,
+  const Record *b) {
+
+  return trace_a->start_ms + a->ms == trace_b->start_ms + b->ms && a->type == b->type
+    && a->arg == b->arg && a->size == b->size && memcmp(a->payload, b->payload, a->size) == 0;
+}
+
+static void print_record(const char *label, const Trace *trace, const Record *record) {
+  if (record == NULL) {
+    printf("  %-9s none\n", label);
+    return;
+  }
+  printf("  %-9s at %lld ms: %s, arg %u, %u B\n", label,
+    (long long)(trace->start_ms + record->ms), type_names[record->type], record->arg,
+    record->size);
+}
+
+/**
+ * Nothing overwritten, the first checkpoint is the one written at launch.
+ */
+static bool is_from_launch(const Trace *trace) {
+  return trace->overwritten == 0;
+}
+
+/**
+ * Return the index of the first record the replay did differently, -1 when
+ * it did all of them the same.
+ */
+static int compare_traces(const Replay *replay, const Record **recorded, uint16_t *recorded_count,
+  const Record **replayed, uint16_t *replayed_count) {
+
+  const Trace *input = replay->input;
+  const Trace *output = &replay->output;
+  int output_checkpoint = find_checkpoint(output);
+  int64_t from_ms = input->start_ms + input->records[replay->checkpoint].ms;
+
+  if (output_checkpoint >= 0) {
+    int64_t output_from_ms = output->start_ms + output->records[output_checkpoint].ms;
+    if (output_from_ms > from_ms) {
+      // The replay wrapped its own ring, compare what it still has.
+      from_ms = output_from_ms;
+    }
+  }
+
+  *recorded_count = comparable_records(input, from_ms, is_from_launch(input), recorded);
+  *replayed_count = comparable_records(output, from_ms, is_from_launch(input), replayed);
+
+  uint16_t count = *recorded_count < *replayed_count ? *recorded_count : *replayed_count;
+  for (uint16_t i = 0; i < count; i++) {
+    if (!is_same_record(input, recorded[i], output, replayed[i])) {
+      return i;
+    }
+  }
+
+  return *recorded_count == *replayed_count ? -1 : count;
+}
+
+static void print_report(const Replay *replay, int mismatch, const Record **recorded,
+  uint16_t recorded_count, const Record **replayed, uint16_t replayed_count, bool is_csv) {
+
+  const Trace *input = replay->input;
+  Profile total = { 0 };
+
+  for (int type = 0; type < TRACE_TYPE_COUNT; type++) {
+    const Profile *profile = &replay->profiles[type];
+    HostCounters none = { 0 };
+    total.inputs += profile->inputs;
+    add_work(&total.work, &none, &profile->work);
+  }
+
+  if (is_csv) {
+    printf("type,inputs,wakeups,render_passes,layer_redraws,flash_writes,msgs_out\n");
+  } else {
+    printf("Trace: %u records, %u overwritten before the export, replayed from %u ms\n",
+      input->count, input->overwritten, input->records[replay->checkpoint].ms);
+    printf("Inputs: %u replayed, %u not replayable\n\n", total.inputs, replay->skipped);
+    printf("%-12s %7s %8s %8s %8s %8s %8s\n", "input", "count", "wakeups", "renders",
+      "redraws", "flash_wr", "msgs_out");
+  }
+
+  for (int type = 0; type <= TRACE_TYPE_COUNT; type++) {
+    const Profile *profile = type < TRACE_TYPE_COUNT ? &replay->profiles[type] : &total;
+    const char *name = type < TRACE_TYPE_COUNT ? type_names[type] : "all";
+    const HostCounters *work = &profile->work;
+
+    if (profile->inputs == 0) {
+      continue;
+    }
+    printf(is_csv ? "%s,%u,%u,%u,%u,%u,%u\n" : "%-12s %7u %8u %8u %8u %8u %8u\n", name,
+      profile->inputs, work->wakeups, work->render_passes, work->layer_redraws,
+      work->flash_writes, work->msgs_out);
+  }
+
+  if (is_csv) {
+    return;
+  }
+
+  if (mismatch < 0) {
+    printf("\nReplay: deterministic, %u records the same%s\n", recorded_count,
+      is_from_launch(input) ? "" : " (messages sent not compared)");
+    return;
+  }
+  printf("\nReplay: diverged at record %d of %u\n", mismatch, recorded_count);
+  print_record("recorded", input, mismatch < recorded_count ? recorded[mismatch] : NULL);
+  print_record("replayed", &replay->output,
+    mismatch < replayed_count ? replayed[mismatch] : NULL);
+}
+
+static int replay_trace(const char *path, Replay *replay, Trace *input, bool is_csv) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot read %s\n", path);
+    return 2;
+  }
+  input->size = (uint32_t)fread(input->data, 1, sizeof(input->data), file);
+  fclose(file);
+
+  if (!parse_trace(input)) {
+    return 2;
+  }
+
+  int checkpoint = find_checkpoint(input);
+  if (checkpoint < 0) {
+    fprintf(stderr, "No checkpoint left in the trace to replay from\n");
+    return 2;
+  }
+  replay->input = input;
+  replay->checkpoint = (uint16_t)checkpoint;
+
+  // The app launches where the checkpoint was written.
+  int64_t launch_ms = input->start_ms + input->records[checkpoint].ms;
+  host_set_time((time_t)(launch_ms / 1000), (uint16_t)(launch_ms % 1000));
+  restore_checkpoint(&input->records[checkpoint]);
+  host_set_data_logging_handler(collect_trace, &replay->output);
+  host_run_app(run_replay, replay);
+
+  if (!parse_trace(&replay->output)) {
+    return 1;
+  }
+
+  static const Record *recorded[TRACE_MAX_RECORDS];
+  static const Record *replayed[TRACE_MAX_RECORDS];
+  uint16_t recorded_count;
+  uint16_t replayed_count;
+  int mismatch = compare_traces(replay, recorded, &recorded_count, replayed, &replayed_count);
+
+  print_report(replay, mismatch, recorded, recorded_count, replayed, replayed_count, is_csv);
+
+  return mismatch < 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+  static Capture capture = { .points = 12 };
+  static Trace input;
+  static Replay replay;
+  const char *capture_path = NULL;
+  bool is_csv = false;
+
+  static const struct option options[] = {
+    { "capture", required_argument, NULL, 'c' },
+    { "points", required_argument, NULL, 'p' },
+    { "csv", no_argument, NULL, 'x' },
+    { "verbose", no_argument, NULL, 'v' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "c:p:xv", options, NULL)) != -1) {
+    switch (opt) {
+      case 'c':
+        capture_path = optarg;
+        break;
+      case 'p':
+        capture.points = (uint16_t)atoi(optarg);
+        break;
+      case 'x':
+        is_csv = true;
+        break;
+      case 'v':
+        host_set_log_level(APP_LOG_LEVEL_DEBUG_VERBOSE);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s --capture FILE [--points N] [--verbose]\n"
+          "       %s [--csv] [--verbose] FILE\n", argv[0], argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - (capture_path == NULL ? 1 : 0)) {
+    fprintf(stderr, "Usage: %s --capture FILE [--points N] [--verbose]\n"
+      "       %s [--csv] [--verbose] FILE\n", argv[0], argv[0]);
+    return 2;
+  }
+
+  if (capture_path != NULL) {
+    return capture_trace(capture_path, &capture);
+  }
+
+  return replay_trace(argv[optind], &replay, &input, is_csv);
+}